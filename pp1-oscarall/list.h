@@ -2,10 +2,13 @@
  * ------------
  * Simple list class for storing a linear collection of elements. It
  * supports operations similar in name to the CS107 DArray -- nth, insert,
- * append, remove, etc.  This class is nothing more than a very thin
- * cover of a STL deque, with some added range-checking. Given not everyone
- * is familiar with the C++ templates, this class provides a more familiar
- * interface.
+ * append, remove, etc.  Elements are stored contiguously in a small-vector:
+ * the first few live inline in the List object itself and only longer
+ * lists move to a heap array that doubles as it grows. Most lists in the
+ * parse tree (formals, actuals, implements) hold 0-3 elements, so they
+ * never allocate beyond the List itself. Index checks use Assert(), which
+ * compiles out when NDEBUG is defined. Given not everyone is familiar
+ * with the C++ templates, this class provides a more familiar interface.
  *
  * It can handle elements of any type, the typename for a List includes the
  * element type in angle brackets, e.g.  to store elements of type double,
@@ -23,27 +26,61 @@
  *       }
  *       return sum;
  *    }
+ *
+ * The list can also be walked with a range-based for loop, which simply
+ * steps a pointer over the elements:
+ *
+ *   for (int val : *list) sum += val;
  */
 
 #ifndef _H_list
 #define _H_list
 
-#include <deque>
 #include "utility.h"  // for Assert()
   
 
 template<class Element> class List {
 
  private:
-    std::deque<Element> elems;
+    static const int InlineCapacity = 4;
+
+    Element *elems;          // points to inlineElems until list outgrows it
+    int numElems, capacity;
+    Element inlineElems[InlineCapacity];
+
+    bool IsInline() const
+	{ return elems == inlineElems; }
+
+    void Reserve(int needed)
+	{ if (needed <= capacity) return;
+	  while (capacity < needed) capacity *= 2;
+	  Element *grown = new Element[capacity];
+	  for (int i = 0; i < numElems; i++) grown[i] = elems[i];
+	  if (!IsInline()) delete[] elems;
+	  elems = grown; }
 
  public:
            // Create a new empty list
-    List() {}
+    List() : elems(inlineElems), numElems(0), capacity(InlineCapacity) {}
+
+    List(const List &other)
+	: elems(inlineElems), numElems(0), capacity(InlineCapacity)
+	{ *this = other; }
+
+    List &operator=(const List &other)
+	{ if (this == &other) return *this;
+	  numElems = 0;
+	  Reserve(other.numElems);
+	  for (int i = 0; i < other.numElems; i++) elems[i] = other.elems[i];
+	  numElems = other.numElems;
+	  return *this; }
+
+    ~List()
+	{ if (!IsInline()) delete[] elems; }
 
            // Returns count of elements currently in list
     int NumElements() const
-	{ return elems.size(); }
+	{ return numElems; }
 
           // Returns element at index in list. Indexing is 0-based.
           // Raises an assert if index is out of range.
@@ -55,17 +92,30 @@ template<class Element> class List {
           // Raises assert if index out of range
     void InsertAt(const Element &elem, int index)
 	{ Assert(index >= 0 && index <= NumElements());
-	  elems.insert(elems.begin() + index, elem); }
+	  Element copy = elem; // elem may live in the array Reserve frees
+	  Reserve(numElems + 1);
+	  for (int i = numElems; i > index; i--) elems[i] = elems[i-1];
+	  elems[index] = copy;
+	  numElems++; }
 
           // Adds element to list end
     void Append(const Element &elem)
-	{ elems.push_back(elem); }
+	{ Element copy = elem;
+	  Reserve(numElems + 1);
+	  elems[numElems++] = copy; }
 
          // Removes element at index, shuffling down others
          // Raises assert if index out of range
     void RemoveAt(int index)
 	{ Assert(index >= 0 && index < NumElements());
-	  elems.erase(elems.begin() + index); }
+	  for (int i = index; i < numElems - 1; i++) elems[i] = elems[i+1];
+	  numElems--; }
+
+          // Iteration support for range-based for loops
+    Element *begin()             { return elems; }
+    Element *end()               { return elems + numElems; }
+    const Element *begin() const { return elems; }
+    const Element *end() const   { return elems + numElems; }
           
 
 };
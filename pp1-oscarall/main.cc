@@ -10,6 +10,7 @@
 #include "errors.h"
 #include "scanner.h"
 #include "location.h"
+#include "tokenstream.h"
 
 /* Function: PrintOneToken()
  * Usage: PrintOneToken(T_Double, "3.5", val, loc);
@@ -55,8 +56,10 @@ static void PrintOneToken(TokenType token, const char *text, YYSTYPE value,
  * (This is somewhat unusual -- ordinarily lex would just read directly
  * from the usual stdin, without the calls to popen/yyrestart)
  * InitScanner() is used to set up the scanner.
- * Once everything is set up, we loop, calling yylex() to get each token
- * and print out its info. We continue until all input has been scanned.
+ * Once everything is set up, we loop, scanning each token into a token
+ * stream (see tokenstream.h) and printing its info from there. We
+ * continue until all input has been scanned. -d tokens prints how many
+ * tokens and distinct lexemes the stream ended up holding.
  */
 int main(int argc, char *argv[])
 {
@@ -65,9 +68,12 @@ int main(int argc, char *argv[])
     yyrestart(filtered); // tell lex to read from output of preprocessor
   
     InitScanner();
-    TokenType token;
-    while ((token = (TokenType)yylex()) != 0) 
-        PrintOneToken(token, yytext, yylval, yylloc);
+    TokenStream tokens;
+    const Token *t;
+    while ((t = tokens.ScanNext()) != NULL)
+        PrintOneToken((TokenType)t->kind, tokens.TextOf(*t), tokens.ValueOf(*t),
+                      tokens.LocationOf(*t));
+    PrintDebug("tokens", "%d tokens, %d distinct lexemes", tokens.NumTokens(), tokens.NumLexemes());
     pclose(filtered);
     return (ReportError::NumErrors() == 0? 0 : -1);
 }
@@ -0,0 +1,54 @@
+/* File: tokenstream.cc
+ * --------------------
+ * Implementation of the token stream.
+ */
+
+#include "tokenstream.h"
+#include <string.h>
+
+static_assert(sizeof(Token) == 16, "Token is meant to pack into 16 bytes");
+
+static uint16_t Column(int column) {
+    return column < 0 ? 0 : column > UINT16_MAX ? UINT16_MAX : column;
+}
+
+const Token *TokenStream::ScanNext() {
+    int kind = yylex();
+    if (kind == 0) return NULL;
+    // A lexeme always scans to the same token, so its value is that of
+    // its first occurrence
+    std::pair<std::unordered_map<std::string,uint32_t>::iterator,bool> entry =
+        pool.insert(std::make_pair(std::string(yytext), (uint32_t)lexemes.size()));
+    if (entry.second) {
+        Lexeme lexeme = { (uint32_t)text.size(), yylval };
+        text.append(yytext, strlen(yytext) + 1);
+        lexemes.push_back(lexeme);
+    }
+    Token t = { (uint32_t)yylloc.first_line, Column(yylloc.first_column),
+                Column(yylloc.last_column), entry.first->second, (uint16_t)kind };
+    tokens.push_back(t);
+    return &tokens.back();
+}
+
+void TokenStream::ScanAll() {
+    while (ScanNext() != NULL)
+        ;
+}
+
+YYSTYPE TokenStream::ValueOf(const Token &t) const {
+    YYSTYPE value = lexemes[t.lexeme].value;
+    // The scanner points a string constant into yytext, so it is given
+    // the copy in the pool instead
+    if (t.kind == T_StringConstant)
+        value.stringConstant = (char *)TextOf(t);
+    return value;
+}
+
+yyltype TokenStream::LocationOf(const Token &t) const {
+    yyltype loc;
+    memset(&loc, 0, sizeof(loc));
+    loc.first_line = loc.last_line = t.line;
+    loc.first_column = t.firstColumn;
+    loc.last_column = t.lastColumn;
+    return loc;
+}
@@ -0,0 +1,72 @@
+/* File: tokenstream.h
+ * -------------------
+ * The tokens of a file kept in memory, so that a tool going over them
+ * more than once (printing them, parsing them again, formatting) scans
+ * the file only once. yylex hands out each token as a YYSTYPE, whose
+ * 32-byte identifier array makes it large even for punctuation, and a
+ * yyltype of four ints. Here a token is packed into 16 bytes instead:
+ * its kind, where it is, and which lexeme it is. Each distinct lexeme is
+ * kept once, in a pool, with its text and its value (the name of an
+ * identifier, truncated to MaxIdentLen, or the value of a constant), so
+ * a name used a thousand times costs a single YYSTYPE.
+ *
+ *   TokenStream tokens;
+ *   tokens.ScanAll();                     // the whole input, up front
+ *   for (const Token &t : tokens)
+ *       printf("%s ", tokens.TextOf(t));
+ *
+ * ScanNext scans one more token instead, for a client like pp1's main
+ * that has to print each one before the next is scanned, so the errors
+ * the scanner reports come out in the same order as the tokens.
+ */
+
+#ifndef _H_tokenstream
+#define _H_tokenstream
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "scanner.h"
+#include "location.h"
+
+struct Token {
+    uint32_t line;
+    uint16_t firstColumn, lastColumn;   // columns past 65535 are clamped
+    uint32_t lexeme;                    // index in the pool of its stream
+    uint16_t kind;                      // a TokenType, or the character
+                                        // of a one-character token
+};
+
+class TokenStream
+{
+  private:
+    struct Lexeme {
+        uint32_t text;                  // offset in text
+        YYSTYPE value;
+    };
+    std::vector<Token> tokens;
+    std::vector<Lexeme> lexemes;
+    std::string text;                   // each lexeme, NUL-terminated
+    std::unordered_map<std::string,uint32_t> pool;
+
+  public:
+        // Scans the next token with yylex and appends it; returns it,
+        // until the next one is scanned, or NULL at the end of the input
+    const Token *ScanNext();
+    void ScanAll();
+
+    int NumTokens() const { return tokens.size(); }
+    int NumLexemes() const { return lexemes.size(); }
+    const Token &Nth(int i) const { return tokens[i]; }
+    const Token *begin() const { return tokens.data(); }
+    const Token *end() const { return tokens.data() + tokens.size(); }
+
+        // What yylex gave for the token, as far as it is known: the text
+        // stays valid until more tokens are scanned
+    const char *TextOf(const Token &t) const { return text.c_str() + lexemes[t.lexeme].text; }
+    YYSTYPE ValueOf(const Token &t) const;
+    yyltype LocationOf(const Token &t) const;
+};
+
+#endif
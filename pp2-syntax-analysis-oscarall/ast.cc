@@ -5,6 +5,7 @@
 #include "ast.h"
 #include "ast_type.h"
 #include "ast_decl.h"
+#include "astimage.h"
 #include <string.h> // strdup
 #include <stdio.h>  // printf
 
@@ -22,26 +23,22 @@ Node::Node() {
  * If this node has a location (most nodes do, but some do not), it
  * will first print the line number to help you match the parse tree 
  * back to the source text. It then indents the proper number of levels 
- * and prints the "print name" of the node. It then will invoke the
- * virtual function PrintChildren which is expected to print the
- * internals of the node (itself & children) as appropriate.
+ * and prints the "print name" of the node, followed by its value and
+ * its children one level further in, as told by Describe.
  */
-void Node::Print(int indentLevel, const char *label) { 
-    const int numSpaces = 3;
-    printf("\n");
-    if (GetLocation()) 
-        printf("%*d", numSpaces, GetLocation()->first_line);
-    else 
-        printf("%*s", numSpaces, "");
-    printf("%*s%s%s: ", indentLevel*numSpaces, "", 
-           label? label : "", GetPrintNameForNode());
-   PrintChildren(indentLevel);
+void Node::Print(int indentLevel, const char *label, TreeFormat format) { 
+    TreePrinter(format).Print(this, indentLevel, label);
 } 
 	 
 Identifier::Identifier(yyltype loc, const char *n) : Node(loc) {
     name = strdup(n);
 } 
 
-void Identifier::PrintChildren(int indentLevel) {
-    printf("%s", name);
+void Identifier::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_Identifier);
+    out->SetText(name);
+}
+
+void Error::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_Error);
 }
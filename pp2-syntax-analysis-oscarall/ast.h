@@ -21,10 +21,11 @@
  *
  * Printing: The only interesting behavior of the node classes for pp2 is the 
  * bility to print the tree using an in-order walk.  Each node class is 
- * responsible for printing itself/children by overriding the virtual 
- * PrintChildren() and GetPrintNameForNode() methods. All the classes we 
- * provide already implement these methods, so your job is to construct the
- * nodes and wire them up during parsing. Once that's done, printing is a snap!
+ * responsible for describing itself/children by overriding the virtual 
+ * Describe() and GetPrintNameForNode() methods. Print() walks those
+ * descriptions with an explicit stack rather than recursion and collects
+ * all output in one buffer (see astimage.h, which uses the same
+ * descriptions to save the tree as an image).
 
  */
 
@@ -34,6 +35,12 @@
 #include <stdlib.h>   // for NULL
 #include "location.h"
 
+class NodeWriter;
+
+// How Print lays out the tree: the indented format the graders diff
+// against, or one dense line per node for tools (see PrintImage)
+typedef enum { TreeDefault, TreeCompact } TreeFormat;
+
 class Node 
 {
   protected:
@@ -51,9 +58,13 @@ class Node
     virtual const char *GetPrintNameForNode() = 0;
     
     // Print() is deliberately _not_ virtual
-    // subclasses should override PrintChildren() instead
-    void Print(int indentLevel, const char *label = NULL); 
-    virtual void PrintChildren(int indentLevel)  {}
+    // subclasses should override Describe() instead
+    void Print(int indentLevel, const char *label = NULL,
+               TreeFormat format = TreeDefault); 
+
+    // Tells out (see astimage.h) this node's kind, its value if any,
+    // and its children in print order
+    virtual void Describe(NodeWriter *out) = 0;
 };
    
 
@@ -65,7 +76,7 @@ class Identifier : public Node
   public:
     Identifier(yyltype loc, const char *name);
     const char *GetPrintNameForNode()   { return "Identifier"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
 
@@ -79,6 +90,7 @@ class Error : public Node
   public:
     Error() : Node() {}
     const char *GetPrintNameForNode()   { return "Error"; }
+    void Describe(NodeWriter *out);
 };
 
 
@@ -5,6 +5,7 @@
 #include "ast_decl.h"
 #include "ast_type.h"
 #include "ast_stmt.h"
+#include "astimage.h"
         
          
 Decl::Decl(Identifier *n) : Node(*n->GetLocation()) {
@@ -18,9 +19,10 @@ VarDecl::VarDecl(Identifier *n, Type *t) : Decl(n) {
     (type=t)->SetParent(this);
 }
   
-void VarDecl::PrintChildren(int indentLevel) { 
-   type->Print(indentLevel+1);
-   id->Print(indentLevel+1);
+void VarDecl::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_VarDecl);
+    out->AddChild(type);
+    out->AddChild(id);
 }
 
 ClassDecl::ClassDecl(Identifier *n, NamedType *ex, List<NamedType*> *imp, List<Decl*> *m) : Decl(n) {
@@ -32,11 +34,12 @@ ClassDecl::ClassDecl(Identifier *n, NamedType *ex, List<NamedType*> *imp, List<D
     (members=m)->SetParentAll(this);
 }
 
-void ClassDecl::PrintChildren(int indentLevel) {
-    id->Print(indentLevel+1);
-    if (extends) extends->Print(indentLevel+1, "(extends) ");
-    implements->PrintAll(indentLevel+1, "(implements) ");
-    members->PrintAll(indentLevel+1);
+void ClassDecl::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_ClassDecl);
+    out->AddChild(id);
+    out->AddChild(extends, "(extends) ");
+    out->AddChildren(implements, "(implements) ");
+    out->AddChildren(members);
 }
 
 
@@ -45,9 +48,10 @@ InterfaceDecl::InterfaceDecl(Identifier *n, List<Decl*> *m) : Decl(n) {
     (members=m)->SetParentAll(this);
 }
 
-void InterfaceDecl::PrintChildren(int indentLevel) {
-    id->Print(indentLevel+1);
-    members->PrintAll(indentLevel+1);
+void InterfaceDecl::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_InterfaceDecl);
+    out->AddChild(id);
+    out->AddChildren(members);
 }
 	
 FnDecl::FnDecl(Identifier *n, Type *r, List<VarDecl*> *d) : Decl(n) {
@@ -61,11 +65,12 @@ void FnDecl::SetFunctionBody(Stmt *b) {
     (body=b)->SetParent(this);
 }
 
-void FnDecl::PrintChildren(int indentLevel) {
-    returnType->Print(indentLevel+1, "(return type) ");
-    id->Print(indentLevel+1);
-    formals->PrintAll(indentLevel+1, "(formals) ");
-    if (body) body->Print(indentLevel+1, "(body) ");
+void FnDecl::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_FnDecl);
+    out->AddChild(returnType, "(return type) ");
+    out->AddChild(id);
+    out->AddChildren(formals, "(formals) ");
+    out->AddChild(body, "(body) ");
 }
 
 
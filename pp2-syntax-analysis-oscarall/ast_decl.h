@@ -34,7 +34,7 @@ class VarDecl : public Decl
   public:
     VarDecl(Identifier *name, Type *type);
     const char *GetPrintNameForNode() { return "VarDecl"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
 class ClassDecl : public Decl 
@@ -48,7 +48,7 @@ class ClassDecl : public Decl
     ClassDecl(Identifier *name, NamedType *extends, 
               List<NamedType*> *implements, List<Decl*> *members);
     const char *GetPrintNameForNode() { return "ClassDecl"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
 class InterfaceDecl : public Decl 
@@ -59,7 +59,7 @@ class InterfaceDecl : public Decl
   public:
     InterfaceDecl(Identifier *name, List<Decl*> *members);
     const char *GetPrintNameForNode() { return "InterfaceDecl"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
 class FnDecl : public Decl 
@@ -73,7 +73,7 @@ class FnDecl : public Decl
     FnDecl(Identifier *name, Type *returnType, List<VarDecl*> *formals);
     void SetFunctionBody(Stmt *b);
     const char *GetPrintNameForNode() { return "FnDecl"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
 #endif
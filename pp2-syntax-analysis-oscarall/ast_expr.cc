@@ -5,37 +5,54 @@
 #include "ast_expr.h"
 #include "ast_type.h"
 #include "ast_decl.h"
+#include "astimage.h"
 #include <string.h>
 
 
 
+void EmptyExpr::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_EmptyExpr);
+}
+
 IntConstant::IntConstant(yyltype loc, int val) : Expr(loc) {
     value = val;
 }
-void IntConstant::PrintChildren(int indentLevel) { 
-    printf("%d", value);
+
+void IntConstant::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_IntConstant);
+    out->SetInt(value);
 }
 
 DoubleConstant::DoubleConstant(yyltype loc, double val) : Expr(loc) {
     value = val;
 }
-void DoubleConstant::PrintChildren(int indentLevel) { 
-    printf("%g", value);
+
+void DoubleConstant::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_DoubleConstant);
+    out->SetDouble(value);
 }
 
 BoolConstant::BoolConstant(yyltype loc, bool val) : Expr(loc) {
     value = val;
 }
-void BoolConstant::PrintChildren(int indentLevel) { 
-    printf("%s", value ? "true" : "false");
+
+void BoolConstant::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_BoolConstant);
+    out->SetInt(value);
 }
 
 StringConstant::StringConstant(yyltype loc, const char *val) : Expr(loc) {
     Assert(val != NULL);
     value = strdup(val);
 }
-void StringConstant::PrintChildren(int indentLevel) { 
-    printf("%s",value);
+
+void StringConstant::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_StringConstant);
+    out->SetText(value);
+}
+
+void NullConstant::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_NullConstant);
 }
 
 Operator::Operator(yyltype loc, const char *tok) : Node(loc) {
@@ -43,8 +60,9 @@ Operator::Operator(yyltype loc, const char *tok) : Node(loc) {
     strncpy(tokenString, tok, sizeof(tokenString));
 }
 
-void Operator::PrintChildren(int indentLevel) {
-    printf("%s",tokenString);
+void Operator::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_Operator);
+    out->SetText(tokenString);
 }
 
 CompoundExpr::CompoundExpr(Expr *l, Operator *o, Expr *r) 
@@ -63,10 +81,39 @@ CompoundExpr::CompoundExpr(Operator *o, Expr *r)
     (right=r)->SetParent(this);
 }
 
-void CompoundExpr::PrintChildren(int indentLevel) {
-   if (left) left->Print(indentLevel+1);
-   op->Print(indentLevel+1);
-   right->Print(indentLevel+1);
+void CompoundExpr::AddOperands(NodeWriter *out) {
+    out->AddChild(left);
+    out->AddChild(op);
+    out->AddChild(right);
+}
+
+void ArithmeticExpr::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_ArithmeticExpr);
+    AddOperands(out);
+}
+
+void RelationalExpr::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_RelationalExpr);
+    AddOperands(out);
+}
+
+void EqualityExpr::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_EqualityExpr);
+    AddOperands(out);
+}
+
+void LogicalExpr::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_LogicalExpr);
+    AddOperands(out);
+}
+
+void AssignExpr::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_AssignExpr);
+    AddOperands(out);
+}
+
+void This::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_This);
 }
 
 PostfixExpr::PostfixExpr(yyltype loc, Expr *e, Operator *o) : LValue(loc) {
@@ -75,9 +122,10 @@ PostfixExpr::PostfixExpr(yyltype loc, Expr *e, Operator *o) : LValue(loc) {
     (op=o)->SetParent(this);
 }
 
-void PostfixExpr::PrintChildren(int indentLevel) {
-    expr->Print(indentLevel+1);
-    op->Print(indentLevel+1);
+void PostfixExpr::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_PostfixExpr);
+    out->AddChild(expr);
+    out->AddChild(op);
 }
    
   
@@ -86,10 +134,11 @@ ArrayAccess::ArrayAccess(yyltype loc, Expr *b, Expr *s) : LValue(loc) {
     (subscript=s)->SetParent(this);
 }
 
-void ArrayAccess::PrintChildren(int indentLevel) {
-    base->Print(indentLevel+1);
-    subscript->Print(indentLevel+1, "(subscript) ");
-  }
+void ArrayAccess::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_ArrayAccess);
+    out->AddChild(base);
+    out->AddChild(subscript, "(subscript) ");
+}
      
 FieldAccess::FieldAccess(Expr *b, Identifier *f) 
   : LValue(b? Join(b->GetLocation(), f->GetLocation()) : *f->GetLocation()) {
@@ -100,10 +149,11 @@ FieldAccess::FieldAccess(Expr *b, Identifier *f)
 }
 
 
-  void FieldAccess::PrintChildren(int indentLevel) {
-    if (base) base->Print(indentLevel+1);
-    field->Print(indentLevel+1);
-  }
+void FieldAccess::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_FieldAccess);
+    out->AddChild(base);
+    out->AddChild(field);
+}
 
 Call::Call(yyltype loc, Expr *b, Identifier *f, List<Expr*> *a) : Expr(loc)  {
     Assert(f != NULL && a != NULL); // b can be be NULL (just means no explicit base)
@@ -113,11 +163,12 @@ Call::Call(yyltype loc, Expr *b, Identifier *f, List<Expr*> *a) : Expr(loc)  {
     (actuals=a)->SetParentAll(this);
 }
 
- void Call::PrintChildren(int indentLevel) {
-    if (base) base->Print(indentLevel+1);
-    field->Print(indentLevel+1);
-    actuals->PrintAll(indentLevel+1, "(actuals) ");
-  }
+void Call::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_Call);
+    out->AddChild(base);
+    out->AddChild(field);
+    out->AddChildren(actuals, "(actuals) ");
+}
  
 
 NewExpr::NewExpr(yyltype loc, NamedType *c) : Expr(loc) { 
@@ -125,8 +176,9 @@ NewExpr::NewExpr(yyltype loc, NamedType *c) : Expr(loc) {
   (cType=c)->SetParent(this);
 }
 
-void NewExpr::PrintChildren(int indentLevel) {	
-    cType->Print(indentLevel+1);
+void NewExpr::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_NewExpr);
+    out->AddChild(cType);
 }
 
 NewArrayExpr::NewArrayExpr(yyltype loc, Expr *sz, Type *et) : Expr(loc) {
@@ -135,9 +187,16 @@ NewArrayExpr::NewArrayExpr(yyltype loc, Expr *sz, Type *et) : Expr(loc) {
     (elemType=et)->SetParent(this);
 }
 
-void NewArrayExpr::PrintChildren(int indentLevel) {
-    size->Print(indentLevel+1);
-    elemType->Print(indentLevel+1);
+void NewArrayExpr::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_NewArrayExpr);
+    out->AddChild(size);
+    out->AddChild(elemType);
 }
 
-       
+void ReadIntegerExpr::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_ReadIntegerExpr);
+}
+
+void ReadLineExpr::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_ReadLineExpr);
+}
@@ -32,6 +32,7 @@ class EmptyExpr : public Expr
 {
   public:
     const char *GetPrintNameForNode() { return "Empty"; }
+    void Describe(NodeWriter *out);
 };
 
 class IntConstant : public Expr 
@@ -42,7 +43,7 @@ class IntConstant : public Expr
   public:
     IntConstant(yyltype loc, int val);
     const char *GetPrintNameForNode() { return "IntConstant"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
 class DoubleConstant : public Expr 
@@ -53,7 +54,7 @@ class DoubleConstant : public Expr
   public:
     DoubleConstant(yyltype loc, double val);
     const char *GetPrintNameForNode() { return "DoubleConstant"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
 class BoolConstant : public Expr 
@@ -64,7 +65,7 @@ class BoolConstant : public Expr
   public:
     BoolConstant(yyltype loc, bool val);
     const char *GetPrintNameForNode() { return "BoolConstant"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
 class StringConstant : public Expr 
@@ -75,7 +76,7 @@ class StringConstant : public Expr
   public:
     StringConstant(yyltype loc, const char *val);
     const char *GetPrintNameForNode() { return "StringConstant"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
 class NullConstant: public Expr 
@@ -83,6 +84,7 @@ class NullConstant: public Expr
   public: 
     NullConstant(yyltype loc) : Expr(loc) {}
     const char *GetPrintNameForNode() { return "NullConstant"; }
+    void Describe(NodeWriter *out);
 };
 
 class Operator : public Node 
@@ -93,7 +95,7 @@ class Operator : public Node
   public:
     Operator(yyltype loc, const char *tok);
     const char *GetPrintNameForNode() { return "Operator"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
  };
  
 class CompoundExpr : public Expr
@@ -105,7 +107,7 @@ class CompoundExpr : public Expr
   public:
     CompoundExpr(Expr *lhs, Operator *op, Expr *rhs); // for binary
     CompoundExpr(Operator *op, Expr *rhs);             // for unary
-    void PrintChildren(int indentLevel);
+    void AddOperands(NodeWriter *out);
 };
 
 class ArithmeticExpr : public CompoundExpr 
@@ -114,6 +116,7 @@ class ArithmeticExpr : public CompoundExpr
     ArithmeticExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
     ArithmeticExpr(Operator *op, Expr *rhs) : CompoundExpr(op,rhs) {}
     const char *GetPrintNameForNode() { return "ArithmeticExpr"; }
+    void Describe(NodeWriter *out);
 };
 
 class RelationalExpr : public CompoundExpr 
@@ -121,6 +124,7 @@ class RelationalExpr : public CompoundExpr
   public:
     RelationalExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
     const char *GetPrintNameForNode() { return "RelationalExpr"; }
+    void Describe(NodeWriter *out);
 };
 
 class EqualityExpr : public CompoundExpr 
@@ -128,6 +132,7 @@ class EqualityExpr : public CompoundExpr
   public:
     EqualityExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
     const char *GetPrintNameForNode() { return "EqualityExpr"; }
+    void Describe(NodeWriter *out);
 };
 
 class LogicalExpr : public CompoundExpr 
@@ -136,6 +141,7 @@ class LogicalExpr : public CompoundExpr
     LogicalExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
     LogicalExpr(Operator *op, Expr *rhs) : CompoundExpr(op,rhs) {}
     const char *GetPrintNameForNode() { return "LogicalExpr"; }
+    void Describe(NodeWriter *out);
 };
 
 class AssignExpr : public CompoundExpr 
@@ -143,6 +149,7 @@ class AssignExpr : public CompoundExpr
   public:
     AssignExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
     const char *GetPrintNameForNode() { return "AssignExpr"; }
+    void Describe(NodeWriter *out);
 };
 
 class LValue : public Expr 
@@ -156,6 +163,7 @@ class This : public Expr
   public:
     This(yyltype loc) : Expr(loc) {}
     const char *GetPrintNameForNode() { return "This"; }
+    void Describe(NodeWriter *out);
 };
 
 class PostfixExpr : public LValue 
@@ -167,7 +175,7 @@ class PostfixExpr : public LValue
   public:
     PostfixExpr(yyltype loc, Expr *expr, Operator *op);
     const char *GetPrintNameForNode() { return "PostfixExpr"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
 
@@ -179,7 +187,7 @@ class ArrayAccess : public LValue
   public:
     ArrayAccess(yyltype loc, Expr *base, Expr *subscript);
     const char *GetPrintNameForNode() { return "ArrayAccess"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
 /* Note that field access is used both for qualified names
@@ -196,7 +204,7 @@ class FieldAccess : public LValue
   public:
     FieldAccess(Expr *base, Identifier *field); //ok to pass NULL base
     const char *GetPrintNameForNode() { return "FieldAccess"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
 /* Like field access, call is used both for qualified base.field()
@@ -213,7 +221,7 @@ class Call : public Expr
   public:
     Call(yyltype loc, Expr *base, Identifier *field, List<Expr*> *args);
     const char *GetPrintNameForNode() { return "Call"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
 class NewExpr : public Expr
@@ -224,7 +232,7 @@ class NewExpr : public Expr
   public:
     NewExpr(yyltype loc, NamedType *clsType);
     const char *GetPrintNameForNode() { return "NewExpr"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
 class NewArrayExpr : public Expr
@@ -236,7 +244,7 @@ class NewArrayExpr : public Expr
   public:
     NewArrayExpr(yyltype loc, Expr *sizeExpr, Type *elemType);
     const char *GetPrintNameForNode() { return "NewArrayExpr"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
 class ReadIntegerExpr : public Expr
@@ -244,6 +252,7 @@ class ReadIntegerExpr : public Expr
   public:
     ReadIntegerExpr(yyltype loc) : Expr(loc) {}
     const char *GetPrintNameForNode() { return "ReadIntegerExpr"; }
+    void Describe(NodeWriter *out);
 };
 
 class ReadLineExpr : public Expr
@@ -251,6 +260,7 @@ class ReadLineExpr : public Expr
   public:
     ReadLineExpr(yyltype loc) : Expr (loc) {}
     const char *GetPrintNameForNode() { return "ReadLineExpr"; }
+    void Describe(NodeWriter *out);
 };
 
     
@@ -6,6 +6,7 @@
 #include "ast_type.h"
 #include "ast_decl.h"
 #include "ast_expr.h"
+#include "astimage.h"
 
 
 Program::Program(List<Decl*> *d) {
@@ -13,9 +14,9 @@ Program::Program(List<Decl*> *d) {
     (decls=d)->SetParentAll(this);
 }
 
-void Program::PrintChildren(int indentLevel) {
-    decls->PrintAll(indentLevel+1);
-    printf("\n");
+void Program::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_Program);
+    out->AddChildren(decls);
 }
 
 SwitchStmt::SwitchStmt(Expr *e, CaseBlock *c, Default *d) {
@@ -26,10 +27,11 @@ SwitchStmt::SwitchStmt(Expr *e, CaseBlock *c, Default *d) {
     if (defaultStmt) defaultStmt->SetParent(this);
 }
 
-void SwitchStmt::PrintChildren(int indentLevel) {
-    expr->Print(indentLevel+1, "(expr) ");
-    caseBlock->Print(indentLevel+1);
-    if (defaultStmt) defaultStmt->Print(indentLevel+1);
+void SwitchStmt::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_SwitchStmt);
+    out->AddChild(expr, "(expr) ");
+    out->AddChild(caseBlock);
+    out->AddChild(defaultStmt);
 }
 
 Case::Case(Expr *i, List<Stmt*> *s) {
@@ -38,9 +40,10 @@ Case::Case(Expr *i, List<Stmt*> *s) {
     (stmtList=s)->SetParentAll(this);
 }
 
-void Case::PrintChildren(int indentLevel) {
-    intConst->Print(indentLevel+1, "(constant) ");
-    stmtList->PrintAll(indentLevel+1);
+void Case::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_Case);
+    out->AddChild(intConst, "(constant) ");
+    out->AddChildren(stmtList);
 }
 
 Default::Default(List<Stmt*> *s) {
@@ -48,16 +51,19 @@ Default::Default(List<Stmt*> *s) {
     (stmtList=s)->SetParentAll(this);
 }
 
-void Default::PrintChildren(int indentLevel) {
-    stmtList->PrintAll(indentLevel+1);
+void Default::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_Default);
+    out->AddChildren(stmtList);
 }
 
 CaseBlock::CaseBlock(List<Case*> *c) {
     Assert(c != NULL);
     (caseList=c)->SetParentAll(this);
 }
-void CaseBlock::PrintChildren(int indentLevel) {
-    caseList->PrintAll(indentLevel+1);
+
+void CaseBlock::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_CaseBlock);
+    out->AddChildren(caseList);
 }
 
 StmtBlock::StmtBlock(List<VarDecl*> *d, List<Stmt*> *s) {
@@ -66,9 +72,10 @@ StmtBlock::StmtBlock(List<VarDecl*> *d, List<Stmt*> *s) {
     (stmts=s)->SetParentAll(this);
 }
 
-void StmtBlock::PrintChildren(int indentLevel) {
-    decls->PrintAll(indentLevel+1);
-    stmts->PrintAll(indentLevel+1);
+void StmtBlock::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_StmtBlock);
+    out->AddChildren(decls);
+    out->AddChildren(stmts);
 }
 
 ConditionalStmt::ConditionalStmt(Expr *t, Stmt *b) { 
@@ -83,16 +90,18 @@ ForStmt::ForStmt(Expr *i, Expr *t, Expr *s, Stmt *b): LoopStmt(t, b) {
     (step=s)->SetParent(this);
 }
 
-void ForStmt::PrintChildren(int indentLevel) {
-    init->Print(indentLevel+1, "(init) ");
-    test->Print(indentLevel+1, "(test) ");
-    step->Print(indentLevel+1, "(step) ");
-    body->Print(indentLevel+1, "(body) ");
+void ForStmt::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_ForStmt);
+    out->AddChild(init, "(init) ");
+    out->AddChild(test, "(test) ");
+    out->AddChild(step, "(step) ");
+    out->AddChild(body, "(body) ");
 }
 
-void WhileStmt::PrintChildren(int indentLevel) {
-    test->Print(indentLevel+1, "(test) ");
-    body->Print(indentLevel+1, "(body) ");
+void WhileStmt::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_WhileStmt);
+    out->AddChild(test, "(test) ");
+    out->AddChild(body, "(body) ");
 }
 
 IfStmt::IfStmt(Expr *t, Stmt *tb, Stmt *eb): ConditionalStmt(t, tb) { 
@@ -101,10 +110,15 @@ IfStmt::IfStmt(Expr *t, Stmt *tb, Stmt *eb): ConditionalStmt(t, tb) {
     if (elseBody) elseBody->SetParent(this);
 }
 
-void IfStmt::PrintChildren(int indentLevel) {
-    test->Print(indentLevel+1, "(test) ");
-    body->Print(indentLevel+1, "(then) ");
-    if (elseBody) elseBody->Print(indentLevel+1, "(else) ");
+void IfStmt::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_IfStmt);
+    out->AddChild(test, "(test) ");
+    out->AddChild(body, "(then) ");
+    out->AddChild(elseBody, "(else) ");
+}
+
+void BreakStmt::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_BreakStmt);
 }
 
 
@@ -113,8 +127,9 @@ ReturnStmt::ReturnStmt(yyltype loc, Expr *e) : Stmt(loc) {
     (expr=e)->SetParent(this);
 }
 
-void ReturnStmt::PrintChildren(int indentLevel) {
-    expr->Print(indentLevel+1);
+void ReturnStmt::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_ReturnStmt);
+    out->AddChild(expr);
 }
   
 PrintStmt::PrintStmt(List<Expr*> *a) {    
@@ -122,8 +137,9 @@ PrintStmt::PrintStmt(List<Expr*> *a) {
     (args=a)->SetParentAll(this);
 }
 
-void PrintStmt::PrintChildren(int indentLevel) {
-    args->PrintAll(indentLevel+1, "(args) ");
+void PrintStmt::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_PrintStmt);
+    out->AddChildren(args, "(args) ");
 }
 
 
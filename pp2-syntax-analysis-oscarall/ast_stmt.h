@@ -28,7 +28,7 @@ class Program : public Node
   public:
      Program(List<Decl*> *declList);
      const char *GetPrintNameForNode() { return "Program"; }
-     void PrintChildren(int indentLevel);
+     void Describe(NodeWriter *out);
 };
 
 class Stmt : public Node
@@ -46,7 +46,7 @@ class Default: public Stmt
   public:
     Default(List<Stmt*> *stmtList);
     const char *GetPrintNameForNode() { return "Default"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
 class Case : public Stmt
@@ -58,7 +58,7 @@ class Case : public Stmt
   public:
     Case(Expr *intConst, List<Stmt*> *stmtList);
     const char *GetPrintNameForNode() { return "Case"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
 class CaseBlock : public Stmt
@@ -69,7 +69,7 @@ class CaseBlock : public Stmt
   public:
     CaseBlock(List<Case*> *caseList);
     const char *GetPrintNameForNode() { return "CaseBlock"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
     
 };
 
@@ -83,7 +83,7 @@ class SwitchStmt : public Stmt
   public:
     SwitchStmt(Expr *expr, CaseBlock *caseList, Default *defaultStmt);
     const char *GetPrintNameForNode() { return "SwitchStmt"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
 class StmtBlock : public Stmt 
@@ -95,7 +95,7 @@ class StmtBlock : public Stmt
   public:
     StmtBlock(List<VarDecl*> *variableDeclarations, List<Stmt*> *statements);
     const char *GetPrintNameForNode() { return "StmtBlock"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
   
@@ -124,7 +124,7 @@ class ForStmt : public LoopStmt
   public:
     ForStmt(Expr *init, Expr *test, Expr *step, Stmt *body);
     const char *GetPrintNameForNode() { return "ForStmt"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
 class WhileStmt : public LoopStmt 
@@ -132,7 +132,7 @@ class WhileStmt : public LoopStmt
   public:
     WhileStmt(Expr *test, Stmt *body) : LoopStmt(test, body) {}
     const char *GetPrintNameForNode() { return "WhileStmt"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
 class IfStmt : public ConditionalStmt 
@@ -143,7 +143,7 @@ class IfStmt : public ConditionalStmt
   public:
     IfStmt(Expr *test, Stmt *thenBody, Stmt *elseBody);
     const char *GetPrintNameForNode() { return "IfStmt"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
 class BreakStmt : public Stmt 
@@ -151,6 +151,7 @@ class BreakStmt : public Stmt
   public:
     BreakStmt(yyltype loc) : Stmt(loc) {}
     const char *GetPrintNameForNode() { return "BreakStmt"; }
+    void Describe(NodeWriter *out);
 };
 
 class ReturnStmt : public Stmt  
@@ -161,7 +162,7 @@ class ReturnStmt : public Stmt
   public:
     ReturnStmt(yyltype loc, Expr *expr);
     const char *GetPrintNameForNode() { return "ReturnStmt"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
 class PrintStmt : public Stmt
@@ -172,7 +173,7 @@ class PrintStmt : public Stmt
   public:
     PrintStmt(List<Expr*> *arguments);
     const char *GetPrintNameForNode() { return "PrintStmt"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
 #endif
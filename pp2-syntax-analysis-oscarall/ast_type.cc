@@ -4,6 +4,7 @@
  */
 #include "ast_type.h"
 #include "ast_decl.h"
+#include "astimage.h"
 #include <string.h>
 
  
@@ -28,8 +29,9 @@ Type::Type(const char *n) {
     typeName = strdup(n);
 }
 
-void Type::PrintChildren(int indentLevel) {
-    printf("%s", typeName);
+void Type::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_Type);
+    out->SetText(typeName);
 }
 
 	
@@ -38,16 +40,19 @@ NamedType::NamedType(Identifier *i) : Type(*i->GetLocation()) {
     (id=i)->SetParent(this);
 } 
 
-void NamedType::PrintChildren(int indentLevel) {
-    id->Print(indentLevel+1);
+void NamedType::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_NamedType);
+    out->AddChild(id);
 }
 
 ArrayType::ArrayType(yyltype loc, Type *et) : Type(loc) {
     Assert(et != NULL);
     (elemType=et)->SetParent(this);
 }
-void ArrayType::PrintChildren(int indentLevel) {
-    elemType->Print(indentLevel+1);
+
+void ArrayType::Describe(NodeWriter *out) {
+    out->BeginNode(this, IK_ArrayType);
+    out->AddChild(elemType);
 }
 
 
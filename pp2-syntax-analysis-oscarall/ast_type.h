@@ -26,7 +26,7 @@ class Type : public Node
     Type(const char *str);
     
     const char *GetPrintNameForNode() { return "Type"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
 class NamedType : public Type 
@@ -38,7 +38,7 @@ class NamedType : public Type
     NamedType(Identifier *i);
     
     const char *GetPrintNameForNode() { return "NamedType"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
 class ArrayType : public Type 
@@ -50,7 +50,7 @@ class ArrayType : public Type
     ArrayType(yyltype loc, Type *elemType);
     
     const char *GetPrintNameForNode() { return "ArrayType"; }
-    void PrintChildren(int indentLevel);
+    void Describe(NodeWriter *out);
 };
 
  
@@ -0,0 +1,438 @@
+/* File: astimage.cc
+ * -----------------
+ * Implementation of the parse tree image writer, loader and printer.
+ */
+
+#include "astimage.h"
+#include "ast.h"
+#include "utility.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char Magic[4] = { 'D', 'C', 'C', 'I' };
+static const uint32_t ImageVersion = 1;
+static const size_t NodesStart = (sizeof(ImageHeader) + 7) & ~(size_t)7;
+
+const char *const ImageKindNames[NumImageKinds] = {
+    "Program", "Identifier", "Error",
+    "Type", "NamedType", "ArrayType",
+    "VarDecl", "ClassDecl", "InterfaceDecl", "FnDecl",
+    "StmtBlock", "ForStmt", "WhileStmt", "IfStmt", "BreakStmt",
+    "ReturnStmt", "PrintStmt", "SwitchStmt", "CaseBlock", "Case",
+    "Default",
+    "Empty", "IntConstant", "DoubleConstant", "BoolConstant",
+    "StringConstant", "NullConstant", "Operator",
+    "ArithmeticExpr", "RelationalExpr", "EqualityExpr", "LogicalExpr",
+    "AssignExpr", "This", "PostfixExpr", "ArrayAccess", "FieldAccess",
+    "Call", "NewExpr", "NewArrayExpr", "ReadIntegerExpr", "ReadLineExpr"
+};
+
+// What the text field of a kind holds
+static bool HasText(ImageKind kind) {
+    return kind == IK_Identifier || kind == IK_Type || kind == IK_Operator
+        || kind == IK_StringConstant;
+}
+
+static void ClearFields(NodeFields *f, ImageKind kind) {
+    f->kind = kind;
+    f->valueType = NoValue;
+    f->text = NULL;
+    f->intValue = 0;
+    f->doubleValue = 0;
+}
+
+
+/* Writer
+ * ------
+ */
+
+void ImageWriter::BeginNode(Node *n, ImageKind kind) {
+    Assert(n == Current().node);
+    Assert(strcmp(ImageKindNames[kind], n->GetPrintNameForNode()) == 0);
+    Current().fields.kind = kind;
+}
+
+void ImageWriter::SetText(const char *text) {
+    Current().fields.valueType = TextValue;
+    Current().fields.text = text;
+}
+
+void ImageWriter::SetInt(int value) {
+    Current().fields.valueType = IntValue;
+    Current().fields.intValue = value;
+}
+
+void ImageWriter::SetDouble(double value) {
+    Current().fields.valueType = DoubleValue;
+    Current().fields.doubleValue = value;
+}
+
+void ImageWriter::AddChild(Node *child, const char *label) {
+    if (!child) return;
+    Entry e;
+    e.node = child;
+    e.label = label;
+    e.firstChild = e.numChildren = 0;
+    ClearFields(&e.fields, NumImageKinds);
+    entries.push_back(e);
+    if (current < entries.size() - 1) // the root is nobody's child
+        Current().numChildren++;
+}
+
+// Distance from a field at position from to position to, as stored
+static ImageOffset OffsetBetween(size_t from, size_t to) {
+    return (ImageOffset)((int64_t)to - (int64_t)from);
+}
+
+void ImageWriter::Build(Node *root, std::string *bytes) {
+    entries.clear();
+    current = 0;
+    AddChild(root);
+    // Each node queues its children behind everything queued so far,
+    // which is what makes siblings consecutive
+    for (current = 0; current < entries.size(); current++) {
+        Current().firstChild = entries.size();
+        Current().node->Describe(this);
+        Assert(Current().fields.kind != NumImageKinds);
+    }
+
+    size_t numDoubles = 0;
+    for (size_t i = 0; i < entries.size(); i++)
+        if (entries[i].fields.valueType == DoubleValue) numDoubles++;
+    size_t doublesStart = NodesStart + entries.size() * sizeof(ImageNode);
+    size_t stringsStart = doublesStart + numDoubles * sizeof(double);
+
+    std::string strings;
+    std::unordered_map<std::string_view, size_t> stringPos;
+    size_t nextDouble = doublesStart;
+    bytes->assign(stringsStart, '\0');
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        Entry &e = entries[i];
+        size_t pos = NodesStart + i * sizeof(ImageNode);
+        ImageNode rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.kind = e.fields.kind;
+        yyltype *loc = e.node->GetLocation();
+        if (loc) {
+            rec.hasLocation = 1;
+            rec.firstLine = loc->first_line;
+            rec.firstColumn = loc->first_column;
+            rec.lastLine = loc->last_line;
+            rec.lastColumn = loc->last_column;
+        }
+        rec.numChildren = e.numChildren;
+        if (e.numChildren)
+            rec.firstChild = OffsetBetween(pos + offsetof(ImageNode, firstChild),
+                                           NodesStart + e.firstChild * sizeof(ImageNode));
+        const char *str[2] = { e.label, e.fields.valueType == TextValue ? e.fields.text : NULL };
+        ImageOffset *field[2] = { &rec.label, &rec.text };
+        size_t fieldPos[2] = { offsetof(ImageNode, label), offsetof(ImageNode, text) };
+        for (int j = 0; j < 2; j++) {
+            if (!str[j]) continue;
+            std::string_view key(str[j]);  // the nodes outlive the map
+            std::unordered_map<std::string_view, size_t>::iterator it = stringPos.find(key);
+            if (it == stringPos.end()) {
+                it = stringPos.insert(std::make_pair(key, stringsStart + strings.size())).first;
+                strings.append(str[j], key.size() + 1);
+            }
+            *field[j] = OffsetBetween(pos + fieldPos[j], it->second);
+        }
+        if (e.fields.valueType == IntValue)
+            rec.intValue = e.fields.intValue;
+        if (e.fields.valueType == DoubleValue) {
+            rec.text = OffsetBetween(pos + offsetof(ImageNode, text), nextDouble);
+            memcpy(&(*bytes)[nextDouble], &e.fields.doubleValue, sizeof(double));
+            nextDouble += sizeof(double);
+        }
+        memcpy(&(*bytes)[pos], &rec, sizeof(rec));
+    }
+    bytes->append(strings);
+
+    ImageHeader header;
+    memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = ImageVersion;
+    header.size = bytes->size();
+    header.numNodes = entries.size();
+    header.stringsStart = stringsStart;
+    memcpy(&(*bytes)[0], &header, sizeof(header));
+}
+
+bool WriteImageFile(Node *root, const char *path) {
+    std::string bytes;
+    ImageWriter().Build(root, &bytes);
+    FILE *fp = fopen(path, "wb");
+    if (!fp) return false;
+    bool ok = fwrite(bytes.data(), 1, bytes.size(), fp) == bytes.size();
+    return (fclose(fp) == 0) && ok;
+}
+
+
+/* Loader
+ * ------
+ */
+
+// Position in the image that the offset stored in field refers to
+static int64_t Target(const char *base, const ImageOffset *field) {
+    return ((const char *)field - base) + (int64_t)*field;
+}
+
+bool ValidateImage(const void *image, size_t size) {
+    const char *base = (const char *)image;
+    ImageHeader header;
+    if (size < NodesStart) return false;
+    memcpy(&header, base, sizeof(header));
+    if (memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != ImageVersion
+        || header.size != size || header.numNodes == 0)
+        return false;
+    uint64_t nodesEnd = NodesStart + (uint64_t)header.numNodes * sizeof(ImageNode);
+    if (nodesEnd > header.stringsStart || header.stringsStart > size)
+        return false;
+    if (header.stringsStart < size && base[size - 1] != '\0')
+        return false;   // so every string in the image is terminated
+
+    const ImageNode *nodes = (const ImageNode *)(base + NodesStart);
+    uint64_t expectedChild = 1;   // breadth-first: children come in order
+    for (uint32_t i = 0; i < header.numNodes; i++) {
+        const ImageNode *n = &nodes[i];
+        if (n->kind >= NumImageKinds) return false;
+        if (n->numChildren) {
+            int64_t first = Target(base, &n->firstChild);
+            if (first != (int64_t)(NodesStart + expectedChild * sizeof(ImageNode)))
+                return false;
+            expectedChild += n->numChildren;
+            if (expectedChild > header.numNodes) return false;
+        }
+        if (n->label) {
+            int64_t at = Target(base, &n->label);
+            if (at < header.stringsStart || at >= (int64_t)size) return false;
+        }
+        if (n->GetKind() == IK_DoubleConstant) {
+            int64_t at = Target(base, &n->text);
+            if (!n->text || at < (int64_t)nodesEnd || at + (int64_t)sizeof(double) > header.stringsStart)
+                return false;
+        } else if (HasText(n->GetKind())) {
+            int64_t at = Target(base, &n->text);
+            if (!n->text || at < header.stringsStart || at >= (int64_t)size) return false;
+        }
+    }
+    return expectedChild == header.numNodes;
+}
+
+const ImageNode *MapImageFile(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    void *image = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        image = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) return NULL;
+    if (!ValidateImage(image, st.st_size)) {
+        munmap(image, st.st_size);
+        return NULL;
+    }
+    return (const ImageNode *)((const char *)image + NodesStart);
+}
+
+
+/* Printer
+ * -------
+ */
+
+static const size_t FlushSize = 1 << 16;
+static const int NumSpaces = 3;
+
+TreePrinter::TreePrinter(TreeFormat f) {
+    format = f;
+    out.reserve(FlushSize + 1024);
+}
+
+TreePrinter::~TreePrinter() {
+    Flush();
+    fflush(stdout);
+}
+
+void TreePrinter::Flush() {
+    fwrite(out.data(), 1, out.size(), stdout);
+    out.clear();
+}
+
+void TreePrinter::Indent(int n) {
+    if ((int)spaces.size() < n) spaces.resize(2 * n, ' ');
+    out.append(spaces.data(), n);
+}
+
+// Same as printf("%*d", width, value)
+void TreePrinter::AppendInt(int value, int width) {
+    char digits[16];
+    int len = 0;
+    unsigned int mag = value < 0 ? 0u - (unsigned int)value : value;
+    do {
+        digits[len++] = '0' + mag % 10;
+        mag /= 10;
+    } while (mag);
+    if (value < 0) digits[len++] = '-';
+    if (width > len) Indent(width - len);
+    while (len) out += digits[--len];
+}
+
+void TreePrinter::AppendValue(const NodeFields &f) {
+    switch (f.kind) {
+      case IK_IntConstant:
+        AppendInt(f.intValue);
+        break;
+      case IK_BoolConstant:
+        out.append(f.intValue ? "true" : "false");
+        break;
+      case IK_DoubleConstant: {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%g", f.doubleValue);
+        out.append(buf);
+        break;
+      }
+      default:
+        if (f.text) out.append(f.text);
+    }
+}
+
+void TreePrinter::PrintNode(const NodeFields &f, bool hasLocation, int line,
+                            int level, const char *label) {
+    if (format == TreeCompact) {
+        AppendInt(level);
+        out += '\t';
+        if (hasLocation) AppendInt(line);
+        out += '\t';
+        out.append(ImageKindNames[f.kind]);
+        out += '\t';
+        if (label) { // "(body) " -> "body"
+            const char *start = label + (*label == '(');
+            const char *end = strchr(start, ')');
+            out.append(start, end ? end - start : strlen(start));
+        }
+        out += '\t';
+        AppendValue(f);
+        out += '\n';
+    } else {
+        out += '\n';
+        if (hasLocation)
+            AppendInt(line, NumSpaces);
+        else
+            Indent(NumSpaces);
+        Indent(level*NumSpaces);
+        if (label) out.append(label);
+        out.append(ImageKindNames[f.kind]);
+        out.append(": ");
+        AppendValue(f);
+    }
+    if (out.size() >= FlushSize) Flush();
+}
+
+// Called once the children of a node have been printed
+void TreePrinter::EndNode(const NodeFields &f) {
+    if (format == TreeDefault && f.kind == IK_Program)
+        out += '\n';
+}
+
+void TreePrinter::BeginNode(Node *n, ImageKind kind) {
+    fields.kind = kind;
+}
+
+void TreePrinter::SetText(const char *text) {
+    fields.valueType = TextValue;
+    fields.text = text;
+}
+
+void TreePrinter::SetInt(int value) {
+    fields.valueType = IntValue;
+    fields.intValue = value;
+}
+
+void TreePrinter::SetDouble(double value) {
+    fields.valueType = DoubleValue;
+    fields.doubleValue = value;
+}
+
+void TreePrinter::AddChild(Node *child, const char *label) {
+    if (!child) return;
+    Pending p = { child, label, childLevel };
+    stack.push_back(p);
+}
+
+// The children of a node are pushed in print order and then reversed
+// in place so the first one is popped first. A Pending with no node
+// marks the end of a Program.
+void TreePrinter::Print(Node *root, int indentLevel, const char *label) {
+    Pending start = { root, label, indentLevel };
+    stack.push_back(start);
+    while (!stack.empty()) {
+        Pending p = stack.back();
+        stack.pop_back();
+        if (!p.node) {
+            ClearFields(&fields, IK_Program);
+            EndNode(fields);
+            continue;
+        }
+        ClearFields(&fields, NumImageKinds);
+        firstChild = stack.size();
+        childLevel = p.level + 1;
+        p.node->Describe(this);
+        Assert(fields.kind != NumImageKinds);
+        yyltype *loc = p.node->GetLocation();
+        PrintNode(fields, loc != NULL, loc ? loc->first_line : 0, p.level, p.label);
+        std::reverse(stack.begin() + firstChild, stack.end());
+        if (fields.kind == IK_Program) {
+            Pending end = { NULL, NULL, 0 };
+            stack.insert(stack.begin() + firstChild, end);
+        }
+    }
+}
+
+void PrintImage(const ImageNode *root, TreeFormat format) {
+    struct Pending { const ImageNode *node; int level; };
+    std::vector<Pending> stack;
+    TreePrinter printer(format);
+    NodeFields fields;
+    Pending start = { root, 0 };
+    stack.push_back(start);
+    while (!stack.empty()) {
+        Pending p = stack.back();
+        stack.pop_back();
+        if (!p.node) {
+            ClearFields(&fields, IK_Program);
+            printer.EndNode(fields);
+            continue;
+        }
+        const ImageNode *n = p.node;
+        ClearFields(&fields, n->GetKind());
+        switch (n->GetKind()) {
+          case IK_IntConstant: case IK_BoolConstant:
+            fields.valueType = IntValue;
+            fields.intValue = n->intValue;
+            break;
+          case IK_DoubleConstant:
+            fields.valueType = DoubleValue;
+            fields.doubleValue = n->GetDoubleValue();
+            break;
+          default:
+            if (HasText(n->GetKind())) {
+                fields.valueType = TextValue;
+                fields.text = n->GetText();
+            }
+        }
+        printer.PrintNode(fields, n->hasLocation, n->firstLine, p.level, n->GetLabel());
+        if (n->GetKind() == IK_Program) {
+            Pending end = { NULL, 0 };
+            stack.push_back(end);
+        }
+        for (int i = n->NumChildren() - 1; i >= 0; i--) {
+            Pending child = { n->Child(i), p.level + 1 };
+            stack.push_back(child);
+        }
+    }
+}
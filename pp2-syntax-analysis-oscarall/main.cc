@@ -9,6 +9,7 @@
 #include "utility.h"
 #include "errors.h"
 #include "parser.h"
+#include "astimage.h"
 
 
 /* Function: main()
@@ -17,15 +18,48 @@
  * on any debugging flags requested by the user when invoking the program.
  * InitScanner() is used to set up the scanner.
  * InitParser() is used to set up the parser. The call to yyparse() will
- * attempt to parse a complete program from the input. 
+ * attempt to parse a complete program from the input, and if that went
+ * without errors the tree is printed. 
+ *
+ * --emit-image=<file> also saves the tree as a mappable image, and
+ * --load-image=<file> prints the tree saved in an image instead of
+ * reading a program (see astimage.h). --tree=compact prints the tree in
+ * the dense one-line-per-node format instead (see TreePrinter).
  */
 int main(int argc, char *argv[])
 {
     ParseCommandLine(argc, argv);
+
+    TreeFormat format = TreeDefault;
+    const char *treeOption = GetOption("tree");
+    if (treeOption && strcmp(treeOption, "compact") == 0)
+        format = TreeCompact;
+    else if (treeOption && strcmp(treeOption, "default") != 0) {
+        fprintf(stderr, "Unknown tree format %s, expected default or compact\n", treeOption);
+        return 2;
+    }
+
+    const char *imageFile = GetOption("load-image");
+    if (imageFile) {
+        const ImageNode *root = MapImageFile(imageFile);
+        if (!root) {
+            fprintf(stderr, "Cannot load tree image %s\n", imageFile);
+            return 2;
+        }
+        PrintImage(root, format);
+        return 0;
+    }
   
     InitScanner();
     InitParser();
     yyparse();
+    if (gProgram && ReportError::NumErrors() == 0) {
+        gProgram->Print(0, NULL, format);
+        imageFile = GetOption("emit-image");
+        if (imageFile && !WriteImageFile(gProgram, imageFile)) {
+            fprintf(stderr, "Cannot write tree image %s\n", imageFile);
+            return 2;
+        }
+    }
     return (ReportError::NumErrors() == 0? 0 : -1);
 }
-
@@ -34,5 +34,6 @@
 
 int yyparse();              // Defined in the generated y.tab.c file
 void InitParser();          // Defined in parser.y
+extern Program *gProgram;   // Tree built by a successful yyparse()
 
 #endif
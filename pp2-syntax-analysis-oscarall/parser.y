@@ -22,6 +22,8 @@
 
 void yyerror(char *msg); // standard error-handling routine
 
+Program *gProgram = NULL;
+
 %}
 
 /* The section before the first %% is the Definitions section of the yacc
@@ -164,10 +166,8 @@ Program   :    DeclList            {
                                       /* pp2: The @1 is needed to convince 
                                        * yacc to set up yylloc. You can remove 
                                        * it once you have other uses of @n*/
-                                      Program *program = new Program($1);
-                                      // if no errors, advance to next phase
-                                      if (ReportError::NumErrors() == 0) 
-                                          program->Print(0);
+                                      // main() prints it if there were no errors
+                                      gProgram = new Program($1);
                                     }
           |    error                {
                                         ReportError::Formatted(&yylloc, "%s", "parse error");
@@ -65,7 +65,8 @@ class Identifier : public Node
 // encountered syntax errors during parsing. The partial completed tree
 // is discarded along with the states being popped, and an instance of
 // the Error class can stand in as the placeholder in the parse tree
-// when your parser can continue after an error.
+// when your parser can continue after an error. In a list of statements
+// that is an ErrorStmt (see ast_stmt.h), which is a Stmt as well.
 class Error : public Node
 {
   public:
@@ -20,10 +20,7 @@ void Decl::Check(Hashtable <Decl*> * symbolTable) {
 
 Hashtable<Decl*> * GetSymbolTableDecl(List<Decl*> * declist) {
     Hashtable<Decl*> * symbolTable = new Hashtable<Decl*>;
-    int declNumber = declist->NumElements();
-
-    for(int i = 0; i < declNumber; i++) {
-        Decl *decl = declist->Nth(i);
+    for (Decl *decl : *declist) {
         char * id = decl->GetId();
         if (!(symbolTable->Lookup(id))) {
             symbolTable->Enter(id, decl);
@@ -37,10 +34,7 @@ Hashtable<Decl*> * GetSymbolTableDecl(List<Decl*> * declist) {
 
 Hashtable<Decl*> * GetSymbolTableDecl(List<VarDecl*> * declist) {
     Hashtable<Decl*> * symbolTable = new Hashtable<Decl*>;
-    int declNumber = declist->NumElements();
-
-    for(int i = 0; i < declNumber; i++) {
-        Decl *decl = declist->Nth(i);
+    for (Decl *decl : *declist) {
         char * id = decl->GetId();
         if (!(symbolTable->Lookup(id))) {
             symbolTable->Enter(id, decl);
@@ -75,10 +69,7 @@ void FnDecl::Check(Hashtable <Decl*> * symbolTable) {
 
     returnType->Check(symbolTable, LookingForType);
 
-    int declNumber = formals->NumElements();
-
-    for(int i = 0; i < declNumber; i++) {
-        VarDecl *decl = formals->Nth(i);
+    for (VarDecl *decl : *formals) {
         decl->Check(symbolTable);
     }
 
@@ -105,11 +96,9 @@ void ClassDecl::Check(Hashtable <Decl*> * symbolTable) {
         }
     }
 
-    int numberOfInterfaces = implements->NumElements();
     interfaces = new List<InterfaceDecl*>;
 
-    for(int i = 0; i < numberOfInterfaces; i++) {
-        NamedType * interface = implements->Nth(i);
+    for (NamedType * interface : *implements) {
         interface->Check(symbolTable, LookingForInterface);
         Decl * decl = symbolTable->Lookup(interface->GetIdentifier()->GetName());
         if (decl) {
@@ -121,19 +110,14 @@ void ClassDecl::Check(Hashtable <Decl*> * symbolTable) {
     CreateSymbolTable();
     Hashtable<Decl*> * unifiedSymbolTable = UnifySymbolTables(symbolTable, classSymbolTable);
 
-    int numberOfMembers = members->NumElements();
-
-    for(int i = 0; i < numberOfMembers; i++) {
-        members->Nth(i)->Check(unifiedSymbolTable);
+    for (Decl * member : *members) {
+        member->Check(unifiedSymbolTable);
     }
 }
 
 Hashtable <Decl*> * InterfaceDecl::GetSymbolTable() {
     Hashtable<Decl*> * symbolTable = new Hashtable<Decl*>;
-    int declNumber = members->NumElements();
-
-    for(int i = 0; i < declNumber; i++) {
-        Decl *decl = members->Nth(i);
+    for (Decl *decl : *members) {
         char *id = decl->GetId();
         if (!(symbolTable->Lookup(id))) {
             symbolTable->Enter(id, decl);
@@ -153,10 +137,7 @@ Hashtable<Decl*> * ClassDecl::GetInheritedSymbolTable() {
         }
     }
 
-    int numberOfInterfaces = interfaces->NumElements();
-    
-    for(int i = 0; i < numberOfInterfaces; i++) {
-        Decl * decl = interfaces->Nth(i);
+    for (Decl * decl : *interfaces) {
         InterfaceDecl * intDecl = dynamic_cast<InterfaceDecl*>(decl);
         if (intDecl) {
             Iterator<Decl *> iter = intDecl->GetSymbolTable()->GetIterator();
@@ -242,7 +223,9 @@ ClassDecl::ClassDecl(Identifier *n, NamedType *ex, List<NamedType*> *imp, List<D
     extends = ex;
     if (extends) extends->SetParent(this);
     (implements=imp)->SetParentAll(this);
+    implements->Freeze();
     (members=m)->SetParentAll(this);
+    members->Freeze();
     hasChecked = false;
 }
 
@@ -250,6 +233,7 @@ ClassDecl::ClassDecl(Identifier *n, NamedType *ex, List<NamedType*> *imp, List<D
 InterfaceDecl::InterfaceDecl(Identifier *n, List<Decl*> *m) : Decl(n) {
     Assert(n != NULL && m != NULL);
     (members=m)->SetParentAll(this);
+    members->Freeze();
 }
 
 	
@@ -257,6 +241,7 @@ FnDecl::FnDecl(Identifier *n, Type *r, List<VarDecl*> *d) : Decl(n) {
     Assert(n != NULL && r!= NULL && d != NULL);
     (returnType=r)->SetParent(this);
     (formals=d)->SetParentAll(this);
+    formals->Freeze();
     body = NULL;
 }
 
@@ -13,14 +13,12 @@
 Program::Program(List<Decl*> *d) {
     Assert(d != NULL);
     (decls=d)->SetParentAll(this);
+    decls->Freeze();
 }
 
 Hashtable<Decl*> * GetSymbolTable(List<Decl*> * declist) {
     Hashtable<Decl*> * symbolTable = new Hashtable<Decl*>;
-    int declNumber = declist->NumElements();
-
-    for(int i = 0; i < declNumber; i++) {
-        Decl *decl = declist->Nth(i);
+    for (Decl *decl : *declist) {
         char * id = decl->GetId();
         if (!(symbolTable->Lookup(id))) {
             symbolTable->Enter(id, decl);
@@ -34,10 +32,7 @@ Hashtable<Decl*> * GetSymbolTable(List<Decl*> * declist) {
 
 Hashtable<Decl*> * GetSymbolTable(List<VarDecl*> * declist) {
     Hashtable<Decl*> * symbolTable = new Hashtable<Decl*>;
-    int declNumber = declist->NumElements();
-
-    for(int i = 0; i < declNumber; i++) {
-        Decl *decl = declist->Nth(i);
+    for (Decl *decl : *declist) {
         char * id = decl->GetId();
         if (!(symbolTable->Lookup(id))) {
             symbolTable->Enter(id, decl);
@@ -58,12 +53,9 @@ void Program::Check() {
      *      and polymorphism in the node classes.
      */
 
-    int declNumber = decls->NumElements();
-
     Hashtable<Decl*> * symbolTable = GetSymbolTable(decls);
 
-    for(int i = 0; i < declNumber; i++) {
-        Decl *decl = decls->Nth(i);
+    for (Decl *decl : *decls) {
         decl->Check(symbolTable);
     }
 }
@@ -80,38 +72,38 @@ Case::Case(Expr *i, List<Stmt*> *s) {
     Assert(i != NULL && s != NULL);
     (intConst=i)->SetParent(this);
     (stmtList=s)->SetParentAll(this);
+    stmtList->Freeze();
 }
 
 Default::Default(List<Stmt*> *s) {
     Assert(s != NULL);
     (stmtList=s)->SetParentAll(this);
+    stmtList->Freeze();
 }
 
 CaseBlock::CaseBlock(List<Case*> *c) {
     Assert(c != NULL);
     (caseList=c)->SetParentAll(this);
+    caseList->Freeze();
 }
 
 StmtBlock::StmtBlock(List<VarDecl*> *d, List<Stmt*> *s) {
     Assert(d != NULL && s != NULL);
     (decls=d)->SetParentAll(this);
+    decls->Freeze();
     (stmts=s)->SetParentAll(this);
+    stmts->Freeze();
 }
 
 void StmtBlock::Check(Hashtable <Decl*> * symbolTable) {
-    int numberOfDeclarations = decls->NumElements();
     Hashtable <Decl*> * blockSymbolTable = GetSymbolTable(decls);
 
-    for (int i = 0; i < numberOfDeclarations; i++) {
-        Decl * decl = decls->Nth(i);
+    for (Decl * decl : *decls) {
         decl->Check(symbolTable);
     }
 
     Hashtable <Decl*> * unifiedSymbolTable = UnifySymbolTables(symbolTable, blockSymbolTable);
-    int numberOfStatements = stmts->NumElements();
-
-    for (int i = 0; i < numberOfStatements; i++) {
-        Stmt * stmt = stmts->Nth(i);
+    for (Stmt * stmt : *stmts) {
         stmt->Check(unifiedSymbolTable);
     }
 }
@@ -143,6 +135,7 @@ ReturnStmt::ReturnStmt(yyltype loc, Expr *e) : Stmt(loc) {
 PrintStmt::PrintStmt(List<Expr*> *a) {    
     Assert(a != NULL);
     (args=a)->SetParentAll(this);
+    args->Freeze();
 }
 
 
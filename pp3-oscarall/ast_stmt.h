@@ -40,6 +40,14 @@ class Stmt : public Node
      virtual void Check(Hashtable <Decl*> * symbolTable) {}
 };
 
+// Stands in for a statement the parser skipped over after a syntax
+// error (see Error in ast.h); there is nothing in it to check
+class ErrorStmt : public Stmt
+{
+  public:
+     ErrorStmt(yyltype loc) : Stmt(loc) {}
+};
+
 class Default: public Stmt
 {
   protected:
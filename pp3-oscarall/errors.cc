@@ -183,10 +183,9 @@ void ReportError::BreakOutsideLoop(BreakStmt *bStmt) {
  * -------------------
  * Standard error-reporting function expected by yacc. Our version merely
  * just calls into the error reporter above, passing the location of
- * the last token read. If you want to suppress the ordinary "parse error"
- * message from yacc, you can implement yyerror to do nothing and
- * then call ReportError::Formatted yourself with a more descriptive 
- * message.
+ * the last token read. The parser recovers from syntax errors (see
+ * parser.y), so this is called once for each one it finds.
  */
 void yyerror(char *msg) {
+    ReportError::Formatted(&yylloc, "%s", "parse error");
 }
@@ -4,9 +4,19 @@
  *
  * pp3: add parser rules and tree construction from your pp2. You should
  *      not need to make any significant changes in the parser itself. After
- *      parsing completes, if no syntax errors were found, the parser calls
- *      program->Check() to kick off the semantic analyzer pass. The
- *      interesting work happens during the tree traversal.
+ *      parsing completes, the parser calls program->Check() to kick off the
+ *      semantic analyzer pass. The interesting work happens during the tree
+ *      traversal.
+ *
+ * Syntax errors are recovered from, so one run reports all of them: a
+ * statement with an error is skipped up to its ';', or over the block
+ * that follows (as after a bad if or while header), and replaced by an
+ * ErrorStmt; a declaration or field with an error is skipped the same
+ * way, or up to a stray '}', and left out of the tree. A class whose
+ * header has an error is skipped up to its '{' instead, and kept with
+ * its fields but no base class or interfaces, so its body is still
+ * parsed as fields and its uses do not report it undeclared. The rest
+ * of the program is still checked.
  */
 
 %{
@@ -134,24 +144,22 @@ void yyerror(char *msg); // standard error-handling routine
 Program   :    DeclList            { 
                                       @1; 
                                       Program *program = new Program($1);
-                                      // if no errors, advance to next phase
-                                      if (ReportError::NumErrors() == 0) 
-                                          program->Check(); 
-                                    }
-          |    error                {
-                                        ReportError::Formatted(&yylloc, "%s", "parse error");
-                                        return 1;
+                                      // what parsed is checked, even after syntax errors
+                                      program->Check(); 
                                     }
           ;
 
-DeclList  :    Decl                 { ($$ = new List<Decl*>)->Append($1); }
-          |    DeclList Decl        { ($$ = $1)->Append($2); }
+DeclList  :    Decl                 { $$ = new List<Decl*>; if ($1) $$->Append($1); }
+          |    DeclList Decl        { $$ = $1; if ($2) $$->Append($2); }
           ;
 
 Decl      :    VarDecl              { $$ = $1; }
           |    FuncDecl             { $$ = $1; }
           |    ClassDecl            { $$ = $1; }
           |    InterfaceDecl        { $$ = $1; }
+          |    error ';'            { yyerrok; $$ = NULL; }
+          |    error StmtBlock      { yyerrok; $$ = NULL; }
+          |    error '}'            { yyerrok; $$ = NULL; }
           ;
 
 InterfaceDecl: T_Interface Ident '{' Prototype '}'  { $$ = new InterfaceDecl($2, $4); }
@@ -170,6 +178,7 @@ PrototypeDecl: Type Ident '(' Formals ')' ';' { $$ = new FnDecl($2, $1, $4); }
           ;
 
 ClassDecl :    T_Class Ident Extends Implements '{' Field '}'   { $$ = new ClassDecl($2, $3, $4, $6); }
+          |    T_Class Ident error '{' Field '}'  { yyerrok; $$ = new ClassDecl($2, NULL, new List<NamedType*>, $5); }
           ;
 
 Extends   :    T_Extends Ident      { $$ = new NamedType($2); }
@@ -187,11 +196,13 @@ IdenList  :    Ident                { ($$ = new List<NamedType*>)->Append(new Na
 Field     :    FieldList            { $$ = $1; }
           |                         { $$ = new List<Decl*>; }
 
-FieldList :    Fields               { ($$ = new List<Decl*>)->Append($1); }
-          |    FieldList Fields     { ($$ = $1)->Append($2); }
+FieldList :    Fields               { $$ = new List<Decl*>; if ($1) $$->Append($1); }
+          |    FieldList Fields     { $$ = $1; if ($2) $$->Append($2); }
 
 Fields    :    VarDecl              { $$ = $1; }
           |    FuncDecl             { $$ = $1; }
+          |    error ';'            { yyerrok; $$ = NULL; }
+          |    error StmtBlock      { yyerrok; $$ = NULL; }
           ;
 
 VarDecl   :    Variable ';'         { $$ = $1; };
@@ -253,6 +264,8 @@ Stmt      :    Expr ';'             { $$ = $1; }
           |    BreakStmt            { $$ = $1; }
           |    SwitchStmt           { $$ = $1; }
           |    StmtBlock            { $$ = $1; }
+          |    error ';'            { yyerrok; $$ = new ErrorStmt(@1); }
+          |    error StmtBlock      { yyerrok; $$ = new ErrorStmt(@1); }
           ;
 
 SwitchStmt:    T_Switch '(' Expr ')' '{' CaseList Default '}'   { $$ = new SwitchStmt($3, new CaseBlock($6), $7); }
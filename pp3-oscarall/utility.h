@@ -34,9 +34,15 @@ void Failure(const char *format, ...);
  * will print something similar to the following if ptr is NULL:
  *   *** Failure: Assertion failed: hashtable.cc, line 55:
  *       ptr != NULL
+ * Release builds compiled with -DNDEBUG drop the test entirely, so
+ * asserts are free in hot loops such as the List accessors.
  */ 
+#ifdef NDEBUG
+#define Assert(expr)  ((void)0)
+#else
 #define Assert(expr)  \
   ((expr) ? (void)0 : Failure("Assertion failed: %s, line %d:\n    %s", __FILE__, __LINE__, #expr))
+#endif
 
 
 
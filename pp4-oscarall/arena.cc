@@ -0,0 +1,39 @@
+/* File: arena.cc
+ * --------------
+ * Implementation of the bump allocator. Chunks are grabbed from malloc
+ * as needed, and requests larger than a quarter chunk get a chunk of
+ * their own so they don't waste the tail of the current one.
+ */
+
+#include "arena.h"
+#include "utility.h"
+
+static const size_t ChunkSize = 64 * 1024;
+static const size_t Alignment = sizeof(double) > sizeof(void*) ? sizeof(double) : sizeof(void*);
+
+static char *next = NULL, *limit = NULL;
+static size_t bytesUsed = 0;
+
+void *ArenaAlloc(size_t size)
+{
+    size = (size + Alignment - 1) & ~(Alignment - 1);
+    bytesUsed += size;
+    if (size > ChunkSize / 4) {
+        void *block = malloc(size);
+        if (!block) Failure("Out of memory in arena");
+        return block;
+    }
+    if (next == NULL || size > (size_t)(limit - next)) {
+        next = (char *)malloc(ChunkSize);
+        if (!next) Failure("Out of memory in arena");
+        limit = next + ChunkSize;
+    }
+    void *block = next;
+    next += size;
+    return block;
+}
+
+size_t ArenaBytesUsed()
+{
+    return bytesUsed;
+}
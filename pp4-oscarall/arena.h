@@ -0,0 +1,33 @@
+/* File: arena.h
+ * -------------
+ * A simple bump allocator for data that lives as long as the parse
+ * tree. Memory is carved sequentially out of large chunks and is never
+ * freed piece by piece; like the tree nodes themselves, it all goes
+ * away when the compiler exits. This makes an allocation little more
+ * than a pointer increment and packs related data (such as the frozen
+ * child lists of the tree, see List::Freeze) close together in memory.
+ */
+
+#ifndef _H_arena
+#define _H_arena
+
+#include <stddef.h>
+
+
+/* Function: ArenaAlloc()
+ * Usage: Decl **span = (Decl **)ArenaAlloc(n * sizeof(Decl*));
+ * -------------------------------------------------------------
+ * Returns a block of at least size bytes, aligned for any type. The
+ * block is not initialized and must never be passed to free/delete.
+ */
+void *ArenaAlloc(size_t size);
+
+
+/* Function: ArenaBytesUsed()
+ * Usage: PrintDebug("arena", "%lu bytes", ArenaBytesUsed());
+ * ----------------------------------------------------------
+ * Returns the number of bytes handed out so far, for statistics.
+ */
+size_t ArenaBytesUsed();
+
+#endif
@@ -6,20 +6,43 @@
 #include "ast_type.h"
 #include "ast_decl.h"
 #include "hashtable.h"
+#include "scope.h"
+#include "astcache.h"
 #include <string.h> // strdup
 #include <stdio.h>  // printf
 
+std::vector<yyltype*> *Node::locationLog = NULL;
+
 Node::Node(yyltype loc) {
     location = new yyltype(loc);
+    if (locationLog) locationLog->push_back(location);
     parent = NULL;
+    nodeScope = NULL;
 }
 
 Node::Node() {
     location = NULL;
     parent = NULL;
+    nodeScope = NULL;
+}
+
+Decl *Node::FindDecl(Identifier *idToFind) {
+    Decl *mine;
+    if (!nodeScope) PrepareScope();
+    if (nodeScope && (mine = nodeScope->Lookup(idToFind)))
+        return mine;
+    return parent ? parent->FindDecl(idToFind) : NULL;
+}
+
+void Node::Serialize(AstWriter *out) {
+    Failure("Node at %p has no cache serialization", this);
 }
 	 
 Identifier::Identifier(yyltype loc, const char *n) : Node(loc) {
     name = strdup(n);
-} 
+}
 
+void Identifier::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_Identifier);
+    out->WriteName(name);
+}
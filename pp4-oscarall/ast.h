@@ -23,7 +23,9 @@
  * node classes. Your semantic analyzer should do an inorder walk on the
  * parse tree, and when visiting each node, verify the particular
  * semantic rules that apply to that construct.
-
+ *
+ * Code generation: Once a program checks without errors, Emit lowers it
+ * into three-address code through a CodeGenerator (see codegen.h).
  */
 
 #ifndef _H_ast
@@ -32,20 +34,48 @@
 #include <stdlib.h>   // for NULL
 #include "location.h"
 #include <iostream>
+#include <vector>
+
+class AstWriter;
+class CodeGenerator;
+class Decl;
+class Identifier;
+class Scope;
 
 class Node 
 {
   protected:
     yyltype *location;
     Node *parent;
+    Scope *nodeScope;   // declarations introduced by this node, if any
 
   public:
     Node(yyltype loc);
     Node();
+    virtual ~Node() {}
+
+    // While set, the location of every node built is added to it, so
+    // a tree can be moved to other lines later (see server.h)
+    static std::vector<yyltype*> *locationLog;
     
     yyltype *GetLocation()   { return location; }
     void SetParent(Node *p)  { parent = p; }
     Node *GetParent()        { return parent; }
+
+    virtual void Check() {}
+    virtual Scope *PrepareScope() { return NULL; }
+    virtual void Emit(CodeGenerator *cg) {}  // see codegen.h
+
+    // Writes this node and its subtree for the tree cache (astcache.h).
+    // RestoreLink is how the cache reader hands back a link resolved
+    // by Check that the constructors can't rebuild.
+    virtual void Serialize(AstWriter *out);
+    virtual void RestoreLink(int which, Node *to) {}
+
+    // Looks for the declaration of id in this node's scope and then
+    // outwards through the scopes of its ancestors. Returns NULL if
+    // no enclosing scope declares it.
+    Decl *FindDecl(Identifier *id);
 };
    
 
@@ -58,6 +88,7 @@ class Identifier : public Node
     Identifier(yyltype loc, const char *name);
     friend std::ostream& operator<<(std::ostream& out, Identifier *id) { return out << id->name; }
     char * GetName() { return name; }
+    void Serialize(AstWriter *out);
 };
 
 
@@ -7,11 +7,15 @@
 #include "ast_stmt.h"
 #include "scope.h"
 #include "errors.h"
+#include "astcache.h"
+#include "codegen.h"
+#include "symindex.h"
         
          
 Decl::Decl(Identifier *n) : Node(*n->GetLocation()) {
     Assert(n != NULL);
     (id=n)->SetParent(this); 
+    if (SymbolIndex::current) SymbolIndex::current->AddDecl(this);
 }
 
 bool Decl::ConflictsWithPrevious(Decl *prev) {
@@ -26,13 +30,21 @@ VarDecl::VarDecl(Identifier *n, Type *t) : Decl(n) {
   
 void VarDecl::Check() { type->Check(); }
 
+void VarDecl::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_VarDecl);
+    out->WriteNode(id);
+    out->WriteNode(type);
+}
+
 ClassDecl::ClassDecl(Identifier *n, NamedType *ex, List<NamedType*> *imp, List<Decl*> *m) : Decl(n) {
     // extends can be NULL, impl & mem may be empty lists but cannot be NULL
     Assert(n != NULL && imp != NULL && m != NULL);     
     extends = ex;
     if (extends) extends->SetParent(this);
     (implements=imp)->SetParentAll(this);
+    implements->Freeze();
     (members=m)->SetParentAll(this);
+    members->Freeze();
     cType = new NamedType(n);
     cType->SetParent(this);
     convImp = NULL;
@@ -79,11 +91,41 @@ Scope *ClassDecl::PrepareScope()
     return nodeScope;
 }
 
+void ClassDecl::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_ClassDecl);
+    out->WriteNode(id);
+    out->WriteNode(extends);
+    out->WriteList(implements);
+    out->WriteList(members);
+}
+
+ClassDecl *ClassDecl::GetBaseClass() {
+    return extends ? dynamic_cast<ClassDecl*>(extends->GetDeclForType()) : NULL;
+}
+
+bool ClassDecl::IsSubtypeOf(Decl *other) {
+    for (ClassDecl *cd = this; cd; cd = cd->GetBaseClass()) {
+        if (cd == other) return true;
+        for (NamedType *in : *cd->implements)
+            if (in->GetDeclForType() == other) return true;
+    }
+    return false;
+}
+
+Decl *ClassDecl::LookupMember(Identifier *id) {
+    return PrepareScope()->Lookup(id);
+}
+
+void ClassDecl::Emit(CodeGenerator *cg) {
+    for (Decl *m : *members)
+        m->Emit(cg);
+}
 
 
 InterfaceDecl::InterfaceDecl(Identifier *n, List<Decl*> *m) : Decl(n) {
     Assert(n != NULL && m != NULL);
     (members=m)->SetParentAll(this);
+    members->Freeze();
 }
 
 void InterfaceDecl::Check() {
@@ -97,11 +139,22 @@ Scope *InterfaceDecl::PrepareScope() {
     members->DeclareAll(nodeScope);
     return nodeScope;
 }
+
+void InterfaceDecl::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_InterfaceDecl);
+    out->WriteNode(id);
+    out->WriteList(members);
+}
+
+Decl *InterfaceDecl::LookupMember(Identifier *id) {
+    return PrepareScope()->Lookup(id);
+}
 	
 FnDecl::FnDecl(Identifier *n, Type *r, List<VarDecl*> *d) : Decl(n) {
     Assert(n != NULL && r!= NULL && d != NULL);
     (returnType=r)->SetParent(this);
     (formals=d)->SetParentAll(this);
+    formals->Freeze();
     body = NULL;
 }
 
@@ -112,13 +165,19 @@ void FnDecl::SetFunctionBody(Stmt *b) {
 void FnDecl::Check() {
     returnType->Check();
     if (body) {
-        nodeScope = new Scope();
-        formals->DeclareAll(nodeScope);
+        PrepareScope();
         formals->CheckAll();
 	body->Check();
     }
 }
 
+Scope *FnDecl::PrepareScope() {
+    if (nodeScope || !body) return nodeScope; // prototypes have no scope
+    nodeScope = new Scope();
+    formals->DeclareAll(nodeScope);
+    return nodeScope;
+}
+
 bool FnDecl::ConflictsWithPrevious(Decl *prev) {
  // special case error for method override
     if (IsMethodDecl() && prev->IsMethodDecl() && parent != prev->GetParent()) { 
@@ -145,5 +204,17 @@ bool FnDecl::MatchesPrototype(FnDecl *other) {
     return true;
 }
 
+void FnDecl::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_FnDecl);
+    out->WriteNode(id);
+    out->WriteNode(returnType);
+    out->WriteList(formals);
+    out->WriteNode(body);
+}
 
-
+void FnDecl::Emit(CodeGenerator *cg) {
+    if (!body) return;
+    cg->BeginFunction(cg->FunctionFor(this), formals);
+    body->Emit(cg);
+    cg->EndFunction();
+}
@@ -48,6 +48,8 @@ class VarDecl : public Decl
     VarDecl(Identifier *name, Type *type);
     void Check();
     Type *GetDeclaredType() { return type; }
+    bool IsVarDecl() { return true; }
+    void Serialize(AstWriter *out);
 };
 
 class ClassDecl : public Decl 
@@ -65,6 +67,14 @@ class ClassDecl : public Decl
     void Check();
     bool IsClassDecl() { return true; }
     Scope *PrepareScope();
+    void Serialize(AstWriter *out);
+    void Emit(CodeGenerator *cg);
+
+    List<Decl*> *GetMembers() { return members; }
+    Type *GetClassType() { return cType; }
+    ClassDecl *GetBaseClass();        // NULL if it extends nothing
+    bool IsSubtypeOf(Decl *other);    // class or interface, itself included
+    Decl *LookupMember(Identifier *id); // including inherited ones
 };
 
 class InterfaceDecl : public Decl 
@@ -77,6 +87,10 @@ class InterfaceDecl : public Decl
     void Check();
     bool IsInterfaceDecl() { return true; }
     Scope *PrepareScope();
+    void Serialize(AstWriter *out);
+
+    List<Decl*> *GetMembers() { return members; }
+    Decl *LookupMember(Identifier *id);
 };
 
 class FnDecl : public Decl 
@@ -90,10 +104,16 @@ class FnDecl : public Decl
     FnDecl(Identifier *name, Type *returnType, List<VarDecl*> *formals);
     void SetFunctionBody(Stmt *b);
     void Check();
+    Scope *PrepareScope();
     bool IsFnDecl() { return true; }
     bool IsMethodDecl();
     bool ConflictsWithPrevious(Decl *prev);
     bool MatchesPrototype(FnDecl *other);
+    void Serialize(AstWriter *out);
+    void Emit(CodeGenerator *cg);
+
+    List<VarDecl*> *GetFormals() { return formals; }
+    Type *GetReturnType() { return returnType; }
 };
 
 #endif
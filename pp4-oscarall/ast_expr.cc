@@ -8,29 +8,167 @@
 #include <string.h>
 
 #include "errors.h"
+#include "astcache.h"
+#include "codegen.h"
+#include "depgraph.h"
 
 
+// The class whose code n is part of, if any
+static ClassDecl *EnclosingClass(Node *n) {
+    for (; n; n = n->GetParent())
+        if (ClassDecl *cd = dynamic_cast<ClassDecl*>(n)) return cd;
+    return NULL;
+}
+
+// The class or interface a type names, if any
+static Decl *DeclForType(Type *t) {
+    NamedType *nt = dynamic_cast<NamedType*>(t);
+    return nt ? nt->GetDeclForType() : NULL;
+}
+
+// A declared type that names no class or interface (or an array of
+// one) has been reported where it was declared, so whatever has that
+// type is in error
+static Type *ResolvedOrError(Type *t) {
+    Type *elem = t;
+    while (ArrayType *at = dynamic_cast<ArrayType*>(elem)) elem = at->GetType();
+    NamedType *nt = dynamic_cast<NamedType*>(elem);
+    return (nt && !nt->GetDeclForType()) ? Type::errorType : t;
+}
+
+static bool IsNumeric(Type *t) {
+    return t == Type::intType || t == Type::doubleType;
+}
+
+// Reports the operands of op as not going together, unless one of them
+// is in error already (and so has been reported where that happened)
+static void ReportOperands(Operator *op, Expr *left, Expr *right) {
+    Type *lt = left ? left->GetType() : NULL, *rt = right->GetType();
+    if (lt == Type::errorType || rt == Type::errorType) return;
+    if (left)
+        ReportError::IncompatibleOperands(op, lt, rt);
+    else
+        ReportError::IncompatibleOperand(op, rt);
+}
+
+Type *Expr::GetType() {
+    return Type::errorType;
+}
+
+int Expr::EmitValue(CodeGenerator *cg) {
+    Failure("Expression on line %d has no code generation",
+            location ? location->first_line : 0);
+    return NoTemp;
+}
+
+void Expr::EmitBranch(CodeGenerator *cg, BasicBlock *ifTrue, BasicBlock *ifFalse) {
+    cg->GenBranch(EmitValue(cg), ifTrue, ifFalse);
+}
+
+
+void EmptyExpr::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_EmptyExpr);
+}
+
+Type *EmptyExpr::GetType() {
+    return Type::voidType;
+}
+
+// Only reached if an empty expression is used for its value
+int EmptyExpr::EmitValue(CodeGenerator *cg) {
+    return cg->GenLoadInt(0);
+}
+
 IntConstant::IntConstant(yyltype loc, int val) : Expr(loc) {
     value = val;
 }
 
+void IntConstant::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_IntConstant);
+    out->WriteInt(value);
+}
+
+Type *IntConstant::GetType() {
+    return Type::intType;
+}
+
+int IntConstant::EmitValue(CodeGenerator *cg) {
+    return cg->GenLoadInt(value);
+}
+
 DoubleConstant::DoubleConstant(yyltype loc, double val) : Expr(loc) {
     value = val;
 }
 
+void DoubleConstant::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_DoubleConstant);
+    out->WriteDouble(value);
+}
+
+Type *DoubleConstant::GetType() {
+    return Type::doubleType;
+}
+
+int DoubleConstant::EmitValue(CodeGenerator *cg) {
+    return cg->GenLoadDouble(value);
+}
+
 BoolConstant::BoolConstant(yyltype loc, bool val) : Expr(loc) {
     value = val;
 }
 
+void BoolConstant::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_BoolConstant);
+    out->WriteInt(value);
+}
+
+Type *BoolConstant::GetType() {
+    return Type::boolType;
+}
+
+int BoolConstant::EmitValue(CodeGenerator *cg) {
+    return cg->GenLoadInt(value);
+}
+
 StringConstant::StringConstant(yyltype loc, const char *val) : Expr(loc) {
     Assert(val != NULL);
     value = strdup(val);
 }
 
+void StringConstant::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_StringConstant);
+    out->WriteString(value);
+}
+
+Type *StringConstant::GetType() {
+    return Type::stringType;
+}
+
+int StringConstant::EmitValue(CodeGenerator *cg) {
+    return cg->GenLoadString(value);
+}
+
+void NullConstant::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_NullConstant);
+}
+
+Type *NullConstant::GetType() {
+    return Type::nullType;
+}
+
+int NullConstant::EmitValue(CodeGenerator *cg) {
+    return cg->GenLoadNull();
+}
+
 Operator::Operator(yyltype loc, const char *tok) : Node(loc) {
     Assert(tok != NULL);
     strncpy(tokenString, tok, sizeof(tokenString));
 }
+
+void Operator::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_Operator);
+    out->WriteName(tokenString);
+}
 CompoundExpr::CompoundExpr(Expr *l, Operator *o, Expr *r) 
   : Expr(Join(l->GetLocation(), r->GetLocation())) {
     Assert(l != NULL && o != NULL && r != NULL);
@@ -46,12 +184,239 @@ CompoundExpr::CompoundExpr(Operator *o, Expr *r)
     (op=o)->SetParent(this);
     (right=r)->SetParent(this);
 }
+
+void CompoundExpr::Check() {
+    if (left) left->Check();
+    right->Check();
+}
+
+// left is written first (NULL for unary) so the reader can tell which
+// constructor to use
+void CompoundExpr::SerializeOperands(AstWriter *out) {
+    out->WriteNode(left);
+    out->WriteNode(op);
+    out->WriteNode(right);
+}
+
+void ArithmeticExpr::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_ArithmeticExpr);
+    SerializeOperands(out);
+}
+
+// Both operands int or both double; there is no floating-point %
+Type *ArithmeticExpr::GetType() {
+    Type *rt = right->GetType();
+    if (!left)
+        return IsNumeric(rt) ? rt : Type::errorType;
+    Type *lt = left->GetType();
+    if (lt != rt || !IsNumeric(lt)) return Type::errorType;
+    return (lt == Type::intType || op->str()[0] != '%') ? lt : Type::errorType;
+}
+
+void ArithmeticExpr::Check() {
+    CompoundExpr::Check();
+    if (GetType() == Type::errorType)
+        ReportOperands(op, left, right);
+}
+
+int ArithmeticExpr::EmitValue(CodeGenerator *cg) {
+    int l = left ? left->EmitValue(cg) : NoTemp, r = right->EmitValue(cg);
+    bool isDouble = (GetType() == Type::doubleType);
+    if (!left)
+        return cg->GenUnary(isDouble ? OP_FNeg : OP_Neg, r);
+    Opcode code;
+    switch (op->str()[0]) {
+      case '+': code = isDouble ? OP_FAdd : OP_Add; break;
+      case '-': code = isDouble ? OP_FSub : OP_Sub; break;
+      case '*': code = isDouble ? OP_FMul : OP_Mul; break;
+      case '/': code = isDouble ? OP_FDiv : OP_Div; break;
+      default:  code = OP_Mod; break;
+    }
+    return cg->GenBinary(code, l, r);
+}
+
+void RelationalExpr::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_RelationalExpr);
+    SerializeOperands(out);
+}
+
+Type *RelationalExpr::GetType() {
+    return Type::boolType;
+}
+
+void RelationalExpr::Check() {
+    CompoundExpr::Check();
+    Type *lt = left->GetType();
+    if (lt != right->GetType() || !IsNumeric(lt))
+        ReportOperands(op, left, right);
+}
+
+int RelationalExpr::EmitValue(CodeGenerator *cg) {
+    bool isDouble = (left->GetType() == Type::doubleType);
+    int l = left->EmitValue(cg), r = right->EmitValue(cg);
+    const char *s = op->str();
+    Opcode code = (s[0] == '<') ? (s[1] == '=' ? OP_Le : OP_Lt)
+                                : (s[1] == '=' ? OP_Ge : OP_Gt);
+    if (isDouble) code = (Opcode)(code + (OP_FEq - OP_Eq));
+    return cg->GenBinary(code, l, r);
+}
+
+void EqualityExpr::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_EqualityExpr);
+    SerializeOperands(out);
+}
+
+Type *EqualityExpr::GetType() {
+    return Type::boolType;
+}
+
+void EqualityExpr::Check() {
+    CompoundExpr::Check();
+    Type *lt = left->GetType(), *rt = right->GetType();
+    if (!lt->IsCompatibleWith(rt) && !rt->IsCompatibleWith(lt))
+        ReportOperands(op, left, right);
+}
+
+int EqualityExpr::EmitValue(CodeGenerator *cg) {
+    Type *lt = left->GetType(), *rt = right->GetType();
+    bool equal = (op->str()[0] == '=');
+    Opcode code = equal ? OP_Eq : OP_Ne;
+    if (lt == Type::stringType && rt == Type::stringType)
+        code = equal ? OP_StrEq : OP_StrNe;
+    else if (lt == Type::doubleType || rt == Type::doubleType)
+        code = equal ? OP_FEq : OP_FNe;
+    int l = left->EmitValue(cg), r = right->EmitValue(cg);
+    return cg->GenBinary(code, l, r);
+}
+
+void LogicalExpr::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_LogicalExpr);
+    SerializeOperands(out);
+}
+
+Type *LogicalExpr::GetType() {
+    return Type::boolType;
+}
+
+void LogicalExpr::Check() {
+    CompoundExpr::Check();
+    if ((left && left->GetType() != Type::boolType) || right->GetType() != Type::boolType)
+        ReportOperands(op, left, right);
+}
+
+int LogicalExpr::EmitValue(CodeGenerator *cg) {
+    if (!left)
+        return cg->GenUnary(OP_Not, right->EmitValue(cg));
+    BasicBlock *yes = cg->NewBlock(), *no = cg->NewBlock(), *done = cg->NewBlock();
+    int result = cg->NewTemp(V_Int);
+    EmitBranch(cg, yes, no);
+    cg->StartBlock(yes);
+    cg->GenMove(result, cg->GenLoadInt(1));
+    cg->GenJump(done);
+    cg->StartBlock(no);
+    cg->GenClear(result);
+    cg->GenJump(done);
+    cg->StartBlock(done);
+    return result;
+}
+
+// The right operand of && and || is only evaluated if the left one
+// doesn't already decide the outcome
+void LogicalExpr::EmitBranch(CodeGenerator *cg, BasicBlock *ifTrue, BasicBlock *ifFalse) {
+    if (!left) {
+        right->EmitBranch(cg, ifFalse, ifTrue);
+        return;
+    }
+    BasicBlock *rest = cg->NewBlock();
+    if (op->str()[0] == '&')
+        left->EmitBranch(cg, rest, ifFalse);
+    else
+        left->EmitBranch(cg, ifTrue, rest);
+    cg->StartBlock(rest);
+    right->EmitBranch(cg, ifTrue, ifFalse);
+}
+
+void AssignExpr::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_AssignExpr);
+    SerializeOperands(out);
+}
+
+Type *AssignExpr::GetType() {
+    return left->GetType();
+}
+
+void AssignExpr::Check() {
+    CompoundExpr::Check();
+    Type *lt = left->GetType(), *rt = right->GetType();
+    if (!rt->IsCompatibleWith(lt))
+        ReportError::IncompatibleOperands(op, lt, rt);
+}
+
+int AssignExpr::EmitValue(CodeGenerator *cg) {
+    LValue *target = dynamic_cast<LValue*>(left);
+    Assert(target != NULL);   // the grammar only allows an LValue
+    return target->EmitAssign(cg, right);
+}
+
+void This::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_This);
+}
+
+Type *This::GetType() {
+    ClassDecl *cd = EnclosingClass(this);
+    return cd ? cd->GetClassType() : Type::errorType;
+}
+
+void This::Check() {
+    if (!EnclosingClass(this))
+        ReportError::ThisOutsideClassScope(this);
+}
+
+int This::EmitValue(CodeGenerator *cg) {
+    return cg->ThisTemp();
+}
    
   
 ArrayAccess::ArrayAccess(yyltype loc, Expr *b, Expr *s) : LValue(loc) {
     (base=b)->SetParent(this); 
     (subscript=s)->SetParent(this);
 }
+
+void ArrayAccess::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_ArrayAccess);
+    out->WriteNode(base);
+    out->WriteNode(subscript);
+}
+
+Type *ArrayAccess::GetType() {
+    ArrayType *at = dynamic_cast<ArrayType*>(base->GetType());
+    return at ? at->GetType() : Type::errorType;
+}
+
+void ArrayAccess::Check() {
+    base->Check();
+    subscript->Check();
+    Type *bt = base->GetType(), *st = subscript->GetType();
+    if (!dynamic_cast<ArrayType*>(bt)) {
+        if (bt != Type::errorType) ReportError::BracketsOnNonArray(base);
+    } else if (st != Type::intType && st != Type::errorType) {
+        ReportError::SubscriptNotInteger(subscript);
+    }
+}
+
+int ArrayAccess::EmitValue(CodeGenerator *cg) {
+    int array = base->EmitValue(cg), index = subscript->EmitValue(cg);
+    cg->GenCheckBounds(array, index);
+    return cg->GenLoadElem(array, index, KindOfType(GetType()));
+}
+
+int ArrayAccess::EmitAssign(CodeGenerator *cg, Expr *value) {
+    int array = base->EmitValue(cg), index = subscript->EmitValue(cg);
+    int v = value->EmitValue(cg);
+    cg->GenCheckBounds(array, index);
+    cg->GenStoreElem(array, index, v);
+    return v;
+}
      
 FieldAccess::FieldAccess(Expr *b, Identifier *f) 
   : LValue(b? Join(b->GetLocation(), f->GetLocation()) : *f->GetLocation()) {
@@ -61,6 +426,79 @@ FieldAccess::FieldAccess(Expr *b, Identifier *f)
     (field=f)->SetParent(this);
 }
 
+void FieldAccess::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_FieldAccess);
+    out->WriteNode(base);
+    out->WriteNode(field);
+}
+
+VarDecl *FieldAccess::GetVarDecl() {
+    if (!base)
+        return NoteUse(field, dynamic_cast<VarDecl*>(FindDecl(field)));
+    ClassDecl *cd = dynamic_cast<ClassDecl*>(DeclForType(base->GetType()));
+    return cd ? NoteUse(field, dynamic_cast<VarDecl*>(cd->LookupMember(field))) : NULL;
+}
+
+Type *FieldAccess::GetType() {
+    VarDecl *var = GetVarDecl();
+    return var ? ResolvedOrError(var->GetDeclaredType()) : Type::errorType;
+}
+
+// Fields are only accessible from the code of their class and its
+// subclasses
+void FieldAccess::Check() {
+    if (base) base->Check();
+    VarDecl *var = GetVarDecl();
+    if (!var) {
+        if (!base)
+            ReportError::IdentifierNotDeclared(field, LookingForVariable);
+        else if (base->GetType() != Type::errorType)
+            ReportError::FieldNotFoundInBase(field, base->GetType());
+        return;
+    }
+    if (!base || !dynamic_cast<ClassDecl*>(var->GetParent())) return;
+    ClassDecl *owner = dynamic_cast<ClassDecl*>(DeclForType(base->GetType()));
+    for (ClassDecl *cd = EnclosingClass(this); cd; cd = cd->GetBaseClass())
+        if (cd == owner) return;
+    ReportError::InaccessibleField(field, base->GetType());
+}
+
+int FieldAccess::EmitValue(CodeGenerator *cg) {
+    VarDecl *var = GetVarDecl();
+    Assert(var != NULL);
+    ValueKind kind = KindOfType(var->GetDeclaredType());
+    if (dynamic_cast<Program*>(var->GetParent()))
+        return cg->GenLoadGlobal(cg->SlotFor(var), kind);
+    if (ClassDecl *owner = dynamic_cast<ClassDecl*>(var->GetParent())) {
+        int object = base ? base->EmitValue(cg) : cg->ThisTemp();
+        return cg->GenLoadField(object, cg->LayoutFor(owner), cg->SlotFor(var), kind);
+    }
+    int temp = cg->TempForLocal(var);
+    Assert(temp != NoTemp);
+    return temp;
+}
+
+int FieldAccess::EmitAssign(CodeGenerator *cg, Expr *value) {
+    VarDecl *var = GetVarDecl();
+    Assert(var != NULL);
+    if (dynamic_cast<Program*>(var->GetParent())) {
+        int v = value->EmitValue(cg);
+        cg->GenStoreGlobal(cg->SlotFor(var), v);
+        return v;
+    }
+    if (ClassDecl *owner = dynamic_cast<ClassDecl*>(var->GetParent())) {
+        int object = base ? base->EmitValue(cg) : cg->ThisTemp();
+        int v = value->EmitValue(cg);
+        cg->GenStoreField(object, cg->LayoutFor(owner), cg->SlotFor(var), v);
+        return v;
+    }
+    int temp = cg->TempForLocal(var);
+    Assert(temp != NoTemp);
+    int v = value->EmitValue(cg);
+    cg->GenMove(temp, v);
+    return v;
+}
+
 
 Call::Call(yyltype loc, Expr *b, Identifier *f, List<Expr*> *a) : Expr(loc)  {
     Assert(f != NULL && a != NULL); // b can be be NULL (just means no explicit base)
@@ -68,6 +506,103 @@ Call::Call(yyltype loc, Expr *b, Identifier *f, List<Expr*> *a) : Expr(loc)  {
     if (base) base->SetParent(this);
     (field=f)->SetParent(this);
     (actuals=a)->SetParentAll(this);
+    actuals->Freeze();
+}
+
+void Call::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_Call);
+    out->WriteNode(base);
+    out->WriteNode(field);
+    out->WriteList(actuals);
+}
+
+FnDecl *Call::GetFnDecl() {
+    if (!base)
+        return NoteUse(field, dynamic_cast<FnDecl*>(FindDecl(field)));
+    Decl *d = DeclForType(base->GetType());
+    if (ClassDecl *cd = dynamic_cast<ClassDecl*>(d))
+        return NoteUse(field, dynamic_cast<FnDecl*>(cd->LookupMember(field)));
+    if (InterfaceDecl *id = dynamic_cast<InterfaceDecl*>(d))
+        return NoteUse(field, dynamic_cast<FnDecl*>(id->LookupMember(field)));
+    return NULL;
+}
+
+bool Call::IsArrayLength() {
+    return base && dynamic_cast<ArrayType*>(base->GetType())
+        && strcmp(field->GetName(), "length") == 0;
+}
+
+Type *Call::GetType() {
+    if (IsArrayLength()) return Type::intType;
+    FnDecl *fn = GetFnDecl();
+    return fn ? ResolvedOrError(fn->GetReturnType()) : Type::errorType;
+}
+
+void Call::Check() {
+    if (base) base->Check();
+    actuals->CheckAll();
+    if (IsArrayLength()) {
+        if (actuals->NumElements() != 0)
+            ReportError::NumArgsMismatch(field, 0, actuals->NumElements());
+        return;
+    }
+    FnDecl *fn = GetFnDecl();
+    if (!fn) {
+        if (!base)
+            ReportError::IdentifierNotDeclared(field, LookingForFunction);
+        else if (base->GetType() != Type::errorType)
+            ReportError::FieldNotFoundInBase(field, base->GetType());
+        return;
+    }
+    List<VarDecl*> *formals = fn->GetFormals();
+    if (formals->NumElements() != actuals->NumElements()) {
+        ReportError::NumArgsMismatch(field, formals->NumElements(), actuals->NumElements());
+        return;
+    }
+    for (int i = 0; i < formals->NumElements(); i++) {
+        Expr *actual = actuals->Nth(i);
+        Type *given = actual->GetType(), *expected = formals->Nth(i)->GetDeclaredType();
+        if (!given->IsCompatibleWith(expected))
+            ReportError::ArgMismatch(actual, i+1, given, expected);
+    }
+}
+
+// A method is called through the vtable of the static type of the
+// receiver, or by selector when that is an interface (or a class that
+// leaves the method to its subclasses)
+int Call::EmitCall(CodeGenerator *cg, bool valueWanted) {
+    if (IsArrayLength())
+        return cg->GenArrayLength(base->EmitValue(cg));
+    FnDecl *fn = GetFnDecl();
+    Assert(fn != NULL);
+
+    Type *returnType = fn->GetReturnType();
+    bool hasValue = (returnType != Type::voidType);
+    ValueKind kind = KindOfType(returnType);
+    bool isMethod = fn->IsMethodDecl();
+    List<int> args;
+    if (isMethod)
+        args.Append(base ? base->EmitValue(cg) : cg->ThisTemp());
+    for (Expr *e : *actuals)
+        args.Append(e->EmitValue(cg));
+
+    int result;
+    if (!isMethod) {
+        result = cg->GenCall(cg->FunctionFor(fn), &args, kind, hasValue && valueWanted);
+    } else {
+        ClassDecl *cd = base ? dynamic_cast<ClassDecl*>(DeclForType(base->GetType()))
+                             : EnclosingClass(this);
+        int selector = cg->SelectorFor(field->GetName());
+        ClassLayout *cls = cd ? cg->LayoutFor(cd) : NULL;
+        int slot = cls ? cls->SlotForSelector(selector) : -1;
+        if (slot >= 0)
+            result = cg->GenCallVirtual(cls, slot, &args, kind, hasValue && valueWanted);
+        else
+            result = cg->GenCallInterface(selector, &args, kind, hasValue && valueWanted);
+    }
+    if (valueWanted && !hasValue)   // a void call used for its value
+        return cg->GenLoadInt(0);
+    return result;
 }
  
 
@@ -76,11 +611,83 @@ NewExpr::NewExpr(yyltype loc, NamedType *c) : Expr(loc) {
   (cType=c)->SetParent(this);
 }
 
+void NewExpr::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_NewExpr);
+    out->WriteNode(cType);
+}
+
+Type *NewExpr::GetType() {
+    return cType;
+}
+
+void NewExpr::Check() {
+    if (!dynamic_cast<ClassDecl*>(cType->GetDeclForType()))
+        ReportError::IdentifierNotDeclared(cType->GetId(), LookingForClass);
+}
+
+int NewExpr::EmitValue(CodeGenerator *cg) {
+    ClassDecl *cd = dynamic_cast<ClassDecl*>(cType->GetDeclForType());
+    Assert(cd != NULL);
+    return cg->GenNewObject(cg->LayoutFor(cd));
+}
+
 
 NewArrayExpr::NewArrayExpr(yyltype loc, Expr *sz, Type *et) : Expr(loc) {
     Assert(sz != NULL && et != NULL);
     (size=sz)->SetParent(this); 
     (elemType=et)->SetParent(this);
+    arrayType = NULL;
+}
+
+void NewArrayExpr::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_NewArrayExpr);
+    out->WriteNode(size);
+    out->WriteNode(elemType);
+}
+
+Type *NewArrayExpr::GetType() {
+    if (!arrayType) {
+        arrayType = new ArrayType(*location, elemType);
+        arrayType->SetParent(this);
+    }
+    return arrayType;
 }
 
-       
+void NewArrayExpr::Check() {
+    size->Check();
+    Type *t = size->GetType();
+    if (t != Type::intType && t != Type::errorType)
+        ReportError::NewArraySizeNotInteger(size);
+    elemType->Check();
+}
+
+int NewArrayExpr::EmitValue(CodeGenerator *cg) {
+    int length = size->EmitValue(cg);
+    return cg->GenNewArray(length, KindOfType(elemType));
+}
+
+void ReadIntegerExpr::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_ReadIntegerExpr);
+}
+
+Type *ReadIntegerExpr::GetType() {
+    return Type::intType;
+}
+
+int ReadIntegerExpr::EmitValue(CodeGenerator *cg) {
+    List<int> noArgs;
+    return cg->GenCallBuiltin(BI_ReadInteger, &noArgs, V_Int, true);
+}
+
+void ReadLineExpr::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_ReadLineExpr);
+}
+
+Type *ReadLineExpr::GetType() {
+    return Type::stringType;
+}
+
+int ReadLineExpr::EmitValue(CodeGenerator *cg) {
+    List<int> noArgs;
+    return cg->GenCallBuiltin(BI_ReadLine, &noArgs, V_Ref, true);
+}
@@ -16,6 +16,9 @@
 
 class NamedType; // for new
 class Type; // for NewArray
+class VarDecl;
+class FnDecl;
+class BasicBlock;
 
 
 class Expr : public Stmt 
@@ -23,6 +26,20 @@ class Expr : public Stmt
   public:
     Expr(yyltype loc) : Stmt(loc) {}
     Expr() : Stmt() {}
+
+    // The static type of the expression, worked out from the
+    // declarations it refers to; Type::errorType if it doesn't resolve
+    // or its operands don't go together. Check reports why, after what
+    // is wrong in the subexpressions.
+    virtual Type *GetType();
+
+    // Code generation (see codegen.h), of a checked expression. EmitValue
+    // returns the temporary holding the value, EmitBranch jumps to ifTrue
+    // or ifFalse on it, and Emit evaluates it as a statement, for its
+    // side effects only.
+    virtual int EmitValue(CodeGenerator *cg);
+    virtual void EmitBranch(CodeGenerator *cg, BasicBlock *ifTrue, BasicBlock *ifFalse);
+    void Emit(CodeGenerator *cg) { EmitValue(cg); }
 };
 
 /* This node type is used for those places where an expression is optional.
@@ -31,6 +48,10 @@ class Expr : public Stmt
 class EmptyExpr : public Expr
 {
   public:
+    void Serialize(AstWriter *out);
+    Type *GetType();
+    int EmitValue(CodeGenerator *cg);
+    void Emit(CodeGenerator *cg) {}
 };
 
 class IntConstant : public Expr 
@@ -40,6 +61,10 @@ class IntConstant : public Expr
   
   public:
     IntConstant(yyltype loc, int val);
+    int GetValue() { return value; }
+    void Serialize(AstWriter *out);
+    Type *GetType();
+    int EmitValue(CodeGenerator *cg);
 };
 
 class DoubleConstant : public Expr 
@@ -49,6 +74,9 @@ class DoubleConstant : public Expr
     
   public:
     DoubleConstant(yyltype loc, double val);
+    void Serialize(AstWriter *out);
+    Type *GetType();
+    int EmitValue(CodeGenerator *cg);
 };
 
 class BoolConstant : public Expr 
@@ -58,6 +86,9 @@ class BoolConstant : public Expr
     
   public:
     BoolConstant(yyltype loc, bool val);
+    void Serialize(AstWriter *out);
+    Type *GetType();
+    int EmitValue(CodeGenerator *cg);
 };
 
 class StringConstant : public Expr 
@@ -67,12 +98,18 @@ class StringConstant : public Expr
     
   public:
     StringConstant(yyltype loc, const char *val);
+    void Serialize(AstWriter *out);
+    Type *GetType();
+    int EmitValue(CodeGenerator *cg);
 };
 
 class NullConstant: public Expr 
 {
   public: 
     NullConstant(yyltype loc) : Expr(loc) {}
+    void Serialize(AstWriter *out);
+    Type *GetType();
+    int EmitValue(CodeGenerator *cg);
 };
 
 class Operator : public Node 
@@ -84,6 +121,7 @@ class Operator : public Node
     Operator(yyltype loc, const char *tok);
     friend std::ostream& operator<<(std::ostream& out, Operator *o) { return out << o->tokenString; }
     const char *str() { return tokenString; }
+    void Serialize(AstWriter *out);
  };
  
 class CompoundExpr : public Expr
@@ -95,6 +133,8 @@ class CompoundExpr : public Expr
   public:
     CompoundExpr(Expr *lhs, Operator *op, Expr *rhs); // for binary
     CompoundExpr(Operator *op, Expr *rhs);             // for unary
+    void Check();   // the operands
+    void SerializeOperands(AstWriter *out);
 };
 
 class ArithmeticExpr : public CompoundExpr 
@@ -102,12 +142,20 @@ class ArithmeticExpr : public CompoundExpr
   public:
     ArithmeticExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
     ArithmeticExpr(Operator *op, Expr *rhs) : CompoundExpr(op,rhs) {}
+    void Check();
+    void Serialize(AstWriter *out);
+    Type *GetType();
+    int EmitValue(CodeGenerator *cg);
 };
 
 class RelationalExpr : public CompoundExpr 
 {
   public:
     RelationalExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
+    void Check();
+    void Serialize(AstWriter *out);
+    Type *GetType();
+    int EmitValue(CodeGenerator *cg);
 };
 
 class EqualityExpr : public CompoundExpr 
@@ -115,6 +163,10 @@ class EqualityExpr : public CompoundExpr
   public:
     EqualityExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
     const char *GetPrintNameForNode() { return "EqualityExpr"; }
+    void Check();
+    void Serialize(AstWriter *out);
+    Type *GetType();
+    int EmitValue(CodeGenerator *cg);
 };
 
 class LogicalExpr : public CompoundExpr 
@@ -123,6 +175,11 @@ class LogicalExpr : public CompoundExpr
     LogicalExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
     LogicalExpr(Operator *op, Expr *rhs) : CompoundExpr(op,rhs) {}
     const char *GetPrintNameForNode() { return "LogicalExpr"; }
+    void Check();
+    void Serialize(AstWriter *out);
+    Type *GetType();
+    int EmitValue(CodeGenerator *cg);
+    void EmitBranch(CodeGenerator *cg, BasicBlock *ifTrue, BasicBlock *ifFalse);
 };
 
 class AssignExpr : public CompoundExpr 
@@ -130,18 +187,30 @@ class AssignExpr : public CompoundExpr
   public:
     AssignExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
     const char *GetPrintNameForNode() { return "AssignExpr"; }
+    void Check();
+    void Serialize(AstWriter *out);
+    Type *GetType();
+    int EmitValue(CodeGenerator *cg);
 };
 
 class LValue : public Expr 
 {
   public:
     LValue(yyltype loc) : Expr(loc) {}
+
+    // Stores the value of the expression into this location and returns
+    // the temporary holding it
+    virtual int EmitAssign(CodeGenerator *cg, Expr *value) = 0;
 };
 
 class This : public Expr 
 {
   public:
     This(yyltype loc) : Expr(loc) {}
+    void Check();
+    void Serialize(AstWriter *out);
+    Type *GetType();
+    int EmitValue(CodeGenerator *cg);
 };
 
 class ArrayAccess : public LValue 
@@ -151,6 +220,11 @@ class ArrayAccess : public LValue
     
   public:
     ArrayAccess(yyltype loc, Expr *base, Expr *subscript);
+    void Check();
+    void Serialize(AstWriter *out);
+    Type *GetType();
+    int EmitValue(CodeGenerator *cg);
+    int EmitAssign(CodeGenerator *cg, Expr *value);
 };
 
 /* Note that field access is used both for qualified names
@@ -166,6 +240,12 @@ class FieldAccess : public LValue
     
   public:
     FieldAccess(Expr *base, Identifier *field); //ok to pass NULL base
+    void Check();
+    void Serialize(AstWriter *out);
+    Type *GetType();
+    int EmitValue(CodeGenerator *cg);
+    int EmitAssign(CodeGenerator *cg, Expr *value);
+    VarDecl *GetVarDecl();   // NULL if it doesn't name a variable
 };
 
 /* Like field access, call is used both for qualified base.field()
@@ -181,6 +261,14 @@ class Call : public Expr
     
   public:
     Call(yyltype loc, Expr *base, Identifier *field, List<Expr*> *args);
+    void Check();
+    void Serialize(AstWriter *out);
+    Type *GetType();
+    int EmitValue(CodeGenerator *cg) { return EmitCall(cg, true); }
+    void Emit(CodeGenerator *cg)     { EmitCall(cg, false); }
+    int EmitCall(CodeGenerator *cg, bool valueWanted);
+    FnDecl *GetFnDecl();       // NULL if it doesn't name a function
+    bool IsArrayLength();      // arr.length()
 };
 
 class NewExpr : public Expr
@@ -190,6 +278,10 @@ class NewExpr : public Expr
     
   public:
     NewExpr(yyltype loc, NamedType *clsType);
+    void Check();
+    void Serialize(AstWriter *out);
+    Type *GetType();
+    int EmitValue(CodeGenerator *cg);
 };
 
 class NewArrayExpr : public Expr
@@ -197,21 +289,32 @@ class NewArrayExpr : public Expr
   protected:
     Expr *size;
     Type *elemType;
+    Type *arrayType;  // elemType[], made when first asked for
     
   public:
     NewArrayExpr(yyltype loc, Expr *sizeExpr, Type *elemType);
+    void Check();
+    void Serialize(AstWriter *out);
+    Type *GetType();
+    int EmitValue(CodeGenerator *cg);
 };
 
 class ReadIntegerExpr : public Expr
 {
   public:
     ReadIntegerExpr(yyltype loc) : Expr(loc) {}
+    void Serialize(AstWriter *out);
+    Type *GetType();
+    int EmitValue(CodeGenerator *cg);
 };
 
 class ReadLineExpr : public Expr
 {
   public:
     ReadLineExpr(yyltype loc) : Expr (loc) {}
+    void Serialize(AstWriter *out);
+    Type *GetType();
+    int EmitValue(CodeGenerator *cg);
 };
 
     
@@ -8,31 +8,74 @@
 #include "ast_expr.h"
 #include "scope.h"
 #include "errors.h"
+#include "astcache.h"
+#include "codegen.h"
+#include "switch.h"
+#include <unordered_map>
 
 
 Program::Program(List<Decl*> *d) {
     Assert(d != NULL);
     (decls=d)->SetParentAll(this);
+    decls->Freeze();
 }
 
 void Program::Check() {
+    PrepareScope();
+    decls->CheckAll();
+}
+
+Scope *Program::PrepareScope() {
+    if (nodeScope) return nodeScope;
     nodeScope = new Scope();
     decls->DeclareAll(nodeScope);
-    decls->CheckAll();
+    return nodeScope;
+}
+
+void Program::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_Program);
+    out->WriteList(decls);
+}
+
+void Program::Emit(CodeGenerator *cg) {
+    cg->LayoutDecls(decls);
+    for (Decl *d : *decls)
+        d->Emit(cg);
 }
 
 StmtBlock::StmtBlock(List<VarDecl*> *d, List<Stmt*> *s) {
     Assert(d != NULL && s != NULL);
     (decls=d)->SetParentAll(this);
+    decls->Freeze();
     (stmts=s)->SetParentAll(this);
+    stmts->Freeze();
 }
 void StmtBlock::Check() {
-    nodeScope = new Scope();
-    decls->DeclareAll(nodeScope);
+    PrepareScope();
     decls->CheckAll();
     stmts->CheckAll();
 }
 
+Scope *StmtBlock::PrepareScope() {
+    if (nodeScope) return nodeScope;
+    nodeScope = new Scope();
+    decls->DeclareAll(nodeScope);
+    return nodeScope;
+}
+
+void StmtBlock::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_StmtBlock);
+    out->WriteList(decls);
+    out->WriteList(stmts);
+}
+
+void StmtBlock::Emit(CodeGenerator *cg) {
+    for (VarDecl *d : *decls)
+        cg->GenClear(cg->DeclareLocal(d));
+    for (Stmt *s : *stmts)
+        s->Emit(cg);
+}
+
 ConditionalStmt::ConditionalStmt(Expr *t, Stmt *b) { 
     Assert(t != NULL && b != NULL);
     (test=t)->SetParent(this); 
@@ -40,15 +83,75 @@ ConditionalStmt::ConditionalStmt(Expr *t, Stmt *b) {
 }
 
 void ConditionalStmt::Check() {
+    CheckTest();
     body->Check();
 }
 
+void ConditionalStmt::CheckTest() {
+    test->Check();
+    Type *t = test->GetType();
+    if (t != Type::boolType && t != Type::errorType)
+        ReportError::TestNotBoolean(test);
+}
+
 ForStmt::ForStmt(Expr *i, Expr *t, Expr *s, Stmt *b): LoopStmt(t, b) { 
     Assert(i != NULL && t != NULL && s != NULL && b != NULL);
     (init=i)->SetParent(this);
     (step=s)->SetParent(this);
 }
 
+void ForStmt::Check() {
+    init->Check();
+    CheckTest();
+    step->Check();
+    body->Check();
+}
+
+void ForStmt::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_ForStmt);
+    out->WriteNode(init);
+    out->WriteNode(test);
+    out->WriteNode(step);
+    out->WriteNode(body);
+}
+
+void ForStmt::Emit(CodeGenerator *cg) {
+    BasicBlock *top = cg->NewBlock(), *loop = cg->NewBlock(),
+               *next = cg->NewBlock(), *done = cg->NewBlock();
+    init->Emit(cg);
+    cg->GenJump(top);
+    cg->StartBlock(top);
+    test->EmitBranch(cg, loop, done);
+    cg->StartBlock(loop);
+    cg->PushBreakTarget(done);
+    body->Emit(cg);
+    cg->PopBreakTarget();
+    cg->GenJump(next);
+    cg->StartBlock(next);
+    step->Emit(cg);
+    cg->GenJump(top);
+    cg->StartBlock(done);
+}
+
+void WhileStmt::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_WhileStmt);
+    out->WriteNode(test);
+    out->WriteNode(body);
+}
+
+void WhileStmt::Emit(CodeGenerator *cg) {
+    BasicBlock *top = cg->NewBlock(), *loop = cg->NewBlock(), *done = cg->NewBlock();
+    cg->GenJump(top);
+    cg->StartBlock(top);
+    test->EmitBranch(cg, loop, done);
+    cg->StartBlock(loop);
+    cg->PushBreakTarget(done);
+    body->Emit(cg);
+    cg->PopBreakTarget();
+    cg->GenJump(top);
+    cg->StartBlock(done);
+}
+
 IfStmt::IfStmt(Expr *t, Stmt *tb, Stmt *eb): ConditionalStmt(t, tb) { 
     Assert(t != NULL && tb != NULL); // else can be NULL
     elseBody = eb;
@@ -59,15 +162,224 @@ void IfStmt::Check() {
     if (elseBody) elseBody->Check();
 }
 
+void IfStmt::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_IfStmt);
+    out->WriteNode(test);
+    out->WriteNode(body);
+    out->WriteNode(elseBody);
+}
+
+void IfStmt::Emit(CodeGenerator *cg) {
+    BasicBlock *thenPart = cg->NewBlock(), *done = cg->NewBlock();
+    BasicBlock *elsePart = elseBody ? cg->NewBlock() : done;
+    test->EmitBranch(cg, thenPart, elsePart);
+    cg->StartBlock(thenPart);
+    body->Emit(cg);
+    cg->GenJump(done);
+    if (elseBody) {
+        cg->StartBlock(elsePart);
+        elseBody->Emit(cg);
+        cg->GenJump(done);
+    }
+    cg->StartBlock(done);
+}
+
+Case::Case(IntConstant *l, List<Stmt*> *s) {
+    Assert(l != NULL && s != NULL);
+    (label=l)->SetParent(this);
+    (stmts=s)->SetParentAll(this);
+    stmts->Freeze();
+}
+
+void Case::Check() {
+    stmts->CheckAll();
+}
+
+void Case::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_Case);
+    out->WriteNode(label);
+    out->WriteList(stmts);
+}
+
+void Case::Emit(CodeGenerator *cg) {
+    for (Stmt *s : *stmts)
+        s->Emit(cg);
+}
+
+Default::Default(List<Stmt*> *s) {
+    Assert(s != NULL);
+    (stmts=s)->SetParentAll(this);
+    stmts->Freeze();
+}
+
+void Default::Check() {
+    stmts->CheckAll();
+}
+
+void Default::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_Default);
+    out->WriteList(stmts);
+}
+
+void Default::Emit(CodeGenerator *cg) {
+    for (Stmt *s : *stmts)
+        s->Emit(cg);
+}
+
+CaseBlock::CaseBlock(List<Case*> *c) {
+    Assert(c != NULL);
+    (cases=c)->SetParentAll(this);
+    cases->Freeze();
+}
+
+// Each value may label one case only
+void CaseBlock::Check() {
+    std::unordered_map<int, Case*> seen;
+    for (Case *c : *cases) {
+        IntConstant *label = c->GetLabel();
+        if (!seen.insert(std::make_pair(label->GetValue(), c)).second)
+            ReportError::DuplicateCase(label, label->GetValue());
+        c->Check();
+    }
+}
+
+void CaseBlock::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_CaseBlock);
+    out->WriteList(cases);
+}
+
+SwitchStmt::SwitchStmt(Expr *e, CaseBlock *c, Default *d) {
+    Assert(e != NULL && c != NULL); // default can be NULL
+    (expr=e)->SetParent(this);
+    (caseBlock=c)->SetParent(this);
+    defaultStmt = d;
+    if (defaultStmt) defaultStmt->SetParent(this);
+}
+
+void SwitchStmt::Check() {
+    expr->Check();
+    Type *t = expr->GetType();
+    if (t != Type::intType && t != Type::errorType)
+        ReportError::SwitchNotInteger(expr);
+    caseBlock->Check();
+    if (defaultStmt) defaultStmt->Check();
+}
+
+void SwitchStmt::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_SwitchStmt);
+    out->WriteNode(expr);
+    out->WriteNode(caseBlock);
+    out->WriteNode(defaultStmt);
+}
+
+// The value picks the block of its case (see switch.h), and each case
+// then runs on into the next unless it breaks out to done
+void SwitchStmt::Emit(CodeGenerator *cg) {
+    int value = expr->EmitValue(cg);
+
+    List<Case*> *cases = caseBlock->GetCases();
+    List<SwitchCase> targets;
+    for (Case *c : *cases) {
+        SwitchCase sc = { c->GetLabel()->GetValue(), cg->NewBlock() };
+        targets.Append(sc);
+    }
+    BasicBlock *done = cg->NewBlock();
+    BasicBlock *otherwise = defaultStmt ? cg->NewBlock() : done;
+    LowerSwitch(cg, value, &targets, otherwise);
+
+    cg->PushBreakTarget(done);
+    for (int i = 0; i < cases->NumElements(); i++) {
+        cg->StartBlock(targets.Nth(i).target);
+        cases->Nth(i)->Emit(cg);
+        cg->GenJump(i + 1 < cases->NumElements() ? targets.Nth(i+1).target : otherwise);
+    }
+    if (defaultStmt) {
+        cg->StartBlock(otherwise);
+        defaultStmt->Emit(cg);
+        cg->GenJump(done);
+    }
+    cg->PopBreakTarget();
+    cg->StartBlock(done);
+}
+
+// A break leaves the innermost loop or switch of its function
+void BreakStmt::Check() {
+    for (Node *n = parent; n && !dynamic_cast<FnDecl*>(n); n = n->GetParent())
+        if (dynamic_cast<LoopStmt*>(n) || dynamic_cast<SwitchStmt*>(n)) return;
+    ReportError::BreakOutsideLoop(this);
+}
+
+void BreakStmt::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_BreakStmt);
+}
+
+void BreakStmt::Emit(CodeGenerator *cg) {
+    cg->GenJump(cg->BreakTarget());
+}
+
 
 ReturnStmt::ReturnStmt(yyltype loc, Expr *e) : Stmt(loc) { 
     Assert(e != NULL);
     (expr=e)->SetParent(this);
 }
+
+void ReturnStmt::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_ReturnStmt);
+    out->WriteNode(expr);
+}
+
+// The value returned (void for a bare return) has to fit the declared
+// return type of the function
+void ReturnStmt::Check() {
+    expr->Check();
+    Node *n = parent;
+    while (n && !dynamic_cast<FnDecl*>(n)) n = n->GetParent();
+    Assert(n != NULL);
+    Type *given = expr->GetType(), *expected = dynamic_cast<FnDecl*>(n)->GetReturnType();
+    if (!given->IsCompatibleWith(expected))
+        ReportError::ReturnMismatch(this, given, expected);
+}
+
+void ReturnStmt::Emit(CodeGenerator *cg) {
+    if (dynamic_cast<EmptyExpr*>(expr))
+        cg->GenReturn(NoTemp);
+    else
+        cg->GenReturn(expr->EmitValue(cg));
+}
   
 PrintStmt::PrintStmt(List<Expr*> *a) {    
     Assert(a != NULL);
     (args=a)->SetParentAll(this);
+    args->Freeze();
 }
 
+// Only ints, bools and strings can be printed
+void PrintStmt::Check() {
+    for (int i = 0; i < args->NumElements(); i++) {
+        Expr *e = args->Nth(i);
+        e->Check();
+        Type *t = e->GetType();
+        if (t != Type::intType && t != Type::boolType && t != Type::stringType &&
+            t != Type::errorType)
+            ReportError::PrintArgMismatch(e, i+1, t);
+    }
+}
 
+void PrintStmt::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_PrintStmt);
+    out->WriteList(args);
+}
+
+void PrintStmt::Emit(CodeGenerator *cg) {
+    List<int> arg;
+    for (int i = 0; i < args->NumElements(); i++) {
+        Expr *e = args->Nth(i);
+        Type *t = e->GetType();
+        Builtin print = (t == Type::intType) ? BI_PrintInt
+                      : (t == Type::boolType) ? BI_PrintBool
+                      : BI_PrintString;
+        arg = List<int>();
+        arg.Append(e->EmitValue(cg));
+        cg->GenCallBuiltin(print, &arg, V_Int, false);
+    }
+}
@@ -16,6 +16,7 @@
 class Decl;
 class VarDecl;
 class Expr;
+class IntConstant;
   
 class Program : public Node
 {
@@ -24,7 +25,12 @@ class Program : public Node
      
   public:
      Program(List<Decl*> *declList);
+     List<Decl*> *GetDecls() { return decls; }
      void Check();
+     Scope *PrepareScope();
+     void UseScope(Scope *globals) { nodeScope = globals; } // see pushparser.h
+     void Serialize(AstWriter *out);
+     void Emit(CodeGenerator *cg);
 };
 
 class Stmt : public Node
@@ -43,6 +49,9 @@ class StmtBlock : public Stmt
   public:
     StmtBlock(List<VarDecl*> *variableDeclarations, List<Stmt*> *statements);
     void Check();
+    Scope *PrepareScope();
+    void Serialize(AstWriter *out);
+    void Emit(CodeGenerator *cg);
 };
 
   
@@ -55,6 +64,7 @@ class ConditionalStmt : public Stmt
   public:
     ConditionalStmt(Expr *testExpr, Stmt *body);
     void Check();
+    void CheckTest();   // reports a test that is not a bool
 };
 
 class LoopStmt : public ConditionalStmt 
@@ -71,12 +81,17 @@ class ForStmt : public LoopStmt
   
   public:
     ForStmt(Expr *init, Expr *test, Expr *step, Stmt *body);
+    void Check();
+    void Serialize(AstWriter *out);
+    void Emit(CodeGenerator *cg);
 };
 
 class WhileStmt : public LoopStmt 
 {
   public:
     WhileStmt(Expr *test, Stmt *body) : LoopStmt(test, body) {}
+    void Serialize(AstWriter *out);
+    void Emit(CodeGenerator *cg);
 };
 
 class IfStmt : public ConditionalStmt 
@@ -87,12 +102,71 @@ class IfStmt : public ConditionalStmt
   public:
     IfStmt(Expr *test, Stmt *thenBody, Stmt *elseBody);
     void Check();
+    void Serialize(AstWriter *out);
+    void Emit(CodeGenerator *cg);
+};
+
+class Case : public Stmt
+{
+  protected:
+    IntConstant *label;
+    List<Stmt*> *stmts;
+
+  public:
+    Case(IntConstant *label, List<Stmt*> *statements);
+    IntConstant *GetLabel() { return label; }
+    void Check();
+    void Serialize(AstWriter *out);
+    void Emit(CodeGenerator *cg);
+};
+
+class Default : public Stmt
+{
+  protected:
+    List<Stmt*> *stmts;
+
+  public:
+    Default(List<Stmt*> *statements);
+    void Check();
+    void Serialize(AstWriter *out);
+    void Emit(CodeGenerator *cg);
+};
+
+class CaseBlock : public Stmt
+{
+  protected:
+    List<Case*> *cases;
+
+  public:
+    CaseBlock(List<Case*> *caseList);
+    List<Case*> *GetCases() { return cases; }
+    void Check();
+    void Serialize(AstWriter *out);
+};
+
+// Cases fall through to the next one (or the default) unless they end
+// in a break, as in C
+class SwitchStmt : public Stmt
+{
+  protected:
+    Expr *expr;
+    CaseBlock *caseBlock;
+    Default *defaultStmt;   // may be NULL
+
+  public:
+    SwitchStmt(Expr *expr, CaseBlock *caseBlock, Default *defaultStmt);
+    void Check();
+    void Serialize(AstWriter *out);
+    void Emit(CodeGenerator *cg);
 };
 
 class BreakStmt : public Stmt 
 {
   public:
     BreakStmt(yyltype loc) : Stmt(loc) {}
+    void Check();
+    void Serialize(AstWriter *out);
+    void Emit(CodeGenerator *cg);
 };
 
 class ReturnStmt : public Stmt  
@@ -102,6 +176,9 @@ class ReturnStmt : public Stmt
   
   public:
     ReturnStmt(yyltype loc, Expr *expr);
+    void Check();
+    void Serialize(AstWriter *out);
+    void Emit(CodeGenerator *cg);
 };
 
 class PrintStmt : public Stmt
@@ -111,6 +188,9 @@ class PrintStmt : public Stmt
     
   public:
     PrintStmt(List<Expr*> *arguments);
+    void Check();
+    void Serialize(AstWriter *out);
+    void Emit(CodeGenerator *cg);
 };
 
 
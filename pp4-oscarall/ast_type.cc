@@ -5,8 +5,10 @@
 #include "ast_type.h"
 #include "ast_decl.h"
 #include <string.h>
+#include "astcache.h"
 
 #include "errors.h"
+#include "depgraph.h"
  
 /* Class constants
  * ---------------
@@ -29,12 +31,33 @@ Type::Type(const char *n) {
     typeName = strdup(n);
 }
 
+// The built-in types are shared singletons, so they are written as an
+// index into this table rather than as nodes of their own.
+Type **Type::builtins[] = { &intType, &doubleType, &voidType, &boolType,
+                            &nullType, &stringType, &errorType, NULL };
+
+void Type::Serialize(AstWriter *out) {
+    int i = 0;
+    while (builtins[i] && *builtins[i] != this) i++;
+    Assert(builtins[i] != NULL);
+    out->BeginNode(this, K_BuiltinType);
+    out->WriteInt(i);
+}
 
 
+
+bool Type::IsCompatibleWith(Type *other) {
+    if (this == errorType || other == errorType) return true;
+    if (this == nullType && dynamic_cast<NamedType*>(other)) return true;
+    return IsEquivalentTo(other);
+}
+
 	
 NamedType::NamedType(Identifier *i) : Type(*i->GetLocation()) {
     Assert(i != NULL);
     (id=i)->SetParent(this);
+    cachedDecl = NULL;
+    isError = false;
 } 
 
 void NamedType::Check() {
@@ -47,7 +70,7 @@ Decl *NamedType::GetDeclForType() {
     if (!cachedDecl && !isError) {
         Decl *declForName = FindDecl(id);
         if (declForName && (declForName->IsClassDecl() || declForName->IsInterfaceDecl())) 
-            cachedDecl = declForName;
+            cachedDecl = NoteUse(id, declForName);
     }
     return cachedDecl;
 }
@@ -67,6 +90,25 @@ bool NamedType::IsEquivalentTo(Type *other) {
     return ot && strcmp(id->GetName(), ot->id->GetName()) == 0;
 }
 
+// An object can also be used as any of its base classes or as an
+// interface that it or one of its base classes implements
+bool NamedType::IsCompatibleWith(Type *other) {
+    if (Type::IsCompatibleWith(other)) return true;
+    ClassDecl *cd = dynamic_cast<ClassDecl*>(GetDeclForType());
+    NamedType *ot = dynamic_cast<NamedType*>(other);
+    return cd && ot && ot->GetDeclForType() && cd->IsSubtypeOf(ot->GetDeclForType());
+}
+
+void NamedType::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_NamedType);
+    out->WriteNode(id);
+    if (cachedDecl) out->AddLink(this, L_DeclForType, cachedDecl);
+}
+
+void NamedType::RestoreLink(int which, Node *to) {
+    if (which == L_DeclForType) cachedDecl = dynamic_cast<Decl*>(to);
+}
+
 ArrayType::ArrayType(yyltype loc, Type *et) : Type(loc) {
     Assert(et != NULL);
     (elemType=et)->SetParent(this);
@@ -81,3 +123,7 @@ bool ArrayType::IsEquivalentTo(Type *other) {
     return (o && elemType->IsEquivalentTo(o->elemType));
 }
 
+void ArrayType::Serialize(AstWriter *out) {
+    out->BeginNode(this, K_ArrayType);
+    out->WriteNode(elemType);
+}
@@ -28,6 +28,7 @@ class Type : public Node
   public :
     static Type *intType, *doubleType, *boolType, *voidType,
                 *nullType, *stringType, *errorType;
+    static Type **builtins[]; // the above, NULL-terminated
 
     Type(yyltype loc) : Node(loc) {}
     Type(const char *str);
@@ -35,20 +36,31 @@ class Type : public Node
     virtual void PrintToStream(std::ostream& out) { out << typeName; }
     friend std::ostream& operator<<(std::ostream& out, Type *t) { t->PrintToStream(out); return out; }
     virtual bool IsEquivalentTo(Type *other) { return this == other; }
-    virtual void Check(Hashtable <Decl*> * symbolTable, reasonT reason) {}
+    // Whether a value of this type can be used where other is expected.
+    // The error type goes with anything, so it is only reported once.
+    virtual bool IsCompatibleWith(Type *other);
+    void Serialize(AstWriter *out);
 };
 
 class NamedType : public Type 
 {
   protected:
     Identifier *id;
+    Decl *cachedDecl; // class or interface this name resolves to
+    bool isError;     // set once the name failed to resolve
     
   public:
     NamedType(Identifier *i);
-    Identifier * GetIdentifier() { return id; }
+    Identifier *GetId() { return id; }
     void PrintToStream(std::ostream& out) { out << id; }
-    void Check(Hashtable <Decl*> * symbolTable, reasonT reason);
+    void Check();
+    Decl *GetDeclForType();
+    bool IsInterface();
+    bool IsClass();
     bool IsEquivalentTo(Type *other);
+    bool IsCompatibleWith(Type *other);
+    void Serialize(AstWriter *out);
+    void RestoreLink(int which, Node *to);
 };
 
 class ArrayType : public Type 
@@ -61,7 +73,8 @@ class ArrayType : public Type
     Type * GetType() { return elemType; }
     void PrintToStream(std::ostream& out) { out << elemType << "[]"; }
     bool IsEquivalentTo(Type *other);
-    void Check(Hashtable <Decl*> * symbolTable, reasonT reason);
+    void Check();
+    void Serialize(AstWriter *out);
 };
 
  
@@ -0,0 +1,507 @@
+/* File: astcache.cc
+ * -----------------
+ * Implementation of the tree writer/reader and the on-disk tree cache.
+ */
+
+#include "astcache.h"
+#include "ast.h"
+#include "ast_decl.h"
+#include "ast_expr.h"
+#include "ast_stmt.h"
+#include "ast_type.h"
+#include "utility.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>  // getpid
+
+static const char Magic[] = "DCCAST";    // plus a version byte
+static const int FormatVersion = 2;
+static const int MagicSize = 8;
+static const int HasLocation = 0x80;     // or'ed into the kind byte
+
+
+/* Writer
+ * ------
+ */
+
+void AstWriter::WriteUnsigned(uint64_t val) {
+    while (val >= 0x80) {
+        WriteByte((val & 0x7f) | 0x80);
+        val >>= 7;
+    }
+    WriteByte(val);
+}
+
+void AstWriter::WriteInt(int val) {
+    // zig-zag so small negative numbers stay short too
+    WriteUnsigned(((uint64_t)(int64_t)val << 1) ^ (uint64_t)((int64_t)val >> 63));
+}
+
+void AstWriter::WriteDouble(double val) {
+    char raw[sizeof(double)];
+    memcpy(raw, &val, sizeof(raw));
+    bytes.append(raw, sizeof(raw));
+}
+
+void AstWriter::WriteString(const char *str) {
+    size_t len = strlen(str);
+    WriteUnsigned(len);
+    bytes.append(str, len);
+}
+
+void AstWriter::WriteName(const char *name) {
+    std::map<std::string, int>::iterator it = nameIds.find(name);
+    if (it == nameIds.end()) {
+        it = nameIds.insert(std::make_pair(std::string(name), (int)names.size())).first;
+        names.push_back(name);
+    }
+    WriteUnsigned(it->second);
+}
+
+void AstWriter::BeginNode(Node *n, NodeKind kind) {
+    yyltype *loc = n->GetLocation();
+    WriteByte(kind | (loc ? HasLocation : 0));
+    if (loc) {
+        WriteUnsigned(loc->first_line);
+        WriteUnsigned(loc->first_column);
+        WriteUnsigned(loc->last_line - loc->first_line);
+        WriteUnsigned(loc->last_column);
+    }
+    nodeIds[n] = numNodes++;
+}
+
+void AstWriter::WriteNode(Node *n) {
+    if (n)
+        n->Serialize(this);
+    else
+        WriteByte(K_Null);
+}
+
+void AstWriter::AddLink(Node *from, LinkKind kind, Node *to) {
+    Link link = { from, kind, to };
+    links.push_back(link);
+}
+
+bool AstWriter::SaveToFile(const char *path, uint64_t sourceHash, Program *program) {
+    WriteNode(program);
+    std::string tree;
+    tree.swap(bytes);
+
+    // links can only be numbered now that the whole tree is written
+    WriteUnsigned(links.size());
+    for (size_t i = 0; i < links.size(); i++) {
+        Assert(nodeIds.count(links[i].from) && nodeIds.count(links[i].to));
+        WriteUnsigned(nodeIds[links[i].from]);
+        WriteUnsigned(links[i].kind);
+        WriteUnsigned(nodeIds[links[i].to]);
+    }
+    std::string linkTable;
+    linkTable.swap(bytes);
+
+    bytes.append(Magic, MagicSize - 2);
+    WriteByte(FormatVersion);
+    WriteByte(0);
+    for (int i = 0; i < 8; i++)
+        WriteByte((sourceHash >> (8 * i)) & 0xff);
+    WriteUnsigned(names.size());
+    for (size_t i = 0; i < names.size(); i++)
+        WriteString(names[i].c_str());
+    bytes += tree;
+    bytes += linkTable;
+
+    FILE *fp = fopen(path, "wb");
+    if (!fp) return false;
+    bool ok = fwrite(bytes.data(), 1, bytes.size(), fp) == bytes.size();
+    return (fclose(fp) == 0) && ok;
+}
+
+
+/* Reader
+ * ------
+ */
+
+AstReader::AstReader(const void *data, size_t len) {
+    cur = (const unsigned char *)data;
+    end = cur + len;
+    failed = false;
+}
+
+int AstReader::ReadByte() {
+    if (cur == end) {
+        failed = true;
+        return K_Null;
+    }
+    return *cur++;
+}
+
+uint64_t AstReader::ReadUnsigned() {
+    uint64_t val = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int b = ReadByte();
+        val |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return val;
+    }
+    failed = true;
+    return 0;
+}
+
+int AstReader::ReadInt() {
+    uint64_t zz = ReadUnsigned();
+    return (int)(int64_t)((zz >> 1) ^ (~(zz & 1) + 1));
+}
+
+double AstReader::ReadDouble() {
+    double val = 0;
+    if (end - cur < (long)sizeof(double)) {
+        failed = true;
+        return val;
+    }
+    memcpy(&val, cur, sizeof(double));
+    cur += sizeof(double);
+    return val;
+}
+
+std::string AstReader::ReadString() {
+    uint64_t len = ReadUnsigned();
+    if (failed || len > (uint64_t)(end - cur)) {
+        failed = true;
+        return "";
+    }
+    std::string str((const char *)cur, len);
+    cur += len;
+    return str;
+}
+
+const char *AstReader::ReadName() {
+    uint64_t index = ReadUnsigned();
+    if (index >= names.size()) {
+        failed = true;
+        return "";
+    }
+    return names[index].c_str();
+}
+
+bool AstReader::ReadLocation(yyltype *loc) {
+    memset(loc, 0, sizeof(*loc));
+    loc->first_line = ReadUnsigned();
+    loc->first_column = ReadUnsigned();
+    loc->last_line = loc->first_line + ReadUnsigned();
+    loc->last_column = ReadUnsigned();
+    return !failed;
+}
+
+template<class T> T *AstReader::Read(bool optional) {
+    Node *n = ReadNode();
+    if (!n) {
+        if (!optional) failed = true;
+        return NULL;
+    }
+    T *t = dynamic_cast<T*>(n);
+    if (!t) failed = true;
+    return t;
+}
+
+template<class T> List<T*> *AstReader::ReadList() {
+    uint64_t count = ReadUnsigned();
+    if (count > (uint64_t)(end - cur)) // every element takes at least a byte
+        failed = true;
+    List<T*> *list = new List<T*>;
+    for (uint64_t i = 0; i < count && !failed; i++)
+        list->Append(Read<T>());
+    return list;
+}
+
+Node *AstReader::ReadNode() {
+    int tag = ReadByte();
+    int kind = tag & ~HasLocation;
+    if (failed || kind == K_Null) return NULL;
+    if (kind >= NumNodeKinds) {
+        failed = true;
+        return NULL;
+    }
+    yyltype loc;
+    memset(&loc, 0, sizeof(loc));
+    if ((tag & HasLocation) && !ReadLocation(&loc)) return NULL;
+
+    int slot = nodes.size();   // numbered before the children, like the writer
+    nodes.push_back(NULL);
+    Node *n = BuildNode(kind, loc);
+    if (failed) return NULL;
+    return nodes[slot] = n;
+}
+
+// The children are read into locals first since the order in which
+// constructor arguments are evaluated is unspecified.
+Node *AstReader::BuildNode(int kind, yyltype loc) {
+    switch (kind) {
+      case K_Identifier: {
+        const char *name = ReadName();
+        return failed ? NULL : new Identifier(loc, name);
+      }
+      case K_BuiltinType: {
+        int i = ReadInt();
+        for (int j = 0; j <= i && !failed; j++)
+            if (!Type::builtins[j]) failed = true;
+        if (failed || i < 0) {
+            failed = true;
+            return NULL;
+        }
+        return *Type::builtins[i];
+      }
+      case K_NamedType: {
+        Identifier *id = Read<Identifier>();
+        return failed ? NULL : new NamedType(id);
+      }
+      case K_ArrayType: {
+        Type *elem = Read<Type>();
+        return failed ? NULL : new ArrayType(loc, elem);
+      }
+      case K_Program: {
+        List<Decl*> *decls = ReadList<Decl>();
+        return failed ? NULL : new Program(decls);
+      }
+      case K_VarDecl: {
+        Identifier *id = Read<Identifier>();
+        Type *type = Read<Type>();
+        return failed ? NULL : new VarDecl(id, type);
+      }
+      case K_ClassDecl: {
+        Identifier *id = Read<Identifier>();
+        NamedType *extends = Read<NamedType>(true);
+        List<NamedType*> *implements = ReadList<NamedType>();
+        List<Decl*> *members = ReadList<Decl>();
+        return failed ? NULL : new ClassDecl(id, extends, implements, members);
+      }
+      case K_InterfaceDecl: {
+        Identifier *id = Read<Identifier>();
+        List<Decl*> *members = ReadList<Decl>();
+        return failed ? NULL : new InterfaceDecl(id, members);
+      }
+      case K_FnDecl: {
+        Identifier *id = Read<Identifier>();
+        Type *returnType = Read<Type>();
+        List<VarDecl*> *formals = ReadList<VarDecl>();
+        Stmt *body = Read<Stmt>(true);
+        if (failed) return NULL;
+        FnDecl *fn = new FnDecl(id, returnType, formals);
+        if (body) fn->SetFunctionBody(body);
+        return fn;
+      }
+      case K_StmtBlock: {
+        List<VarDecl*> *decls = ReadList<VarDecl>();
+        List<Stmt*> *stmts = ReadList<Stmt>();
+        return failed ? NULL : new StmtBlock(decls, stmts);
+      }
+      case K_ForStmt: {
+        Expr *init = Read<Expr>();
+        Expr *test = Read<Expr>();
+        Expr *step = Read<Expr>();
+        Stmt *body = Read<Stmt>();
+        return failed ? NULL : new ForStmt(init, test, step, body);
+      }
+      case K_WhileStmt: {
+        Expr *test = Read<Expr>();
+        Stmt *body = Read<Stmt>();
+        return failed ? NULL : new WhileStmt(test, body);
+      }
+      case K_IfStmt: {
+        Expr *test = Read<Expr>();
+        Stmt *thenBody = Read<Stmt>();
+        Stmt *elseBody = Read<Stmt>(true);
+        return failed ? NULL : new IfStmt(test, thenBody, elseBody);
+      }
+      case K_BreakStmt:
+        return new BreakStmt(loc);
+      case K_ReturnStmt: {
+        Expr *expr = Read<Expr>();
+        return failed ? NULL : new ReturnStmt(loc, expr);
+      }
+      case K_PrintStmt: {
+        List<Expr*> *args = ReadList<Expr>();
+        return failed ? NULL : new PrintStmt(args);
+      }
+      case K_SwitchStmt: {
+        Expr *expr = Read<Expr>();
+        CaseBlock *cases = Read<CaseBlock>();
+        Default *defaultStmt = Read<Default>(true);
+        return failed ? NULL : new SwitchStmt(expr, cases, defaultStmt);
+      }
+      case K_CaseBlock: {
+        List<Case*> *cases = ReadList<Case>();
+        return failed ? NULL : new CaseBlock(cases);
+      }
+      case K_Case: {
+        IntConstant *label = Read<IntConstant>();
+        List<Stmt*> *stmts = ReadList<Stmt>();
+        return failed ? NULL : new Case(label, stmts);
+      }
+      case K_Default: {
+        List<Stmt*> *stmts = ReadList<Stmt>();
+        return failed ? NULL : new Default(stmts);
+      }
+      case K_EmptyExpr:
+        return new EmptyExpr();
+      case K_IntConstant: {
+        int val = ReadInt();
+        return failed ? NULL : new IntConstant(loc, val);
+      }
+      case K_DoubleConstant: {
+        double val = ReadDouble();
+        return failed ? NULL : new DoubleConstant(loc, val);
+      }
+      case K_BoolConstant: {
+        int val = ReadInt();
+        return failed ? NULL : new BoolConstant(loc, val != 0);
+      }
+      case K_StringConstant: {
+        std::string val = ReadString();
+        return failed ? NULL : new StringConstant(loc, val.c_str());
+      }
+      case K_NullConstant:
+        return new NullConstant(loc);
+      case K_Operator: {
+        const char *tok = ReadName();
+        return failed ? NULL : new Operator(loc, tok);
+      }
+      case K_ArithmeticExpr: case K_RelationalExpr: case K_EqualityExpr:
+      case K_LogicalExpr: case K_AssignExpr: {
+        Expr *left = Read<Expr>(true);
+        Operator *op = Read<Operator>();
+        Expr *right = Read<Expr>();
+        if (failed) return NULL;
+        if (!left) { // only arithmetic and logical operators are unary
+            if (kind == K_ArithmeticExpr) return new ArithmeticExpr(op, right);
+            if (kind == K_LogicalExpr) return new LogicalExpr(op, right);
+            failed = true;
+            return NULL;
+        }
+        switch (kind) {
+          case K_ArithmeticExpr: return new ArithmeticExpr(left, op, right);
+          case K_RelationalExpr: return new RelationalExpr(left, op, right);
+          case K_EqualityExpr:   return new EqualityExpr(left, op, right);
+          case K_LogicalExpr:    return new LogicalExpr(left, op, right);
+          default:               return new AssignExpr(left, op, right);
+        }
+      }
+      case K_This:
+        return new This(loc);
+      case K_ArrayAccess: {
+        Expr *base = Read<Expr>();
+        Expr *subscript = Read<Expr>();
+        return failed ? NULL : new ArrayAccess(loc, base, subscript);
+      }
+      case K_FieldAccess: {
+        Expr *base = Read<Expr>(true);
+        Identifier *field = Read<Identifier>();
+        return failed ? NULL : new FieldAccess(base, field);
+      }
+      case K_Call: {
+        Expr *base = Read<Expr>(true);
+        Identifier *field = Read<Identifier>();
+        List<Expr*> *actuals = ReadList<Expr>();
+        return failed ? NULL : new Call(loc, base, field, actuals);
+      }
+      case K_NewExpr: {
+        NamedType *cType = Read<NamedType>();
+        return failed ? NULL : new NewExpr(loc, cType);
+      }
+      case K_NewArrayExpr: {
+        Expr *size = Read<Expr>();
+        Type *elemType = Read<Type>();
+        return failed ? NULL : new NewArrayExpr(loc, size, elemType);
+      }
+      case K_ReadIntegerExpr:
+        return new ReadIntegerExpr(loc);
+      case K_ReadLineExpr:
+        return new ReadLineExpr(loc);
+    }
+    failed = true;
+    return NULL;
+}
+
+Program *AstReader::Load(uint64_t sourceHash) {
+    if (end - cur < MagicSize + 8 || memcmp(cur, Magic, MagicSize - 2) != 0
+        || cur[MagicSize - 2] != FormatVersion)
+        return NULL;
+    cur += MagicSize;
+    uint64_t storedHash = 0;
+    for (int i = 0; i < 8; i++)
+        storedHash |= (uint64_t)ReadByte() << (8 * i);
+    if (storedHash != sourceHash) return NULL; // the entry was written for other source text
+
+    uint64_t numNames = ReadUnsigned();
+    for (uint64_t i = 0; i < numNames && !failed; i++)
+        names.push_back(ReadString());
+
+    Program *program = Read<Program>();
+
+    uint64_t numLinks = ReadUnsigned();
+    for (uint64_t i = 0; i < numLinks && !failed; i++) {
+        uint64_t from = ReadUnsigned();
+        int which = ReadUnsigned();
+        uint64_t to = ReadUnsigned();
+        if (from >= nodes.size() || to >= nodes.size())
+            failed = true;
+        else
+            nodes[from]->RestoreLink(which, nodes[to]);
+    }
+    if (failed || cur != end) return NULL;
+    return program;
+}
+
+
+/* Cache
+ * -----
+ */
+
+uint64_t HashSource(const char *text, size_t len) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)text[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static std::string CachePath(const char *dir, uint64_t hash) {
+    char name[32];
+    sprintf(name, "/%016llx.ast", (unsigned long long)hash);
+    return std::string(dir) + name;
+}
+
+Program *LoadCachedProgram(const char *dir, const char *text, size_t len) {
+    uint64_t hash = HashSource(text, len);
+    std::string path = CachePath(dir, hash);
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (!fp) {
+        PrintDebug("cache", "miss for %s", path.c_str());
+        return NULL;
+    }
+    std::string data;
+    char buf[8192];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+        data.append(buf, n);
+    fclose(fp);
+
+    Program *program = AstReader(data.data(), data.size()).Load(hash);
+    if (!program) PrintDebug("cache", "ignoring unreadable entry %s", path.c_str());
+    return program;
+}
+
+void SaveCachedProgram(const char *dir, const char *text, size_t len, Program *program) {
+    uint64_t hash = HashSource(text, len);
+    std::string path = CachePath(dir, hash);
+    // written under a temporary name and renamed into place, so a
+    // concurrent run never sees a half-written entry
+    char suffix[32];
+    sprintf(suffix, ".%d.tmp", (int)getpid());
+    std::string tmp = path + suffix;
+    AstWriter writer;
+    if (writer.SaveToFile(tmp.c_str(), hash, program) && rename(tmp.c_str(), path.c_str()) == 0)
+        PrintDebug("cache", "saved %s", path.c_str());
+    else {
+        remove(tmp.c_str());
+        PrintDebug("cache", "could not write %s", path.c_str());
+    }
+}
@@ -0,0 +1,144 @@
+/* File: astcache.h
+ * ----------------
+ * Compact binary serialization of a checked parse tree, and an on-disk
+ * cache of such trees keyed by a hash of the source text. When dcc is
+ * run with --cache=<dir> on a program it has already compiled without
+ * errors, it loads the tree back from the cache and skips scanning,
+ * parsing and Program::Check altogether.
+ *
+ * Format: a fixed header (magic, format version, source hash) followed
+ * by the nodes in pre-order. Each node is a kind byte, its location (if
+ * any) and then its fields and children. Integers are stored as
+ * variable-length (LEB128) numbers, so most fields take a byte or two,
+ * and identifier names are interned in a string table so each distinct
+ * name is stored once. Nodes are numbered in the order they are
+ * written; after the tree comes a table of the links the checker
+ * resolved (e.g. a NamedType to its ClassDecl) as pairs of node numbers.
+ *
+ * Each node class writes itself by overriding Node::Serialize, the
+ * reader rebuilds the tree through the usual node constructors (so
+ * parent links come for free) and hands each resolved link back to its
+ * node through Node::RestoreLink.
+ */
+
+#ifndef _H_astcache
+#define _H_astcache
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "list.h"
+#include "location.h"
+
+class Node;
+class Program;
+
+typedef enum {
+    K_Null, K_Identifier, K_BuiltinType, K_NamedType, K_ArrayType,
+    K_Program, K_VarDecl, K_ClassDecl, K_InterfaceDecl, K_FnDecl,
+    K_StmtBlock, K_ForStmt, K_WhileStmt, K_IfStmt, K_BreakStmt,
+    K_ReturnStmt, K_PrintStmt, K_SwitchStmt, K_CaseBlock, K_Case, K_Default,
+    K_EmptyExpr, K_IntConstant, K_DoubleConstant, K_BoolConstant,
+    K_StringConstant, K_NullConstant, K_Operator,
+    K_ArithmeticExpr, K_RelationalExpr, K_EqualityExpr, K_LogicalExpr,
+    K_AssignExpr, K_This, K_ArrayAccess, K_FieldAccess, K_Call,
+    K_NewExpr, K_NewArrayExpr, K_ReadIntegerExpr, K_ReadLineExpr,
+    NumNodeKinds
+} NodeKind;
+
+// Which link of a node a restored link is for (see Node::RestoreLink)
+typedef enum { L_DeclForType } LinkKind;
+
+
+/* Class: AstWriter
+ * ----------------
+ * Accumulates the serialized form of a tree in memory. The Serialize
+ * methods of the node classes call BeginNode first and then write their
+ * fields and children in the same order the reader consumes them.
+ */
+class AstWriter
+{
+  private:
+    std::string bytes;
+    std::map<Node*, int> nodeIds;
+    std::map<std::string, int> nameIds;
+    std::vector<std::string> names;
+    struct Link { Node *from; int kind; Node *to; };
+    std::vector<Link> links;
+    int numNodes;
+
+    void WriteByte(int b) { bytes += (char)b; }
+    void WriteUnsigned(uint64_t val);
+
+  public:
+    AstWriter() : numNodes(0) {}
+
+    void BeginNode(Node *n, NodeKind kind);
+    void WriteNode(Node *n);             // n may be NULL
+    void WriteInt(int val);
+    void WriteDouble(double val);
+    void WriteString(const char *str);   // stored inline, not interned
+    void WriteName(const char *name);    // interned
+    void AddLink(Node *from, LinkKind kind, Node *to);
+
+    template<class Element> void WriteList(List<Element> *list)
+      { WriteUnsigned(list->NumElements());
+        for (Element elem : *list) WriteNode(elem); }
+
+        // Writes the header, name table, tree and link table to path
+    bool SaveToFile(const char *path, uint64_t sourceHash, Program *program);
+};
+
+
+/* Class: AstReader
+ * ----------------
+ * Rebuilds a tree from the bytes written by AstWriter. Any truncated or
+ * malformed input makes the reader fail cleanly (Load returns NULL)
+ * rather than build a partial tree.
+ */
+class AstReader
+{
+  private:
+    const unsigned char *cur, *end;
+    bool failed;
+    std::vector<std::string> names;
+    std::vector<Node*> nodes;
+
+    int ReadByte();
+    uint64_t ReadUnsigned();
+    int ReadInt();
+    double ReadDouble();
+    std::string ReadString();
+    const char *ReadName();
+    bool ReadLocation(yyltype *loc);
+
+    Node *ReadNode();
+    Node *BuildNode(int kind, yyltype loc);
+    template<class T> T *Read(bool optional = false);
+    template<class T> List<T*> *ReadList();
+
+  public:
+    AstReader(const void *data, size_t len);
+    Program *Load(uint64_t sourceHash);
+};
+
+
+/* Function: HashSource()
+ * ----------------------
+ * 64-bit FNV-1a hash of the source text, used as the cache key.
+ */
+uint64_t HashSource(const char *text, size_t len);
+
+/* Functions: LoadCachedProgram(), SaveCachedProgram()
+ * ---------------------------------------------------
+ * Look up/store the checked tree for the given source text in the cache
+ * directory. Load returns NULL on a miss or an unreadable entry. Only
+ * trees that checked without errors should be saved, since a cache hit
+ * reports nothing.
+ */
+Program *LoadCachedProgram(const char *dir, const char *text, size_t len);
+void SaveCachedProgram(const char *dir, const char *text, size_t len, Program *program);
+
+#endif
@@ -0,0 +1,412 @@
+/* File: bce.cc
+ * ------------
+ * Implementation of bounds check elimination.
+ */
+
+#include "bce.h"
+#include "ssa.h"
+#include "arena.h"
+#include "utility.h"
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// x < y holds in the blocks block dominates, since it is only entered
+// from a branch on that test
+struct LessThan {
+    int block, x, y;
+};
+
+
+class BoundsCheckEliminator
+{
+  private:
+    TacFunction *fn;
+    Dominators *doms;
+    std::vector<Instr*> def;           // NULL for parameters
+    std::vector<int> defBlock;         // -1 for parameters
+    std::vector<LessThan> facts;
+    std::vector<bool> nonNegative;
+    int numChecks, numProven, numHoisted;
+
+        // The loop Hoist is looking at
+    std::vector<bool> inLoop;
+    std::vector<bool> storedFields, storedKinds;
+    std::vector<Instr*> checks;
+    std::vector<BasicBlock*> checkBlocks;
+    std::unordered_map<int, int> copies;   // temporaries recomputed before it
+
+    void Analyze();
+    bool IsConstant(int temp, int *value);
+    bool Holds(int x, int block);
+    bool IsLengthOf(int y, int array);
+    bool IsProven(Instr *check, int block);
+    void Prove();
+
+    bool IsQuiet(Instr *instr);
+    bool CanRecompute(int temp, int numChecks);
+    int Recompute(int temp, BasicBlock *b);
+    Instr *NewCheck(int array, int index);
+    bool HoistFrom(BasicBlock *header, const std::vector<std::vector<int> > &latches);
+    bool Hoist();
+
+  public:
+    BoundsCheckEliminator(TacFunction *f)
+      : fn(f), doms(NULL), numChecks(0), numProven(0), numHoisted(0) {}
+    ~BoundsCheckEliminator() { delete doms; }
+    void Run();
+};
+
+bool BoundsCheckEliminator::IsConstant(int temp, int *value) {
+    Instr *d = def[temp];
+    if (!d || d->op != OP_LoadInt) return false;
+    *value = d->intValue;
+    return true;
+}
+
+// Whether x < y holds at the start of block for some y
+bool BoundsCheckEliminator::Holds(int x, int block) {
+    for (const LessThan &f : facts)
+        if (f.x == x && doms->Dominates(f.block, block)) return true;
+    return false;
+}
+
+bool BoundsCheckEliminator::IsLengthOf(int y, int array) {
+    return (def[y] && def[y]->op == OP_ArrayLength && def[y]->a == array)
+        || (def[array] && def[array]->op == OP_NewArray && def[array]->a == y);
+}
+
+void BoundsCheckEliminator::Analyze() {
+    delete doms;
+    doms = new Dominators(fn);
+    int n = fn->NumTemps();
+    def.assign(n, NULL);
+    defBlock.assign(n, -1);
+    for (BasicBlock *b : fn->blocks)
+        for (Instr *instr = b->first; instr; instr = instr->next)
+            if (instr->dst != NoTemp) {
+                def[instr->dst] = instr;
+                defBlock[instr->dst] = b->id;
+            }
+
+    facts.clear();
+    for (BasicBlock *b : fn->blocks) {
+        Instr *branch = b->Terminator();
+        if (!branch || branch->op != OP_Branch || branch->target[0] == branch->target[1])
+            continue;
+        Instr *test = def[branch->a];
+        if (!test) continue;
+        for (int k = 0; k < 2; k++) {
+            BasicBlock *to = branch->target[k];
+            if (to->preds.NumElements() != 1) continue;
+            LessThan f = { to->id, NoTemp, NoTemp };
+            if ((test->op == OP_Lt && k == 0) || (test->op == OP_Ge && k == 1)) {
+                f.x = test->a;
+                f.y = test->b;
+            } else if ((test->op == OP_Gt && k == 0) || (test->op == OP_Le && k == 1)) {
+                f.x = test->b;
+                f.y = test->a;
+            }
+            if (f.x != NoTemp) facts.push_back(f);
+        }
+    }
+
+    // Assume everything that might be non-negative is, then take back
+    // what doesn't follow until nothing changes. x + 1 can't wrap around
+    // where x < y holds, as y is at most the largest int.
+    nonNegative.assign(n, false);
+    for (int t = 0; t < n; t++) {
+        Instr *d = def[t];
+        if (!d) continue;
+        if (d->op == OP_LoadInt) nonNegative[t] = d->intValue >= 0;
+        if (d->op == OP_ArrayLength || d->op == OP_Phi || d->op == OP_Move || d->op == OP_Add)
+            nonNegative[t] = true;
+    }
+    for (bool changed = true; changed; ) {
+        changed = false;
+        for (int t = 0; t < n; t++) {
+            if (!nonNegative[t]) continue;
+            Instr *d = def[t];
+            bool holds = true;
+            int one;
+            if (d->op == OP_Phi) {
+                for (int j = 0; j < d->numArgs; j++)
+                    holds = holds && d->args[j] != NoTemp && nonNegative[d->args[j]];
+            } else if (d->op == OP_Move) {
+                holds = nonNegative[d->a];
+            } else if (d->op == OP_Add) {
+                int x = (IsConstant(d->b, &one) && one == 1) ? d->a
+                      : (IsConstant(d->a, &one) && one == 1) ? d->b : NoTemp;
+                holds = x != NoTemp && nonNegative[x] && Holds(x, defBlock[t]);
+            }
+            if (!holds) {
+                nonNegative[t] = false;
+                changed = true;
+            }
+        }
+    }
+}
+
+
+/* Proving checks
+ * --------------
+ * Every way of proving a check also shows the array is not null: it
+ * was just allocated, or its length was taken before.
+ */
+
+bool BoundsCheckEliminator::IsProven(Instr *check, int block) {
+    int array = check->a, index = check->b, k, length;
+    if (!nonNegative[index]) return false;
+    Instr *alloc = (def[array] && def[array]->op == OP_NewArray) ? def[array] : NULL;
+    bool knownLength = alloc && IsConstant(alloc->a, &length);
+    if (knownLength && IsConstant(index, &k) && k < length) return true;
+    for (const LessThan &f : facts) {
+        if (f.x != index || !doms->Dominates(f.block, block)) continue;
+        if (IsLengthOf(f.y, array) || (knownLength && IsConstant(f.y, &k) && k <= length))
+            return true;
+    }
+    return false;
+}
+
+// Visits the blocks in dominator tree order, so a check that dominates
+// another has been seen by the time that one is
+void BoundsCheckEliminator::Prove() {
+    std::map<std::pair<int, int>, std::vector<int> > seen;   // blocks by array and index
+    for (int id : doms->preorder) {
+        BasicBlock *b = fn->blocks.Nth(id);
+        for (Instr *instr = b->first, *next; instr; instr = next) {
+            next = instr->next;
+            if (instr->op != OP_CheckBounds) continue;
+            numChecks++;
+            std::vector<int> &same = seen[std::make_pair(instr->a, instr->b)];
+            bool redundant = false;
+            for (int other : same) redundant = redundant || doms->Dominates(other, id);
+            same.push_back(id);
+            if (redundant || IsProven(instr, id)) {
+                b->Remove(instr);
+                numProven++;
+            }
+        }
+    }
+}
+
+
+/* Hoisting checks out of loops
+ * ----------------------------
+ */
+
+// Whether instr can neither stop the program nor show anything, once
+// the checks have been taken care of
+bool BoundsCheckEliminator::IsQuiet(Instr *instr) {
+    int length;
+    switch (instr->op) {
+      case OP_Div: case OP_Mod:
+        return false;
+      case OP_LoadField: case OP_StoreField:
+        return instr->a == 0 && fn->cls;   // the receiver
+      case OP_NewArray:
+        return IsConstant(instr->a, &length) && length > 0;
+      case OP_Move: case OP_Phi: case OP_LoadGlobal: case OP_StoreGlobal:
+      case OP_LoadElem: case OP_StoreElem: case OP_CheckBounds: case OP_NewObject:
+      case OP_Jump: case OP_Branch: case OP_Switch:
+        return true;
+      default:
+        return instr->IsComputation();
+    }
+}
+
+// Whether temp has the same value on every round of the loop and can be
+// computed before it. An element can be loaded once one of the first
+// numChecks checks has been done on it, and only if the loop stores no
+// elements of its kind, which could be in the same array.
+bool BoundsCheckEliminator::CanRecompute(int temp, int numChecks) {
+    if (defBlock[temp] < 0 || !inLoop[defBlock[temp]]) return true;
+    Instr *d = def[temp];
+    switch (d->op) {
+      case OP_LoadInt:
+        return true;
+      case OP_LoadField:
+        return !storedFields[d->intValue];
+      case OP_LoadElem:
+        if (storedKinds[fn->tempKinds.Nth(temp)]) return false;
+        for (int i = 0; i < numChecks; i++)
+            if (checks[i]->a == d->a && checks[i]->b == d->b)
+                return CanRecompute(d->a, i) && CanRecompute(d->b, i);
+        return false;
+      default:
+        return false;
+    }
+}
+
+// A temporary of b that holds the value temp has in the loop
+int BoundsCheckEliminator::Recompute(int temp, BasicBlock *b) {
+    if (defBlock[temp] < 0 || !inLoop[defBlock[temp]]) return temp;
+    std::unordered_map<int, int>::iterator it = copies.find(temp);
+    if (it != copies.end()) return it->second;
+    Instr *copy = NewInstr(def[temp]->op);
+    *copy = *def[temp];
+    copy->dst = fn->NewTemp(fn->tempKinds.Nth(temp));
+    if (copy->a != NoTemp) copy->a = Recompute(copy->a, b);
+    if (copy->b != NoTemp) copy->b = Recompute(copy->b, b);
+    b->Append(copy);
+    return copies[temp] = copy->dst;
+}
+
+Instr *BoundsCheckEliminator::NewCheck(int array, int index) {
+    Instr *check = NewInstr(OP_CheckBounds);
+    check->a = array;
+    check->b = index;
+    return check;
+}
+
+bool BoundsCheckEliminator::HoistFrom(BasicBlock *header,
+                                      const std::vector<std::vector<int> > &latches) {
+    // One way in besides the back edge, which must be a plain jump
+    if (latches[header->id].size() != 1 || header->preds.NumElements() != 2) return false;
+    BasicBlock *latch = fn->blocks.Nth(latches[header->id][0]);
+    int fromLatch = (header->preds.Nth(0) == latch) ? 0 : 1;
+    BasicBlock *pre = header->preds.Nth(1 - fromLatch);
+    if (pre->last->op != OP_Jump) return false;
+
+    inLoop.assign(fn->blocks.NumElements(), false);
+    inLoop[header->id] = true;
+    std::vector<BasicBlock*> work(1, latch);
+    while (!work.empty()) {
+        BasicBlock *b = work.back();
+        work.pop_back();
+        if (inLoop[b->id]) continue;
+        inLoop[b->id] = true;
+        for (BasicBlock *pred : b->preds) work.push_back(pred);
+    }
+
+    // The header tests i < n, for an i that starts at init and goes up
+    // by one on every round
+    Instr *branch = header->Terminator();
+    if (!branch || branch->op != OP_Branch) return false;
+    BasicBlock *body = branch->target[0], *exit = branch->target[1];
+    if (!inLoop[body->id] || inLoop[exit->id] || body->preds.NumElements() != 1) return false;
+    Instr *test = def[branch->a];
+    if (!test || (test->op != OP_Lt && test->op != OP_Gt)) return false;
+    int var = (test->op == OP_Lt) ? test->a : test->b;
+    int bound = (test->op == OP_Lt) ? test->b : test->a;
+    Instr *phi = def[var];
+    if (!phi || phi->op != OP_Phi || defBlock[var] != header->id) return false;
+    int init = phi->args[1 - fromLatch], one;
+    Instr *step = def[phi->args[fromLatch]];
+    if (!step || step->op != OP_Add) return false;
+    if (!(step->a == var && IsConstant(step->b, &one) && one == 1) &&
+        !(step->b == var && IsConstant(step->a, &one) && one == 1))
+        return false;
+
+    // Nothing else leaves the loop or loops inside it, and the checks
+    // are done on every round, after the test
+    storedFields.assign(fn->cls ? fn->cls->NumFields() : 0, false);
+    storedKinds.assign(3, false);
+    checks.clear();
+    checkBlocks.clear();
+    for (int id : doms->preorder) {
+        if (!inLoop[id]) continue;
+        BasicBlock *b = fn->blocks.Nth(id);
+        if (b != header && !latches[id].empty()) return false;
+        for (BasicBlock *succ : b->succs)
+            if (!inLoop[succ->id] && !(b == header && succ == exit)) return false;
+        for (Instr *instr = b->first; instr; instr = instr->next) {
+            if (!IsQuiet(instr)) return false;
+            if (instr->op == OP_StoreField) storedFields[instr->intValue] = true;
+            if (instr->op == OP_StoreElem) storedKinds[fn->tempKinds.Nth(instr->c)] = true;
+            if (instr->op != OP_CheckBounds) continue;
+            if (!doms->Dominates(body->id, id) || !doms->Dominates(id, latch->id)) return false;
+            checks.push_back(instr);
+            checkBlocks.push_back(b);
+        }
+    }
+    if (checks.empty() || !CanRecompute(bound, 0)) return false;
+    for (int i = 0; i < (int)checks.size(); i++)
+        if (!CanRecompute(checks[i]->a, i) || (checks[i]->b != var && !CanRecompute(checks[i]->b, i)))
+            return false;
+
+    // The pre-header now goes to a block with the checks when init < n
+    copies.clear();
+    pre->Remove(pre->last);
+    int n = Recompute(bound, pre);
+    Instr *guard = NewInstr(OP_Lt);
+    guard->dst = fn->NewTemp(V_Int);
+    guard->a = init;
+    guard->b = n;
+    pre->Append(guard);
+    BasicBlock *checked = fn->NewBlock();
+    fn->blocks.RemoveAt(fn->blocks.NumElements() - 1);
+    fn->blocks.InsertAt(checked, pre->id + 1);
+    Instr *split = NewInstr(OP_Branch);
+    split->a = guard->dst;
+    split->target[0] = checked;
+    split->target[1] = header;
+    pre->Append(split);
+
+    // The checks of the first round, in order, then those of the last
+    std::vector<int> arrays;
+    for (Instr *check : checks) {
+        arrays.push_back(Recompute(check->a, checked));
+        int index = (check->b == var) ? init : Recompute(check->b, checked);
+        checked->Append(NewCheck(arrays.back(), index));
+    }
+    int last = NoTemp;
+    for (int i = 0; i < (int)checks.size(); i++) {
+        if (checks[i]->b != var) continue;
+        if (last == NoTemp) {
+            Instr *load = NewInstr(OP_LoadInt);
+            load->dst = fn->NewTemp(V_Int);
+            load->intValue = 1;
+            checked->Append(load);
+            Instr *sub = NewInstr(OP_Sub);
+            sub->dst = last = fn->NewTemp(V_Int);
+            sub->a = n;
+            sub->b = load->dst;
+            checked->Append(sub);
+        }
+        checked->Append(NewCheck(arrays[i], last));
+    }
+    Instr *jump = NewInstr(OP_Jump);
+    jump->target[0] = header;
+    checked->Append(jump);
+    for (int i = 0; i < (int)checks.size(); i++)
+        checkBlocks[i]->Remove(checks[i]);
+    numHoisted += checks.size();
+
+    // The header's phis take the same value from either way in
+    header->preds.Append(checked);
+    ForEachPhi(header, [&](Instr *phi) {
+        int *args = (int *)ArenaAlloc((phi->numArgs + 1) * sizeof(int));
+        for (int j = 0; j < phi->numArgs; j++) args[j] = phi->args[j];
+        args[phi->numArgs++] = phi->args[1 - fromLatch];
+        phi->args = args;
+    });
+    UpdateEdges(fn);
+    return true;
+}
+
+bool BoundsCheckEliminator::Hoist() {
+    std::vector<std::vector<int> > latches(fn->blocks.NumElements());
+    for (BasicBlock *b : fn->blocks)
+        for (BasicBlock *succ : b->succs)
+            if (doms->Dominates(succ->id, b->id)) latches[succ->id].push_back(b->id);
+    for (BasicBlock *b : fn->blocks)
+        if (!latches[b->id].empty() && HoistFrom(b, latches)) return true;
+    return false;
+}
+
+void BoundsCheckEliminator::Run() {
+    Analyze();
+    Prove();
+    while (Hoist()) Analyze();
+    if (numChecks)
+        PrintDebug("bce", "%s: %d checks, %d proven, %d hoisted out of loops",
+                   fn->name, numChecks, numProven, numHoisted);
+}
+
+
+void EliminateBoundsChecks(TacFunction *fn) {
+    Assert(fn->inSSA);
+    BoundsCheckEliminator(fn).Run();
+}
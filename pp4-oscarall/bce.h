@@ -0,0 +1,38 @@
+/* File: bce.h
+ * -----------
+ * Elimination of array bounds checks, a pass on SSA form (see ssa.h).
+ * Every subscript is lowered with an OP_CheckBounds in front of it; this
+ * removes those that a range analysis proves can never fail, and moves
+ * the rest out of simple loops where that doesn't change what the
+ * program does.
+ *
+ * The analysis works out which int temporaries can't be negative (a
+ * constant that isn't, an array length, and a loop variable that starts
+ * out non-negative and goes up by one while it is below something, so
+ * it can't wrap around), and which tests x < y hold where, from the
+ * branches on them. A check of a[i] is proven when i can't be negative
+ * and i < y holds there for a y that is a.length() or the length a was
+ * allocated with, or a constant no larger than that. A check that an
+ * identical one before it dominates goes too.
+ *
+ * A loop for i from init while i < n, going up by one, with no other
+ * way out, no inner loop and nothing in it that shows (no calls, prints
+ * or anything else that can stop the program), does not need its
+ * checks on every round: a check of a[i] or of a[k], where a and k are
+ * the same on every round, is done once before the loop, for init and
+ * for n - 1, and only if the loop runs at all. A program that would
+ * have stopped inside such a loop stops before it instead, which can't
+ * be told apart.
+ *
+ * -d bce reports for each function how many checks were proven and how
+ * many were hoisted.
+ */
+
+#ifndef _H_bce
+#define _H_bce
+
+struct TacFunction;
+
+void EliminateBoundsChecks(TacFunction *fn);
+
+#endif
@@ -0,0 +1,439 @@
+/* File: bytecode.cc
+ * -----------------
+ * Translation of three-address code into bytecode, and the -d bytecode
+ * dump.
+ */
+
+#include "bytecode.h"
+#include "tac.h"
+#include "liveness.h"
+#include "dstring.h"
+#include "arena.h"
+#include <string.h>
+#include <algorithm>
+#include <unordered_map>
+
+#define BYTECODE_NAME(name, dumpName, format) dumpName,
+const char *const BytecodeNames[NumBytecodes] = { BYTECODES(BYTECODE_NAME) };
+#undef BYTECODE_NAME
+
+#define BYTECODE_FORMAT(name, dumpName, format) format,
+const char *const BytecodeFormats[NumBytecodes] = { BYTECODES(BYTECODE_FORMAT) };
+#undef BYTECODE_FORMAT
+
+
+int BcProgram::InstrSize(int pc) {
+    const int *instr = code.begin() + pc;
+    int size = 1;
+    for (const char *f = BytecodeFormats[instr[0]]; *f; f++)
+        size += (*f == '*' || *f == '#') ? 1 + instr[size] : 1;
+    return size;
+}
+
+BcStackMap *BcProgram::StackMapAt(int pc) {
+    BcStackMap *map = std::lower_bound(stackMaps.begin(), stackMaps.end(), pc,
+                                       [](const BcStackMap &m, int p) { return m.pc < p; });
+    return (map != stackMaps.end() && map->pc == pc) ? map : NULL;
+}
+
+static void PrintInstr(FILE *fp, BcProgram *prog, int pc) {
+    const int *instr = prog->code.begin() + pc;
+    fprintf(fp, "  %5d  %s", pc, BytecodeNames[instr[0]]);
+    int w = 1;
+    for (const char *f = BytecodeFormats[instr[0]]; *f; f++, w++) {
+        fputs(f == BytecodeFormats[instr[0]] ? " " : ", ", fp);
+        int x = instr[w];
+        switch (*f) {
+          case 'r': fprintf(fp, "r%d", x); break;
+          case 'i': fprintf(fp, "%d", x); break;
+          case 'g': fprintf(fp, "global[%d]", x); break;
+          case 'f': fprintf(fp, "field[%d]", x); break;
+          case 'c': fputs(prog->classes.Nth(x)->name, fp); break;
+          case 'F': fputs(prog->functions.Nth(x)->name, fp); break;
+          case 'v': fprintf(fp, "vtable[%d]", x); break;
+          case 's': fputs(prog->selectorNames.Nth(x), fp); break;
+          case 'L': fprintf(fp, "@%d", x); break;
+          case 'k': fprintf(fp, "k%d", x); break;
+          case '*':
+            fputc('(', fp);
+            for (int i = 0; i < x; i++)
+                fprintf(fp, "%sr%d", i ? ", " : "", instr[w + 1 + i]);
+            fputc(')', fp);
+            w += x;
+            break;
+          case '#':
+            fputc('[', fp);
+            for (int i = 0; i < x; i++)
+                fprintf(fp, "%s@%d", i ? ", " : "", instr[w + 1 + i]);
+            fputc(']', fp);
+            w += x;
+            break;
+        }
+    }
+    fputc('\n', fp);
+}
+
+void BcProgram::Print(FILE *fp) {
+    for (BcClass *cls : classes) {
+        fprintf(fp, "class %s (%d fields)\n  vtable:", cls->name, cls->numFields);
+        for (int i = 0; cls->vtable[i]; i++)
+            fprintf(fp, " %s", cls->vtable[i]->name);
+        fputs("\n\n", fp);
+    }
+    for (int i = 0; i < functions.NumElements(); i++) {
+        BcFunction *f = functions.Nth(i);
+        int end = (i + 1 < functions.NumElements()) ? functions.Nth(i+1)->entry : code.NumElements();
+        fprintf(fp, "function %s (%d params, %d registers)\n", f->name, f->numParams, f->numRegs);
+        for (int pc = f->entry; pc < end; pc += InstrSize(pc)) {
+            PrintInstr(fp, this, pc);
+            BcStackMap *map = StackMapAt(pc + InstrSize(pc));
+            if (!map) continue;
+            fputs("         refs:", fp);
+            for (int i = 0; i < map->numRefs; i++) fprintf(fp, " r%d", map->refs[i]);
+            fputc('\n', fp);
+        }
+        fputc('\n', fp);
+    }
+}
+
+
+/* Class: BytecodeCompiler
+ * -----------------------
+ * Translates one function at a time. Jumps are emitted with the id of
+ * the target block and patched to its position once the whole function
+ * has been laid out.
+ */
+class BytecodeCompiler
+{
+  private:
+    BcProgram *prog;
+    TacProgram *tac;
+    std::unordered_map<TacFunction*, BcFunction*> functions;
+    std::unordered_map<ClassLayout*, BcClass*> classes;
+    std::unordered_map<const char*, int> strings;   // constant of each pooled literal
+
+    TacFunction *fn;           // being translated
+    int scratch;               // register for results nobody uses
+    List<int> blockStarts;     // position of each block of fn
+    List<int> fixups;          // positions of jump targets to patch
+    List<int> uses;            // how many times each temporary is read
+    std::unordered_map<Instr*, List<int> > liveRefs;   // across each safepoint
+
+    void Emit(int word)        { prog->code.Append(word); }
+    int Dst(Instr *instr)      { return instr->dst == NoTemp ? scratch : instr->dst; }
+    void EmitTarget(BasicBlock *b);
+    int AddConstant(Value v);
+    int StringConstant(const char *text);
+    void CountUses();
+    static bool IsSafepoint(Instr *instr);
+    void FindLiveRefs(Liveness &liveness);
+    bool FusesWithBranch(Instr *instr);
+    void EmitBranch(Bytecode jump, Bytecode negated, int a, int b,
+                    BasicBlock *ifTrue, BasicBlock *ifFalse, BasicBlock *next);
+    void EmitCall(Bytecode op, int dst, int callee, Instr *instr);
+    void CompileInstr(Instr *instr, BasicBlock *next);
+    void CompileFunction(TacFunction *f);
+
+  public:
+    BytecodeCompiler(TacProgram *t);
+    BcProgram *Compile();
+};
+
+BytecodeCompiler::BytecodeCompiler(TacProgram *t) {
+    tac = t;
+    prog = new BcProgram;
+    fn = NULL;
+    scratch = 0;
+}
+
+void BytecodeCompiler::EmitTarget(BasicBlock *b) {
+    fixups.Append(prog->code.NumElements());
+    Emit(b->id);
+}
+
+int BytecodeCompiler::AddConstant(Value v) {
+    prog->constants.Append(v);
+    return prog->constants.NumElements() - 1;
+}
+
+// Literals are pooled (see TacProgram), so each gets one constant
+int BytecodeCompiler::StringConstant(const char *text) {
+    std::unordered_map<const char*, int>::iterator it = strings.find(text);
+    if (it != strings.end()) return it->second;
+    Value v;
+    v.p = NewString(text, strlen(text));
+    return strings[text] = AddConstant(v);
+}
+
+void BytecodeCompiler::CountUses() {
+    uses = List<int>();
+    for (int i = 0; i < fn->NumTemps(); i++) uses.Append(0);
+    int *count = uses.begin();
+    for (BasicBlock *b : fn->blocks)
+        for (Instr *instr = b->first; instr; instr = instr->next) {
+            if (instr->a != NoTemp) count[instr->a]++;
+            if (instr->b != NoTemp) count[instr->b]++;
+            if (instr->c != NoTemp) count[instr->c]++;
+            for (int i = 0; i < instr->numArgs; i++) count[instr->args[i]]++;
+        }
+}
+
+// Whether a collection may happen during instr
+bool BytecodeCompiler::IsSafepoint(Instr *instr) {
+    return instr->op == OP_NewObject || instr->op == OP_NewArray
+        || (instr->IsCall() && instr->op != OP_CallBuiltin);
+}
+
+void BytecodeCompiler::FindLiveRefs(Liveness &liveness) {
+    liveRefs.clear();
+    for (BasicBlock *b : fn->blocks) {
+        TempSet live = liveness.liveOut[b->id];
+        for (Instr *instr = b->last; instr; instr = instr->prev) {
+            if (IsSafepoint(instr)) {
+                List<int> &refs = liveRefs[instr];
+                live.ForEach([&](int t) {
+                    if (t != instr->dst && fn->tempKinds.Nth(t) == V_Ref) refs.Append(t);
+                });
+            }
+            Liveness::StepBack(live, instr);
+        }
+    }
+}
+
+// An int comparison whose result only feeds the branch right after it
+// is left to that branch, which becomes a compare-and-branch
+bool BytecodeCompiler::FusesWithBranch(Instr *instr) {
+    Instr *next = instr->next;
+    return instr->op >= OP_Eq && instr->op <= OP_Ge && next && next->op == OP_Branch
+        && next->a == instr->dst && uses.Nth(instr->dst) == 1;
+}
+
+// Jumps to ifTrue when the test holds and to ifFalse otherwise, falling
+// through when either is the next block. b is NoTemp for the tests of a
+// single register.
+void BytecodeCompiler::EmitBranch(Bytecode jump, Bytecode negated, int a, int b,
+                                  BasicBlock *ifTrue, BasicBlock *ifFalse, BasicBlock *next) {
+    if (ifTrue == next) {
+        jump = negated;
+        ifTrue = ifFalse;
+        ifFalse = next;
+    }
+    Emit(jump);
+    Emit(a);
+    if (b != NoTemp) Emit(b);
+    EmitTarget(ifTrue);
+    if (ifFalse != next) {
+        Emit(BC_Jump);
+        EmitTarget(ifFalse);
+    }
+}
+
+void BytecodeCompiler::EmitCall(Bytecode op, int dst, int callee, Instr *instr) {
+    Emit(op);
+    Emit(dst);
+    Emit(callee);
+    Emit(instr->numArgs);
+    for (int i = 0; i < instr->numArgs; i++)
+        Emit(instr->args[i]);
+}
+
+static const Bytecode BuiltinCodes[NumBuiltins] = {
+    BC_PrintInt, BC_PrintBool, BC_PrintString,
+    BC_ReadInteger, BC_ReadLine
+};
+
+// The TAC opcodes from OP_Add to OP_Not have bytecodes of the same
+// name and operands, in the same order
+void BytecodeCompiler::CompileInstr(Instr *instr, BasicBlock *next) {
+    Value v;
+    switch (instr->op) {
+      case OP_LoadInt:
+        Emit(BC_LoadInt); Emit(Dst(instr)); Emit(instr->intValue);
+        break;
+      case OP_LoadNull:
+        Emit(BC_LoadInt); Emit(Dst(instr)); Emit(0);
+        break;
+      case OP_LoadDouble:
+        v.d = instr->doubleValue;
+        Emit(BC_LoadConst); Emit(Dst(instr)); Emit(AddConstant(v));
+        break;
+      case OP_LoadString:
+        Emit(BC_LoadConst); Emit(Dst(instr)); Emit(StringConstant(instr->text));
+        break;
+      case OP_Move:
+        if (instr->dst == instr->a) break;
+        Emit(BC_Move); Emit(instr->dst); Emit(instr->a);
+        break;
+      case OP_LoadGlobal:
+        Emit(BC_LoadGlobal); Emit(Dst(instr)); Emit(instr->intValue);
+        break;
+      case OP_StoreGlobal:
+        Emit(BC_StoreGlobal); Emit(instr->intValue); Emit(instr->a);
+        break;
+      case OP_LoadField:
+        Emit(BC_LoadField); Emit(Dst(instr)); Emit(instr->a); Emit(instr->intValue);
+        break;
+      case OP_StoreField:
+        Emit(BC_StoreField); Emit(instr->a); Emit(instr->intValue); Emit(instr->b);
+        break;
+      case OP_LoadElem:
+        Emit(BC_LoadElem); Emit(Dst(instr)); Emit(instr->a); Emit(instr->b);
+        break;
+      case OP_StoreElem:
+        Emit(BC_StoreElem); Emit(instr->a); Emit(instr->b); Emit(instr->c);
+        break;
+      case OP_ArrayLength:
+        Emit(BC_Length); Emit(Dst(instr)); Emit(instr->a);
+        break;
+      case OP_CheckBounds:
+        Emit(BC_CheckBounds); Emit(instr->a); Emit(instr->b);
+        break;
+      case OP_CheckNull:
+        Emit(BC_CheckNull); Emit(instr->a);
+        break;
+      case OP_NewObject:
+        Emit(BC_NewObject); Emit(Dst(instr)); Emit(classes[instr->cls]->index);
+        break;
+      case OP_NewArray:
+        Emit(BC_NewArray); Emit(Dst(instr)); Emit(instr->a); Emit(instr->intValue == V_Ref);
+        break;
+      case OP_Call:
+        EmitCall(BC_Call, Dst(instr), functions[instr->callee]->index, instr);
+        break;
+      case OP_CallVirtual:
+        EmitCall(BC_CallVirtual, Dst(instr), instr->intValue, instr);
+        break;
+      case OP_CallInterface:
+        EmitCall(BC_CallInterface, Dst(instr), instr->intValue, instr);
+        break;
+      case OP_CallBuiltin:
+        Emit(BuiltinCodes[instr->intValue]);
+        Emit(instr->numArgs ? instr->args[0] : Dst(instr));
+        break;
+      case OP_Jump:
+        if (instr->target[0] != next) {
+            Emit(BC_Jump);
+            EmitTarget(instr->target[0]);
+        }
+        break;
+      case OP_Branch:
+        if (instr->prev && FusesWithBranch(instr->prev)) {
+            static const Bytecode jumps[] = { BC_JumpEq, BC_JumpNe, BC_JumpLt, BC_JumpLe, BC_JumpGt, BC_JumpGe };
+            static const Bytecode negated[] = { BC_JumpNe, BC_JumpEq, BC_JumpGe, BC_JumpGt, BC_JumpLe, BC_JumpLt };
+            Instr *test = instr->prev;
+            int k = test->op - OP_Eq;
+            EmitBranch(jumps[k], negated[k], test->a, test->b, instr->target[0], instr->target[1], next);
+        } else {
+            EmitBranch(BC_JumpIfTrue, BC_JumpIfFalse, instr->a, NoTemp,
+                       instr->target[0], instr->target[1], next);
+        }
+        break;
+      case OP_Switch:
+        Emit(BC_JumpTable);
+        Emit(instr->a);
+        Emit(instr->table->low);
+        EmitTarget(instr->target[0]);
+        Emit(instr->table->size);
+        for (int i = 0; i < instr->table->size; i++)
+            EmitTarget(instr->table->targets[i]);
+        break;
+      case OP_Return:
+        if (instr->a == NoTemp) Emit(BC_ReturnVoid);
+        else { Emit(BC_Return); Emit(instr->a); }
+        break;
+      default:
+        Assert(instr->op >= OP_Add && instr->op <= OP_Not);
+        Emit(BC_Add + (instr->op - OP_Add));
+        Emit(Dst(instr));
+        Emit(instr->a);
+        if (instr->b != NoTemp) Emit(instr->b);
+    }
+}
+
+void BytecodeCompiler::CompileFunction(TacFunction *f) {
+    fn = f;
+    scratch = f->NumTemps();
+    functions[f]->entry = prog->code.NumElements();
+    blockStarts = List<int>();
+    fixups = List<int>();
+    CountUses();
+    Liveness liveness(f);
+    FindLiveRefs(liveness);
+    liveness.liveIn[0].ForEach([&](int t) {
+        if (t >= f->numParams && f->tempKinds.Nth(t) == V_Ref) {
+            Emit(BC_LoadInt); Emit(t); Emit(0);
+        }
+    });
+
+    int numBlocks = f->blocks.NumElements();
+    for (int i = 0; i < numBlocks; i++) {
+        BasicBlock *b = f->blocks.Nth(i);
+        BasicBlock *next = (i + 1 < numBlocks) ? f->blocks.Nth(i+1) : NULL;
+        Assert(b->id == i);
+        blockStarts.Append(prog->code.NumElements());
+        for (Instr *instr = b->first; instr; instr = instr->next) {
+            if (FusesWithBranch(instr)) continue;
+            CompileInstr(instr, next);
+            if (!IsSafepoint(instr)) continue;
+            List<int> &refs = liveRefs[instr];
+            BcStackMap map = { prog->code.NumElements(), refs.NumElements(), NULL };
+            map.refs = (int *)ArenaAlloc(map.numRefs * sizeof(int));
+            for (int k = 0; k < map.numRefs; k++) map.refs[k] = refs.Nth(k);
+            prog->stackMaps.Append(map);
+        }
+    }
+    int *code = prog->code.begin();
+    for (int pos : fixups)
+        code[pos] = blockStarts.Nth(code[pos]);
+}
+
+BcProgram *BytecodeCompiler::Compile() {
+    for (TacFunction *f : tac->functions) {
+        BcFunction *bf = (BcFunction *)ArenaAlloc(sizeof(BcFunction));
+        bf->name = f->name;
+        bf->index = prog->functions.NumElements();
+        bf->numParams = f->numParams;
+        bf->numRegs = f->NumTemps() + 1;   // and the scratch register
+        bf->entry = 0;
+        functions[f] = bf;
+        prog->functions.Append(bf);
+    }
+    prog->main = tac->main ? functions[tac->main] : NULL;
+    prog->selectorNames = tac->selectorNames;
+    prog->numGlobals = tac->globalKinds.NumElements();
+    for (int i = 0; i < prog->numGlobals; i++)
+        if (tac->globalKinds.Nth(i) == V_Ref) prog->refGlobals.Append(i);
+
+    int numSelectors = tac->selectorNames.NumElements();
+    for (ClassLayout *cls : tac->classes) {
+        BcClass *bc = (BcClass *)ArenaAlloc(sizeof(BcClass));
+        bc->name = cls->name;
+        bc->index = prog->classes.NumElements();
+        bc->numFields = cls->NumFields();
+        bc->numRefFields = 0;
+        bc->refFields = (int *)ArenaAlloc(bc->numFields * sizeof(int));
+        for (int i = 0; i < bc->numFields; i++)
+            if (cls->fieldKinds.Nth(i) == V_Ref) bc->refFields[bc->numRefFields++] = i;
+        int numMethods = cls->vtable.NumElements();
+        bc->vtable = (BcFunction **)ArenaAlloc((numMethods + 1) * sizeof(BcFunction*));
+        bc->bySelector = (BcFunction **)ArenaAlloc((numSelectors + 1) * sizeof(BcFunction*));
+        memset(bc->bySelector, 0, (numSelectors + 1) * sizeof(BcFunction*));
+        for (int i = 0; i < numMethods; i++) {
+            bc->vtable[i] = functions[cls->vtable.Nth(i)];
+            bc->bySelector[cls->selectors.Nth(i)] = bc->vtable[i];
+        }
+        bc->vtable[numMethods] = NULL;
+        classes[cls] = bc;
+        prog->classes.Append(bc);
+    }
+
+    for (TacFunction *f : tac->functions)
+        CompileFunction(f);
+    return prog;
+}
+
+
+BcProgram *CompileBytecode(TacProgram *tac) {
+    BytecodeCompiler compiler(tac);
+    return compiler.Compile();
+}
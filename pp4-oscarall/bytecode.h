@@ -0,0 +1,209 @@
+/* File: bytecode.h
+ * ----------------
+ * The register-based bytecode that dcc --run executes (see vm.h), and
+ * the translation of three-address code (see tac.h) into it.
+ *
+ * Each function gets a frame of registers, one for every temporary of
+ * its TAC plus one that takes the results nobody uses, so an operand is
+ * simply a register number. The code of the whole program is a single
+ * array of ints: an opcode followed by its operands, whose number and
+ * meaning are given by the format string of the opcode (see BYTECODES).
+ * Jump targets are positions in that array.
+ *
+ * The translation lays the blocks of a function out in order and leaves
+ * out jumps to the block that follows. An int comparison whose result
+ * is only used by the branch right after it becomes a single
+ * compare-and-branch instruction, which is what most loop tests are.
+ * An OP_Switch becomes a jumptable, which goes to the target for its
+ * register minus the low value when that is below the table size and
+ * to its default otherwise.
+ *
+ * The garbage collector (see heap.h) learns where the references are
+ * from the program: which fields of each class and which globals hold
+ * them, whether the elements of an array do (the last operand of
+ * newarray), and a stack map for every instruction that may collect
+ * or call into something that does (new, newarray and the calls). A
+ * stack map lists the registers that hold references live across the
+ * instruction, so a register whose value is dead, or not set yet, is
+ * never taken for one. A reference register that is live on entry to a
+ * function without being a parameter, which can only happen when the
+ * program reads a variable it never set, is cleared on entry.
+ */
+
+#ifndef _H_bytecode
+#define _H_bytecode
+
+#include <stdio.h>
+#include <stdint.h>
+#include "list.h"
+
+struct TacProgram;
+struct BcFunction;
+struct BcClass;
+
+
+/* Union: Value
+ * ------------
+ * What a register, global, field or array element holds. Ints and bools
+ * are kept sign-extended in i, so comparing i compares ints and
+ * references alike.
+ */
+typedef union {
+    int64_t i;
+    double d;
+    void *p;
+} Value;
+
+
+/* Macro: BYTECODES
+ * ----------------
+ * The instruction set, as X(name, dump name, operand format). Each
+ * character of the format is one operand word:
+ *   r  register                    i  immediate int
+ *   k  index into the constants    g  global slot
+ *   f  field slot                  c  class index
+ *   F  function index              v  vtable slot
+ *   s  method selector             L  jump target
+ *   *  argument count n, followed by n registers
+ *   #  table size n, followed by n jump targets
+ * Stores, prints, jumps, returns, checkbounds and checknull only read
+ * registers; every other instruction writes its first register and
+ * reads the rest.
+ */
+#define BYTECODES(X) \
+    X(LoadInt,       "loadint",     "ri")  \
+    X(LoadConst,     "loadconst",   "rk")  \
+    X(Move,          "move",        "rr")  \
+    X(Add,           "add",         "rrr") \
+    X(Sub,           "sub",         "rrr") \
+    X(Mul,           "mul",         "rrr") \
+    X(Div,           "div",         "rrr") \
+    X(Mod,           "mod",         "rrr") \
+    X(Neg,           "neg",         "rr")  \
+    X(FAdd,          "fadd",        "rrr") \
+    X(FSub,          "fsub",        "rrr") \
+    X(FMul,          "fmul",        "rrr") \
+    X(FDiv,          "fdiv",        "rrr") \
+    X(FNeg,          "fneg",        "rr")  \
+    X(Eq,            "eq",          "rrr") \
+    X(Ne,            "ne",          "rrr") \
+    X(Lt,            "lt",          "rrr") \
+    X(Le,            "le",          "rrr") \
+    X(Gt,            "gt",          "rrr") \
+    X(Ge,            "ge",          "rrr") \
+    X(FEq,           "feq",         "rrr") \
+    X(FNe,           "fne",         "rrr") \
+    X(FLt,           "flt",         "rrr") \
+    X(FLe,           "fle",         "rrr") \
+    X(FGt,           "fgt",         "rrr") \
+    X(FGe,           "fge",         "rrr") \
+    X(StrEq,         "streq",       "rrr") \
+    X(StrNe,         "strne",       "rrr") \
+    X(Not,           "not",         "rr")  \
+    X(LoadGlobal,    "loadglobal",  "rg")  \
+    X(StoreGlobal,   "storeglobal", "gr")  \
+    X(LoadField,     "loadfield",   "rrf") \
+    X(StoreField,    "storefield",  "rfr") \
+    X(LoadElem,      "loadelem",    "rrr") \
+    X(StoreElem,     "storeelem",   "rrr") \
+    X(Length,        "length",      "rr")  \
+    X(CheckBounds,   "checkbounds", "rr")  \
+    X(CheckNull,     "checknull",   "r")   \
+    X(NewObject,     "new",         "rc")  \
+    X(NewArray,      "newarray",    "rri") \
+    X(Call,          "call",        "rF*") \
+    X(CallVirtual,   "vcall",       "rv*") \
+    X(CallInterface, "icall",       "rs*") \
+    X(Return,        "return",      "r")   \
+    X(ReturnVoid,    "returnvoid",  "")    \
+    X(PrintInt,      "printint",    "r")   \
+    X(PrintBool,     "printbool",   "r")   \
+    X(PrintString,   "printstring", "r")   \
+    X(ReadInteger,   "readinteger", "r")   \
+    X(ReadLine,      "readline",    "r")   \
+    X(Jump,          "jump",        "L")   \
+    X(JumpIfTrue,    "jumpiftrue",  "rL")  \
+    X(JumpIfFalse,   "jumpiffalse", "rL")  \
+    X(JumpEq,        "jumpeq",      "rrL") \
+    X(JumpNe,        "jumpne",      "rrL") \
+    X(JumpLt,        "jumplt",      "rrL") \
+    X(JumpLe,        "jumple",      "rrL") \
+    X(JumpGt,        "jumpgt",      "rrL") \
+    X(JumpGe,        "jumpge",      "rrL") \
+    X(JumpTable,     "jumptable",   "riL#")
+
+#define BYTECODE_ENUM(name, dumpName, format) BC_##name,
+typedef enum { BYTECODES(BYTECODE_ENUM) NumBytecodes } Bytecode;
+#undef BYTECODE_ENUM
+
+extern const char *const BytecodeNames[NumBytecodes];
+extern const char *const BytecodeFormats[NumBytecodes];
+
+
+struct BcFunction {
+    const char *name;
+    int index;
+    int numParams;       // including the receiver of a method
+    int numRegs;
+    int entry;           // position of the first instruction
+};
+
+struct BcClass {
+    const char *name;
+    int index;
+    int numFields;
+    int numRefFields;
+    int *refFields;            // slots of the fields that hold references
+    BcFunction **vtable;       // ends with NULL
+    BcFunction **bySelector;   // NULL where the class has no such method
+};
+
+
+/* Struct: BcStackMap
+ * -------------------
+ * The registers holding live references at the instruction that ends
+ * at pc, which is where a frame that called out from it returns to.
+ */
+struct BcStackMap {
+    int pc;
+    int numRefs;
+    int *refs;
+};
+
+
+/* Struct: BcProgram
+ * -----------------
+ * Everything the VM needs to run a program. The constants are the
+ * doubles and strings the code loads with LoadConst. There is one
+ * string constant for each literal in the string pool of the program,
+ * made as dstring.h describes, and it lives as long as the program.
+ */
+struct BcProgram {
+    List<int> code;
+    List<Value> constants;
+    List<BcFunction*> functions;
+    List<BcClass*> classes;
+    List<const char*> selectorNames;
+    List<BcStackMap> stackMaps;    // in order of pc
+    int numGlobals;
+    List<int> refGlobals;          // slots of the globals that hold references
+    BcFunction *main;     // NULL if the program has no main
+
+    BcProgram() : numGlobals(0), main(NULL) {}
+
+        // Size in words of the instruction at pc
+    int InstrSize(int pc);
+        // Stack map of the instruction that ends at pc, or NULL
+    BcStackMap *StackMapAt(int pc);
+    void Print(FILE *fp);
+};
+
+
+/* Function: CompileBytecode()
+ * ---------------------------
+ * Translates a lowered program into bytecode. The TAC must have had
+ * its control flow graph computed (TacFunction::ComputeEdges).
+ */
+BcProgram *CompileBytecode(TacProgram *tac);
+
+#endif
@@ -0,0 +1,486 @@
+/* File: codegen.cc
+ * ----------------
+ * Implementation of the CodeGenerator.
+ */
+
+#include "codegen.h"
+#include "ast_decl.h"
+#include "ast_type.h"
+#include "ast_stmt.h"
+#include "arena.h"
+#include "errors.h"
+#include <new>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+
+ValueKind KindOfType(Type *type) {
+    if (type == Type::doubleType) return V_Double;
+    if (type == Type::intType || type == Type::boolType || type == Type::voidType
+        || type == Type::errorType)
+        return V_Int;
+    return V_Ref;   // strings, null, objects and arrays
+}
+
+// Bytes a field of the type takes in a native object
+static int SizeOfType(Type *type) {
+    if (type == Type::boolType) return 1;
+    return KindOfType(type) == V_Int ? 4 : 8;
+}
+
+static int RoundUp(int n, int to) {
+    return (n + to - 1) / to * to;
+}
+
+// The size of an object of cls were its fields laid out in slot order
+static int DeclarationOrderSize(ClassLayout *cls) {
+    int end = 8;
+    for (int size : cls->fieldSizes) end = RoundUp(end, size) + size;
+    return RoundUp(end, 8);
+}
+
+// Gives the fields of cls from slot firstOwn on their offsets, largest
+// first and each at the lowest offset that is aligned for it and not
+// taken by a field before it, and works out the size of an object
+static void PackFields(ClassLayout *cls, int firstOwn) {
+    std::vector<bool> taken(cls->base ? cls->base->size : 8, false);
+    std::fill(taken.begin(), taken.begin() + 8, true);   // the vtable address
+    for (int i = 0; i < firstOwn; i++)
+        for (int b = 0; b < cls->fieldSizes.Nth(i); b++)
+            taken[cls->fieldOffsets.Nth(i) + b] = true;
+
+    std::vector<int> order;
+    for (int i = firstOwn; i < cls->NumFields(); i++) order.push_back(i);
+    std::stable_sort(order.begin(), order.end(), [cls](int x, int y) {
+        return cls->fieldSizes.Nth(x) > cls->fieldSizes.Nth(y);
+    });
+    std::vector<int> offsets(cls->NumFields() - firstOwn);
+    for (int i : order) {
+        int size = cls->fieldSizes.Nth(i), at = 8;
+        for (;; at += size) {
+            if ((int)taken.size() < at + size) taken.resize(at + size, false);
+            if (std::find(taken.begin() + at, taken.begin() + at + size, true) == taken.begin() + at + size)
+                break;
+        }
+        std::fill(taken.begin() + at, taken.begin() + at + size, true);
+        offsets[i - firstOwn] = at;
+    }
+    for (int at : offsets) cls->fieldOffsets.Append(at);
+    cls->size = RoundUp(taken.size(), 8);
+}
+
+CodeGenerator::CodeGenerator() {
+    code = new TacProgram;
+    fn = NULL;
+    current = NULL;
+}
+
+
+/* Declarations
+ * ------------
+ */
+
+void CodeGenerator::LayoutDecls(List<Decl*> *decls) {
+    for (Decl *d : *decls) {
+        if (d->IsVarDecl()) {
+            slots[d] = code->globalKinds.NumElements();
+            code->globalKinds.Append(KindOfType(dynamic_cast<VarDecl*>(d)->GetDeclaredType()));
+            code->globalNames.Append(d->GetName());
+        } else if (d->IsClassDecl()) {
+            LayoutFor(dynamic_cast<ClassDecl*>(d));
+        } else if (d->IsFnDecl()) {
+            TacFunction *f = NewFunction(dynamic_cast<FnDecl*>(d), NULL);
+            if (strcmp(d->GetName(), "main") == 0) code->main = f;
+        }
+    }
+}
+
+// The layout of a class starts as a copy of that of its base class.
+// Fields get the next free slot, and a method takes over the vtable slot
+// of the method it overrides or gets a new one. -d layout reports how
+// much smaller packing the fields made an object.
+ClassLayout *CodeGenerator::LayoutFor(ClassDecl *cd) {
+    std::unordered_map<ClassDecl*, ClassLayout*>::iterator it = layouts.find(cd);
+    if (it != layouts.end()) {
+        Assert(it->second != NULL);   // only a cyclic hierarchy gets here mid-layout
+        return it->second;
+    }
+    layouts[cd] = NULL;
+    ClassDecl *baseDecl = cd->GetBaseClass();
+    ClassLayout *base = NULL;
+    if (baseDecl && !(layouts.count(baseDecl) && layouts[baseDecl] == NULL))
+        base = LayoutFor(baseDecl);
+
+    ClassLayout *cls = new ClassLayout(cd->GetName(), cd, base, code->classes.NumElements());
+    if (base) {
+        cls->fieldKinds = base->fieldKinds;
+        cls->fieldSizes = base->fieldSizes;
+        cls->fieldOffsets = base->fieldOffsets;
+        cls->vtable = base->vtable;
+        cls->selectors = base->selectors;
+    }
+    for (Decl *m : *cd->GetMembers()) {
+        if (m->IsVarDecl()) {
+            Type *type = dynamic_cast<VarDecl*>(m)->GetDeclaredType();
+            slots[m] = cls->NumFields();
+            cls->fieldKinds.Append(KindOfType(type));
+            cls->fieldSizes.Append(SizeOfType(type));
+        } else if (m->IsFnDecl()) {
+            TacFunction *f = NewFunction(dynamic_cast<FnDecl*>(m), cls);
+            int selector = SelectorFor(m->GetName());
+            int slot = cls->SlotForSelector(selector);
+            if (slot >= 0) {
+                cls->vtable.RemoveAt(slot);
+                cls->vtable.InsertAt(f, slot);
+            } else {
+                slot = cls->vtable.NumElements();
+                cls->vtable.Append(f);
+                cls->selectors.Append(selector);
+            }
+            slots[m] = slot;
+        }
+    }
+    PackFields(cls, base ? base->NumFields() : 0);
+    PrintDebug("layout", "%s: %d bytes, %d in declaration order, %d at 8 bytes a field",
+               cls->name, cls->size, DeclarationOrderSize(cls), 8 * (1 + cls->NumFields()));
+    code->classes.Append(cls);
+    layouts[cd] = cls;
+    return cls;
+}
+
+TacFunction *CodeGenerator::NewFunction(FnDecl *decl, ClassLayout *cls) {
+    const char *name = decl->GetName();
+    if (cls) {
+        char *qualified = (char *)ArenaAlloc(strlen(cls->name) + strlen(name) + 2);
+        sprintf(qualified, "%s.%s", cls->name, name);
+        name = qualified;
+    }
+    TacFunction *f = new (ArenaAlloc(sizeof(TacFunction))) TacFunction(name, decl, cls);
+    f->returnsValue = (decl->GetReturnType() != Type::voidType);
+    functions[decl] = f;
+    code->functions.Append(f);
+    return f;
+}
+
+TacFunction *CodeGenerator::FunctionFor(FnDecl *decl) {
+    std::unordered_map<FnDecl*, TacFunction*>::iterator it = functions.find(decl);
+    Assert(it != functions.end());
+    return it->second;
+}
+
+int CodeGenerator::SlotFor(Decl *d) {
+    std::unordered_map<Decl*, int>::iterator it = slots.find(d);
+    Assert(it != slots.end());
+    return it->second;
+}
+
+
+/* Functions
+ * ---------
+ */
+
+void CodeGenerator::BeginFunction(TacFunction *f, List<VarDecl*> *formals) {
+    fn = f;
+    locals.clear();
+    breakTargets = List<BasicBlock*>();
+    if (fn->cls) NewTemp(V_Ref);   // the receiver, see ThisTemp
+    for (VarDecl *formal : *formals)
+        DeclareLocal(formal);
+    fn->numParams = fn->NumTemps();
+    current = NULL;
+    StartBlock(NewBlock());
+}
+
+void CodeGenerator::EndFunction() {
+    if (!current->Terminator())
+        GenReturn(fn->returnsValue ? GenZero(KindOfType(fn->decl->GetReturnType())) : NoTemp);
+    fn->ComputeEdges();
+    fn = NULL;
+    current = NULL;
+}
+
+int CodeGenerator::DeclareLocal(VarDecl *var) {
+    int temp = NewTemp(KindOfType(var->GetDeclaredType()));
+    locals[var] = temp;
+    return temp;
+}
+
+int CodeGenerator::TempForLocal(VarDecl *var) {
+    std::unordered_map<VarDecl*, int>::iterator it = locals.find(var);
+    return (it == locals.end()) ? NoTemp : it->second;
+}
+
+
+/* Control flow
+ * ------------
+ */
+
+BasicBlock *CodeGenerator::NewBlock() {
+    return new (ArenaAlloc(sizeof(BasicBlock))) BasicBlock(-1);
+}
+
+void CodeGenerator::StartBlock(BasicBlock *b) {
+    Assert(b->id == -1);   // each block is started once
+    Assert(!current || current->Terminator());
+    b->id = fn->blocks.NumElements();
+    fn->blocks.Append(b);
+    current = b;
+}
+
+BasicBlock *CodeGenerator::BreakTarget() {
+    int n = breakTargets.NumElements();
+    return n ? breakTargets.Nth(n - 1) : NULL;
+}
+
+
+/* Instructions
+ * ------------
+ */
+
+Instr *CodeGenerator::Append(Instr *instr) {
+    if (current->Terminator())
+        StartBlock(NewBlock());
+    current->Append(instr);
+    return instr;
+}
+
+int CodeGenerator::GenWithResult(Opcode op, ValueKind kind, int a, int b) {
+    Instr *instr = NewInstr(op);
+    instr->a = a;
+    instr->b = b;
+    Append(instr);
+    instr->dst = NewTemp(kind);
+    return instr->dst;
+}
+
+int CodeGenerator::GenLoadInt(int value) {
+    int dst = GenWithResult(OP_LoadInt, V_Int);
+    current->last->intValue = value;
+    return dst;
+}
+
+int CodeGenerator::GenLoadDouble(double value) {
+    int dst = GenWithResult(OP_LoadDouble, V_Double);
+    current->last->doubleValue = value;
+    return dst;
+}
+
+// The scanner keeps a string constant as written, in quotes and with
+// escapes such as \n left for the assembler, so they are decoded here.
+// Each distinct text is kept once, in the string pool of the program.
+int CodeGenerator::GenLoadString(const char *literal) {
+    int len = strlen(literal);
+    Assert(len >= 2 && literal[0] == '"' && literal[len-1] == '"');
+    std::string decoded;
+    for (int i = 1; i < len - 1; i++) {
+        if (literal[i] == '\\' && i + 1 < len - 1) {
+            switch (literal[i+1]) {
+              case 'n':  decoded += '\n'; i++; continue;
+              case 't':  decoded += '\t'; i++; continue;
+              case '\\': decoded += '\\'; i++; continue;
+            }
+        }
+        decoded += literal[i];
+    }
+    const char *&text = strings[decoded];
+    if (!text) {
+        char *copy = (char *)ArenaAlloc(decoded.size() + 1);
+        strcpy(copy, decoded.c_str());
+        code->strings.Append(text = copy);
+    }
+    int dst = GenWithResult(OP_LoadString, V_Ref);
+    current->last->text = text;
+    return dst;
+}
+
+int CodeGenerator::GenLoadNull() {
+    return GenWithResult(OP_LoadNull, V_Ref);
+}
+
+int CodeGenerator::GenZero(ValueKind kind) {
+    switch (kind) {
+      case V_Double: return GenLoadDouble(0);
+      case V_Ref:    return GenLoadNull();
+      default:       return GenLoadInt(0);
+    }
+}
+
+void CodeGenerator::GenClear(int temp) {
+    ValueKind kind = fn->tempKinds.Nth(temp);
+    Instr *instr = NewInstr(kind == V_Double ? OP_LoadDouble : kind == V_Ref ? OP_LoadNull : OP_LoadInt);
+    instr->dst = temp;
+    Append(instr);
+}
+
+void CodeGenerator::GenMove(int dst, int src) {
+    Instr *instr = NewInstr(OP_Move);
+    instr->dst = dst;
+    instr->a = src;
+    Append(instr);
+}
+
+static ValueKind ResultKind(Opcode op) {
+    switch (op) {
+      case OP_FAdd: case OP_FSub: case OP_FMul: case OP_FDiv: case OP_FNeg:
+        return V_Double;
+      default:
+        return V_Int;   // arithmetic on ints and all comparisons
+    }
+}
+
+int CodeGenerator::GenBinary(Opcode op, int a, int b) {
+    return GenWithResult(op, ResultKind(op), a, b);
+}
+
+int CodeGenerator::GenUnary(Opcode op, int a) {
+    return GenWithResult(op, ResultKind(op), a);
+}
+
+int CodeGenerator::GenLoadGlobal(int slot, ValueKind kind) {
+    int dst = GenWithResult(OP_LoadGlobal, kind);
+    current->last->intValue = slot;
+    return dst;
+}
+
+void CodeGenerator::GenStoreGlobal(int slot, int value) {
+    Instr *instr = NewInstr(OP_StoreGlobal);
+    instr->a = value;
+    instr->intValue = slot;
+    Append(instr);
+}
+
+int CodeGenerator::GenLoadField(int object, ClassLayout *cls, int slot, ValueKind kind) {
+    int dst = GenWithResult(OP_LoadField, kind, object);
+    current->last->intValue = slot;
+    current->last->cls = cls;
+    return dst;
+}
+
+void CodeGenerator::GenStoreField(int object, ClassLayout *cls, int slot, int value) {
+    Instr *instr = NewInstr(OP_StoreField);
+    instr->a = object;
+    instr->b = value;
+    instr->intValue = slot;
+    instr->cls = cls;
+    Append(instr);
+}
+
+int CodeGenerator::GenLoadElem(int array, int index, ValueKind kind) {
+    return GenWithResult(OP_LoadElem, kind, array, index);
+}
+
+void CodeGenerator::GenStoreElem(int array, int index, int value) {
+    Instr *instr = NewInstr(OP_StoreElem);
+    instr->a = array;
+    instr->b = index;
+    instr->c = value;
+    Append(instr);
+}
+
+int CodeGenerator::GenArrayLength(int array) {
+    return GenWithResult(OP_ArrayLength, V_Int, array);
+}
+
+void CodeGenerator::GenCheckBounds(int array, int index) {
+    Instr *instr = NewInstr(OP_CheckBounds);
+    instr->a = array;
+    instr->b = index;
+    Append(instr);
+}
+
+int CodeGenerator::GenNewObject(ClassLayout *cls) {
+    int dst = GenWithResult(OP_NewObject, V_Ref);
+    current->last->cls = cls;
+    return dst;
+}
+
+int CodeGenerator::GenNewArray(int length, ValueKind elemKind) {
+    int dst = GenWithResult(OP_NewArray, V_Ref, length);
+    current->last->intValue = elemKind;
+    return dst;
+}
+
+
+/* Calls
+ * -----
+ */
+
+static Instr *NewCall(Opcode op, List<int> *args) {
+    Instr *instr = NewInstr(op);
+    instr->numArgs = args->NumElements();
+    instr->args = (int *)ArenaAlloc(instr->numArgs * sizeof(int));
+    for (int i = 0; i < instr->numArgs; i++)
+        instr->args[i] = args->Nth(i);
+    return instr;
+}
+
+int CodeGenerator::GenCall(TacFunction *callee, List<int> *args, ValueKind result, bool resultWanted) {
+    Instr *instr = NewCall(OP_Call, args);
+    instr->callee = callee;
+    Append(instr);
+    if (resultWanted) instr->dst = NewTemp(result);
+    return instr->dst;
+}
+
+int CodeGenerator::GenCallVirtual(ClassLayout *cls, int slot, List<int> *args, ValueKind result,
+                                  bool resultWanted) {
+    Assert(args->NumElements() > 0);
+    Instr *instr = NewCall(OP_CallVirtual, args);
+    instr->intValue = slot;
+    instr->cls = cls;
+    Append(instr);
+    if (resultWanted) instr->dst = NewTemp(result);
+    return instr->dst;
+}
+
+int CodeGenerator::GenCallInterface(int selector, List<int> *args, ValueKind result, bool resultWanted) {
+    Assert(args->NumElements() > 0);
+    Instr *instr = NewCall(OP_CallInterface, args);
+    instr->intValue = selector;
+    Append(instr);
+    if (resultWanted) instr->dst = NewTemp(result);
+    return instr->dst;
+}
+
+int CodeGenerator::GenCallBuiltin(Builtin builtin, List<int> *args, ValueKind result, bool resultWanted) {
+    Instr *instr = NewCall(OP_CallBuiltin, args);
+    instr->intValue = builtin;
+    Append(instr);
+    if (resultWanted) instr->dst = NewTemp(result);
+    return instr->dst;
+}
+
+void CodeGenerator::GenJump(BasicBlock *to) {
+    Instr *instr = NewInstr(OP_Jump);
+    instr->target[0] = to;
+    Append(instr);
+}
+
+void CodeGenerator::GenBranch(int test, BasicBlock *ifTrue, BasicBlock *ifFalse) {
+    Instr *instr = NewInstr(OP_Branch);
+    instr->a = test;
+    instr->target[0] = ifTrue;
+    instr->target[1] = ifFalse;
+    Append(instr);
+}
+
+void CodeGenerator::GenSwitch(int value, int low, List<BasicBlock*> *targets, BasicBlock *otherwise) {
+    JumpTable *table = (JumpTable *)ArenaAlloc(sizeof(JumpTable));
+    table->low = low;
+    table->size = targets->NumElements();
+    table->targets = (BasicBlock **)ArenaAlloc(table->size * sizeof(BasicBlock*));
+    for (int i = 0; i < table->size; i++)
+        table->targets[i] = targets->Nth(i);
+    Instr *instr = NewInstr(OP_Switch);
+    instr->a = value;
+    instr->table = table;
+    instr->target[0] = otherwise;
+    Append(instr);
+}
+
+void CodeGenerator::GenReturn(int value) {
+    Instr *instr = NewInstr(OP_Return);
+    instr->a = value;
+    Append(instr);
+}
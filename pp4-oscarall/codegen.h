@@ -0,0 +1,132 @@
+/* File: codegen.h
+ * ---------------
+ * The CodeGenerator lowers a checked program into three-address code
+ * (see tac.h). The node classes do the walking: Program::Emit lays out
+ * the globals, classes and functions first, then each FnDecl emits its
+ * body, statements through Stmt::Emit and expressions through
+ * Expr::EmitValue (which returns the temporary holding the value) or
+ * Expr::EmitBranch (for tests, so && and || become control flow).
+ * The CodeGenerator keeps track of where the code goes and hands out
+ * temporaries, blocks and slots.
+ *
+ * Only a program that checked without errors is generated, so names
+ * resolve and operands, arguments, subscripts, tests and return values
+ * have the right types (Program::Check reported them otherwise). The
+ * generator asks the expressions for their types (Expr::GetType)
+ * whenever the instruction to use depends on them, e.g. fadd rather
+ * than add.
+ *
+ * && and || short-circuit. Locals are cleared to zero/null when their
+ * block is entered and globals and fields start out zero/null too, so
+ * no temporary is ever read before it is written.
+ */
+
+#ifndef _H_codegen
+#define _H_codegen
+
+#include <string>
+#include <unordered_map>
+#include "tac.h"
+#include "list.h"
+
+class Decl;
+class VarDecl;
+class FnDecl;
+class ClassDecl;
+class Type;
+
+// How values of the type are held: doubles, references or ints/bools
+ValueKind KindOfType(Type *type);
+
+
+class CodeGenerator
+{
+  private:
+    TacProgram *code;
+    TacFunction *fn;             // being generated
+    BasicBlock *current;         // instructions are appended here
+    List<BasicBlock*> breakTargets;
+    std::unordered_map<Decl*, int> slots;       // global, field or vtable slot
+    std::unordered_map<VarDecl*, int> locals;   // temporary of each local
+    std::unordered_map<ClassDecl*, ClassLayout*> layouts;
+    std::unordered_map<FnDecl*, TacFunction*> functions;
+    std::unordered_map<std::string, const char*> strings;   // in code->strings
+
+    Instr *Append(Instr *instr);
+    int GenWithResult(Opcode op, ValueKind kind, int a = NoTemp, int b = NoTemp);
+    TacFunction *NewFunction(FnDecl *decl, ClassLayout *cls);
+
+  public:
+    CodeGenerator();
+    TacProgram *GetCode() { return code; }
+
+        // Declarations. LayoutDecls assigns the global slots, lays out
+        // the classes and creates a TacFunction for every function and
+        // method, so calls can refer to them before they are generated.
+    void LayoutDecls(List<Decl*> *decls);
+    ClassLayout *LayoutFor(ClassDecl *cd);
+    TacFunction *FunctionFor(FnDecl *decl);
+    int SlotFor(Decl *d);
+    int SelectorFor(const char *methodName) { return code->SelectorFor(methodName); }
+
+        // Functions. BeginFunction puts the receiver (for methods) and
+        // the formals in the first temporaries; EndFunction adds the
+        // missing return at the end and works out the control flow graph.
+    void BeginFunction(TacFunction *f, List<VarDecl*> *formals);
+    void EndFunction();
+    TacFunction *CurrentFunction() { return fn; }
+    int DeclareLocal(VarDecl *var);
+    int TempForLocal(VarDecl *var);  // NoTemp if var is not a local
+    int ThisTemp()                   { return 0; }
+
+        // Control flow. A block is added to the function when it is
+        // started, so blocks come out in source order. Anything generated
+        // after a jump or return goes into a new, unreachable block.
+    BasicBlock *NewBlock();
+    void StartBlock(BasicBlock *b);
+    void PushBreakTarget(BasicBlock *b) { breakTargets.Append(b); }
+    void PopBreakTarget()               { breakTargets.RemoveAt(breakTargets.NumElements() - 1); }
+    BasicBlock *BreakTarget();          // NULL outside loops
+
+        // Instructions. Those that produce a value return a new
+        // temporary holding it.
+    int NewTemp(ValueKind kind)         { return fn->NewTemp(kind); }
+    int GenLoadInt(int value);
+    int GenLoadDouble(double value);
+    int GenLoadString(const char *literal);   // as in the source, quotes and all
+    int GenLoadNull();
+    int GenZero(ValueKind kind);
+    void GenClear(int temp);                  // zero/null by its kind
+    void GenMove(int dst, int src);
+    int GenBinary(Opcode op, int a, int b);
+    int GenUnary(Opcode op, int a);
+    int GenLoadGlobal(int slot, ValueKind kind);
+    void GenStoreGlobal(int slot, int value);
+    int GenLoadField(int object, ClassLayout *cls, int slot, ValueKind kind);
+    void GenStoreField(int object, ClassLayout *cls, int slot, int value);
+    int GenLoadElem(int array, int index, ValueKind kind);
+    void GenStoreElem(int array, int index, int value);
+    int GenArrayLength(int array);
+    void GenCheckBounds(int array, int index);
+    int GenNewObject(ClassLayout *cls);
+    int GenNewArray(int length, ValueKind elemKind);
+
+        // Calls. result is the kind of value returned, and resultWanted
+        // says whether a temporary should be made for it (NoTemp is
+        // returned otherwise). For virtual and interface calls the
+        // receiver must be args[0]; cls is its static class.
+    int GenCall(TacFunction *callee, List<int> *args, ValueKind result, bool resultWanted);
+    int GenCallVirtual(ClassLayout *cls, int slot, List<int> *args, ValueKind result,
+                       bool resultWanted);
+    int GenCallInterface(int selector, List<int> *args, ValueKind result, bool resultWanted);
+    int GenCallBuiltin(Builtin builtin, List<int> *args, ValueKind result, bool resultWanted);
+
+    void GenJump(BasicBlock *to);
+    void GenBranch(int test, BasicBlock *ifTrue, BasicBlock *ifFalse);
+        // Goes to targets[value - low], or to otherwise if value is out
+        // of their range; switch statements are lowered in switch.h
+    void GenSwitch(int value, int low, List<BasicBlock*> *targets, BasicBlock *otherwise);
+    void GenReturn(int value);                // value may be NoTemp
+};
+
+#endif
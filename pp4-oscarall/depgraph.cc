@@ -0,0 +1,140 @@
+/* File: depgraph.cc
+ * -----------------
+ * Implementation of the dependency graph of declarations.
+ */
+
+#include "depgraph.h"
+#include "ast_decl.h"
+#include "ast_stmt.h"
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+DependencyGraph *DependencyGraph::current = NULL;
+
+// Globals, functions, classes and interfaces, and their members, are
+// what the graph is made of
+static bool IsInGraph(Decl *d) {
+    Node *p = d->GetParent();
+    return dynamic_cast<Program*>(p) || dynamic_cast<ClassDecl*>(p) || dynamic_cast<InterfaceDecl*>(p);
+}
+
+void DependencyGraph::AddUse(Identifier *name, Decl *used) {
+    if (!IsInGraph(used)) return;
+    for (Node *n = name; n; n = n->GetParent()) {
+        Decl *user = dynamic_cast<Decl*>(n);
+        if (!user || !IsInGraph(user)) continue;
+        if (user != used) recorded.push_back(std::make_pair(user, used));
+        return;
+    }
+}
+
+void DependencyGraph::AddDecl(Decl *d) {
+    index[d] = decls.size();
+    decls.push_back(d);
+}
+
+// Lays the edges out in rows, each sorted and without repeats
+static void BuildRows(int numNodes, std::vector<std::pair<int,int> > &edges,
+                      std::vector<int> *first, std::vector<int> *targets) {
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    first->assign(numNodes + 1, 0);
+    targets->resize(edges.size());
+    for (size_t i = 0; i < edges.size(); i++) {
+        (*first)[edges[i].first + 1]++;
+        (*targets)[i] = edges[i].second;
+    }
+    for (int i = 0; i < numNodes; i++)
+        (*first)[i + 1] += (*first)[i];
+}
+
+void DependencyGraph::Build(List<Decl*> *program) {
+    decls.clear();
+    index.clear();
+    std::vector<std::pair<int,int> > forward, backward;
+    for (Decl *d : *program) {
+        AddDecl(d);
+        List<Decl*> *members = NULL;
+        if (ClassDecl *cd = dynamic_cast<ClassDecl*>(d)) members = cd->GetMembers();
+        else if (InterfaceDecl *id = dynamic_cast<InterfaceDecl*>(d)) members = id->GetMembers();
+        if (!members) continue;
+        for (Decl *m : *members) {
+            forward.push_back(std::make_pair(index[d], (int)decls.size()));
+            AddDecl(m);
+        }
+    }
+    for (std::pair<Decl*,Decl*> &use : recorded) {
+        std::unordered_map<Decl*,int>::iterator user = index.find(use.first), used = index.find(use.second);
+        if (user != index.end() && used != index.end())
+            forward.push_back(std::make_pair(user->second, used->second));
+    }
+    for (std::pair<int,int> &edge : forward)
+        backward.push_back(std::make_pair(edge.second, edge.first));
+    BuildRows(decls.size(), forward, &firstUse, &uses);
+    BuildRows(decls.size(), backward, &firstUser, &users);
+}
+
+// Everything reachable from from, not counting from itself
+List<Decl*> DependencyGraph::Reach(int from, const std::vector<int> &first, const std::vector<int> &edges) {
+    std::vector<bool> seen(decls.size(), false);
+    std::vector<int> work(1, from);
+    List<Decl*> reached;
+    seen[from] = true;
+    while (!work.empty()) {
+        int n = work.back();
+        work.pop_back();
+        for (int e = first[n]; e < first[n + 1]; e++) {
+            if (seen[edges[e]]) continue;
+            seen[edges[e]] = true;
+            reached.Append(decls[edges[e]]);
+            work.push_back(edges[e]);
+        }
+    }
+    return reached;
+}
+
+List<Decl*> DependencyGraph::Affected(Decl *changed) {
+    std::unordered_map<Decl*,int>::iterator it = index.find(changed);
+    return it == index.end() ? List<Decl*>() : Reach(it->second, firstUser, users);
+}
+
+List<Decl*> DependencyGraph::Unreachable() {
+    List<Decl*> dead;
+    int main = -1;
+    for (size_t i = 0; i < decls.size() && main < 0; i++)
+        if (decls[i]->IsFnDecl() && !decls[i]->IsMethodDecl() && strcmp(decls[i]->GetName(), "main") == 0)
+            main = i;
+    if (main < 0) return dead;
+    std::vector<bool> live(decls.size(), false);
+    live[main] = true;
+    for (Decl *d : Reach(main, firstUse, uses))
+        live[index[d]] = true;
+    for (size_t i = 0; i < decls.size(); i++)
+        if (!live[i]) dead.Append(decls[i]);
+    return dead;
+}
+
+const char *DependencyGraph::NameOf(int i) {
+    static std::string name;
+    Decl *owner = dynamic_cast<Decl*>(decls[i]->GetParent());
+    name = owner ? std::string(owner->GetName()) + "." + decls[i]->GetName() : decls[i]->GetName();
+    return name.c_str();
+}
+
+void DependencyGraph::Print(FILE *fp) {
+    fprintf(fp, "dependencies of %d declarations, %zu edges:\n", NumDecls(), uses.size());
+    for (int i = 0; i < NumDecls(); i++) {
+        if (firstUse[i] == firstUse[i + 1]) continue;
+        fprintf(fp, "  %s ->", NameOf(i));
+        for (int e = firstUse[i]; e < firstUse[i + 1]; e++)
+            fprintf(fp, "%s %s", e == firstUse[i] ? "" : ",", NameOf(uses[e]));
+        fprintf(fp, "\n");
+    }
+    List<Decl*> dead = Unreachable();
+    if (dead.NumElements() == 0) return;
+    fprintf(fp, "unreachable from main:");
+    for (int i = 0; i < dead.NumElements(); i++)
+        fprintf(fp, "%s %s", i ? "," : "", NameOf(index[dead.Nth(i)]));
+    fprintf(fp, "\n");
+}
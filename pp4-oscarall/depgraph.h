@@ -0,0 +1,78 @@
+/* File: depgraph.h
+ * ----------------
+ * The dependency graph of the declarations of a program: for each
+ * global, function, class or interface, and each member of a class or
+ * interface, the declarations it refers to. An edge is recorded where
+ * a name is resolved: a type name (NamedType), a variable or field
+ * (FieldAccess) and a function or method (Call), from the declaration
+ * the use is in to the one it resolved to. Uses of locals and formals
+ * stay within their function and are left out. A class or interface
+ * also depends on each of its members, since its layout and its checks
+ * are made of them.
+ *
+ * Names are resolved both by the checker and by code generation, where
+ * pp4 resolves the names in expressions, so the graph is complete once
+ * the program has been generated. Build then turns what was recorded
+ * into adjacency arrays both ways (compressed rows: the edges of node i
+ * are those from first[i] up to first[i+1]), so each query walks only
+ * the edges it needs:
+ *
+ *   Affected(d)   what has to be checked and generated again when d
+ *                 changes: everything that depends on it, directly or
+ *                 through others
+ *   Unreachable() the declarations main can't reach, that is the dead
+ *                 ones; every member of a class main reaches counts as
+ *                 reached, since dynamic dispatch may call any of them
+ *
+ * -d deps prints the graph and the dead declarations after the program
+ * has been generated.
+ */
+
+#ifndef _H_depgraph
+#define _H_depgraph
+
+#include <stdio.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "list.h"
+#include "symindex.h"
+
+class Decl;
+class Identifier;
+
+class DependencyGraph
+{
+  private:
+    std::vector<std::pair<Decl*,Decl*> > recorded;   // user, used
+    std::vector<Decl*> decls;
+    std::unordered_map<Decl*,int> index;
+    std::vector<int> firstUse, uses;       // what each one refers to
+    std::vector<int> firstUser, users;     // and what refers to it
+
+    void AddDecl(Decl *d);
+    List<Decl*> Reach(int from, const std::vector<int> &first, const std::vector<int> &edges);
+    const char *NameOf(int i);
+
+  public:
+        // Records the uses resolved while set
+    static DependencyGraph *current;
+
+    void AddUse(Identifier *name, Decl *used);
+    void Build(List<Decl*> *program);
+
+    int NumDecls() { return decls.size(); }
+    List<Decl*> Affected(Decl *changed);
+    List<Decl*> Unreachable();
+    void Print(FILE *fp);
+};
+
+// Notes that name resolved to d, for the dependency graph and the
+// symbol index if they are being recorded, and returns d
+template <class D> inline D *NoteUse(Identifier *name, D *d) {
+    if (d && DependencyGraph::current) DependencyGraph::current->AddUse(name, d);
+    if (d && SymbolIndex::current) SymbolIndex::current->AddUse(name, d);
+    return d;
+}
+
+#endif
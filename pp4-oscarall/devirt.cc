@@ -0,0 +1,114 @@
+/* File: devirt.cc
+ * ---------------
+ * Implementation of devirtualization.
+ */
+
+#include "devirt.h"
+#include "tac.h"
+#include "utility.h"
+
+static bool DerivesFrom(ClassLayout *cls, ClassLayout *base) {
+    for (; cls; cls = cls->base)
+        if (cls == base) return true;
+    return false;
+}
+
+// Whether instr would stop the program if temp were null
+static bool Dereferences(Instr *instr, int temp) {
+    switch (instr->op) {
+      case OP_LoadField: case OP_StoreField: case OP_CheckNull:
+        return instr->a == temp;
+      case OP_CallVirtual: case OP_CallInterface:
+        return instr->args[0] == temp;
+      default:
+        return false;
+    }
+}
+
+
+class Devirtualizer
+{
+  private:
+    TacProgram *code;
+    TacFunction *fn;
+    bool thisIsFixed;     // no instruction of fn writes the receiver
+    int numVirtual, numDirect;
+
+    TacFunction *OnlyTarget(Instr *call);
+    bool IsNonNull(Instr *call, int temp);
+    void Rewrite(BasicBlock *b, Instr *call);
+
+  public:
+    Devirtualizer(TacProgram *c)
+      : code(c), fn(NULL), thisIsFixed(false), numVirtual(0), numDirect(0) {}
+    void Run();
+};
+
+// The method the call reaches whatever class its receiver turns out to
+// be, or NULL if it may reach more than one
+TacFunction *Devirtualizer::OnlyTarget(Instr *call) {
+    TacFunction *target = NULL;
+    for (ClassLayout *cls : code->classes) {
+        int slot;
+        if (call->op == OP_CallVirtual)
+            slot = DerivesFrom(cls, call->cls) ? call->intValue : -1;
+        else
+            slot = cls->SlotForSelector(call->intValue);
+        if (slot < 0) continue;
+        TacFunction *method = cls->vtable.Nth(slot);
+        if (target && method != target) return NULL;
+        target = method;
+    }
+    return target;
+}
+
+// Whether temp is known not to be null right before call: it holds a
+// new object or the receiver, or has been dereferenced since it was set
+bool Devirtualizer::IsNonNull(Instr *call, int temp) {
+    for (Instr *instr = call->prev; instr; instr = instr->prev) {
+        if (instr->dst == temp) return instr->op == OP_NewObject;
+        if (Dereferences(instr, temp)) return true;
+    }
+    return temp == 0 && fn->cls && thisIsFixed;
+}
+
+void Devirtualizer::Rewrite(BasicBlock *b, Instr *call) {
+    numVirtual++;
+    TacFunction *target = OnlyTarget(call);
+    if (!target) return;
+    numDirect++;
+    int receiver = call->args[0];
+    if (!IsNonNull(call, receiver)) {
+        Instr *check = NewInstr(OP_CheckNull);
+        check->a = receiver;
+        b->InsertBefore(check, call);
+    }
+    PrintDebug("devirt", "%s: direct call to %s", fn->name, target->name);
+    call->op = OP_Call;
+    call->callee = target;
+    call->cls = NULL;
+}
+
+void Devirtualizer::Run() {
+    for (TacFunction *f : code->functions) {
+        fn = f;
+        thisIsFixed = true;
+        for (BasicBlock *b : fn->blocks)
+            for (Instr *instr = b->first; instr; instr = instr->next)
+                if (instr->dst == 0) thisIsFixed = false;
+        for (BasicBlock *b : fn->blocks) {
+            for (Instr *instr = b->first, *next; instr; instr = next) {
+                next = instr->next;
+                if (instr->op == OP_CallVirtual || instr->op == OP_CallInterface)
+                    Rewrite(b, instr);
+            }
+        }
+    }
+    PrintDebug("devirt", "%d virtual calls, %d made direct, %d left",
+               numVirtual, numDirect, numVirtual - numDirect);
+}
+
+
+void Devirtualize(TacProgram *code) {
+    Devirtualizer(code).Run();
+}
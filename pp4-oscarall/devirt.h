@@ -0,0 +1,32 @@
+/* File: devirt.h
+ * --------------
+ * Devirtualization of method calls by class hierarchy analysis. A Decaf
+ * program is compiled as a whole, so every class and every override is
+ * known once it has been lowered: the vtables (see tac.h) already hold,
+ * slot by slot, the methods the checker matched up as overriding one
+ * another.
+ *
+ * A call through the vtable of the static class of its receiver can
+ * only reach what that slot holds in the class itself or in one of its
+ * subclasses, and a call through an interface only what the classes
+ * with a method of that name have for it. When that is a single method
+ * the call becomes a direct one (OP_Call). The null check that looking
+ * in the vtable did is kept as an OP_CheckNull, unless the receiver is
+ * this, a new object or has already been dereferenced in the block.
+ *
+ * The direct calls this makes are what the inline pass (see inline.h)
+ * then takes the small ones, accessors and setters mostly, from.
+ *
+ * It runs on plain code, first in the default pipeline (see passes.h),
+ * and -d devirt reports each call it changes and how many virtual calls
+ * were left.
+ */
+
+#ifndef _H_devirt
+#define _H_devirt
+
+struct TacProgram;
+
+void Devirtualize(TacProgram *code);
+
+#endif
@@ -0,0 +1,29 @@
+/* File: dstring.cc
+ * ----------------
+ * Implementation of run-time strings.
+ */
+
+#include "dstring.h"
+#include "utility.h"
+#include <stdlib.h>
+
+uint32_t HashString(const char *s, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)s[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+char *NewString(const char *s, size_t length) {
+    if (length > UINT32_MAX) Failure("String of %zu characters is too long", length);
+    StringHeader *header = (StringHeader *)malloc(sizeof(StringHeader) + length + 1);
+    if (!header) Failure("Can't allocate a string of %zu characters", length);
+    header->length = length;
+    header->hash = HashString(s, length);
+    char *chars = (char *)(header + 1);
+    memcpy(chars, s, length);
+    chars[length] = '\0';
+    return chars;
+}
@@ -0,0 +1,49 @@
+/* File: dstring.h
+ * ---------------
+ * How Decaf strings are represented while a program runs, in the VM
+ * (see vm.h) and in native code alike (see x86.h and runtime.c).
+ *
+ * A string is a pointer to its NUL-terminated characters, so it can be
+ * printed as it is, with a StringHeader right in front of them that
+ * gives its length and hash. Strings never change once made. Two
+ * strings are equal when they are the same pointer; otherwise they can
+ * only be equal when their lengths and hashes are, and only then are
+ * their characters compared.
+ *
+ * String literals are interned as the program is lowered (see
+ * CodeGenerator::GenLoadString), so the program has one copy of each,
+ * and two literals are equal exactly when they are the same pointer.
+ * The strings ReadLine returns get their header as they are read.
+ * The hash is 32-bit FNV-1a, which runtime.c computes the same way.
+ */
+
+#ifndef _H_dstring
+#define _H_dstring
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+struct StringHeader {
+    uint32_t length;
+    uint32_t hash;
+};
+
+uint32_t HashString(const char *s, size_t length);
+
+    // A string with the given characters, which lives as long as the
+    // program does
+char *NewString(const char *s, size_t length);
+
+static inline StringHeader *HeaderOfString(const char *s) {
+    return (StringHeader *)s - 1;
+}
+
+static inline bool StringsEqual(const char *a, const char *b) {
+    if (a == b) return true;
+    if (!a || !b) return false;
+    StringHeader *x = HeaderOfString(a), *y = HeaderOfString(b);
+    return x->length == y->length && x->hash == y->hash && memcmp(a, b, x->length) == 0;
+}
+
+#endif
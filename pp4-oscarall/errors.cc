@@ -5,6 +5,7 @@
 
 #include "errors.h"
 #include <iostream>
+#include <mutex>
 #include <sstream>
 #include <stdarg.h>
 #include <stdio.h>
@@ -18,6 +19,11 @@ using namespace std;
 
 
 int ReportError::numErrors = 0;
+std::vector<Diagnostic> *ReportError::captured = NULL;
+
+// The scanner may report its errors from a thread of its own (see
+// scanthread.h)
+static std::mutex outputLock;
 
 void ReportError::UnderlineErrorInLine(const char *line, yyltype *pos) {
     if (!line) return;
@@ -30,7 +36,15 @@ void ReportError::UnderlineErrorInLine(const char *line, yyltype *pos) {
  
  
 void ReportError::OutputError(yyltype *loc, string msg) {
+    std::lock_guard<std::mutex> hold(outputLock);
     numErrors++;
+    if (captured) {
+        // The messages built in a stringstream end in a NUL
+        Diagnostic d = { loc ? loc->first_line : 0, loc ? loc->first_column : 0,
+                         loc ? loc->last_column : 0, msg.c_str() };
+        captured->push_back(d);
+        return;
+    }
     fflush(stdout); // make sure any buffered text has been output
     if (loc) {
         cerr << endl << "*** Error line " << loc->first_line << "." << endl;
@@ -178,16 +192,30 @@ void ReportError::TestNotBoolean(Expr *expr) {
 void ReportError::BreakOutsideLoop(BreakStmt *bStmt) {
     OutputError(bStmt->GetLocation(), "break is only allowed inside a loop");
 }
+
+void ReportError::SwitchNotInteger(Expr *expr) {
+    OutputError(expr->GetLocation(), "Switch expression must be an integer");
+}
+
+void ReportError::DuplicateCase(Expr *label, int value) {
+    stringstream s;
+    s << "Duplicate case value " << value << " in switch" << '\0';
+    OutputError(label->GetLocation(), s.str());
+}
+
+void ReportError::NoMainFound() {
+    OutputError(NULL, "Linker: function 'main' not defined");
+}
   
 /* Function: yyerror()
  * -------------------
  * Standard error-reporting function expected by yacc. Our version merely
  * just calls into the error reporter above, passing the location of
- * the last token read. If you want to suppress the ordinary "parse error"
+ * the token the parser was looking at. If you want to suppress the ordinary "parse error"
  * message from yacc, you can implement yyerror to do nothing and
  * then call ReportError::Formatted yourself with a more descriptive 
  * message.
  */
-void yyerror(char *msg) {
-    ReportError::Formatted(&yylloc, "%s", msg);
+void yyerror(yyltype *loc, const char *msg) {
+    ReportError::Formatted(loc, "%s", msg);
 }
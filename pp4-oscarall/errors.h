@@ -13,6 +13,7 @@
 #define _H_errors
 
 #include <string>
+#include <vector>
 using std::string;
 #include "location.h"
 class Type;
@@ -46,6 +47,13 @@ class Operator;
 
 typedef enum {LookingForType, LookingForClass, LookingForInterface, LookingForVariable, LookingForFunction} reasonT;
 
+// An error as ReportError::CaptureInto collects it rather than printing
+// it; line is 0 for an error without a location
+struct Diagnostic {
+    int line, firstColumn, lastColumn;
+    string message;
+};
+
 class ReportError
 {
  public:
@@ -98,6 +106,12 @@ class ReportError
   static void TestNotBoolean(Expr *testExpr);
   static void ReturnMismatch(ReturnStmt *rStmt, Type *given, Type *expected);
   static void BreakOutsideLoop(BreakStmt *bStmt);
+  static void SwitchNotInteger(Expr *switchExpr);
+  static void DuplicateCase(Expr *label, int value);
+
+
+  // Error used when a program is linked to be run
+  static void NoMainFound();
 
 
   // Generic method to report a printf-style error message
@@ -106,12 +120,17 @@ class ReportError
 
   // Returns number of error messages printed
   static int NumErrors() { return numErrors; }
+
+  // Appends errors to list instead of printing them, until called
+  // again with NULL (see server.h)
+  static void CaptureInto(std::vector<Diagnostic> *list) { captured = list; }
   
  private:
 
   static void UnderlineErrorInLine(const char *line, yyltype *pos);
   static void OutputError(yyltype *loc, string msg);
   static int numErrors;
+  static std::vector<Diagnostic> *captured;
   
 };
 
@@ -0,0 +1,300 @@
+/* File: fold.cc
+ * -------------
+ * Implementation of constant folding and propagation.
+ */
+
+#include "fold.h"
+#include "tac.h"
+#include "utility.h"
+#include <stdint.h>
+#include <string.h>
+#include <set>
+
+
+static const Constant Unassigned = Constant::Unknown(false);
+static const Constant Varying = Constant::Unknown(true);
+
+bool Constant::operator==(const Constant &o) const {
+    if (state != o.state) return false;
+    if (state != Known) return true;
+    if (kind != o.kind) return false;
+    if (kind == V_Int) return i == o.i;
+    // Compared bit for bit, so 0.0 and -0.0 differ and a NaN equals itself
+    if (kind == V_Double) return memcmp(&d, &o.d, sizeof(d)) == 0;
+    return text == o.text;
+}
+
+Constant Meet(const Constant &x, const Constant &y) {
+    if (x.state == Constant::Unassigned) return y;
+    if (y.state == Constant::Unassigned) return x;
+    return (x == y) ? x : Varying;
+}
+
+static bool IsConstantLoad(Opcode op) {
+    return op == OP_LoadInt || op == OP_LoadDouble || op == OP_LoadString || op == OP_LoadNull;
+}
+
+// Whether two known references are the same object. String literals
+// are interned (see TacProgram), so they are when their text is.
+static bool SameReference(const Constant &x, const Constant &y) {
+    return x.text == y.text;
+}
+
+static Constant IntResult(Opcode op, int64_t a, int64_t b) {
+    switch (op) {
+      case OP_Add: return Constant::Int(a + b);
+      case OP_Sub: return Constant::Int(a - b);
+      case OP_Mul: return Constant::Int(a * b);
+      case OP_Div: return b ? Constant::Int(a / b) : Varying;
+      case OP_Mod: return b ? Constant::Int(a % b) : Varying;
+      case OP_Eq:  return Constant::Int(a == b);
+      case OP_Ne:  return Constant::Int(a != b);
+      case OP_Lt:  return Constant::Int(a < b);
+      case OP_Le:  return Constant::Int(a <= b);
+      case OP_Gt:  return Constant::Int(a > b);
+      case OP_Ge:  return Constant::Int(a >= b);
+      default:     return Varying;
+    }
+}
+
+static Constant DoubleResult(Opcode op, double a, double b) {
+    switch (op) {
+      case OP_FAdd: return Constant::Double(a + b);
+      case OP_FSub: return Constant::Double(a - b);
+      case OP_FMul: return Constant::Double(a * b);
+      case OP_FDiv: return Constant::Double(a / b);
+      case OP_FEq:  return Constant::Int(a == b);
+      case OP_FNe:  return Constant::Int(a != b);
+      case OP_FLt:  return Constant::Int(a < b);
+      case OP_FLe:  return Constant::Int(a <= b);
+      case OP_FGt:  return Constant::Int(a > b);
+      case OP_FGe:  return Constant::Int(a >= b);
+      default:      return Varying;
+    }
+}
+
+Constant Evaluate(Instr *instr, const Env &env) {
+    switch (instr->op) {
+      case OP_LoadInt:    return Constant::Int(instr->intValue);
+      case OP_LoadDouble: return Constant::Double(instr->doubleValue);
+      case OP_LoadString: return Constant::Ref(instr->text);
+      case OP_LoadNull:   return Constant::Ref(NULL);
+      case OP_Move:       return env[instr->a];
+      default:
+        if (!instr->IsComputation()) return Varying;
+    }
+
+    const Constant &a = env[instr->a];
+    const Constant &b = (instr->b == NoTemp) ? a : env[instr->b];
+    if (a.state == Constant::Unassigned || b.state == Constant::Unassigned) return Unassigned;
+    if (!a.IsKnown() || !b.IsKnown() || a.kind != b.kind) return Varying;
+
+    switch (instr->op) {
+      case OP_Neg:  return a.kind == V_Int ? Constant::Int(-a.i) : Varying;
+      case OP_Not:  return a.kind == V_Int ? Constant::Int(!a.i) : Varying;
+      case OP_FNeg: return a.kind == V_Double ? Constant::Double(-a.d) : Varying;
+      case OP_Eq: case OP_Ne:
+        if (a.kind == V_Ref) {
+            bool same = SameReference(a, b);
+            return Constant::Int(instr->op == OP_Eq ? same : !same);
+        }
+        break;
+      case OP_StrEq: case OP_StrNe: {
+        if (a.kind != V_Ref) return Varying;
+        bool same = SameReference(a, b);
+        return Constant::Int(instr->op == OP_StrEq ? same : !same);
+      }
+      default:
+        break;
+    }
+    if (a.kind == V_Int) return IntResult(instr->op, a.i, b.i);
+    if (a.kind == V_Double) return DoubleResult(instr->op, a.d, b.d);
+    return Varying;
+}
+
+void MakeLoad(Instr *instr, const Constant &c) {
+    instr->a = instr->b = instr->c = NoTemp;
+    instr->numArgs = 0;
+    if (c.kind == V_Int) {
+        instr->op = OP_LoadInt;
+        instr->intValue = (int)c.i;
+    } else if (c.kind == V_Double) {
+        instr->op = OP_LoadDouble;
+        instr->doubleValue = c.d;
+    } else if (c.text) {
+        instr->op = OP_LoadString;
+        instr->text = c.text;
+    } else {
+        instr->op = OP_LoadNull;
+    }
+}
+
+/* Class: Folder
+ * -------------
+ * Folds one function: Analyze finds what is known at the start of each
+ * block that can be reached, Rewrite uses it, and the clean-ups then
+ * tidy up what is left.
+ */
+class Folder
+{
+  private:
+    TacFunction *fn;
+    std::vector<Env> in;          // at the start of each block
+    std::vector<bool> reached;
+    int folded, pruned, removed, merged;
+
+    void Reach(BasicBlock *b, const Env &env, std::set<int> *worklist);
+    void Analyze();
+    void Rewrite();
+    void RemoveDeadCode();
+    void MergeBlocks();
+
+  public:
+    Folder(TacFunction *f) : fn(f), folded(0), pruned(0), removed(0), merged(0) {}
+    void Fold();
+};
+
+// Control reaches b with env; queues b when that tells something new
+void Folder::Reach(BasicBlock *b, const Env &env, std::set<int> *worklist) {
+    if (!reached[b->id]) {
+        reached[b->id] = true;
+        in[b->id] = env;
+    } else {
+        bool changed = false;
+        Env &old = in[b->id];
+        for (size_t t = 0; t < env.size(); t++) {
+            Constant c = Meet(old[t], env[t]);
+            if (!(c == old[t])) {
+                old[t] = c;
+                changed = true;
+            }
+        }
+        if (!changed) return;
+    }
+    worklist->insert(b->id);
+}
+
+void Folder::Analyze() {
+    int numBlocks = fn->blocks.NumElements();
+    in.assign(numBlocks, Env());
+    reached.assign(numBlocks, false);
+    Env entry(fn->NumTemps(), Unassigned);
+    for (int t = 0; t < fn->numParams; t++) entry[t] = Varying;
+
+    // Blocks are taken in source order, so a join is mostly visited once
+    // all the paths into it have been, and each is queued once at most
+    std::set<int> worklist;
+    Reach(fn->blocks.Nth(0), entry, &worklist);
+    while (!worklist.empty()) {
+        BasicBlock *b = fn->blocks.Nth(*worklist.begin());
+        worklist.erase(worklist.begin());
+        Env env = in[b->id];
+        for (Instr *instr = b->first; instr; instr = instr->next)
+            if (instr->dst != NoTemp) env[instr->dst] = Evaluate(instr, env);
+
+        Instr *t = b->Terminator();
+        if (t->op == OP_Jump) {
+            Reach(t->target[0], env, &worklist);
+        } else if (t->op == OP_Branch) {
+            // A test not assigned yet is not known to go either way
+            const Constant &test = env[t->a];
+            if (test.state == Constant::Varying || (test.IsKnown() && test.i))
+                Reach(t->target[0], env, &worklist);
+            if (test.state == Constant::Varying || (test.IsKnown() && !test.i))
+                Reach(t->target[1], env, &worklist);
+        } else if (t->op == OP_Switch) {
+            const Constant &value = env[t->a];
+            if (value.IsKnown())
+                Reach(t->table->Lookup(value.i, t->target[0]), env, &worklist);
+            else if (value.state == Constant::Varying)
+                for (int i = 0; i < t->NumTargets(); i++)
+                    Reach(t->Target(i), env, &worklist);
+        }
+    }
+}
+
+void Folder::Rewrite() {
+    for (BasicBlock *b : fn->blocks) {
+        if (!reached[b->id]) continue;
+        Env env = in[b->id];
+        for (Instr *instr = b->first; instr; instr = instr->next) {
+            if (instr->dst != NoTemp) {
+                Constant c = Evaluate(instr, env);
+                env[instr->dst] = c;
+                if (c.IsKnown() && instr->IsComputation() && !IsConstantLoad(instr->op)) {
+                    MakeLoad(instr, c);
+                    folded++;
+                }
+            } else if (instr->op == OP_Branch && env[instr->a].IsKnown()) {
+                instr->target[0] = instr->target[env[instr->a].i ? 0 : 1];
+                instr->op = OP_Jump;
+                instr->a = NoTemp;
+                pruned++;
+            } else if (instr->op == OP_Switch && env[instr->a].IsKnown()) {
+                instr->target[0] = instr->table->Lookup(env[instr->a].i, instr->target[0]);
+                instr->op = OP_Jump;
+                instr->a = NoTemp;
+                pruned++;
+            }
+        }
+    }
+    fn->ComputeEdges();
+}
+
+// Drops pure instructions whose results are never read, and then those
+// that only fed them
+void Folder::RemoveDeadCode() {
+    std::vector<int> uses(fn->NumTemps(), 0);
+    for (BasicBlock *b : fn->blocks)
+        for (Instr *instr = b->first; instr; instr = instr->next)
+            instr->ForEachUse([&](int &t) { uses[t]++; });
+
+    for (bool changed = true; changed; ) {
+        changed = false;
+        for (BasicBlock *b : fn->blocks)
+            for (Instr *instr = b->last; instr; ) {
+                Instr *prev = instr->prev;
+                if (instr->dst != NoTemp && uses[instr->dst] == 0 && instr->IsRemovable()) {
+                    instr->ForEachUse([&](int &t) { uses[t]--; });
+                    b->Remove(instr);
+                    removed++;
+                    changed = true;
+                }
+                instr = prev;
+            }
+    }
+}
+
+// A block whose only predecessor jumps to it is appended to that one
+void Folder::MergeBlocks() {
+    BasicBlock *entry = fn->blocks.Nth(0);
+    for (BasicBlock *b : fn->blocks) {
+        Instr *t;
+        while ((t = b->Terminator()) && t->op == OP_Jump) {
+            BasicBlock *next = t->target[0];
+            if (next == b || next == entry || next->preds.NumElements() != 1) break;
+            b->Remove(t);
+            while (Instr *instr = next->first) {
+                next->Remove(instr);
+                b->Append(instr);
+            }
+            merged++;
+        }
+    }
+    fn->ComputeEdges();
+}
+
+void Folder::Fold() {
+    Analyze();
+    Rewrite();
+    RemoveDeadCode();
+    MergeBlocks();
+    PrintDebug("fold", "%s: %d instructions folded, %d branches pruned, "
+               "%d instructions removed, %d blocks merged",
+               fn->name, folded, pruned, removed, merged);
+}
+
+
+void FoldConstants(TacFunction *fn) {
+    Folder(fn).Fold();
+}
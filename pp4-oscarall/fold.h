@@ -0,0 +1,89 @@
+/* File: fold.h
+ * ------------
+ * Constant folding and propagation over the three-address code (see
+ * tac.h). It works on the code as lowered, before SSA form is built
+ * or after it is taken apart, and runs last in the default pipeline
+ * (see passes.h) to tidy up what the SSA passes leave.
+ *
+ * What each temporary holds is worked out for every block by a forward
+ * dataflow analysis in which a temporary is either not yet assigned, a
+ * known constant or varying. A constant assigned to a local (a Move
+ * from a temporary holding a constant) is a constant too, so constants
+ * flow through locals and across blocks wherever every path agrees on
+ * them. Only blocks that can be reached are taken into account, and a
+ * branch on a known test reaches just the block it goes to, so code
+ * guarded by a test that folds to false doesn't spoil what is known
+ * after it.
+ *
+ * Then every instruction that computes a known value without side
+ * effects is replaced by a load of that value, a branch on a known test
+ * becomes a jump, and blocks that can no longer be reached are dropped
+ * (the pruned branches of if and while statements). Instructions whose
+ * results are never read are removed, and a block that is only entered
+ * from a jump at the end of another is merged into it.
+ *
+ * Folding follows what the program would do when run: int arithmetic
+ * wraps around in 32 bits, as in the VM and in native code, so the
+ * quotient of -2147483648 by -1 is -2147483648 and the remainder 0.
+ * Division or remainder by a zero that is known is left in place, so
+ * the program still stops with a runtime error where it would have.
+ * Doubles are folded with the host's IEEE arithmetic.
+ */
+
+#ifndef _H_fold
+#define _H_fold
+
+#include <stdint.h>
+#include <vector>
+#include "tac.h"
+
+
+/* Struct: Constant
+ * ----------------
+ * What is known about a temporary at some point: not assigned yet, a
+ * known constant, or varying. A known reference is null (text is NULL)
+ * or a string constant. This lattice is shared with the sparse
+ * conditional constant propagation of the SSA passes (see ssa.h).
+ */
+struct Constant {
+    enum { Unassigned, Known, Varying } state;
+    ValueKind kind;
+    int64_t i;
+    double d;
+    const char *text;
+
+    static Constant Unknown(bool assigned)
+        { Constant c = Constant(); c.state = assigned ? Varying : Unassigned; return c; }
+    static Constant Int(int64_t value)
+        { Constant c = Constant(); c.state = Known; c.kind = V_Int; c.i = (int32_t)value; return c; }
+    static Constant Double(double value)
+        { Constant c = Constant(); c.state = Known; c.kind = V_Double; c.d = value; return c; }
+    static Constant Ref(const char *text)
+        { Constant c = Constant(); c.state = Known; c.kind = V_Ref; c.text = text; return c; }
+
+    bool IsKnown() const { return state == Known; }
+    bool operator==(const Constant &o) const;
+};
+
+typedef std::vector<Constant> Env;   // one Constant per temporary
+
+// What a temporary holds where two paths join
+Constant Meet(const Constant &x, const Constant &y);
+
+// What instr leaves in its destination, given what env knows of its
+// operands; varying for anything but a computation
+Constant Evaluate(Instr *instr, const Env &env);
+
+// Turns instr into a load of the known constant c
+void MakeLoad(Instr *instr, const Constant &c);
+
+
+/* Function: FoldConstants()
+ * -------------------------
+ * Folds the constants of fn, which must not be in SSA form, and leaves
+ * its control flow graph recomputed. -d fold prints what was folded.
+ * This is the fold pass of the pipeline (see passes.h).
+ */
+void FoldConstants(TacFunction *fn);
+
+#endif
@@ -0,0 +1,196 @@
+/* File: heap.cc
+ * -------------
+ * Implementation of the generational heap.
+ */
+
+#include "heap.h"
+#include "utility.h"
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+// An array larger than this share of the nursery goes straight into the
+// old generation
+static const int LargeFraction = 4;
+
+static double MsecsSince(clock_t start) {
+    return (clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+}
+
+Heap::Heap(size_t nurseryBytes, size_t oldBytes) {
+    nursery = (char *)calloc(nurseryBytes, 1);
+    old = (char *)malloc(oldBytes);
+    if (!nursery || !old) Failure("Can't set aside %zu bytes for the heap", nurseryBytes + oldBytes);
+    nurseryTop = nurseryLimit = nursery;
+    nurseryEnd = nursery + nurseryBytes;
+    oldTop = old;
+    oldEnd = old + oldBytes;
+    SizeNursery();
+
+    start = clock();
+    numMinor = numMajor = 0;
+    minorMsecs = majorMsecs = maxPause = 0;
+    allocated = promoted = reclaimed = 0;
+}
+
+Heap::~Heap() {
+    free(nursery);
+    free(old);
+}
+
+Value *Heap::Place(char *at, int64_t numValues, Kind kind) {
+    Header *header = (Header *)at;
+    header->numValues = numValues;
+    header->kind = kind;
+    header->flags = 0;
+    header->forward = NULL;
+    return (Value *)(header + 1);
+}
+
+template <class F> void Heap::ForEachReference(Value *object, F f) {
+    Header *header = HeaderOf(object);
+    if (header->kind == K_Object) {
+        BcClass *cls = (BcClass *)object[0].p;
+        for (int i = 0; i < cls->numRefFields; i++)
+            f(object[1 + cls->refFields[i]]);
+    } else if (header->kind == K_RefArray) {
+        for (uint32_t i = 1; i < header->numValues; i++)
+            f(object[i]);
+    }
+}
+
+// The nursery may only take in as much as the old generation has room
+// for, so that it can always be promoted whole
+void Heap::SizeNursery() {
+    nurseryLimit = nursery + std::min(nurseryEnd - nursery, oldEnd - oldTop);
+}
+
+// Large arrays go into the old generation, if there is room for them
+// and for what is in the nursery; anything else has to wait for a
+// collection
+Value *Heap::AllocateSlowly(int64_t numValues, Kind kind) {
+    if (numValues < 0 || numValues > UINT32_MAX) return NULL;
+    size_t bytes = BytesFor(numValues);
+    if (bytes <= (size_t)(nurseryEnd - nursery) / LargeFraction) return NULL;
+    if ((size_t)(oldEnd - oldTop) < bytes + (nurseryTop - nursery)) return NULL;
+    memset(oldTop, 0, bytes);
+    Value *result = Place(oldTop, numValues, kind);
+    oldTop += bytes;
+    allocated += bytes;
+    SizeNursery();
+    return result;
+}
+
+Value *Heap::Evacuate(Value *object) {
+    Header *header = HeaderOf(object);
+    if (header->forward) return header->forward;
+    size_t bytes = BytesFor(header->numValues);
+    memcpy(oldTop, header, bytes);
+    header->forward = (Value *)(oldTop + sizeof(Header));
+    oldTop += bytes;
+    promoted += bytes;
+    return header->forward;
+}
+
+void Heap::CollectNursery(const std::vector<Value*> &roots) {
+    auto evacuate = [&](Value &v) { if (InNursery(v.p)) v.p = Evacuate((Value *)v.p); };
+    char *scan = oldTop;
+    for (Value *slot : roots) evacuate(*slot);
+    for (Value *object : remembered) {
+        HeaderOf(object)->flags &= ~Remembered;
+        ForEachReference(object, evacuate);
+    }
+    remembered.clear();
+    while (scan < oldTop) {
+        Header *header = (Header *)scan;
+        ForEachReference((Value *)(header + 1), evacuate);
+        scan += BytesFor(header->numValues);
+    }
+    allocated += nurseryTop - nursery;
+    memset(nursery, 0, nurseryTop - nursery);
+    nurseryTop = nursery;
+}
+
+void Heap::Mark(Value *object) {
+    auto mark = [&](Value &v) {
+        if (!InOld(v.p) || (HeaderOf((Value *)v.p)->flags & Marked)) return;
+        HeaderOf((Value *)v.p)->flags |= Marked;
+        markStack.push_back((Value *)v.p);
+    };
+    Value root;
+    root.p = object;
+    mark(root);
+    while (!markStack.empty()) {
+        Value *next = markStack.back();
+        markStack.pop_back();
+        ForEachReference(next, mark);
+    }
+}
+
+// Only runs right after the nursery has been emptied, so nothing outside
+// the roots refers into the old generation
+void Heap::CompactOld(const std::vector<Value*> &roots) {
+    for (Value *slot : roots) Mark((Value *)slot->p);
+
+    char *to = old;
+    for (char *at = old; at < oldTop; at += BytesFor(((Header *)at)->numValues)) {
+        Header *header = (Header *)at;
+        if (!(header->flags & Marked)) continue;
+        header->forward = (Value *)(to + sizeof(Header));
+        to += BytesFor(header->numValues);
+    }
+
+    auto update = [&](Value &v) { if (InOld(v.p)) v.p = HeaderOf((Value *)v.p)->forward; };
+    for (Value *slot : roots) update(*slot);
+    for (char *at = old; at < oldTop; at += BytesFor(((Header *)at)->numValues))
+        if (((Header *)at)->flags & Marked)
+            ForEachReference((Value *)((Header *)at + 1), update);
+
+    // Each object moves down, never past the start of the next one
+    for (char *at = old, *next; at < oldTop; at = next) {
+        Header *header = (Header *)at;
+        next = at + BytesFor(header->numValues);
+        if (!(header->flags & Marked)) continue;
+        Header *dest = HeaderOf(header->forward);
+        header->flags &= ~Marked;
+        header->forward = NULL;
+        memmove(dest, header, next - at);
+    }
+    reclaimed += oldTop - to;
+    oldTop = to;
+}
+
+void Heap::Collect(const std::vector<Value*> &roots, int64_t numValues) {
+    clock_t minorStart = clock();
+    CollectNursery(roots);
+    double pause = MsecsSince(minorStart);
+    minorMsecs += pause;
+    numMinor++;
+
+    size_t needed = nurseryEnd - nursery;
+    if (numValues >= 0 && BytesFor(numValues) > needed / LargeFraction) needed += BytesFor(numValues);
+    bool major = (size_t)(oldEnd - oldTop) < needed;
+    if (major) {
+        clock_t majorStart = clock();
+        CompactOld(roots);
+        double msecs = MsecsSince(majorStart);
+        majorMsecs += msecs;
+        pause += msecs;
+        numMajor++;
+    }
+    maxPause = std::max(maxPause, pause);
+    SizeNursery();
+    PrintDebug("gc", "%s collection, %.2f ms, %zu KB left in the old generation",
+               major ? "major" : "minor", pause, (size_t)(oldTop - old) >> 10);
+}
+
+void Heap::PrintStats(FILE *fp) {
+    double total = MsecsSince(start), inGC = minorMsecs + majorMsecs;
+    const double MB = 1 << 20;
+    fprintf(fp, "gc: %d minor collections in %.1f ms, %d major in %.1f ms, longest pause %.1f ms\n",
+            numMinor, minorMsecs, numMajor, majorMsecs, maxPause);
+    fprintf(fp, "gc: %.1f MB allocated, %.1f MB promoted, %.1f MB reclaimed from the old generation\n",
+            (allocated + (nurseryTop - nursery)) / MB, promoted / MB, reclaimed / MB);
+    fprintf(fp, "gc: %.1f ms of %.1f ms spent collecting, %.1f%% throughput\n",
+            inGC, total, total > 0 ? 100 * (total - inGC) / total : 100.0);
+}
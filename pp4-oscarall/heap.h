@@ -0,0 +1,120 @@
+/* File: heap.h
+ * ------------
+ * The garbage-collected heap that objects and arrays of the VM (see
+ * vm.h) are allocated in, in two generations.
+ *
+ * New objects go in the nursery, a fixed-size region they are bump
+ * allocated from. When it fills up, a minor collection copies what is
+ * still reachable into the old generation (Cheney's algorithm) and
+ * starts the nursery over; whatever survives one collection is taken
+ * to be long-lived. Arrays too large for the nursery go straight into
+ * the old generation.
+ *
+ * The old generation is collected by mark-compact (the Lisp 2
+ * algorithm): what is reachable is marked, given the address it will
+ * have once the live objects have been slid down to the start of the
+ * region, has its references updated to those addresses, and is then
+ * moved there. This runs after a minor collection whenever the old
+ * generation has less room left than the nursery would need to be
+ * promoted whole, so a minor collection never runs out of room; when
+ * it has little room left, the nursery is made smaller to match.
+ *
+ * Every block of the heap has a header in front of it, which says how
+ * many Values it takes and whether it is an object, whose class says
+ * which fields hold references (see BcClass), an array of references,
+ * or an array of anything else. References into the heap are found
+ * precisely: the roots are the slots the VM hands over (the globals
+ * and registers that hold references, from the stack maps of
+ * bytecode.h), and a reference that points outside the heap, as
+ * strings do, is left alone. Stores into objects and arrays go through
+ * a write barrier, which remembers the old objects that were given a
+ * reference to a young one; a minor collection treats those as roots
+ * too.
+ *
+ * The sizes of the two generations are set with --nursery=<kilobytes>
+ * (default 1024) and --heap=<megabytes> (default 1024). --gc-stats
+ * prints on stderr how many collections of each kind there were, how
+ * long they paused the program and what share of the running time the
+ * program had to itself, and -d gc reports each collection as it ends.
+ */
+
+#ifndef _H_heap
+#define _H_heap
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <vector>
+#include "bytecode.h"
+
+
+class Heap
+{
+  public:
+    typedef enum { K_Object, K_RefArray, K_DataArray } Kind;
+
+  private:
+    struct Header {
+        uint32_t numValues;
+        uint8_t kind;
+        uint8_t flags;
+        Value *forward;      // where it was moved to, while collecting
+    };
+    enum { Marked = 1, Remembered = 2 };
+
+    char *nursery, *nurseryTop, *nurseryLimit, *nurseryEnd;
+    char *old, *oldTop, *oldEnd;
+    std::vector<Value*> remembered;   // old objects that may refer to young ones
+    std::vector<Value*> markStack;
+
+    clock_t start;
+    int numMinor, numMajor;
+    double minorMsecs, majorMsecs, maxPause;
+    int64_t allocated, promoted, reclaimed;
+
+    static Header *HeaderOf(Value *object) { return (Header *)object - 1; }
+    static size_t BytesFor(int64_t numValues) { return sizeof(Header) + numValues * sizeof(Value); }
+    bool InNursery(void *p) const { return (uintptr_t)((char *)p - nursery) < (uintptr_t)(nurseryEnd - nursery); }
+    bool InOld(void *p) const     { return (uintptr_t)((char *)p - old) < (uintptr_t)(oldTop - old); }
+
+    static Value *Place(char *at, int64_t numValues, Kind kind);
+    template <class F> static void ForEachReference(Value *object, F f);
+    Value *AllocateSlowly(int64_t numValues, Kind kind);
+    Value *Evacuate(Value *object);
+    void CollectNursery(const std::vector<Value*> &roots);
+    void Mark(Value *object);
+    void CompactOld(const std::vector<Value*> &roots);
+    void SizeNursery();
+
+  public:
+    Heap(size_t nurseryBytes, size_t oldBytes);
+    ~Heap();
+
+        // numValues zeroed Values, or NULL if the heap has to be
+        // collected first
+    Value *Allocate(int64_t numValues, Kind kind) {
+        size_t bytes = BytesFor(numValues);
+        if (numValues < 0 || bytes > (size_t)(nurseryLimit - nurseryTop))
+            return AllocateSlowly(numValues, kind);
+        Value *result = Place(nurseryTop, numValues, kind);
+        nurseryTop += bytes;
+        return result;
+    }
+
+        // To be called after value has been stored into object
+    void WriteBarrier(Value *object, Value value) {
+        if (InNursery(value.p) && InOld(object) && !(HeaderOf(object)->flags & Remembered)) {
+            HeaderOf(object)->flags |= Remembered;
+            remembered.push_back(object);
+        }
+    }
+
+        // Collects the nursery, and the old generation too if it is
+        // short of room, making room for numValues more if it can. roots
+        // are the slots outside the heap that may hold references.
+    void Collect(const std::vector<Value*> &roots, int64_t numValues);
+
+    void PrintStats(FILE *fp);
+};
+
+#endif
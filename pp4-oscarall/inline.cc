@@ -0,0 +1,253 @@
+/* File: inline.cc
+ * ---------------
+ * Implementation of inlining.
+ */
+
+#include "inline.h"
+#include "tac.h"
+#include "fold.h"
+#include "ssa.h"
+#include "arena.h"
+#include "utility.h"
+#include <stdlib.h>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+static const int DefaultBudget = 60;       // instructions each caller may grow by
+static const int ConstantArgBonus = 2;
+static const int LoopWeight = 4;
+
+static int SizeOf(TacFunction *fn) {
+    int size = 0;
+    for (BasicBlock *b : fn->blocks)
+        for (Instr *instr = b->first; instr; instr = instr->next) size++;
+    return size;
+}
+
+// Whether the last assignment of temp before instr in its block loads
+// a constant
+static bool IsConstantBefore(Instr *instr, int temp) {
+    for (Instr *prev = instr->prev; prev; prev = prev->prev)
+        if (prev->dst == temp)
+            return prev->op == OP_LoadInt || prev->op == OP_LoadDouble
+                || prev->op == OP_LoadString || prev->op == OP_LoadNull;
+    return false;
+}
+
+// Which blocks are in the body of some loop, found from the back edges
+static std::vector<bool> BlocksInLoops(TacFunction *fn) {
+    Dominators doms(fn);
+    std::vector<bool> inLoop(fn->blocks.NumElements(), false);
+    for (BasicBlock *b : fn->blocks)
+        for (BasicBlock *header : b->succs) {
+            if (!doms.Dominates(header->id, b->id)) continue;
+            inLoop[header->id] = true;
+            std::vector<BasicBlock*> work(1, b);
+            while (!work.empty()) {
+                BasicBlock *body = work.back();
+                work.pop_back();
+                if (inLoop[body->id] && body != b) continue;
+                inLoop[body->id] = true;
+                for (BasicBlock *pred : body->preds)
+                    if (!inLoop[pred->id]) work.push_back(pred);
+            }
+        }
+    return inLoop;
+}
+
+static Instr *NewMove(int dst, int src) {
+    Instr *move = NewInstr(OP_Move);
+    move->dst = dst;
+    move->a = src;
+    return move;
+}
+
+
+class Inliner
+{
+  private:
+    struct Site {
+        Instr *call;
+        int cost, weighted;
+    };
+
+    TacProgram *code;
+    int budget;
+    std::unordered_map<TacFunction*, int> component;   // of the call graph
+    std::vector<TacFunction*> bottomUp;
+    std::unordered_map<Instr*, BasicBlock*> blockOf;
+    int numInlined;
+
+        // Tarjan's algorithm, which finishes a component after those
+        // it calls into
+    std::unordered_map<TacFunction*, int> index, lowLink;
+    std::vector<TacFunction*> stack;
+    void Visit(TacFunction *fn);
+
+    Instr *Copy(Instr *instr, const std::vector<int> &temps,
+                std::unordered_map<BasicBlock*, BasicBlock*> &blocks);
+    void Inline(TacFunction *fn, Instr *call);
+    void InlineInto(TacFunction *fn);
+
+  public:
+    Inliner(TacProgram *c, int b) : code(c), budget(b), numInlined(0) {}
+    void Run();
+};
+
+void Inliner::Visit(TacFunction *fn) {
+    int number = index.size();
+    index[fn] = lowLink[fn] = number;
+    stack.push_back(fn);
+    for (BasicBlock *b : fn->blocks)
+        for (Instr *instr = b->first; instr; instr = instr->next) {
+            if (instr->op != OP_Call) continue;
+            TacFunction *callee = instr->callee;
+            if (!index.count(callee)) {
+                Visit(callee);
+                lowLink[fn] = std::min(lowLink[fn], lowLink[callee]);
+            } else if (!component.count(callee)) {   // still on the stack
+                lowLink[fn] = std::min(lowLink[fn], index[callee]);
+            }
+        }
+    if (lowLink[fn] != index[fn]) return;
+    TacFunction *member;
+    do {
+        member = stack.back();
+        stack.pop_back();
+        component[member] = number;
+        bottomUp.push_back(member);
+    } while (member != fn);
+}
+
+Instr *Inliner::Copy(Instr *instr, const std::vector<int> &temps,
+                     std::unordered_map<BasicBlock*, BasicBlock*> &blocks) {
+    Instr *copy = NewInstr(instr->op);
+    *copy = *instr;
+    if (copy->numArgs) {
+        copy->args = (int *)ArenaAlloc(copy->numArgs * sizeof(int));
+        for (int i = 0; i < copy->numArgs; i++) copy->args[i] = instr->args[i];
+    }
+    if (copy->dst != NoTemp) copy->dst = temps[copy->dst];
+    copy->ForEachUse([&](int &t) { t = temps[t]; });
+    for (int k = 0; k < 2; k++)
+        if (copy->target[k]) copy->target[k] = blocks[copy->target[k]];
+    if (copy->op == OP_Switch) {
+        JumpTable *table = (JumpTable *)ArenaAlloc(sizeof(JumpTable));
+        *table = *instr->table;
+        table->targets = (BasicBlock **)ArenaAlloc(table->size * sizeof(BasicBlock*));
+        for (int i = 0; i < table->size; i++)
+            table->targets[i] = blocks[instr->table->targets[i]];
+        copy->table = table;
+    }
+    return copy;
+}
+
+// Splits the block of call after it, and puts a copy of the callee in
+// between the two halves
+void Inliner::Inline(TacFunction *fn, Instr *call) {
+    TacFunction *callee = call->callee;
+    BasicBlock *b = blockOf[call];
+    int numBlocks = fn->blocks.NumElements();
+
+    std::vector<int> temps(callee->NumTemps());
+    for (int t = 0; t < callee->NumTemps(); t++)
+        temps[t] = fn->NewTemp(callee->tempKinds.Nth(t));
+    std::unordered_map<BasicBlock*, BasicBlock*> blocks;
+    for (BasicBlock *from : callee->blocks) blocks[from] = fn->NewBlock();
+    BasicBlock *after = fn->NewBlock();
+    while (Instr *instr = call->next) {
+        b->Remove(instr);
+        after->Append(instr);
+        blockOf[instr] = after;
+    }
+
+    for (BasicBlock *from : callee->blocks) {
+        BasicBlock *to = blocks[from];
+        for (Instr *instr = from->first; instr; instr = instr->next) {
+            if (instr->op != OP_Return) {
+                to->Append(Copy(instr, temps, blocks));
+                continue;
+            }
+            if (call->dst != NoTemp) to->Append(NewMove(call->dst, temps[instr->a]));
+            Instr *jump = NewInstr(OP_Jump);
+            jump->target[0] = after;
+            to->Append(jump);
+        }
+    }
+
+    // A null check devirtualization left is done by the body itself
+    // when that starts with a field of the receiver
+    Instr *check = call->prev, *first = callee->blocks.Nth(0)->first;
+    if (check && check->op == OP_CheckNull && callee->cls && check->a == call->args[0]
+        && (first->op == OP_LoadField || first->op == OP_StoreField) && first->a == 0)
+        b->Remove(check);
+    for (int i = 0; i < call->numArgs; i++)
+        b->InsertBefore(NewMove(temps[i], call->args[i]), call);
+    Instr *enter = NewInstr(OP_Jump);
+    enter->target[0] = blocks[callee->blocks.Nth(0)];
+    b->InsertBefore(enter, call);
+    b->Remove(call);
+
+    // Lay the new blocks out right after b
+    int at = 0;
+    while (fn->blocks.Nth(at) != b) at++;
+    for (int i = numBlocks; i < fn->blocks.NumElements(); i++) {
+        BasicBlock *moved = fn->blocks.Nth(i);
+        fn->blocks.RemoveAt(i);
+        fn->blocks.InsertAt(moved, ++at);
+    }
+}
+
+void Inliner::InlineInto(TacFunction *fn) {
+    std::vector<bool> inLoop = BlocksInLoops(fn);
+    std::vector<Site> sites;
+    for (BasicBlock *b : fn->blocks)
+        for (Instr *instr = b->first; instr; instr = instr->next) {
+            blockOf[instr] = b;
+            if (instr->op != OP_Call || component[instr->callee] == component[fn]) continue;
+            Site site = { instr, SizeOf(instr->callee) - (instr->numArgs + 2), 0 };
+            for (int i = 0; i < instr->numArgs; i++)
+                if (IsConstantBefore(instr, instr->args[i])) site.cost -= ConstantArgBonus;
+            site.weighted = site.cost;
+            if (site.cost > 0 && inLoop[b->id])
+                site.weighted = (site.cost + LoopWeight - 1) / LoopWeight;
+            sites.push_back(site);
+        }
+    std::stable_sort(sites.begin(), sites.end(),
+                     [](const Site &x, const Site &y) { return x.weighted < y.weighted; });
+
+    int grown = 0, inlined = 0;
+    for (const Site &site : sites) {
+        if (site.cost > 0 && grown + site.cost > budget) continue;
+        PrintDebug("inline", "%s: inlined %s (cost %d)", fn->name, site.call->callee->name, site.cost);
+        grown += std::max(site.cost, 0);
+        Inline(fn, site.call);
+        inlined++;
+    }
+    blockOf.clear();
+    if (!inlined) return;
+    numInlined += inlined;
+    fn->ComputeEdges();
+    FoldConstants(fn);
+}
+
+void Inliner::Run() {
+    int before = 0;
+    for (TacFunction *fn : code->functions) {
+        before += SizeOf(fn);
+        if (!index.count(fn)) Visit(fn);
+    }
+    for (TacFunction *fn : bottomUp)
+        InlineInto(fn);
+    int after = 0;
+    for (TacFunction *fn : code->functions) after += SizeOf(fn);
+    PrintDebug("inline", "%d calls inlined, %d instructions before and %d after",
+               numInlined, before, after);
+}
+
+
+void InlineCalls(TacProgram *code) {
+    const char *limit = GetOption("inline-limit");
+    Inliner(code, limit && *limit ? atoi(limit) : DefaultBudget).Run();
+}
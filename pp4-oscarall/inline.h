@@ -0,0 +1,37 @@
+/* File: inline.h
+ * --------------
+ * Inlining of direct calls (OP_Call) over the whole program, as the
+ * inline pass on plain code (see passes.h). The callee's blocks are
+ * copied into the caller, with temporaries of their own: the block of
+ * the call is split in two, the arguments are moved into the copied
+ * parameters before the copy of the entry, and each return becomes a
+ * move of the result and a jump to the second half.
+ *
+ * Functions are taken bottom-up over the call graph, callees first, so
+ * what is inlined has had its own calls inlined and been folded. A call
+ * between functions of the same strongly connected component (a direct
+ * or mutual recursion) is never inlined. The cost of a call is how many
+ * instructions inlining it adds: the callee's size less what the call
+ * itself takes (the call, its arguments and the return) and two for
+ * each constant argument, which folding is likely to take further.
+ * Calls that cost nothing, like those of accessors, are always inlined.
+ * The rest are taken cheapest first, a call inside a loop counting as
+ * a quarter of its cost, for as long as the caller has not grown by
+ * more than the budget given with -finline-limit=<instructions>
+ * (default 60).
+ *
+ * Every function something was inlined into is folded again (see
+ * fold.h), which drops what the constant arguments made dead. A null
+ * check on the receiver right before the call (see devirt.h) goes when
+ * the body starts by dereferencing it anyway. -d inline reports each
+ * call inlined and how much the program grew.
+ */
+
+#ifndef _H_inline
+#define _H_inline
+
+struct TacProgram;
+
+void InlineCalls(TacProgram *code);
+
+#endif
@@ -2,10 +2,18 @@
  * ------------
  * Simple list class for storing a linear collection of elements. It
  * supports operations similar in name to the CS107 DArray -- nth, insert,
- * append, remove, etc.  This class is nothing more than a very thin
- * cover of a STL deque, with some added range-checking. Given not everyone
- * is familiar with the C++ templates, this class provides a more familiar
- * interface.
+ * append, remove, etc.  Elements are stored contiguously in a small-vector:
+ * the first few live inline in the List object itself and only longer
+ * lists move to a heap array that doubles as it grows. Most lists in the
+ * parse tree (formals, actuals, implements) hold 0-3 elements, so they
+ * never allocate beyond the List itself. Index checks use Assert(), which
+ * compiles out when NDEBUG is defined. Given not everyone is familiar
+ * with the C++ templates, this class provides a more familiar interface.
+ *
+ * The parser grows lists one Append at a time, but once a node takes
+ * ownership of a list it never grows again. The node constructor then
+ * calls Freeze(), which moves a heap-backed list into an exactly-sized
+ * span in the arena (see arena.h) and releases the growable array.
  *
  * It can handle elements of any type, the typename for a List includes the
  * element type in angle brackets, e.g.  to store elements of type double,
@@ -23,13 +31,18 @@
  *       }
  *       return sum;
  *    }
+ *
+ * The list can also be walked with a range-based for loop, which simply
+ * steps a pointer over the elements:
+ *
+ *   for (int val : *list) sum += val;
  */
 
 #ifndef _H_list
 #define _H_list
 
-#include <deque>
 #include "utility.h"  // for Assert()
+#include "arena.h"    // for Freeze()
 #include "scope.h"
   
 class Node;
@@ -37,15 +50,52 @@ class Node;
 template<class Element> class List {
 
  private:
-    std::deque<Element> elems;
+    static const int InlineCapacity = 4;
+
+    Element *elems;          // points to inlineElems until list outgrows it
+    int numElems, capacity;
+    bool frozen;             // elems is inline or an arena span
+    Element inlineElems[InlineCapacity];
+
+    bool IsInline() const
+	{ return elems == inlineElems; }
+
+    void Reserve(int needed)
+	{ if (needed <= capacity) return;
+	  Assert(!frozen);
+	  while (capacity < needed) capacity *= 2;
+	  Element *grown = new Element[capacity];
+	  for (int i = 0; i < numElems; i++) grown[i] = elems[i];
+	  Release();
+	  elems = grown; }
+
+    void Release()
+	{ if (!IsInline() && !frozen) delete[] elems; }
 
  public:
            // Create a new empty list
-    List() {}
+    List() : elems(inlineElems), numElems(0), capacity(InlineCapacity),
+             frozen(false) {}
+
+    List(const List &other)
+	: elems(inlineElems), numElems(0), capacity(InlineCapacity),
+	  frozen(false)
+	{ *this = other; }
+
+    List &operator=(const List &other)
+	{ if (this == &other) return *this;
+	  numElems = 0;
+	  Reserve(other.numElems);
+	  for (int i = 0; i < other.numElems; i++) elems[i] = other.elems[i];
+	  numElems = other.numElems;
+	  return *this; }
+
+    ~List()
+	{ Release(); }
 
            // Returns count of elements currently in list
     int NumElements() const
-	{ return elems.size(); }
+	{ return numElems; }
 
           // Returns element at index in list. Indexing is 0-based.
           // Raises an assert if index is out of range.
@@ -54,20 +104,55 @@ template<class Element> class List {
 	  return elems[index]; }
 
           // Inserts element at index, shuffling over others
-          // Raises assert if index out of range
+          // Raises assert if index out of range or the list is frozen
     void InsertAt(const Element &elem, int index)
-	{ Assert(index >= 0 && index <= NumElements());
-	  elems.insert(elems.begin() + index, elem); }
+	{ Assert(index >= 0 && index <= NumElements() && !frozen);
+	  Element copy = elem; // elem may live in the array Reserve frees
+	  Reserve(numElems + 1);
+	  for (int i = numElems; i > index; i--) elems[i] = elems[i-1];
+	  elems[index] = copy;
+	  numElems++; }
 
           // Adds element to list end
+          // Raises assert if the list is frozen
     void Append(const Element &elem)
-	{ elems.push_back(elem); }
+	{ Assert(!frozen);
+	  Element copy = elem;
+	  Reserve(numElems + 1);
+	  elems[numElems++] = copy; }
 
          // Removes element at index, shuffling down others
-         // Raises assert if index out of range
+         // Raises assert if index out of range. Allowed on a frozen
+         // list since it only shrinks the span in place.
     void RemoveAt(int index)
 	{ Assert(index >= 0 && index < NumElements());
-	  elems.erase(elems.begin() + index); }
+	  for (int i = index; i < numElems - 1; i++) elems[i] = elems[i+1];
+	  numElems--; }
+
+          // Makes the list immutable: its size can only shrink from here
+          // on. A list that outgrew the inline storage is moved into an
+          // exactly-sized arena span and its heap array is released. The
+          // elements are copied bitwise, so this is meant for lists of
+          // pointers, which is all the parse tree uses.
+    void Freeze()
+	{ if (frozen) return;
+	  if (!IsInline()) {
+	      Element *span = (Element *)ArenaAlloc(numElems * sizeof(Element));
+	      for (int i = 0; i < numElems; i++) span[i] = elems[i];
+	      delete[] elems;
+	      elems = span;
+	  }
+	  capacity = numElems;
+	  frozen = true; }
+
+    bool IsFrozen() const
+	{ return frozen; }
+
+          // Iteration support for range-based for loops
+    Element *begin()             { return elems; }
+    Element *end()               { return elems + numElems; }
+    const Element *begin() const { return elems; }
+    const Element *end() const   { return elems + numElems; }
           
        // These are some specific methods useful for lists of ast nodes
        // They will only work on lists of elements that respond to the
@@ -75,15 +160,15 @@ template<class Element> class List {
        // you can still have Lists of ints, chars*, as long as you 
        // don't try to SetParentAll on that list.
     void SetParentAll(Node *p)
-        { for (int i = 0; i < NumElements(); i++)
-             Nth(i)->SetParent(p); }
+        { for (Element elem : *this)
+             elem->SetParent(p); }
     void DeclareAll(Scope *s)
-        { for (int i = 0; i < NumElements(); i++)
-             s->Declare(Nth(i)); }
+        { for (Element elem : *this)
+             s->Declare(elem); }
 
    void CheckAll()
-        { for (int i = 0; i < NumElements(); i++)
-             Nth(i)->Check(); }
+        { for (Element elem : *this)
+             elem->Check(); }
 
 };
 
@@ -0,0 +1,39 @@
+/* File: liveness.cc
+ * -----------------
+ * Implementation of liveness analysis.
+ */
+
+#include "liveness.h"
+
+Liveness::Liveness(TacFunction *fn) {
+    int numTemps = fn->NumTemps(), numBlocks = fn->blocks.NumElements();
+
+    // Uses (before any definition) and definitions of each block
+    std::vector<TempSet> uses(numBlocks, TempSet(numTemps)), defs(uses);
+    liveIn = liveOut = uses;
+    for (int i = 0; i < numBlocks; i++) {
+        BasicBlock *b = fn->blocks.Nth(i);
+        for (Instr *instr = b->first; instr; instr = instr->next) {
+            instr->ForEachUse([&](int &t) { if (!defs[i].Contains(t)) uses[i].Add(t); });
+            if (instr->dst != NoTemp) defs[i].Add(instr->dst);
+        }
+    }
+    for (bool changed = true; changed; ) {
+        changed = false;
+        for (int i = numBlocks - 1; i >= 0; i--) {
+            for (BasicBlock *succ : fn->blocks.Nth(i)->succs)
+                liveOut[i].Union(liveIn[succ->id]);
+            TempSet in = liveOut[i];
+            in.Transfer(uses[i], defs[i]);
+            if (!(in == liveIn[i])) {
+                liveIn[i] = in;
+                changed = true;
+            }
+        }
+    }
+}
+
+void Liveness::StepBack(TempSet &live, Instr *instr) {
+    if (instr->dst != NoTemp) live.Remove(instr->dst);
+    instr->ForEachUse([&](int &t) { live.Add(t); });
+}
@@ -0,0 +1,66 @@
+/* File: liveness.h
+ * ----------------
+ * Liveness of the temporaries of a TacFunction, worked out per block
+ * with the usual backward dataflow. The register allocator (see
+ * regalloc.h) turns it into live intervals, and the bytecode compiler
+ * (see bytecode.h) into the stack maps the garbage collector finds
+ * references by.
+ */
+
+#ifndef _H_liveness
+#define _H_liveness
+
+#include <vector>
+#include "tac.h"
+
+
+/* Class: TempSet
+ * --------------
+ * A set of temporaries as a bit vector.
+ */
+class TempSet
+{
+  private:
+    std::vector<unsigned long> words;
+    static const int Bits = 8 * sizeof(unsigned long);
+
+  public:
+    TempSet(int numTemps = 0) : words((numTemps + Bits - 1) / Bits, 0) {}
+
+    bool Contains(int t) const { return (words[t / Bits] >> (t % Bits)) & 1; }
+    void Add(int t)            { words[t / Bits] |= 1UL << (t % Bits); }
+    void Remove(int t)         { words[t / Bits] &= ~(1UL << (t % Bits)); }
+
+    bool operator==(const TempSet &other) const { return words == other.words; }
+
+        // this = uses + (this - defs)
+    void Transfer(const TempSet &uses, const TempSet &defs) {
+        for (size_t i = 0; i < words.size(); i++)
+            words[i] = uses.words[i] | (words[i] & ~defs.words[i]);
+    }
+    void Union(const TempSet &other) {
+        for (size_t i = 0; i < words.size(); i++) words[i] |= other.words[i];
+    }
+    template <class F> void ForEach(F f) const {
+        for (size_t i = 0; i < words.size(); i++)
+            for (unsigned long w = words[i]; w; w &= w - 1)
+                f((int)(i * Bits + __builtin_ctzl(w)));
+    }
+};
+
+
+/* Struct: Liveness
+ * ----------------
+ * The temporaries live on entry to and on exit from each block, indexed
+ * by block id. The control flow graph must have been computed.
+ */
+struct Liveness {
+    std::vector<TempSet> liveIn, liveOut;
+
+    Liveness(TacFunction *fn);
+
+        // Steps live, the set live right after instr, back to before it
+    static void StepBack(TempSet &live, Instr *instr);
+};
+
+#endif
@@ -9,6 +9,144 @@
 #include "utility.h"
 #include "errors.h"
 #include "parser.h"
+#include "pushparser.h"
+#include "scanthread.h"
+#include "scanner.h"
+#include "ast_stmt.h"
+#include "astcache.h"
+#include "codegen.h"
+#include "passes.h"
+#include "bytecode.h"
+#include "vm.h"
+#include "x86.h"
+#include "server.h"
+#include "depgraph.h"
+#include "symindex.h"
+#include <string>
+#include <time.h>
+
+
+/* Function: ParseAndCheck()
+ * --------------------------
+ * Runs the parser, pushing it the tokens a batch at a time so it
+ * collects the global declarations as it goes (see pushparser.h), and,
+ * if it built a tree without scanner or syntax errors, the semantic
+ * checker on it. With --scan-thread, the tokens are scanned on a second
+ * thread (see scanthread.h). Returns the checked tree or NULL if
+ * anything was wrong. -d parse prints the wall-clock time parsing took,
+ * to compare the two.
+ */
+static const int TokenBatchSize = 256;
+
+static Program *ParseAndCheck()
+{
+    PushParser parser;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (GetOption("scan-thread"))
+        ParseOnScannerThread(&parser);
+    else {
+        Token batch[TokenBatchSize];
+        while (parser.Push(batch, ScanTokens(batch, TokenBatchSize)))
+            ;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    PrintDebug("parse", "scanned and parsed in %.3f ms",
+               (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6);
+    if (ReportError::NumErrors() > 0)
+        return NULL;
+    Program *program = parser.GetProgram();
+    if (!program)
+        return NULL;
+    program->Check();
+    return (ReportError::NumErrors() == 0 ? program : NULL);
+}
+
+static double MsecsSince(clock_t start)
+{
+    return (clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+}
+
+/* Function: CompileWithCache()
+ * ----------------------------
+ * Looks the source text up in the tree cache in dir (see astcache.h) and
+ * only scans, parses and checks it on a miss. The input has to be read
+ * up front to hash it, so on a miss the scanner is restarted on that
+ * copy, which is left in source and *hit set to false; main saves the
+ * tree once the whole compile is over without errors. Timings of both
+ * paths are printed with -d cache.
+ */
+static Program *CompileWithCache(const char *dir, std::string *source, bool *hit)
+{
+    char buf[8192];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), stdin)) > 0)
+        source->append(buf, n);
+
+    clock_t start = clock();
+    Program *program = LoadCachedProgram(dir, source->data(), source->size());
+    if ((*hit = (program != NULL))) {
+        PrintDebug("cache", "loaded cached tree in %.3f ms", MsecsSince(start));
+        return program;
+    }
+
+    start = clock();
+    if (!source->empty()) {
+        FILE *text = fmemopen((void *)source->data(), source->size(), "r");
+        if (!text) Failure("Cannot reread the input from memory");
+        yyrestart(text);
+    }
+    program = ParseAndCheck();
+    PrintDebug("cache", "parsed and checked in %.3f ms", MsecsSince(start));
+    return program;
+}
+
+
+/* Function: Run()
+ * ---------------
+ * Translates the lowered program into bytecode and runs it (--run).
+ * The source arrives on stdin, so the program reads its own input from
+ * the file given with --input=<file>; without one, ReadLine and
+ * ReadInteger see the end of input. -d bytecode prints the bytecode
+ * and -d run the time the program took; --nursery, --heap and
+ * --gc-stats size and report on its heap (see heap.h).
+ */
+static int Run(TacProgram *code)
+{
+    if (!code->main) {
+        ReportError::NoMainFound();
+        return -1;
+    }
+    BcProgram *bytecode = CompileBytecode(code);
+    if (IsDebugOn("bytecode"))
+        bytecode->Print(stdout);
+
+    FILE *input = NULL;
+    const char *inputName = GetOption("input");
+    if (inputName && *inputName && !(input = fopen(inputName, "r")))
+        Failure("Cannot open input file %s", inputName);
+    clock_t start = clock();
+    int status = RunProgram(bytecode, input);
+    PrintDebug("run", "ran in %.3f ms", MsecsSince(start));
+    if (input) fclose(input);
+    return status;
+}
+
+
+/* Function: EmitAssembly()
+ * ------------------------
+ * Writes the program as x86-64 assembly to stdout (--asm), to be
+ * linked with runtime.c.
+ */
+static int EmitAssembly(TacProgram *code)
+{
+    if (!code->main) {
+        ReportError::NoMainFound();
+        return -1;
+    }
+    EmitX86(code, stdout);
+    return 0;
+}
 
 
 /* Function: main()
@@ -16,16 +154,74 @@
  * Entry point to the entire program.  We parse the command line and turn
  * on any debugging flags requested by the user when invoking the program.
  * InitScanner() is used to set up the scanner.
- * InitParser() is used to set up the parser. The call to yyparse() will
- * attempt to parse a complete program from the input. 
+ * InitParser() is used to set up the parser. ParseAndCheck() will
+ * attempt to parse a complete program from the input, which is then
+ * checked. With --cache=<dir>, a program compiled before without errors
+ * is loaded from the tree cache instead. A program without errors is
+ * then lowered into three-address code and optimized by the passes of
+ * --passes=<list> or the default pipeline (see passes.h). -d tac prints
+ * the result; with
+ * --run it is executed as well, and with --asm compiled to assembly.
+ * With --server, dcc instead answers check requests on stdin until told
+ * to stop (see server.h). -d deps records the dependency graph of the
+ * declarations while the program is checked and generated, and prints
+ * it (see depgraph.h). --index=<file> writes the symbol index of the
+ * program, which --definition and --references then answer from
+ * without compiling anything (see symindex.h).
  */
 int main(int argc, char *argv[])
 {
     ParseCommandLine(argc, argv);
+    const char *indexPath = GetOption("index");
+    if (GetOption("definition") || GetOption("references"))
+        return QuerySymbolIndex(indexPath, GetOption("definition"), GetOption("references"), stdout);
   
     InitScanner();
     InitParser();
-    yyparse();
+    if (GetOption("server"))
+        return RunServer(stdin, stdout);
+    DependencyGraph deps;
+    if (IsDebugOn("deps"))
+        DependencyGraph::current = &deps;
+    SymbolIndex symbols;
+    if (indexPath)
+        SymbolIndex::current = &symbols;
+    // A program loaded from the cache is not checked, so what it
+    // declares and uses is never seen
+    const char *cacheDir = GetOption("cache");
+    bool useCache = cacheDir && *cacheDir && !indexPath, cacheHit = false;
+    std::string source;
+    Program *program = useCache ? CompileWithCache(cacheDir, &source, &cacheHit) : ParseAndCheck();
+    if (program) {
+        CodeGenerator cg;
+        program->Emit(&cg);
+        if (DependencyGraph::current) {
+            deps.Build(program->GetDecls());
+            deps.Print(stdout);
+            DependencyGraph::current = NULL;
+        }
+        if (SymbolIndex::current) {
+            if (!symbols.Write(indexPath))
+                Failure("Cannot write symbol index %s", indexPath);
+            SymbolIndex::current = NULL;
+        }
+        if (ReportError::NumErrors() == 0) {
+            const char *pipeline = GetOption("passes");
+            RunPasses(cg.GetCode(), pipeline ? pipeline : DefaultPipeline);
+        }
+        if (ReportError::NumErrors() == 0 && IsDebugOn("tac"))
+            cg.GetCode()->Print(stdout);
+        int status = 0;
+        if (ReportError::NumErrors() == 0 && GetOption("run"))
+            status = Run(cg.GetCode());
+        else if (ReportError::NumErrors() == 0 && GetOption("asm"))
+            status = EmitAssembly(cg.GetCode());
+        // A cache hit reports nothing, so only a compile that reported
+        // nothing either is saved
+        if (useCache && !cacheHit && ReportError::NumErrors() == 0)
+            SaveCachedProgram(cacheDir, source.data(), source.size(), program);
+        if (ReportError::NumErrors() == 0)
+            return status;
+    }
     return (ReportError::NumErrors() == 0? 0 : -1);
 }
-
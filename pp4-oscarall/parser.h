@@ -30,9 +30,12 @@
 
 #ifndef YYBISON                 
 #include "y.tab.h"              
+extern YYSTYPE yylval;      // The parser is pure, so y.tab.h leaves it out
 #endif
 
 int yyparse();              // Defined in the generated y.tab.c file
 void InitParser();          // Defined in parser.y
 
+extern Program *gProgram;   // Tree built by a successful yyparse()
+
 #endif
@@ -1,6 +1,11 @@
 /* File: parser.y
  * --------------
  * Yacc input file to generate the parser for the compiler.
+ *
+ * The parser is generated both ways: yyparse() pulls its tokens from
+ * yylex() until the end of the input, and PushParser (see pushparser.h)
+ * is given them in batches and hands over each top-level declaration
+ * as soon as it has been reduced.
  */
 
 %{
@@ -8,11 +13,17 @@
 #include "scanner.h" // for yylex
 #include "parser.h"
 #include "errors.h"
+#include "scope.h"
 
-void yyerror(char *msg); // standard error-handling routine
+void yyerror(yyltype *loc, const char *msg); // standard error-handling routine
+
+Program *gProgram = NULL;
 
 %}
 
+%define api.push-pull both
+%define api.pure full
+
  
 /* yylval 
  * ------
@@ -24,9 +35,57 @@ void yyerror(char *msg); // standard error-handling routine
     double doubleConstant;
     char identifier[MaxIdentLen+1]; // +1 for terminating null
     Decl *decl;
+    Type *type;
+    VarDecl *varDecl;
     List<Decl*> *declList;
+    Identifier *ident;
+    FnDecl *fnDecl;
+    List<VarDecl*> *formals;
+    StmtBlock *stmtBlock;
+    List<Stmt*> *stmtList;
+    LValue *lValue;
+    Expr *expr;
+    Stmt *stmt;
+    List<Expr*> *exprList;
+    Call *call;
+    ReturnStmt *returnStmt;
+    IfStmt *ifStmt;
+    PrintStmt *printStmt;
+    WhileStmt *whileStmt;
+    ForStmt *forStmt;
+    BreakStmt *breakStmt;
+    List<Case*> *caseList;
+    Case *cas;
+    Default *def;
+    SwitchStmt *switchStmt;
+    NamedType *namedType;
+    List<NamedType*> *implements;
+    ClassDecl *classDecl;
+    InterfaceDecl *interfaceDecl;
 }
 
+%{
+#include "pushparser.h" // after YYSTYPE, which Token holds
+
+/* yylval and yylloc
+ * -----------------
+ * The parser is pure, keeping the value and location of its lookahead
+ * to itself, so these two are only the scanner's: yylex leaves each
+ * token in them, and ScanTokens or the yylex below copies it out. That
+ * way the scanner may run on a thread of its own (see scanthread.h).
+ */
+YYSTYPE yylval;
+yyltype yylloc;
+
+static int yylex(YYSTYPE *value, yyltype *location)
+{
+   int token = yylex();
+   *value = yylval;
+   *location = yylloc;
+   return token;
+}
+%}
+
 
 /* Tokens
  * ------
@@ -34,20 +93,65 @@ void yyerror(char *msg); // standard error-handling routine
 %token   T_Void T_Bool T_Int T_Double T_String T_Class 
 %token   T_LessEqual T_GreaterEqual T_Equal T_NotEqual T_Dims
 %token   T_And T_Or T_Null T_Extends T_This T_Interface T_Implements
-%token   T_While T_For T_If T_Else T_Return T_Break
+%token   T_While T_For T_If T_Else T_Return T_Break T_Switch T_Case T_Default
 %token   T_New T_NewArray T_Print T_ReadInteger T_ReadLine
 
 %token   <identifier> T_Identifier
-%token   <stringConstant> T_StringConstant 
+%token   <stringConstant> T_StringConstant
 %token   <integerConstant> T_IntConstant
 %token   <doubleConstant> T_DoubleConstant
 %token   <boolConstant> T_BoolConstant
 
 
+%nonassoc ')'
+%nonassoc T_Else
+
+%nonassoc '='
+%left T_Or
+%left T_And
+%nonassoc T_Equal T_NotEqual
+%nonassoc T_GreaterEqual T_LessEqual '<' '>'
+%left '+' '-'
+%left '%' '*' '/'
+%left '!'
+%left '[' '.'
+%left '('
+
+
+
+
+
 /* Non-terminal types
  * ------------------
  */
-%type <declList>  DeclList 
+%type <declList>  DeclList Field FieldList PrototypeList Prototype
+%type <decl>      Decl Fields PrototypeDecl
+%type <varDecl>   VarDecl Variable
+%type <type>      Type Void
+%type <ident>     Ident
+%type <fnDecl>    FuncDecl
+%type <formals>   Formals VarList VarDeclList
+%type <stmtBlock> StmtBlock
+%type <stmtList>  StmtList
+%type <lValue>    LValue
+%type <expr>      Expr Constant OptExpr
+%type <stmt>      Stmt
+%type <exprList>  Actuals ExprList
+%type <call>      Call
+%type <returnStmt>ReturnStmt
+%type <ifStmt>    IfStmt
+%type <printStmt> PrintStmt
+%type <whileStmt> WhileStmt
+%type <forStmt>   ForStmt
+%type <breakStmt> BreakStmt
+%type <caseList>  CaseList
+%type <cas>       Case
+%type <def>       Default
+%type <switchStmt>SwitchStmt
+%type <namedType> Extends
+%type <implements>Implements IdenList
+%type <classDecl> ClassDecl
+%type <interfaceDecl>InterfaceDecl
 
 %%
 /* Rules
@@ -56,18 +160,212 @@ void yyerror(char *msg); // standard error-handling routine
  */
 Program   :    DeclList            { 
                                       @1; 
-                                      Program *program = new Program($1);
-                                      // if no errors, advance to next phase
-                                      if (ReportError::NumErrors() == 0) 
-                                          program->Check(); 
+                                      // main() runs the later phases on it
+                                      gProgram = new Program($1);
                                     }
           ;
 
-DeclList  :            { /* replace with your parser */ }
+DeclList  :    Decl                 { ($$ = new List<Decl*>)->Append($1);
+                                      if (PushParser::current) PushParser::current->Parsed($1); }
+          |    DeclList Decl        { ($$ = $1)->Append($2);
+                                      if (PushParser::current) PushParser::current->Parsed($2); }
+          ;
+
+Decl      :    VarDecl              { $$ = $1; }
+          |    FuncDecl             { $$ = $1; }
+          |    ClassDecl            { $$ = $1; }
+          |    InterfaceDecl        { $$ = $1; }
+          ;
+
+InterfaceDecl: T_Interface Ident '{' Prototype '}'  { $$ = new InterfaceDecl($2, $4); }
+          ;
+
+Prototype :    PrototypeList        { $$ = $1; }
+          |                         { $$ = new List<Decl*>; }
           ;
 
+PrototypeList: PrototypeDecl        { ($$ = new List<Decl*>)->Append($1); }
+          |    PrototypeList PrototypeDecl  { ($$ = $1)->Append($2); }
+          ;
 
+PrototypeDecl: Type Ident '(' Formals ')' ';' { $$ = new FnDecl($2, $1, $4); }
+          |    Void Ident '(' Formals ')' ';' { $$ = new FnDecl($2, $1, $4); }
+          ;
+
+ClassDecl :    T_Class Ident Extends Implements '{' Field '}'   { $$ = new ClassDecl($2, $3, $4, $6); }
+          ;
+
+Extends   :    T_Extends Ident      { $$ = new NamedType($2); }
+          |                         { $$ = NULL; }
+          ;
+
+Implements:    T_Implements IdenList    { $$ = $2; }
+          |                         { $$ = new List<NamedType*>; }
+          ;
 
+IdenList  :    Ident                { ($$ = new List<NamedType*>)->Append(new NamedType($1));}
+          |    IdenList ',' Ident   { ($$ = $1)->Append(new NamedType($3)); }
+          ;
+
+Field     :    FieldList            { $$ = $1; }
+          |                         { $$ = new List<Decl*>; }
+
+FieldList :    Fields               { ($$ = new List<Decl*>)->Append($1); }
+          |    FieldList Fields     { ($$ = $1)->Append($2); }
+
+Fields    :    VarDecl              { $$ = $1; }
+          |    FuncDecl             { $$ = $1; }
+          ;
+
+VarDecl   :    Variable ';'         { $$ = $1; };
+          ;
+
+Variable  :    Type Ident           { $$ = new VarDecl($2, $1); }
+          ;
+
+
+Type      :    T_Int                { $$ = Type::intType; }
+          |    T_Double             { $$ = Type::doubleType; }
+          |    T_Bool               { $$ = Type::boolType; }
+          |    T_String             { $$ = Type::stringType; }
+          |    Ident                { $$ = new NamedType($1); }
+          |    Type T_Dims          { $$ = new ArrayType(@$, $1); }
+          ;
+
+Ident     :    T_Identifier         { $$ = new Identifier(@1, $1);}
+          ;
+
+Void      :    T_Void               { $$ = Type::voidType; }
+          ;
+
+FuncDecl  :    Type Ident '(' Formals ')' StmtBlock { ($$ = new FnDecl($2, $1, $4))->SetFunctionBody($6); }
+          |    Void Ident '(' Formals ')' StmtBlock { ($$ = new FnDecl($2, $1, $4))->SetFunctionBody($6); }
+          ;
+
+Formals   :    VarList              { $$ = $1; }
+          |                         { $$ = new List<VarDecl*>; }
+          ;
+
+
+VarList   :    Variable             { ($$ = new List<VarDecl*>)->Append($1); }
+          |    VarList ',' Variable { ($$ = $1)->Append($3); }
+          ;
+
+
+VarDeclList:   VarDecl              { ($$ = new List<VarDecl*>)->Append($1); }
+           |   VarDeclList VarDecl     { ($$ = $1)->Append($2); }
+           ;
+
+StmtBlock :    '{' VarDeclList StmtList '}'  { $$ = new StmtBlock($2, $3); }
+          |    '{' VarDeclList '}'  { $$ = new StmtBlock($2, new List<Stmt*>); }
+          |    '{' StmtList '}'     { $$ = new StmtBlock(new List<VarDecl*>, $2); }
+          |    '{' '}'              { $$ = new StmtBlock(new List<VarDecl*>, new List<Stmt*>); }
+          ;
+
+StmtList  :    Stmt                 { ($$ = new List<Stmt*>)->Append($1); } 
+          |    StmtList Stmt        { ($$ = $1)->Append($2); }
+          ;
+
+Stmt      :    Expr ';'             { $$ = $1; }
+          |    ';'                  { $$ = new EmptyExpr; }
+          |    ReturnStmt           { $$ = $1; }
+          |    IfStmt               { $$ = $1; }
+          |    PrintStmt            { $$ = $1; }
+          |    WhileStmt            { $$ = $1; }
+          |    ForStmt              { $$ = $1; }
+          |    BreakStmt            { $$ = $1; }
+          |    SwitchStmt           { $$ = $1; }
+          |    StmtBlock            { $$ = $1; }
+          ;
+
+SwitchStmt:    T_Switch '(' Expr ')' '{' CaseList Default '}'   { $$ = new SwitchStmt($3, new CaseBlock($6), $7); }
+          |    T_Switch '(' Expr ')' '{' CaseList '}'   { $$ = new SwitchStmt($3, new CaseBlock($6), NULL); }
+          ;
+
+CaseList  :    Case                 { ($$ = new List<Case*>)->Append($1); }
+          |    CaseList Case        { ($$ = $1)->Append($2); }
+          ;
+
+Case      :    T_Case T_IntConstant ':' StmtList    { $$ = new Case(new IntConstant(@2, $2), $4); }
+          |    T_Case T_IntConstant ':'     { $$ = new Case(new IntConstant(@2, $2), new List<Stmt*>); }
+          ;
+
+Default   :    T_Default ':' StmtList   { $$ = new Default($3); }
+          |    T_Default ':'        { $$ = new Default(new List<Stmt*>); }
+          ;
+
+BreakStmt :    T_Break ';'          { $$ = new BreakStmt(@1); }
+
+ReturnStmt:    T_Return ';'         { $$ = new ReturnStmt(@1, new EmptyExpr); }
+          |    T_Return Expr ';'    { $$ = new ReturnStmt(@2, $2); }
+          ;
+
+WhileStmt :    T_While '(' Expr ')' Stmt    { $$ = new WhileStmt($3, $5); }
+          ;
+
+ForStmt   :    T_For '(' OptExpr ';' Expr ';' OptExpr ')' Stmt  { $$ = new ForStmt($3, $5, $7, $9); }
+          ;
+
+OptExpr   :    Expr                 { $$ = $1; }
+          |                         { $$ = new EmptyExpr; }
+
+IfStmt    :    T_If '(' Expr ')' Stmt           { $$ = new IfStmt($3, $5, NULL); }
+          |    T_If '(' Expr ')' Stmt T_Else Stmt   { $$ = new IfStmt($3, $5, $7); }
+          ;
+
+Expr      :    LValue '=' Expr      { $$ = new AssignExpr($1, new Operator(@2, "="), $3); }
+          |    Constant             { $$ = $1; }
+          |    LValue               { $$ = $1; }
+          |    T_This               { $$ = new This(@1); }
+          |    Call                 { $$ = $1; }
+          |    '(' Expr ')'         { $$ = $2; }
+          |    Expr T_Equal Expr    { $$ = new EqualityExpr($1, new Operator(@2, "=="), $3); }
+          |    Expr T_NotEqual Expr { $$ = new EqualityExpr($1, new Operator(@2, "!="), $3); }
+          |    Expr '+' Expr        { $$ = new ArithmeticExpr($1, new Operator(@2, "+"), $3); }
+          |    Expr '-' Expr        { $$ = new ArithmeticExpr($1, new Operator(@2, "-"), $3); }
+          |    Expr '*' Expr        { $$ = new ArithmeticExpr($1, new Operator(@2, "*"), $3); }
+          |    Expr '/' Expr        { $$ = new ArithmeticExpr($1, new Operator(@2, "/"), $3); }
+          |    Expr '%' Expr        { $$ = new ArithmeticExpr($1, new Operator(@2, "%"), $3); }
+          |    '-' Expr %prec '!'   { $$ = new ArithmeticExpr(new Operator(@1, "-"), $2); }
+          |    Expr '<' Expr        { $$ = new RelationalExpr($1, new Operator(@2, "<"), $3); }
+          |    Expr T_LessEqual Expr    { $$ = new RelationalExpr($1, new Operator(@2, "<="), $3); }
+          |    Expr '>' Expr        { $$ = new RelationalExpr($1, new Operator(@2, ">"), $3); }
+          |    Expr T_GreaterEqual Expr { $$ = new RelationalExpr($1, new Operator(@2, ">="), $3); }
+          |    Expr T_And Expr      { $$ = new LogicalExpr($1, new Operator(@2, "&&"), $3); }
+          |    Expr T_Or Expr       { $$ = new LogicalExpr($1, new Operator(@2, "||"), $3); }
+          |    '!' Expr             { $$ = new LogicalExpr(new Operator(@1, "!"), $2); }
+          |    T_ReadInteger '(' ')'    { $$ = new ReadIntegerExpr(@$); }
+          |    T_ReadLine '(' ')'   { $$ = new ReadLineExpr(@$); }
+          |    T_New '(' Ident ')'  { $$ = new NewExpr(@$, new NamedType($3)); }
+          |    T_NewArray '(' Expr ',' Type ')'  { $$ = new NewArrayExpr(@$, $3, $5); }
+          ;
+
+LValue    :    Ident                { $$ = new FieldAccess(NULL, $1); }
+          |    Expr '.' Ident       { $$ = new FieldAccess($1, $3); }
+          |    Expr '[' Expr ']'    { $$ = new ArrayAccess(@$, $1, $3); }
+          ;
+
+Constant  :    T_IntConstant        { $$ = new IntConstant(@1, $1); }
+          |    T_BoolConstant       { $$ = new BoolConstant(@1, $1); }
+          |    T_StringConstant     { $$ = new StringConstant(@1, $1); }
+          |    T_DoubleConstant     { $$ = new DoubleConstant(@1, $1); }
+          |    T_Null               { $$ = new NullConstant(@1); }
+          ;
+
+Call      :    Ident '(' Actuals ')'   { $$ = new Call(@$, NULL, $1, $3); }
+          |    Expr '.' Ident '(' Actuals ')'   { $$ = new Call(@$, $1, $3, $5); }
+          ;
+
+Actuals   :    ExprList             { $$ = $1; }
+          |                         { $$ = new List<Expr*>; }
+          ;
+
+PrintStmt :    T_Print '(' ExprList ')' ';' { $$ = new PrintStmt($3); } 
+          ;
+
+ExprList  :    Expr                 { ($$ = new List<Expr*>)->Append($1); }
+          |    ExprList ',' Expr    { ($$ = $1)->Append($3); }
+          ;
 %%
 
 
@@ -89,3 +387,75 @@ void InitParser()
    PrintDebug("parser", "Initializing parser");
    yydebug = false;
 }
+
+
+/* Function: ScanTokens
+ * --------------------
+ * Fills batch with up to max tokens from yylex(), each with its value
+ * and location, stopping after the end of the input (token 0). Returns
+ * how many it scanned.
+ */
+int ScanTokens(Token *batch, int max)
+{
+   int n = 0;
+   while (n < max) {
+      Token *t = &batch[n++];
+      t->type = yylex();
+      t->value = yylval;
+      t->location = yylloc;
+      if (t->type == 0) break;
+   }
+   return n;
+}
+
+
+/* PushParser
+ * ----------
+ * See pushparser.h. A global whose name is already taken is set aside
+ * and only declared, and so reported, once the parse has succeeded.
+ */
+PushParser *PushParser::current = NULL;
+
+PushParser::PushParser(std::function<void(Decl*)> whenParsed)
+  : status(YYPUSH_MORE), globals(new Scope()), onDecl(whenParsed)
+{
+   if (!(state = yypstate_new()))
+      Failure("Cannot allocate the parser state");
+   gProgram = NULL;
+}
+
+PushParser::~PushParser()
+{
+   yypstate_delete(state);
+}
+
+bool PushParser::Push(const Token *tokens, int n)
+{
+   current = this;
+   for (int i = 0; i < n && status == YYPUSH_MORE; i++) {
+      yyltype location = tokens[i].location;
+      status = yypush_parse(state, tokens[i].type, &tokens[i].value, &location);
+   }
+   current = NULL;
+   return status == YYPUSH_MORE;
+}
+
+void PushParser::Parsed(Decl *d)
+{
+   if (globals->Lookup(d->GetId()))
+      conflicting.Append(d);
+   else
+      globals->Declare(d);
+   if (onDecl) onDecl(d);
+}
+
+Program *PushParser::GetProgram()
+{
+   if (status != 0 || !gProgram) return NULL;
+   while (conflicting.NumElements() > 0) {
+      globals->Declare(conflicting.Nth(0));
+      conflicting.RemoveAt(0);
+   }
+   gProgram->UseScope(globals);
+   return gProgram;
+}
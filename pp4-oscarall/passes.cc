@@ -0,0 +1,93 @@
+/* File: passes.cc
+ * ---------------
+ * Implementation of the pass manager.
+ */
+
+#include "passes.h"
+#include "tac.h"
+#include "bce.h"
+#include "devirt.h"
+#include "inline.h"
+#include "fold.h"
+#include "ssa.h"
+#include "ssaopt.h"
+#include "utility.h"
+#include <string.h>
+#include <string>
+#include <time.h>
+
+const char *const DefaultPipeline = "devirt,inline,ssa,sccp,gvn,bce,dce,unssa,fold";
+
+typedef enum { Plain, SSA } Form;
+
+// A pass runs either over each function or, when it needs to see them
+// all, over the whole program
+struct Pass {
+    const char *name;
+    void (*run)(TacFunction *fn);
+    void (*runOnProgram)(TacProgram *code);
+    Form needs, leaves;
+};
+
+static const Pass Passes[] = {
+    { "devirt", NULL,               Devirtualize, Plain, Plain },
+    { "inline", NULL,               InlineCalls,  Plain, Plain },
+    { "fold",   FoldConstants,      NULL,         Plain, Plain },
+    { "ssa",    BuildSSA,           NULL,         Plain, SSA },
+    { "sccp",   PropagateConstants, NULL,         SSA,   SSA },
+    { "gvn",    NumberValues,       NULL,         SSA,   SSA },
+    { "bce",    EliminateBoundsChecks, NULL,      SSA,   SSA },
+    { "dce",    EliminateDeadCode,  NULL,         SSA,   SSA },
+    { "unssa",  LeaveSSA,           NULL,         SSA,   Plain },
+};
+static const int NumPasses = sizeof(Passes) / sizeof(Passes[0]);
+
+static const char *const FormNames[] = { "plain code", "SSA form" };
+
+static int CountInstructions(TacProgram *code) {
+    int n = 0;
+    for (TacFunction *fn : code->functions)
+        for (BasicBlock *b : fn->blocks)
+            for (Instr *instr = b->first; instr; instr = instr->next) n++;
+    return n;
+}
+
+void RunPasses(TacProgram *code, const char *pipeline) {
+    // Check the whole pipeline first, following the form the code is in
+    List<const Pass*> passes;
+    Form form = Plain;
+    for (const char *p = pipeline; *p; ) {
+        const char *end = strchr(p, ',');
+        std::string name = end ? std::string(p, end - p) : std::string(p);
+        p = end ? end + 1 : p + name.size();
+        if (name.empty()) continue;
+        const Pass *pass = NULL;
+        for (int i = 0; i < NumPasses && !pass; i++)
+            if (name == Passes[i].name) pass = &Passes[i];
+        if (!pass)
+            Failure("Unknown pass '%s' in --passes", name.c_str());
+        if (pass->needs != form)
+            Failure("Pass '%s' can't run on %s", pass->name, FormNames[form]);
+        form = pass->leaves;
+        passes.Append(pass);
+    }
+    if (form != Plain)
+        Failure("The pipeline in --passes leaves the code in SSA form; end it with unssa");
+
+    bool report = IsDebugOn("passes");
+    if (report) {
+        PrintDebug("passes", "%-6s %9s %7s", "pass", "ms", "instrs");
+        PrintDebug("passes", "%-6s %9s %7d", "-", "", CountInstructions(code));
+    }
+    for (const Pass *pass : passes) {
+        clock_t start = clock();
+        if (pass->runOnProgram)
+            pass->runOnProgram(code);
+        else
+            for (TacFunction *fn : code->functions)
+                pass->run(fn);
+        double msecs = (clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+        if (report)
+            PrintDebug("passes", "%-6s %9.3f %7d", pass->name, msecs, CountInstructions(code));
+    }
+}
@@ -0,0 +1,43 @@
+/* File: passes.h
+ * --------------
+ * The pass manager, which runs the optimization passes over the
+ * lowered program (see tac.h) before it is printed, run or emitted.
+ *
+ * A pipeline is a comma-separated list of pass names, given with
+ * --passes=<list>; --passes= with an empty list turns optimization
+ * off. Each pass runs over every function before the next starts. The
+ * passes are
+ *
+ *   devirt  devirtualization by class hierarchy analysis (devirt.h)
+ *   inline  inlining of direct calls (inline.h)
+ *   fold    constant folding and propagation on plain code (fold.h)
+ *   ssa     builds SSA form (ssa.h)
+ *   sccp    sparse conditional constant propagation (ssaopt.h)
+ *   gvn     dominator-based global value numbering (ssaopt.h)
+ *   bce     bounds check elimination (bce.h)
+ *   dce     dead code elimination (ssaopt.h)
+ *   unssa   takes SSA form apart again (ssa.h)
+ *
+ * sccp, gvn, bce and dce need SSA form and devirt, inline and fold need
+ * code that is not in it; a pipeline that runs a pass on the wrong form,
+ * or leaves the code in SSA form, is rejected before anything runs. -d passes prints how
+ * long each pass took and how many instructions were left after it.
+ */
+
+#ifndef _H_passes
+#define _H_passes
+
+struct TacProgram;
+
+// What runs when --passes is not given
+extern const char *const DefaultPipeline;
+
+
+/* Function: RunPasses()
+ * ---------------------
+ * Runs the passes of pipeline over code in order. Fails with a message
+ * if the pipeline names a pass that doesn't exist or is not valid.
+ */
+void RunPasses(TacProgram *code, const char *pipeline);
+
+#endif
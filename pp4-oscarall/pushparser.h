@@ -0,0 +1,58 @@
+/* File: pushparser.h
+ * -------------------
+ * The parser driven from outside: rather than pulling its tokens from
+ * yylex() as yyparse() does, it is handed them in batches, however they
+ * were scanned. Both are generated from parser.y.
+ */
+
+#ifndef _H_pushparser
+#define _H_pushparser
+
+#include "parser.h"
+#include <functional>
+
+// A token as the scanner produced it, to be handed to the parser later
+struct Token {
+    int type;                   // 0 at the end of the input
+    YYSTYPE value;
+    yyltype location;
+};
+
+int ScanTokens(Token *batch, int max);  // Defined in parser.y
+
+
+/* Class: PushParser
+ * -----------------
+ * Push gives the parser the next batch of tokens and returns false once
+ * the parse is over, that is after the end of the input or a syntax
+ * error. Each top-level declaration is declared in the global scope as
+ * soon as it has been reduced, and then passed to whenParsed, so the
+ * declarations are collected while the rest of the file is still being
+ * scanned. A declaration that conflicts with an earlier one is held back
+ * until GetProgram, so it is reported after the scanner and syntax errors
+ * as Program::Check would, and not at all if the parse fails. GetProgram
+ * returns the tree, already holding that scope, or NULL if the parse
+ * failed.
+ */
+class PushParser
+{
+  private:
+    struct yypstate *state;
+    int status;                 // YYPUSH_MORE until the parse is over
+    Scope *globals;
+    List<Decl*> conflicting;    // not declared yet, see GetProgram
+    std::function<void(Decl*)> onDecl;
+
+  public:
+        // The one being pushed tokens, for the actions of the grammar
+    static PushParser *current;
+
+    PushParser(std::function<void(Decl*)> whenParsed = nullptr);
+    ~PushParser();
+
+    bool Push(const Token *tokens, int n);
+    void Parsed(Decl *d);
+    Program *GetProgram();
+};
+
+#endif
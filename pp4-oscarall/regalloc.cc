@@ -0,0 +1,126 @@
+/* File: regalloc.cc
+ * -----------------
+ * Implementation of linear scan allocation.
+ */
+
+#include "regalloc.h"
+#include "liveness.h"
+#include <algorithm>
+#include <limits.h>
+#include <vector>
+
+RegisterClass ClassOfKind(ValueKind kind) {
+    return kind == V_Double ? RC_Double : RC_General;
+}
+
+
+struct Interval {
+    int temp, start, end;
+    bool crossesCall;
+};
+
+void AllocateRegisters(TacFunction *fn, RegisterPool pools[NumRegisterClasses],
+                       bool (*callsOut)(Instr *instr), Allocation *result) {
+    int numTemps = fn->NumTemps(), numBlocks = fn->blocks.NumElements();
+
+    Liveness liveness(fn);
+    std::vector<TempSet> &liveIn = liveness.liveIn, &liveOut = liveness.liveOut;
+
+    // One interval per temporary, covering every position where it is live
+    std::vector<Interval> intervals(numTemps);
+    for (int t = 0; t < numTemps; t++) {
+        Interval empty = { t, INT_MAX, -1, false };
+        intervals[t] = empty;
+    }
+    auto extend = [&](int t, int pos) {
+        intervals[t].start = std::min(intervals[t].start, pos);
+        intervals[t].end = std::max(intervals[t].end, pos);
+    };
+    for (int t = 0; t < fn->numParams; t++) extend(t, 0);
+    std::vector<int> calls;   // positions of instructions that call out
+    int pos = 1;
+    for (int i = 0; i < numBlocks; i++) {
+        BasicBlock *b = fn->blocks.Nth(i);
+        int first = pos;
+        for (Instr *instr = b->first; instr; instr = instr->next, pos++) {
+            instr->ForEachUse([&](int &t) { extend(t, pos); });
+            if (instr->dst != NoTemp) extend(instr->dst, pos);
+            if (callsOut(instr)) calls.push_back(pos);
+        }
+        liveIn[i].ForEach([&](int t) { extend(t, first); });
+        liveOut[i].ForEach([&](int t) { extend(t, pos - 1); });
+    }
+
+    std::vector<Interval*> byStart;
+    for (Interval &iv : intervals) {
+        if (iv.end < 0) continue;   // never live
+        std::vector<int>::iterator next = std::upper_bound(calls.begin(), calls.end(), iv.start);
+        iv.crossesCall = (next != calls.end() && *next < iv.end);
+        byStart.push_back(&iv);
+    }
+    std::stable_sort(byStart.begin(), byStart.end(),
+                     [](Interval *x, Interval *y) { return x->start < y->start; });
+
+    result->reg = List<int>();
+    result->slot = List<int>();
+    for (int t = 0; t < numTemps; t++) {
+        result->reg.Append(NoRegister);
+        result->slot.Append(NoRegister);
+    }
+    result->numSlots = 0;
+    int *regOf = result->reg.begin(), *slotOf = result->slot.begin();
+    auto spill = [&](Interval *iv) {
+        regOf[iv->temp] = NoRegister;
+        slotOf[iv->temp] = result->numSlots++;
+    };
+
+    // Active intervals, and which one holds each register of the pools
+    std::vector<Interval*> active;
+    std::vector<Interval*> holder;
+    for (int c = 0; c < NumRegisterClasses; c++)
+        for (int r : pools[c].regs)
+            if (r >= (int)holder.size()) holder.resize(r + 1, NULL);
+
+    for (Interval *cur : byStart) {
+        for (size_t i = 0; i < active.size(); ) {
+            if (active[i]->end < cur->start) {
+                holder[regOf[active[i]->temp]] = NULL;
+                active.erase(active.begin() + i);
+            } else {
+                i++;
+            }
+        }
+
+        RegisterPool &pool = pools[ClassOfKind(fn->tempKinds.Nth(cur->temp))];
+        int chosen = NoRegister;
+        for (int pass = (cur->crossesCall ? 1 : 0); pass < 2 && chosen == NoRegister; pass++)
+            for (int i = 0; i < pool.regs.NumElements(); i++)
+                if (pool.preserved.Nth(i) == (pass == 1) && !holder[pool.regs.Nth(i)]) {
+                    chosen = pool.regs.Nth(i);
+                    break;
+                }
+
+        if (chosen == NoRegister) {
+            // The interval that ends last gives up its register, if cur could use it
+            Interval *victim = NULL;
+            for (Interval *a : active) {
+                int r = regOf[a->temp];
+                int i = 0;
+                while (i < pool.regs.NumElements() && pool.regs.Nth(i) != r) i++;
+                if (i == pool.regs.NumElements()) continue;          // other class
+                if (cur->crossesCall && !pool.preserved.Nth(i)) continue;
+                if (!victim || a->end > victim->end) victim = a;
+            }
+            if (!victim || victim->end <= cur->end) {
+                spill(cur);
+                continue;
+            }
+            chosen = regOf[victim->temp];
+            spill(victim);
+            active.erase(std::find(active.begin(), active.end(), victim));
+        }
+        regOf[cur->temp] = chosen;
+        holder[chosen] = cur;
+        active.push_back(cur);
+    }
+}
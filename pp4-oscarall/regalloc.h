@@ -0,0 +1,73 @@
+/* File: regalloc.h
+ * ----------------
+ * Linear scan register allocation (Poletto and Sarkar) over the
+ * temporaries of a TacFunction, for the native code emitter (see
+ * x86.h).
+ *
+ * Instructions are numbered in the order the blocks are laid out,
+ * starting at 1; position 0 stands for the entry, where the parameters
+ * arrive. From the liveness of each block (see liveness.h) each
+ * temporary gets one live interval that runs from the first to the
+ * last position where it is live. The intervals are visited by start
+ * and each takes a free register of its class. When
+ * none is free, whichever of it and the intervals holding a register
+ * it could use ends last is spilled to a stack slot of its own.
+ *
+ * Registers are either preserved across calls or not. An interval that
+ * spans an instruction that calls out may only get a preserved one,
+ * since nothing is saved around calls; the others prefer registers
+ * that are not preserved, leaving the preserved ones for where they
+ * are needed.
+ */
+
+#ifndef _H_regalloc
+#define _H_regalloc
+
+#include "list.h"
+#include "tac.h"
+
+static const int NoRegister = -1;
+
+// Registers are grouped in two classes: for ints and references, and for doubles
+typedef enum { RC_General, RC_Double, NumRegisterClasses } RegisterClass;
+
+RegisterClass ClassOfKind(ValueKind kind);
+
+
+/* Struct: RegisterPool
+ * --------------------
+ * The registers of one class the allocator may hand out, in order of
+ * preference, and whether each survives calls.
+ */
+struct RegisterPool {
+    List<int> regs;
+    List<bool> preserved;
+
+    void Add(int reg, bool survivesCalls) { regs.Append(reg); preserved.Append(survivesCalls); }
+};
+
+
+/* Struct: Allocation
+ * ------------------
+ * Where each temporary lives: in reg, or else in spill slot slot.
+ * Temporaries that are never live have neither.
+ */
+struct Allocation {
+    List<int> reg;
+    List<int> slot;
+    int numSlots;
+
+    bool InRegister(int temp) { return reg.Nth(temp) != NoRegister; }
+    bool IsSpilled(int temp)  { return slot.Nth(temp) != NoRegister; }
+};
+
+
+/* Function: AllocateRegisters()
+ * -----------------------------
+ * Fills in result for fn. callsOut tells which instructions clobber
+ * the registers that are not preserved.
+ */
+void AllocateRegisters(TacFunction *fn, RegisterPool pools[NumRegisterClasses],
+                       bool (*callsOut)(Instr *instr), Allocation *result);
+
+#endif
@@ -0,0 +1,74 @@
+/* File: ring.h
+ * ------------
+ * A fixed-size ring buffer through which one thread hands items to
+ * another without taking a lock. Only the producer moves tail and only
+ * the consumer moves head: each publishes its own with a release store
+ * and reads the other's with an acquire load, so an item is completely
+ * written before the consumer can see it. Each side also keeps the last
+ * value it read of the other's position and only loads it again when
+ * the ring looks full (or empty), which keeps the two threads off each
+ * other's cache lines most of the time.
+ *
+ * Both sides work on runs of slots rather than single items:
+ *
+ *   Token *slots;
+ *   size_t n = ring.Writable(&slots);  // producer: fill up to n slots,
+ *   ring.Publish(filled);              // then hand them over
+ *
+ *   const Token *items;
+ *   size_t n = ring.Readable(&items);  // consumer: use up to n items,
+ *   ring.Release(used);                // then give the slots back
+ *
+ * A run stops at the end of the array, so a side may get fewer slots
+ * than are free and see the rest on its next call. The capacity must be
+ * a power of two.
+ */
+
+#ifndef _H_ring
+#define _H_ring
+
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+#include "utility.h"
+
+template<class Element> class Ring {
+  private:
+    std::vector<Element> slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head;   // next to read, moved by the consumer
+    size_t tailSeen;                        // the consumer's copy of tail
+    alignas(64) std::atomic<size_t> tail;   // next to write, moved by the producer
+    size_t headSeen;                        // the producer's copy of head
+
+  public:
+    Ring(size_t capacity) : slots(capacity), mask(capacity - 1),
+        head(0), tailSeen(0), tail(0), headSeen(0)
+        { Assert(capacity > 0 && (capacity & mask) == 0); }
+
+        // Producer: a run of free slots starting at *first
+    size_t Writable(Element **first) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - headSeen == slots.size())
+            headSeen = head.load(std::memory_order_acquire);
+        size_t free = slots.size() - (t - headSeen), toEnd = slots.size() - (t & mask);
+        *first = &slots[t & mask];
+        return free < toEnd ? free : toEnd;
+    }
+    void Publish(size_t n)
+        { tail.store(tail.load(std::memory_order_relaxed) + n, std::memory_order_release); }
+
+        // Consumer: a run of items starting at *first
+    size_t Readable(const Element **first) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tailSeen)
+            tailSeen = tail.load(std::memory_order_acquire);
+        size_t ready = tailSeen - h, toEnd = slots.size() - (h & mask);
+        *first = &slots[h & mask];
+        return ready < toEnd ? ready : toEnd;
+    }
+    void Release(size_t n)
+        { head.store(head.load(std::memory_order_relaxed) + n, std::memory_order_release); }
+};
+
+#endif
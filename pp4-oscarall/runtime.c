@@ -0,0 +1,148 @@
+/* File: runtime.c
+ * ---------------
+ * The runtime that programs compiled by dcc --asm are linked with (see
+ * x86.h). It is plain C and is not part of dcc itself:
+ *
+ *   dcc --asm < prog.decaf > prog.s && cc -o prog prog.s runtime.c
+ *
+ * It provides main, which calls the main function of the program, the
+ * built-in functions, allocation and the reporting of runtime errors,
+ * which print the same messages as dcc --run. Memory is not reclaimed
+ * while the program runs: the garbage collector of the VM (see heap.h)
+ * has no stack maps for native frames to go by.
+ */
+
+#define _GNU_SOURCE
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+void _D_main(void);
+
+// In the order of the codes the generated code passes to _DecafError
+static const char *const Messages[] = {
+    "Array subscript out of bounds",
+    "Division by zero",
+    "Array size is <= 0",
+    "Out of memory",
+};
+enum { BoundsError, DivisionError, SizeError, MemoryError };
+
+void _DecafError(int code) {
+    printf("Decaf runtime error: %s\n", Messages[code]);
+    fflush(stdout);
+    exit(1);
+}
+
+void _PrintInt(int value)         { printf("%d", value); }
+void _PrintBool(int value)        { fputs(value ? "true" : "false", stdout); }
+void _PrintString(const char *s)  { fputs(s, stdout); }
+
+// A line of standard input without its newline, or NULL at the end
+static char *ReadInputLine(void) {
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len = getline(&line, &size, stdin);
+    if (len < 0) {
+        free(line);
+        return NULL;
+    }
+    if (len > 0 && line[len-1] == '\n') line[--len] = '\0';
+    if (len > 0 && line[len-1] == '\r') line[--len] = '\0';
+    return line;
+}
+
+int _ReadInteger(void) {
+    char *line = ReadInputLine();
+    int value = line ? (int32_t)strtol(line, NULL, 10) : 0;
+    free(line);
+    return value;
+}
+
+// Strings are preceded by their length and hash, as in the VM (see
+// dstring.h); the hash is 32-bit FNV-1a, as HashString computes it
+struct StringHeader {
+    uint32_t length;
+    uint32_t hash;
+};
+
+static char *NewString(const char *s, size_t length) {
+    struct StringHeader *header = malloc(sizeof(struct StringHeader) + length + 1);
+    if (!header) _DecafError(MemoryError);
+    header->length = length;
+    header->hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        header->hash ^= (unsigned char)s[i];
+        header->hash *= 16777619u;
+    }
+    char *chars = (char *)(header + 1);
+    memcpy(chars, s, length);
+    chars[length] = '\0';
+    return chars;
+}
+
+char *_ReadLine(void) {
+    char *line = ReadInputLine();
+    char *s = NewString(line ? line : "", line ? strlen(line) : 0);
+    free(line);
+    return s;
+}
+
+int _StringEqual(const char *a, const char *b) {
+    if (a == b) return 1;
+    if (!a || !b) return 0;
+    const struct StringHeader *x = (const struct StringHeader *)a - 1;
+    const struct StringHeader *y = (const struct StringHeader *)b - 1;
+    return x->length == y->length && x->hash == y->hash && memcmp(a, b, x->length) == 0;
+}
+
+// An object of size bytes whose first word is its vtable
+void *_AllocObject(int size, void *vtable) {
+    void **object = calloc(1, size);
+    if (!object) _DecafError(MemoryError);
+    object[0] = vtable;
+    return object;
+}
+
+// An array is its length followed by its elements, all 8 bytes wide
+void *_AllocArray(int length) {
+    if (length < 1) _DecafError(SizeError);
+    int64_t *array = calloc(length + 1, 8);
+    if (!array) _DecafError(MemoryError);
+    array[0] = length;
+    return array;
+}
+
+// The generated code doesn't test for null, so dereferencing it faults;
+// so does overflowing the stack, which is why the handler runs on a
+// stack of its own
+static void Fault(int signal) {
+    (void)signal;
+    static const char message[] =
+        "Decaf runtime error: Null object dereferenced or stack overflow\n";
+    fflush(stdout);
+    if (write(STDOUT_FILENO, message, sizeof(message) - 1) < 0) _exit(2);
+    _exit(1);
+}
+
+int main(void) {
+    static char altStack[1 << 16];
+    stack_t ss;
+    ss.ss_sp = altStack;
+    ss.ss_size = sizeof(altStack);
+    ss.ss_flags = 0;
+    sigaltstack(&ss, NULL);
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = Fault;
+    action.sa_flags = SA_ONSTACK;
+    sigaction(SIGSEGV, &action, NULL);
+    sigaction(SIGBUS, &action, NULL);
+
+    _D_main();
+    fflush(stdout);
+    return 0;
+}
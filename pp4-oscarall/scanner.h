@@ -21,5 +21,7 @@ void yyrestart(FILE *fp); // ditto
 
 void InitScanner();                 // Defined in scanner.l user subroutines
 const char *GetLineNumbered(int n); // ditto
+void RestartScanner(FILE *fp, int firstLine, int firstColumn); // ditto
+int ColumnOf(const char *line, int n); // ditto
  
 #endif
@@ -0,0 +1,149 @@
+/* File: scanthread.cc
+ * -------------------
+ * Implementation of scanning on a thread of its own.
+ */
+
+#include "scanthread.h"
+#include "pushparser.h"
+#include "scanner.h"
+#include "ring.h"
+#include "utility.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+static const size_t RingSize = 4096;   // tokens
+static const size_t ScanBatch = 64;     // most tokens published at once
+static const int PushBatch = 256;       // tokens unpacked for the parser at once
+
+// A token as it goes through the ring: 16 bytes, where a Token takes
+// 72, as its value is kept once for each distinct lexeme in the pool
+struct PackedToken {
+    uint32_t line;
+    uint16_t firstColumn, lastColumn;   // columns past 65535 are clamped
+    uint32_t lexeme;                    // in the pool, for the kinds with a value
+    uint16_t kind;                      // 0 at the end of the input
+};
+
+/* Class: LexemePool
+ * -----------------
+ * The value of each distinct identifier and constant scanned. Only the
+ * scanner thread adds to it, into chunks that never move, and it does
+ * so before it publishes the first token of that lexeme, so the parser
+ * thread reads what the ring has made visible without a lock.
+ */
+class LexemePool
+{
+  private:
+    static const int ChunkBits = 12, ChunkSize = 1 << ChunkBits, MaxChunks = 1 << 12;
+    std::vector<YYSTYPE*> chunks;                    // MaxChunks, allocated as needed
+    uint32_t size;
+    std::unordered_map<std::string, uint32_t> index; // kind and text to lexeme
+    std::string key;                                 // reused, to look one up
+
+  public:
+    LexemePool() : chunks(MaxChunks, NULL), size(0) {}
+    ~LexemePool() { for (YYSTYPE *c : chunks) delete[] c; }
+
+    uint32_t Intern(int kind, const char *text, YYSTYPE *value);
+    const YYSTYPE &Nth(uint32_t i) const { return chunks[i >> ChunkBits][i & (ChunkSize - 1)]; }
+};
+
+// A string constant scanned again is given up for the pooled copy
+uint32_t LexemePool::Intern(int kind, const char *text, YYSTYPE *value)
+{
+    key.assign(1, (char)kind);
+    key += text;
+    auto found = index.find(key);
+    if (found != index.end()) {
+        if (kind == T_StringConstant) free(value->stringConstant);
+        return found->second;
+    }
+    if (size == (uint32_t)ChunkSize * MaxChunks)
+        Failure("More than %d distinct lexemes", ChunkSize * MaxChunks);
+    YYSTYPE *&chunk = chunks[size >> ChunkBits];
+    if (!chunk) chunk = new YYSTYPE[ChunkSize];
+    chunk[size & (ChunkSize - 1)] = *value;
+    index.emplace(key, size);
+    return size++;
+}
+
+static bool HasValue(int kind)
+{
+    return kind == T_Identifier || kind == T_StringConstant || kind == T_IntConstant
+        || kind == T_DoubleConstant || kind == T_BoolConstant;
+}
+
+static uint16_t Clamp(int column)
+{
+    return column > UINT16_MAX ? UINT16_MAX : column;
+}
+
+// Fills batch with up to max tokens from yylex(), as ScanTokens does
+static int ScanPacked(LexemePool *pool, PackedToken *batch, int max)
+{
+    int n = 0;
+    while (n < max) {
+        PackedToken *t = &batch[n++];
+        int kind = yylex();
+        t->kind = kind;
+        t->line = yylloc.first_line;
+        t->firstColumn = Clamp(yylloc.first_column);
+        t->lastColumn = Clamp(yylloc.last_column);
+        t->lexeme = HasValue(kind) ? pool->Intern(kind, yytext, &yylval) : 0;
+        if (kind == 0) break;
+    }
+    return n;
+}
+
+static void Unpack(const LexemePool &pool, const PackedToken &p, Token *t)
+{
+    static const YYSTYPE none = {};
+    t->type = p.kind;
+    t->value = HasValue(p.kind) ? pool.Nth(p.lexeme) : none;
+    t->location = yyltype();
+    t->location.first_line = t->location.last_line = p.line;
+    t->location.first_column = p.firstColumn;
+    t->location.last_column = p.lastColumn;
+}
+
+void ParseOnScannerThread(PushParser *parser)
+{
+    Ring<PackedToken> ring(RingSize);
+    LexemePool pool;
+    std::atomic<bool> parsed(false);   // tells the scanner to stop early
+    std::thread scanner([&]() {
+        while (!parsed.load(std::memory_order_relaxed)) {
+            PackedToken *slots;
+            size_t n = ring.Writable(&slots);
+            if (n == 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            int scanned = ScanPacked(&pool, slots, n < ScanBatch ? n : ScanBatch);
+            ring.Publish(scanned);
+            if (slots[scanned - 1].kind == 0) break;
+        }
+    });
+
+    Token batch[PushBatch];
+    for (bool more = true; more; ) {
+        const PackedToken *tokens;
+        size_t n = ring.Readable(&tokens);
+        if (n == 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (n > PushBatch) n = PushBatch;
+        for (size_t i = 0; i < n; i++)
+            Unpack(pool, tokens[i], &batch[i]);
+        ring.Release(n);
+        more = parser->Push(batch, n);
+    }
+    parsed.store(true, std::memory_order_relaxed);
+    scanner.join();
+}
@@ -0,0 +1,32 @@
+/* File: scanthread.h
+ * ------------------
+ * Scanning on a thread of its own (--scan-thread). Normally the parser
+ * is handed each batch of tokens right after it was scanned, on the
+ * same thread. Here the scanner runs ahead on a second thread, writing
+ * its tokens into a ring (see ring.h) that the parser reads them from,
+ * so a large file is scanned and parsed, and its declarations collected
+ * (see pushparser.h), at the same time. The tokens are packed into 16
+ * bytes for the ring, with the value of each identifier and constant
+ * kept once in a pool, and unpacked just before they are pushed. The
+ * overlap only pays off with a second CPU to run on. The parser being
+ * pure, yylval and yylloc belong to the scanner thread, and the lines
+ * the scanner saves and the errors it reports are guarded by locks of
+ * their own.
+ *
+ * As the scanner is ahead of the parser, a scanner error past a syntax
+ * error may be reported as well, or before it.
+ */
+
+#ifndef _H_scanthread
+#define _H_scanthread
+
+class PushParser;
+
+/* Function: ParseOnScannerThread()
+ * --------------------------------
+ * Gives parser the whole input, scanned on a second thread, and returns
+ * once the parse is over and the thread has finished.
+ */
+void ParseOnScannerThread(PushParser *parser);
+
+#endif
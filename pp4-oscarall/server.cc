@@ -0,0 +1,530 @@
+/* File: server.cc
+ * ---------------
+ * Implementation of dcc --server.
+ */
+
+#include "server.h"
+#include "parser.h"
+#include "scanner.h"
+#include "errors.h"
+#include "codegen.h"
+#include "utility.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+static double MsecsSince(clock_t start) {
+    return (clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+}
+
+
+/* JSON
+ * ----
+ * Requests are flat objects, so that is all the reader takes: member
+ * values that are objects or arrays are refused.
+ */
+
+struct JsonValue {
+    bool isString;
+    std::string text;    // decoded if a string, as written otherwise
+};
+
+class JsonReader
+{
+  private:
+    const std::string &s;
+    size_t pos;
+
+    void SkipSpace() { while (pos < s.size() && isspace((unsigned char)s[pos])) pos++; }
+    bool ReadHex(unsigned *code);
+    bool ReadString(std::string *out);
+    bool ReadValue(JsonValue *value);
+
+  public:
+    JsonReader(const std::string &text) : s(text), pos(0) {}
+    bool ReadObject(std::map<std::string, JsonValue> *members, std::string *why);
+};
+
+static void AppendUtf8(std::string *out, unsigned code) {
+    if (code < 0x80) {
+        *out += (char)code;
+    } else if (code < 0x800) {
+        *out += (char)(0xC0 | code >> 6);
+        *out += (char)(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        *out += (char)(0xE0 | code >> 12);
+        *out += (char)(0x80 | (code >> 6 & 0x3F));
+        *out += (char)(0x80 | (code & 0x3F));
+    } else {
+        *out += (char)(0xF0 | code >> 18);
+        *out += (char)(0x80 | (code >> 12 & 0x3F));
+        *out += (char)(0x80 | (code >> 6 & 0x3F));
+        *out += (char)(0x80 | (code & 0x3F));
+    }
+}
+
+bool JsonReader::ReadHex(unsigned *code) {
+    if (pos + 4 > s.size()) return false;
+    *code = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = s[pos++];
+        if (!isxdigit((unsigned char)c)) return false;
+        *code = *code * 16 + (isdigit((unsigned char)c) ? c - '0' : (tolower(c) - 'a' + 10));
+    }
+    return true;
+}
+
+bool JsonReader::ReadString(std::string *out) {
+    if (pos >= s.size() || s[pos] != '"') return false;
+    pos++;
+    while (pos < s.size() && s[pos] != '"') {
+        char c = s[pos++];
+        if (c != '\\') {
+            *out += c;
+            continue;
+        }
+        if (pos >= s.size()) return false;
+        switch (c = s[pos++]) {
+          case '"': case '\\': case '/': *out += c; break;
+          case 'b': *out += '\b'; break;
+          case 'f': *out += '\f'; break;
+          case 'n': *out += '\n'; break;
+          case 'r': *out += '\r'; break;
+          case 't': *out += '\t'; break;
+          case 'u': {
+            unsigned code, low;
+            if (!ReadHex(&code)) return false;
+            // A surrogate pair stands for one character past the first 64K
+            if (code >= 0xD800 && code < 0xDC00 && s.compare(pos, 2, "\\u") == 0) {
+                pos += 2;
+                if (!ReadHex(&low) || low < 0xDC00 || low >= 0xE000) return false;
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            }
+            AppendUtf8(out, code);
+            break;
+          }
+          default:
+            return false;
+        }
+    }
+    if (pos >= s.size()) return false;
+    pos++;
+    return true;
+}
+
+bool JsonReader::ReadValue(JsonValue *value) {
+    SkipSpace();
+    value->text.clear();
+    if ((value->isString = (pos < s.size() && s[pos] == '"')))
+        return ReadString(&value->text);
+    size_t start = pos;
+    while (pos < s.size() && (isalnum((unsigned char)s[pos]) || strchr("+-.", s[pos]))) pos++;
+    value->text = s.substr(start, pos - start);
+    if (value->text == "true" || value->text == "false" || value->text == "null") return true;
+    char *end;
+    strtod(value->text.c_str(), &end);
+    return !value->text.empty() && *end == '\0';
+}
+
+bool JsonReader::ReadObject(std::map<std::string, JsonValue> *members, std::string *why) {
+    SkipSpace();
+    if (pos >= s.size() || s[pos++] != '{') {
+        *why = "a request must be a JSON object";
+        return false;
+    }
+    SkipSpace();
+    if (pos < s.size() && s[pos] == '}') pos++;
+    else for (;;) {
+        std::string name;
+        JsonValue value;
+        SkipSpace();
+        if (!ReadString(&name)) break;
+        SkipSpace();
+        if (pos >= s.size() || s[pos++] != ':' || !ReadValue(&value)) break;
+        (*members)[name] = value;
+        SkipSpace();
+        if (pos < s.size() && s[pos] == ',') { pos++; continue; }
+        if (pos < s.size() && s[pos] == '}') { pos++; break; }
+        pos = s.size() + 1;
+        break;
+    }
+    SkipSpace();
+    if (pos != s.size()) {
+        *why = "malformed JSON";
+        return false;
+    }
+    return true;
+}
+
+static std::string Quote(const std::string &text) {
+    std::string out = "\"";
+    for (char c : text) {
+        switch (c) {
+          case '"':  out += "\\\""; break;
+          case '\\': out += "\\\\"; break;
+          case '\n': out += "\\n"; break;
+          case '\t': out += "\\t"; break;
+          case '\r': out += "\\r"; break;
+          default:
+            if ((unsigned char)c < ' ') {
+                char code[8];
+                sprintf(code, "\\u%04x", c);
+                out += code;
+            } else {
+                out += c;
+            }
+        }
+    }
+    return out + "\"";
+}
+
+
+/* Struct: TopLevel
+ * ----------------
+ * A top-level declaration of the source as the server keeps it. The
+ * text may also hold several declarations, or none that parse.
+ * Declarations go through the same stages as in a batch run, each one
+ * only once the whole program got through the one before, so a stage
+ * can be behind the others.
+ */
+typedef enum { Parsed, Checked, Generated, NumStages } Stage;
+
+struct TopLevel {
+    std::string text;
+    int firstLine, lastLine;
+    int firstColumn;                           // where it starts on firstLine
+    std::set<std::string> uses;                // every identifier in the text
+    List<Decl*> decls;                         // what the text parsed into
+    std::vector<yyltype*> locations;           // of all the nodes of decls
+    Stage stage;                               // the last one it went through
+    std::vector<Diagnostic> found[NumStages];  // the errors of each stage
+
+    bool Mentions(const std::set<std::string> &names) {
+        for (const std::string &name : uses)
+            if (names.count(name)) return true;
+        return false;
+    }
+    // Whether the error is in the text, as far as its position tells;
+    // the text that follows on its last line can hold it too
+    bool Holds(const Diagnostic &d) {
+        return (d.line > firstLine || (d.line == firstLine && d.firstColumn >= firstColumn))
+            && d.line <= lastLine;
+    }
+    void MoveTo(int line, int column);
+};
+
+// Only what is on its first line moves sideways
+void TopLevel::MoveTo(int line, int column) {
+    int delta = line - firstLine, shift = column - firstColumn;
+    if (delta == 0 && shift == 0) return;
+    for (yyltype *loc : locations) {
+        if (loc->first_line == firstLine) loc->first_column += shift;
+        if (loc->last_line == firstLine) loc->last_column += shift;
+        loc->first_line += delta;
+        loc->last_line += delta;
+    }
+    for (int s = 0; s < NumStages; s++)
+        for (Diagnostic &d : found[s]) {
+            if (d.line <= 0) continue;
+            if (d.line == firstLine) {
+                d.firstColumn += shift;
+                d.lastColumn += shift;
+            }
+            d.line += delta;
+        }
+    firstLine += delta;
+    lastLine += delta;
+    firstColumn = column;
+}
+
+// Skips a comment starting at i, if there is one, counting the lines it
+// spans
+static bool SkipComment(const std::string &source, size_t *i, int *line) {
+    if (source.compare(*i, 2, "//") == 0) {
+        while (*i < source.size() && source[*i] != '\n') (*i)++;
+        return true;
+    }
+    if (source.compare(*i, 2, "/*") != 0) return false;
+    size_t end = source.find("*/", *i + 2);
+    end = (end == std::string::npos) ? source.size() : end + 2;
+    *line += std::count(source.begin() + *i, source.begin() + end, '\n');
+    *i = end;
+    return true;
+}
+
+// Cuts the source after each semicolon outside braces and each brace
+// that closes the outermost one, leaving out what is between the
+// declarations
+static std::vector<TopLevel*> Split(const std::string &source) {
+    std::vector<TopLevel*> pieces;
+    size_t i = 0;
+    int line = 1;
+    for (;;) {
+        while (i < source.size()) {
+            if (source[i] == '\n') line++;
+            else if (SkipComment(source, &i, &line)) continue;
+            else if (!isspace((unsigned char)source[i])) break;
+            i++;
+        }
+        if (i >= source.size()) break;
+
+        TopLevel *t = new TopLevel;
+        t->firstLine = line;
+        size_t start = i, lineStart = source.rfind('\n', i);
+        lineStart = (lineStart == std::string::npos) ? 0 : lineStart + 1;
+        t->firstColumn = ColumnOf(source.data() + lineStart, i - lineStart);
+        int depth = 0;
+        bool done = false;
+        while (i < source.size() && !done) {
+            char c = source[i];
+            if (SkipComment(source, &i, &line)) continue;
+            if (isalpha((unsigned char)c)) {
+                size_t end = i;
+                while (end < source.size() && (isalnum((unsigned char)source[end]) || source[end] == '_')) end++;
+                t->uses.insert(source.substr(i, end - i));
+                i = end;
+                continue;
+            }
+            if (isdigit((unsigned char)c)) {   // so 0x1F names nothing
+                while (i < source.size() && (isalnum((unsigned char)source[i]) || source[i] == '.')) i++;
+                continue;
+            }
+            if (c == '"') {
+                do i++; while (i < source.size() && source[i] != '"' && source[i] != '\n');
+                if (i < source.size() && source[i] == '"') i++;
+                continue;
+            }
+            if (c == '\n') line++;
+            else if (c == '{') depth++;
+            else if (c == '}') done = (--depth <= 0);
+            else if (c == ';') done = (depth == 0);
+            i++;
+        }
+        t->text = source.substr(start, i - start);
+        t->lastLine = line;
+        pieces.push_back(t);
+    }
+    return pieces;
+}
+
+
+/* Class: Server
+ * -------------
+ * The declarations of the last source checked, in order.
+ */
+class Server
+{
+  private:
+    std::vector<TopLevel*> current;
+
+    void Parse(TopLevel *t);
+    template <class F> int Advance(Stage stage, F work, std::vector<Diagnostic> *global);
+    std::string Check(const std::string &source);
+
+  public:
+    std::string Handle(const std::string &request, bool *done);
+};
+
+void Server::Parse(TopLevel *t) {
+    t->decls = List<Decl*>();
+    t->locations.clear();
+    for (int s = 0; s < NumStages; s++) t->found[s].clear();
+    t->stage = Parsed;
+    FILE *text = fmemopen((void *)t->text.data(), t->text.size(), "r");
+    if (!text) Failure("Cannot read a declaration from memory");
+    RestartScanner(text, t->firstLine, t->firstColumn);
+    gProgram = NULL;
+    Node::locationLog = &t->locations;
+    ReportError::CaptureInto(&t->found[Parsed]);
+    yyparse();
+    ReportError::CaptureInto(NULL);
+    Node::locationLog = NULL;
+    fclose(text);
+    if (gProgram)
+        for (Decl *d : *gProgram->GetDecls()) t->decls.Append(d);
+}
+
+// Does work on the declarations that are a stage short of stage. An
+// error is kept with the declaration it is in, if that was one of them,
+// and goes into global otherwise. Returns how many top-level
+// declarations of the source that was, broken ones included.
+template <class F> int Server::Advance(Stage stage, F work, std::vector<Diagnostic> *global) {
+    std::vector<TopLevel*> behind;
+    std::vector<Diagnostic> found;
+    ReportError::CaptureInto(&found);
+    for (TopLevel *t : current) {
+        if (t->stage != stage - 1) continue;
+        for (Decl *d : t->decls) work(d);
+        t->stage = stage;
+        behind.push_back(t);
+    }
+    ReportError::CaptureInto(NULL);
+    for (const Diagnostic &d : found) {
+        TopLevel *owner = NULL;   // the last one it can be in
+        for (TopLevel *t : behind)
+            if (t->Holds(d)) owner = t;
+        (owner ? owner->found[stage] : *global).push_back(d);
+    }
+    return behind.size();
+}
+
+// Adds what t declares to names, and the classes and interfaces among
+// them to typeNames too
+static void AddNames(TopLevel *t, std::set<std::string> *names, std::set<std::string> *typeNames) {
+    for (Decl *d : t->decls) {
+        names->insert(d->GetName());
+        if (d->IsClassDecl() || d->IsInterfaceDecl()) typeNames->insert(d->GetName());
+    }
+}
+
+static bool NoErrors(const std::vector<TopLevel*> &pieces, Stage stage) {
+    for (TopLevel *t : pieces)
+        if (!t->found[stage].empty()) return false;
+    return true;
+}
+
+std::string Server::Check(const std::string &source) {
+    clock_t start = clock();
+    std::vector<TopLevel*> pieces = Split(source);
+    std::map<std::string, std::deque<TopLevel*> > previous;
+    for (TopLevel *t : current) previous[t->text].push_back(t);
+
+    // What is new is parsed, and what is the same is kept
+    std::set<std::string> changed, changedTypes;
+    std::vector<bool> parsed(pieces.size(), false);
+    int numParsed = 0, numChecked = 0, numGenerated = 0;
+    for (size_t i = 0; i < pieces.size(); i++) {
+        std::deque<TopLevel*> &same = previous[pieces[i]->text];
+        if (!same.empty()) {
+            same.front()->MoveTo(pieces[i]->firstLine, pieces[i]->firstColumn);
+            delete pieces[i];
+            pieces[i] = same.front();
+            same.pop_front();
+            continue;
+        }
+        Parse(pieces[i]);
+        numParsed++;
+        parsed[i] = true;
+        AddNames(pieces[i], &changed, &changedTypes);
+    }
+    for (auto &entry : previous)
+        for (TopLevel *gone : entry.second) {
+            AddNames(gone, &changed, &changedTypes);
+            delete gone;
+        }
+
+    // and so is what depends on none of it. Checking links a name in a
+    // tree only to the class or interface it names, so what mentions a
+    // changed one is parsed again, and then what mentions that. What
+    // mentions only other changed names has to be checked again, and
+    // as checking also leaves the scopes of its blocks in the tree, it
+    // is parsed again too.
+    for (bool grew = true; grew; ) {
+        grew = false;
+        for (size_t i = 0; i < pieces.size(); i++) {
+            if (parsed[i] || !pieces[i]->Mentions(changedTypes)) continue;
+            Parse(pieces[i]);
+            numParsed++;
+            parsed[i] = grew = true;
+            AddNames(pieces[i], &changed, &changedTypes);
+        }
+    }
+    for (size_t i = 0; i < pieces.size(); i++) {
+        if (parsed[i] || !pieces[i]->Mentions(changed)) continue;
+        Parse(pieces[i]);
+        numParsed++;
+    }
+    current = pieces;
+
+    // As in a batch run, a stage only starts if the one before found
+    // nothing wrong
+    List<Decl*> *decls = new List<Decl*>;
+    for (TopLevel *t : pieces)
+        for (Decl *d : t->decls) decls->Append(d);
+    std::vector<Diagnostic> global;
+    Stage last = Parsed;
+    if (NoErrors(pieces, Parsed)) {
+        last = Checked;
+        Program *program = new Program(decls);
+        ReportError::CaptureInto(&global);
+        program->PrepareScope();
+        numChecked = Advance(Checked, [](Decl *d) { d->Check(); }, &global);
+    }
+    if (last == Checked && global.empty() && NoErrors(pieces, Checked)) {
+        last = Generated;
+        CodeGenerator cg;
+        cg.LayoutDecls(decls);
+        numGenerated = Advance(Generated, [&cg](Decl *d) { d->Emit(&cg); }, &global);
+    }
+
+    std::vector<Diagnostic> errors;
+    for (TopLevel *t : pieces)
+        for (int s = 0; s <= last; s++)
+            errors.insert(errors.end(), t->found[s].begin(), t->found[s].end());
+    errors.insert(errors.end(), global.begin(), global.end());
+    std::stable_sort(errors.begin(), errors.end(), [](const Diagnostic &x, const Diagnostic &y) {
+        return x.line < y.line || (x.line == y.line && x.firstColumn < y.firstColumn);
+    });
+
+    std::string reply = "\"errors\": [";
+    for (size_t i = 0; i < errors.size(); i++) {
+        char position[96];
+        sprintf(position, "%s{\"line\": %d, \"column\": %d, \"endColumn\": %d, \"message\": ",
+                i ? ", " : "", errors[i].line, errors[i].firstColumn, errors[i].lastColumn);
+        reply += position + Quote(errors[i].message) + "}";
+    }
+    double msecs = MsecsSince(start);
+    char counts[160];
+    sprintf(counts, "], \"decls\": %d, \"parsed\": %d, \"checked\": %d, \"generated\": %d, \"msecs\": %.3f",
+            (int)pieces.size(), numParsed, numChecked, numGenerated, msecs);
+    // PrintDebug would write into the responses
+    if (IsDebugOn("server"))
+        fprintf(stderr, "server: %d declarations, %d parsed, %d checked, %d generated, %d errors in %.3f ms\n",
+                (int)pieces.size(), numParsed, numChecked, numGenerated, (int)errors.size(), msecs);
+    return reply + counts;
+}
+
+std::string Server::Handle(const std::string &request, bool *done) {
+    std::map<std::string, JsonValue> members;
+    std::string why, id = "null";
+    if (!JsonReader(request).ReadObject(&members, &why))
+        return "{\"id\": null, \"error\": " + Quote(why) + "}";
+    if (members.count("id"))
+        id = members["id"].isString ? Quote(members["id"].text) : members["id"].text;
+
+    const JsonValue &method = members["method"];
+    if (method.isString && method.text == "check") {
+        if (!members.count("text") || !members["text"].isString)
+            return "{\"id\": " + id + ", \"error\": \"check needs the text of the program\"}";
+        return "{\"id\": " + id + ", " + Check(members["text"].text) + "}";
+    }
+    if (method.isString && method.text == "shutdown") {
+        *done = true;
+        return "{\"id\": " + id + ", \"shutdown\": true}";
+    }
+    return "{\"id\": " + id + ", \"error\": " + Quote("unknown method " + method.text) + "}";
+}
+
+
+int RunServer(FILE *in, FILE *out) {
+    Server server;
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+    bool done = false;
+    while (!done && (len = getline(&line, &size, in)) >= 0) {
+        std::string request(line, len);
+        if (request.find_first_not_of(" \t\r\n") == std::string::npos) continue;
+        fprintf(out, "%s\n", server.Handle(request, &done).c_str());
+        fflush(out);
+    }
+    free(line);
+    return 0;
+}
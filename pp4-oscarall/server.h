@@ -0,0 +1,61 @@
+/* File: server.h
+ * --------------
+ * dcc --server: a long-lived checker for editors and CI, which keeps
+ * the checked tree of a program between requests and only does again
+ * the part of the work an edit calls for.
+ *
+ * It reads one request per line on stdin and writes one response per
+ * line on stdout, both JSON objects:
+ *
+ *   {"id": 1, "method": "check", "text": "<the whole source>"}
+ *   {"id": 1, "errors": [{"line": 3, "column": 5, "endColumn": 7,
+ *    "message": "..."}], "decls": 12, "parsed": 1, "checked": 1,
+ *    "generated": 3, "msecs": 0.21}
+ *
+ *   {"id": 2, "method": "shutdown"}
+ *   {"id": 2, "shutdown": true}
+ *
+ * errors are those a batch run would print, except that a syntax error
+ * does not hide those in the other declarations, sorted by line (0 for
+ * an error without a location); decls counts the top-level declarations
+ * in the text, those with a syntax error too, and parsed, checked and
+ * generated how many of them this request parsed, checked and generated
+ * code for; msecs is how long it took. A request that can't be handled gets
+ * {"id": ..., "error": "<why>"}. The server stops at the end of its
+ * input or after a shutdown.
+ *
+ * The source is split into its top-level declarations by a scan of
+ * the braces and semicolons outside comments and strings. One whose
+ * text is the same as in the previous request keeps its tree and the
+ * errors found in it, moved to its new place if it moved. Each of the
+ * others is parsed on its own, so a syntax error costs only that
+ * declaration. The names the new and removed declarations declare
+ * have changed. Checking leaves a link to the class or interface a
+ * type names in the tree, so a declaration that mentions a changed
+ * class or interface is parsed again, and so on; one that mentions
+ * only other changed names is parsed and checked again as well, since
+ * checking leaves the scopes of its blocks in the tree too. As in a batch run, declarations are only checked once the
+ * whole program parses, and code is only generated once it checks,
+ * each in a program rebuilt out of the current declarations. These
+ * are declared in a fresh global scope every time, so conflicts
+ * between them are always found again. Trees that are replaced are
+ * not freed, like every tree dcc builds.
+ *
+ * The line a conflict with an inherited member names is that of the
+ * last check of the subclass, which a base class that merely moved
+ * does not cause. -d server reports on stderr what each request did.
+ */
+
+#ifndef _H_server
+#define _H_server
+
+#include <stdio.h>
+
+/* Function: RunServer()
+ * ---------------------
+ * Answers requests from in on out until the end of in or a shutdown.
+ * Returns the exit status for dcc.
+ */
+int RunServer(FILE *in, FILE *out);
+
+#endif
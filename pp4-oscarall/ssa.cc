@@ -0,0 +1,325 @@
+/* File: ssa.cc
+ * ------------
+ * Implementation of dominators and of SSA construction and
+ * destruction.
+ */
+
+#include "ssa.h"
+#include "arena.h"
+#include "utility.h"
+#include <unordered_map>
+
+Dominators::Dominators(TacFunction *fn) {
+    int numBlocks = fn->blocks.NumElements();
+
+    // Reverse postorder by a depth-first walk with an explicit stack
+    std::vector<int> postorder, rpoNumber(numBlocks, -1);
+    std::vector<std::pair<BasicBlock*, int> > stack;
+    std::vector<bool> visited(numBlocks, false);
+    stack.push_back(std::make_pair(fn->blocks.Nth(0), 0));
+    visited[0] = true;
+    while (!stack.empty()) {
+        BasicBlock *b = stack.back().first;
+        int next = stack.back().second++;
+        if (next < b->succs.NumElements()) {
+            BasicBlock *succ = b->succs.Nth(next);
+            if (!visited[succ->id]) {
+                visited[succ->id] = true;
+                stack.push_back(std::make_pair(succ, 0));
+            }
+        } else {
+            postorder.push_back(b->id);
+            stack.pop_back();
+        }
+    }
+    for (int i = 0; i < (int)postorder.size(); i++)
+        rpoNumber[postorder[i]] = (int)postorder.size() - 1 - i;
+
+    idom.assign(numBlocks, -1);
+    idom[0] = 0;
+    auto intersect = [&](int x, int y) {
+        while (x != y) {
+            while (rpoNumber[x] > rpoNumber[y]) x = idom[x];
+            while (rpoNumber[y] > rpoNumber[x]) y = idom[y];
+        }
+        return x;
+    };
+    for (bool changed = true; changed; ) {
+        changed = false;
+        for (int i = (int)postorder.size() - 2; i >= 0; i--) {
+            BasicBlock *b = fn->blocks.Nth(postorder[i]);
+            int newIdom = -1;
+            for (BasicBlock *p : b->preds)
+                if (idom[p->id] != -1)
+                    newIdom = (newIdom == -1) ? p->id : intersect(p->id, newIdom);
+            if (idom[b->id] != newIdom) {
+                idom[b->id] = newIdom;
+                changed = true;
+            }
+        }
+    }
+
+    children.assign(numBlocks, std::vector<int>());
+    for (int b = 1; b < numBlocks; b++)
+        if (idom[b] != -1) children[idom[b]].push_back(b);
+    std::vector<int> todo(1, 0);
+    while (!todo.empty()) {
+        int b = todo.back();
+        todo.pop_back();
+        preorder.push_back(b);
+        for (int i = (int)children[b].size() - 1; i >= 0; i--)
+            todo.push_back(children[b][i]);
+    }
+
+    // A join is in the frontier of every block on the way up from each
+    // of its predecessors to its immediate dominator
+    frontier.assign(numBlocks, std::vector<int>());
+    for (BasicBlock *b : fn->blocks) {
+        if (b->preds.NumElements() < 2) continue;
+        for (BasicBlock *p : b->preds)
+            for (int runner = p->id; runner != idom[b->id]; runner = idom[runner]) {
+                std::vector<int> &df = frontier[runner];
+                if (df.empty() || df.back() != b->id) df.push_back(b->id);
+            }
+    }
+}
+
+bool Dominators::Dominates(int a, int b) const {
+    for (;;) {
+        if (a == b) return true;
+        if (b == 0) return false;
+        b = idom[b];
+    }
+}
+
+
+static Instr *NewPhi(int temp, int numArgs) {
+    Instr *phi = NewInstr(OP_Phi);
+    phi->dst = temp;
+    phi->intValue = temp;
+    phi->numArgs = numArgs;
+    phi->args = (int *)ArenaAlloc(numArgs * sizeof(int));
+    for (int i = 0; i < numArgs; i++) phi->args[i] = NoTemp;
+    return phi;
+}
+
+// The entry may not be the target of a branch, so the parameters
+// arrive in a block that needs no phis
+static void SeparateEntry(TacFunction *fn) {
+    BasicBlock *entry = fn->blocks.Nth(0);
+    if (entry->preds.NumElements() == 0) return;
+    BasicBlock *b = fn->NewBlock();
+    fn->blocks.RemoveAt(fn->blocks.NumElements() - 1);
+    fn->blocks.InsertAt(b, 0);
+    Instr *jump = NewInstr(OP_Jump);
+    jump->target[0] = entry;
+    b->Append(jump);
+    fn->ComputeEdges();
+}
+
+
+/* Class: Renamer
+ * --------------
+ * Gives every assignment of a temporary that needs it a new temporary,
+ * and every use the one that reaches it, walking the dominator tree.
+ */
+class Renamer
+{
+  private:
+    TacFunction *fn;
+    const Dominators &doms;
+    std::vector<bool> renamed;
+    std::vector<std::vector<int> > names;   // stack per original temporary
+    std::vector<int> undefined;             // zero of each temporary, if made
+
+    int Current(int temp);
+    void Define(int *temp, std::vector<int> *pushed);
+
+  public:
+    Renamer(TacFunction *f, const Dominators &d, const std::vector<bool> &r)
+      : fn(f), doms(d), renamed(r), names(r.size()), undefined(r.size(), NoTemp) {}
+    void Rename();
+};
+
+// The name of temp where it is read. One that no assignment reaches
+// can only be read by a phi on a path where its value doesn't matter,
+// and gets a zero loaded at the entry.
+int Renamer::Current(int temp) {
+    if (!renamed[temp]) return temp;
+    if (!names[temp].empty()) return names[temp].back();
+    if (undefined[temp] == NoTemp) {
+        ValueKind kind = fn->tempKinds.Nth(temp);
+        Instr *zero = NewInstr(kind == V_Int ? OP_LoadInt : kind == V_Double ? OP_LoadDouble : OP_LoadNull);
+        zero->dst = undefined[temp] = fn->NewTemp(kind);
+        BasicBlock *entry = fn->blocks.Nth(0);
+        entry->InsertBefore(zero, entry->first);
+    }
+    return undefined[temp];
+}
+
+void Renamer::Define(int *temp, std::vector<int> *pushed) {
+    if (!renamed[*temp]) return;
+    int original = *temp;
+    *temp = fn->NewTemp(fn->tempKinds.Nth(original));
+    names[original].push_back(*temp);
+    pushed->push_back(original);
+}
+
+void Renamer::Rename() {
+    for (int t = 0; t < fn->numParams; t++)
+        if (renamed[t]) names[t].push_back(t);
+
+    // Each block is visited on the way down the tree, and the names it
+    // pushed are popped on the way back up
+    std::vector<std::vector<int> > pushed(fn->blocks.NumElements());
+    std::vector<std::pair<int, bool> > stack(1, std::make_pair(0, false));
+    while (!stack.empty()) {
+        int id = stack.back().first;
+        bool leaving = stack.back().second;
+        stack.pop_back();
+        if (leaving) {
+            for (int original : pushed[id]) names[original].pop_back();
+            continue;
+        }
+        BasicBlock *b = fn->blocks.Nth(id);
+        std::vector<int> *mine = &pushed[id];
+        for (Instr *instr = b->first; instr; instr = instr->next) {
+            if (instr->op != OP_Phi)
+                instr->ForEachUse([&](int &t) { t = Current(t); });
+            if (instr->dst != NoTemp) Define(&instr->dst, mine);
+        }
+        for (BasicBlock *succ : b->succs)
+            for (int j = 0; j < succ->preds.NumElements(); j++)
+                if (succ->preds.Nth(j) == b)
+                    ForEachPhi(succ, [&](Instr *phi) { phi->args[j] = Current(phi->intValue); });
+
+        stack.push_back(std::make_pair(id, true));
+        for (int child : doms.children[id])
+            stack.push_back(std::make_pair(child, false));
+    }
+}
+
+void BuildSSA(TacFunction *fn) {
+    Assert(!fn->inSSA);
+    SeparateEntry(fn);
+    Dominators doms(fn);
+    int numTemps = fn->NumTemps(), numBlocks = fn->blocks.NumElements();
+
+    // Where each temporary is assigned, and which are read in some block
+    // before being assigned there
+    std::vector<std::vector<int> > defBlocks(numTemps);
+    std::vector<int> numDefs(numTemps, 0);
+    std::vector<bool> global(numTemps, false);
+    for (int t = 0; t < fn->numParams; t++) {
+        defBlocks[t].push_back(0);
+        numDefs[t]++;
+    }
+    for (BasicBlock *b : fn->blocks) {
+        std::vector<bool> assigned(numTemps, false);
+        for (Instr *instr = b->first; instr; instr = instr->next) {
+            instr->ForEachUse([&](int &t) { if (!assigned[t]) global[t] = true; });
+            if (instr->dst != NoTemp) {
+                int t = instr->dst;
+                if (defBlocks[t].empty() || defBlocks[t].back() != b->id)
+                    defBlocks[t].push_back(b->id);
+                numDefs[t]++;
+                assigned[t] = true;
+            }
+        }
+    }
+
+    std::vector<bool> renamed(numTemps, false);
+    std::vector<int> hasPhi(numBlocks, -1);   // last temporary given a phi in each block
+    for (int t = 0; t < numTemps; t++) {
+        renamed[t] = numDefs[t] > 1;
+        if (!global[t]) continue;
+        std::vector<int> work = defBlocks[t];
+        std::vector<bool> queued(numBlocks, false);
+        for (int b : work) queued[b] = true;
+        while (!work.empty()) {
+            int b = work.back();
+            work.pop_back();
+            for (int d : doms.frontier[b]) {
+                if (hasPhi[d] == t) continue;
+                hasPhi[d] = t;
+                renamed[t] = true;
+                BasicBlock *join = fn->blocks.Nth(d);
+                join->InsertBefore(NewPhi(t, join->preds.NumElements()), join->first);
+                if (!queued[d]) {
+                    queued[d] = true;
+                    work.push_back(d);
+                }
+            }
+        }
+    }
+
+    Renamer(fn, doms, renamed).Rename();
+    fn->inSSA = true;
+}
+
+
+void LeaveSSA(TacFunction *fn) {
+    Assert(fn->inSSA);
+    std::vector<int> uses(fn->NumTemps(), 0);
+    std::vector<Instr*> def(fn->NumTemps(), NULL);
+    std::unordered_map<Instr*, BasicBlock*> blockOf;
+    for (BasicBlock *b : fn->blocks)
+        for (Instr *instr = b->first; instr; instr = instr->next) {
+            instr->ForEachUse([&](int &t) { uses[t]++; });
+            if (instr->dst != NoTemp) def[instr->dst] = instr;
+            blockOf[instr] = b;
+        }
+
+    for (BasicBlock *b : fn->blocks)
+        ForEachPhi(b, [&](Instr *phi) {
+            int copy = fn->NewTemp(fn->tempKinds.Nth(phi->dst));
+            for (int j = 0; j < phi->numArgs; j++) {
+                BasicBlock *pred = b->preds.Nth(j);
+                int arg = phi->args[j];
+                // A value computed in the predecessor just for the phi can
+                // be computed into the copy, saving the move
+                Instr *d = def[arg];
+                if (d && d->op != OP_Phi && uses[arg] == 1 && blockOf[d] == pred) {
+                    d->dst = copy;
+                    continue;
+                }
+                Instr *move = NewInstr(OP_Move);
+                move->dst = copy;
+                move->a = arg;
+                // Ahead of the comparison that feeds a branch, if it doesn't
+                // compute the value copied, so the two stay together
+                Instr *before = pred->Terminator();
+                Instr *test = before->prev;
+                if (before->op == OP_Branch && test && test->dst == before->a && test->dst != arg)
+                    before = test;
+                pred->InsertBefore(move, before);
+            }
+            phi->op = OP_Move;
+            phi->a = copy;
+            phi->numArgs = 0;
+            phi->args = NULL;
+        });
+    fn->inSSA = false;
+}
+
+
+void UpdateEdges(TacFunction *fn) {
+    std::unordered_map<BasicBlock*, List<BasicBlock*> > oldPreds;
+    for (BasicBlock *b : fn->blocks)
+        if (b->first && b->first->op == OP_Phi) oldPreds[b] = b->preds;
+    fn->ComputeEdges();
+    for (BasicBlock *b : fn->blocks) {
+        if (!oldPreds.count(b)) continue;
+        List<BasicBlock*> &old = oldPreds[b];
+        ForEachPhi(b, [&](Instr *phi) {
+            int *args = (int *)ArenaAlloc(b->preds.NumElements() * sizeof(int));
+            for (int j = 0; j < b->preds.NumElements(); j++) {
+                int k = 0;
+                while (old.Nth(k) != b->preds.Nth(j)) k++;
+                args[j] = phi->args[k];
+            }
+            phi->args = args;
+            phi->numArgs = b->preds.NumElements();
+        });
+    }
+}
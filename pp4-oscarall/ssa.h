@@ -0,0 +1,80 @@
+/* File: ssa.h
+ * -----------
+ * Static single assignment form for the three-address code (see
+ * tac.h), on which the optimization passes of ssaopt.h work.
+ *
+ * In SSA form every temporary is assigned by exactly one instruction,
+ * or is a parameter, and that assignment dominates every use. Where
+ * the values of a temporary from different paths meet, an OP_Phi at the
+ * start of the block picks the one for the edge control came in on.
+ * TacFunction::inSSA says whether a function is in this form; the
+ * backends only take code that is not.
+ *
+ * BuildSSA works from the dominator tree of the control flow graph (by
+ * the iterative algorithm of Cooper, Harvey and Kennedy). Phis go on
+ * the iterated dominance frontier of the blocks that assign a
+ * temporary, but only for temporaries that some block reads before
+ * assigning them (semi-pruned SSA, after Briggs et al.); the rest are
+ * local to a block and need none. Renaming then walks the dominator
+ * tree with a stack of names per temporary. Temporaries assigned once
+ * keep their number.
+ *
+ * LeaveSSA replaces each phi by copies: every predecessor copies its
+ * argument to a fresh temporary before its branch, and the phi becomes
+ * a copy of that temporary. Since the fresh temporaries are read only
+ * where the phis were, this is right even when the passes have
+ * stretched the lives of the values (the lost copy and swap problems),
+ * and no edges need to be split.
+ */
+
+#ifndef _H_ssa
+#define _H_ssa
+
+#include <vector>
+#include "tac.h"
+
+
+/* Struct: Dominators
+ * ------------------
+ * The dominator tree and dominance frontiers of a function, indexed by
+ * block id. The entry is its own immediate dominator. preorder lists
+ * the blocks so that each comes after its dominators.
+ */
+struct Dominators {
+    std::vector<int> idom;
+    std::vector<std::vector<int> > children, frontier;
+    std::vector<int> preorder;
+
+    Dominators(TacFunction *fn);
+    bool Dominates(int a, int b) const;
+};
+
+
+/* Function: BuildSSA(), LeaveSSA()
+ * --------------------------------
+ * Put fn into SSA form and take it back out, as the ssa and unssa
+ * passes.
+ */
+void BuildSSA(TacFunction *fn);
+void LeaveSSA(TacFunction *fn);
+
+// The phis at the start of b, which come before anything else
+template <class F> void ForEachPhi(BasicBlock *b, F f) {
+    for (Instr *instr = b->first; instr && instr->op == OP_Phi; ) {
+        Instr *next = instr->next;   // f may remove instr
+        f(instr);
+        instr = next;
+    }
+}
+
+
+/* Function: UpdateEdges()
+ * -----------------------
+ * TacFunction::ComputeEdges for a function in SSA form: after branches
+ * have been changed, recomputes the edges and drops the blocks that
+ * can no longer be reached, keeping the arguments of each phi in step
+ * with the predecessors of its block.
+ */
+void UpdateEdges(TacFunction *fn);
+
+#endif
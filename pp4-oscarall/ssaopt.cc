@@ -0,0 +1,315 @@
+/* File: ssaopt.cc
+ * ---------------
+ * Implementation of the SSA optimization passes.
+ */
+
+#include "ssaopt.h"
+#include "ssa.h"
+#include "fold.h"
+#include "utility.h"
+#include <string.h>
+#include <unordered_map>
+#include <utility>
+
+// Which block each instruction is in, and which instructions read each
+// temporary
+static void FindUsers(TacFunction *fn, std::unordered_map<Instr*, BasicBlock*> *blockOf,
+                      std::vector<std::vector<Instr*> > *users) {
+    users->assign(fn->NumTemps(), std::vector<Instr*>());
+    for (BasicBlock *b : fn->blocks)
+        for (Instr *instr = b->first; instr; instr = instr->next) {
+            (*blockOf)[instr] = b;
+            instr->ForEachUse([&](int &t) { (*users)[t].push_back(instr); });
+        }
+}
+
+
+/* Sparse conditional constant propagation
+ * ---------------------------------------
+ */
+
+class ConstantPropagator
+{
+  private:
+    TacFunction *fn;
+    Env values;
+    std::unordered_map<Instr*, BasicBlock*> blockOf;
+    std::vector<std::vector<Instr*> > users;
+    std::vector<bool> reached;
+    std::vector<std::vector<bool> > taken;     // per block, per predecessor
+    std::vector<std::pair<BasicBlock*, BasicBlock*> > edges;
+    std::vector<Instr*> instrs;
+
+    void Set(int temp, const Constant &c);
+    void Take(BasicBlock *from, BasicBlock *to) { edges.push_back(std::make_pair(from, to)); }
+    void VisitPhi(Instr *phi, BasicBlock *b);
+    void Visit(Instr *instr, BasicBlock *b);
+    void Rewrite();
+
+  public:
+    ConstantPropagator(TacFunction *f) : fn(f) {}
+    void Propagate();
+};
+
+void ConstantPropagator::Set(int temp, const Constant &c) {
+    if (values[temp] == c) return;
+    values[temp] = c;
+    for (Instr *user : users[temp]) instrs.push_back(user);
+}
+
+void ConstantPropagator::VisitPhi(Instr *phi, BasicBlock *b) {
+    Constant c = Constant::Unknown(false);
+    for (int j = 0; j < phi->numArgs; j++)
+        if (taken[b->id][j]) c = Meet(c, values[phi->args[j]]);
+    Set(phi->dst, c);
+}
+
+void ConstantPropagator::Visit(Instr *instr, BasicBlock *b) {
+    if (instr->op == OP_Phi) {
+        VisitPhi(instr, b);
+    } else if (instr->op == OP_Jump) {
+        Take(b, instr->target[0]);
+    } else if (instr->op == OP_Branch) {
+        const Constant &test = values[instr->a];
+        if (test.state == Constant::Varying || (test.IsKnown() && test.i))
+            Take(b, instr->target[0]);
+        if (test.state == Constant::Varying || (test.IsKnown() && !test.i))
+            Take(b, instr->target[1]);
+    } else if (instr->op == OP_Switch) {
+        const Constant &value = values[instr->a];
+        if (value.IsKnown())
+            Take(b, instr->table->Lookup(value.i, instr->target[0]));
+        else if (value.state == Constant::Varying)
+            for (int i = 0; i < instr->NumTargets(); i++) Take(b, instr->Target(i));
+    } else if (instr->dst != NoTemp) {
+        Set(instr->dst, Evaluate(instr, values));
+    }
+}
+
+void ConstantPropagator::Propagate() {
+    values.assign(fn->NumTemps(), Constant::Unknown(false));
+    for (int t = 0; t < fn->numParams; t++) values[t] = Constant::Unknown(true);
+    FindUsers(fn, &blockOf, &users);
+    reached.assign(fn->blocks.NumElements(), false);
+    taken.resize(fn->blocks.NumElements());
+    for (BasicBlock *b : fn->blocks) taken[b->id].assign(b->preds.NumElements(), false);
+
+    Take(NULL, fn->blocks.Nth(0));
+    while (!edges.empty() || !instrs.empty()) {
+        if (!edges.empty()) {
+            BasicBlock *from = edges.back().first, *to = edges.back().second;
+            edges.pop_back();
+            bool isNew = (from == NULL);
+            for (int j = 0; j < to->preds.NumElements(); j++)
+                if (to->preds.Nth(j) == from && !taken[to->id][j]) {
+                    taken[to->id][j] = true;
+                    isNew = true;
+                }
+            if (!isNew) continue;
+            if (!reached[to->id]) {
+                reached[to->id] = true;
+                for (Instr *instr = to->first; instr; instr = instr->next) Visit(instr, to);
+            } else {
+                ForEachPhi(to, [&](Instr *phi) { VisitPhi(phi, to); });
+            }
+        } else {
+            Instr *instr = instrs.back();
+            instrs.pop_back();
+            BasicBlock *b = blockOf[instr];
+            if (reached[b->id]) Visit(instr, b);
+        }
+    }
+    Rewrite();
+}
+
+void ConstantPropagator::Rewrite() {
+    int folded = 0, pruned = 0;
+    for (BasicBlock *b : fn->blocks) {
+        if (!reached[b->id]) continue;
+        Instr *afterPhis = b->first;
+        while (afterPhis && afterPhis->op == OP_Phi) afterPhis = afterPhis->next;
+        for (Instr *instr = b->first; instr; ) {
+            Instr *next = instr->next;
+            bool isPhi = (instr->op == OP_Phi);
+            // Loads of constants (the first opcodes) are left as they are
+            if (instr->dst != NoTemp && values[instr->dst].IsKnown()
+                && (isPhi || (instr->IsComputation() && instr->op >= OP_Move))) {
+                MakeLoad(instr, values[instr->dst]);
+                folded++;
+                if (isPhi) {   // no longer a phi, so it goes after them
+                    b->Remove(instr);
+                    b->InsertBefore(instr, afterPhis);
+                }
+            } else if (instr->op == OP_Branch && values[instr->a].IsKnown()) {
+                instr->target[0] = instr->target[values[instr->a].i ? 0 : 1];
+                instr->op = OP_Jump;
+                instr->a = NoTemp;
+                pruned++;
+            } else if (instr->op == OP_Switch && values[instr->a].IsKnown()) {
+                instr->target[0] = instr->table->Lookup(values[instr->a].i, instr->target[0]);
+                instr->op = OP_Jump;
+                instr->a = NoTemp;
+                pruned++;
+            }
+            instr = next;
+        }
+    }
+    UpdateEdges(fn);
+    PrintDebug("sccp", "%s: %d instructions folded, %d branches pruned", fn->name, folded, pruned);
+}
+
+void PropagateConstants(TacFunction *fn) {
+    Assert(fn->inSSA);
+    ConstantPropagator(fn).Propagate();
+}
+
+
+/* Value numbering
+ * ---------------
+ */
+
+// What a computation is made of, its operands by value number
+struct Expression {
+    int op, a, b;
+    int64_t constant;
+
+    bool operator==(const Expression &o) const
+        { return op == o.op && a == o.a && b == o.b && constant == o.constant; }
+};
+
+struct ExpressionHash {
+    size_t operator()(const Expression &e) const {
+        size_t h = e.op;
+        h = h * 1000003 + e.a;
+        h = h * 1000003 + e.b;
+        return h * 1000003 + (size_t)e.constant;
+    }
+};
+
+static bool IsCommutative(Opcode op) {
+    switch (op) {
+      case OP_Add: case OP_Mul: case OP_Eq: case OP_Ne:
+      case OP_FAdd: case OP_FMul: case OP_FEq: case OP_FNe:
+      case OP_StrEq: case OP_StrNe:
+        return true;
+      default:
+        return false;
+    }
+}
+
+void NumberValues(TacFunction *fn) {
+    Assert(fn->inSSA);
+    Dominators doms(fn);
+    std::vector<int> number(fn->NumTemps());
+    for (int t = 0; t < fn->NumTemps(); t++) number[t] = t;
+    auto find = [&](int t) {
+        while (number[t] != t) t = number[t] = number[number[t]];
+        return t;
+    };
+
+    // The table only holds the computations of the blocks on the path
+    // from the entry to the one being visited, so entries are taken out
+    // again on the way back up the dominator tree
+    std::unordered_map<Expression, int, ExpressionHash> table;
+    std::vector<std::vector<Expression> > added(fn->blocks.NumElements());
+    std::vector<std::pair<int, bool> > stack(1, std::make_pair(0, false));
+    int removed = 0;
+    while (!stack.empty()) {
+        int id = stack.back().first;
+        bool leaving = stack.back().second;
+        stack.pop_back();
+        if (leaving) {
+            for (const Expression &e : added[id]) table.erase(e);
+            continue;
+        }
+        BasicBlock *b = fn->blocks.Nth(id);
+        for (Instr *instr = b->first; instr; ) {
+            Instr *next = instr->next;
+            int same = NoTemp;
+            if (instr->op == OP_Phi) {
+                // Arguments on back edges haven't been visited, so this only
+                // finds the phis that are redundant on the face of it
+                for (int j = 0; j < instr->numArgs && same != -2; j++) {
+                    int arg = find(instr->args[j]);
+                    if (arg == instr->dst) continue;
+                    same = (same == NoTemp || same == arg) ? arg : -2;
+                }
+                if (same < 0) same = NoTemp;
+            } else {
+                instr->ForEachUse([&](int &t) { t = find(t); });
+                if (instr->op == OP_Move) {
+                    same = instr->a;
+                } else if (instr->IsComputation() && instr->op != OP_LoadString) {
+                    Expression e = { instr->op, instr->a, instr->b, 0 };
+                    if (instr->op == OP_LoadInt) e.constant = instr->intValue;
+                    if (instr->op == OP_LoadDouble) memcpy(&e.constant, &instr->doubleValue, sizeof(double));
+                    if (IsCommutative(instr->op) && e.a > e.b) std::swap(e.a, e.b);
+                    std::unordered_map<Expression, int, ExpressionHash>::iterator it = table.find(e);
+                    if (it != table.end()) {
+                        same = it->second;
+                    } else {
+                        table[e] = instr->dst;
+                        added[id].push_back(e);
+                    }
+                }
+            }
+            if (same != NoTemp) {
+                number[instr->dst] = same;
+                b->Remove(instr);
+                removed++;
+            }
+            instr = next;
+        }
+        stack.push_back(std::make_pair(id, true));
+        for (int child : doms.children[id])
+            stack.push_back(std::make_pair(child, false));
+    }
+
+    for (BasicBlock *b : fn->blocks)
+        for (Instr *instr = b->first; instr; instr = instr->next)
+            instr->ForEachUse([&](int &t) { t = find(t); });
+    PrintDebug("gvn", "%s: %d instructions removed", fn->name, removed);
+}
+
+
+/* Dead code elimination
+ * ---------------------
+ */
+
+void EliminateDeadCode(TacFunction *fn) {
+    Assert(fn->inSSA);
+    std::vector<Instr*> def(fn->NumTemps(), NULL);
+    std::vector<Instr*> work;
+    std::unordered_map<Instr*, bool> live;
+    for (BasicBlock *b : fn->blocks)
+        for (Instr *instr = b->first; instr; instr = instr->next) {
+            if (instr->dst != NoTemp) def[instr->dst] = instr;
+            if (!instr->IsRemovable() || instr->dst == NoTemp) {
+                live[instr] = true;
+                work.push_back(instr);
+            }
+        }
+    while (!work.empty()) {
+        Instr *instr = work.back();
+        work.pop_back();
+        instr->ForEachUse([&](int &t) {
+            Instr *d = def[t];
+            if (d && !live[d]) {
+                live[d] = true;
+                work.push_back(d);
+            }
+        });
+    }
+
+    int removed = 0;
+    for (BasicBlock *b : fn->blocks)
+        for (Instr *instr = b->first; instr; ) {
+            Instr *next = instr->next;
+            if (!live[instr]) {
+                b->Remove(instr);
+                removed++;
+            }
+            instr = next;
+        }
+    PrintDebug("dce", "%s: %d instructions removed", fn->name, removed);
+}
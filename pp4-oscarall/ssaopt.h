@@ -0,0 +1,38 @@
+/* File: ssaopt.h
+ * --------------
+ * The optimization passes that work on SSA form (see ssa.h).
+ *
+ * PropagateConstants (sccp) is sparse conditional constant propagation
+ * (Wegman and Zadeck). It keeps the lattice of fold.h for each
+ * temporary and visits an instruction again only when one of its
+ * operands changes, and a block only once an edge into it is found to
+ * be taken. Like the fold pass it folds what turns out to be constant
+ * and prunes the branches that are never taken, but since it works on
+ * the SSA values rather than on a state per block, it is both faster
+ * and finds constants the fold pass can't, such as a loop variable
+ * that keeps its initial value.
+ *
+ * NumberValues (gvn) is dominator-based value numbering (Briggs,
+ * Cooper and Simpson). Walking the dominator tree, each computation is
+ * looked up in a table of those that dominate it; one computing the
+ * same operation on the same values is removed and its uses take the
+ * earlier result. Copies are propagated the same way, and a phi whose
+ * arguments are all the same value is replaced by it.
+ *
+ * EliminateDeadCode (dce) marks the instructions that have effects
+ * (stores, calls, branches, anything that can stop the program) and,
+ * transitively, those that compute their operands, and removes the
+ * rest. Unlike the clean-up of the fold pass, this also removes values
+ * that only feed themselves around a loop.
+ */
+
+#ifndef _H_ssaopt
+#define _H_ssaopt
+
+struct TacFunction;
+
+void PropagateConstants(TacFunction *fn);
+void NumberValues(TacFunction *fn);
+void EliminateDeadCode(TacFunction *fn);
+
+#endif
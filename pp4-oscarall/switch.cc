@@ -0,0 +1,194 @@
+/* File: switch.cc
+ * ---------------
+ * Implementation of switch lowering.
+ */
+
+#include "switch.h"
+#include "codegen.h"
+#include "utility.h"
+#include <algorithm>
+#include <vector>
+
+static const int MinTableCases = 4;
+static const int MinDensity = 40;        // percent of the range with a case
+static const int MinHashCases = 32;
+static const int MaxPerBucket = 2;
+
+// Whether count cases from low to high are worth a jump table
+static bool IsDense(int64_t count, int64_t low, int64_t high) {
+    return count * 100 >= MinDensity * (high - low + 1);
+}
+
+// Where a value lands in a hash table of size buckets, as OP_Mod computes it
+static int BucketOf(int value, int buckets) {
+    return value % buckets;
+}
+
+
+/* Class: SwitchLowering
+ * ---------------------
+ * The cases are sorted by value, and a cluster is a run of them that is
+ * dispatched as a whole: a single case, or a dense run behind a table.
+ */
+class SwitchLowering
+{
+  private:
+    struct Cluster { int first, count; bool isTable; };
+
+    CodeGenerator *cg;
+    int value;
+    std::vector<SwitchCase> cases;
+    BasicBlock *otherwise;
+    std::vector<Cluster> clusters;
+
+    void FindClusters();
+    int PickHashSize(int *worst);
+    void EmitCompare(const SwitchCase &c);
+    void EmitTable(const Cluster &cluster);
+    void EmitTree(int lo, int hi);
+    void EmitHashed(int buckets);
+
+  public:
+    SwitchLowering(CodeGenerator *g, int v, List<SwitchCase> *c, BasicBlock *o)
+      : cg(g), value(v), cases(c->begin(), c->end()), otherwise(o) {}
+    void Lower();
+};
+
+// Each cluster starts at the first case not yet taken and runs to the
+// last case that keeps it dense, if that makes it long enough for a table
+void SwitchLowering::FindClusters() {
+    int n = cases.size();
+    for (int i = 0; i < n; ) {
+        int last = i;
+        for (int j = i + MinTableCases - 1; j < n; j++)
+            if (IsDense(j - i + 1, cases[i].value, cases[j].value)) last = j;
+        Cluster c = { i, last - i + 1, last - i + 1 >= MinTableCases };
+        if (!c.isTable) c.count = 1;
+        clusters.push_back(c);
+        i += c.count;
+    }
+}
+
+// The smallest table size from the number of cases up to four times that
+// which puts the fewest cases in one bucket, or 0 if none gets that down
+// to MaxPerBucket
+int SwitchLowering::PickHashSize(int *worst) {
+    int n = cases.size(), best = 0;
+    *worst = MaxPerBucket + 1;
+    std::vector<int> count;
+    for (int size = n; size <= 4 * n && *worst > 1; size++) {
+        count.assign(2 * size - 1, 0);   // remainders of negative values too
+        int most = 0;
+        for (const SwitchCase &c : cases)
+            most = std::max(most, ++count[BucketOf(c.value, size) + size - 1]);
+        if (most < *worst) {
+            *worst = most;
+            best = size;
+        }
+    }
+    return best;
+}
+
+void SwitchLowering::EmitCompare(const SwitchCase &c) {
+    int test = cg->GenBinary(OP_Eq, value, cg->GenLoadInt(c.value));
+    cg->GenBranch(test, c.target, otherwise);
+}
+
+void SwitchLowering::EmitTable(const Cluster &cluster) {
+    int low = cases[cluster.first].value;
+    int high = cases[cluster.first + cluster.count - 1].value;
+    std::vector<BasicBlock*> entries((int64_t)high - low + 1, otherwise);
+    for (int i = cluster.first; i < cluster.first + cluster.count; i++)
+        entries[(int64_t)cases[i].value - low] = cases[i].target;
+    List<BasicBlock*> targets;
+    for (BasicBlock *b : entries) targets.Append(b);
+    cg->GenSwitch(value, low, &targets, otherwise);
+}
+
+// Clusters lo up to hi, halving the range with each test
+void SwitchLowering::EmitTree(int lo, int hi) {
+    if (hi - lo == 1) {
+        const Cluster &c = clusters[lo];
+        if (c.isTable) EmitTable(c);
+        else EmitCompare(cases[c.first]);
+        return;
+    }
+    int mid = (lo + hi) / 2;
+    BasicBlock *below = cg->NewBlock(), *above = cg->NewBlock();
+    int test = cg->GenBinary(OP_Lt, value, cg->GenLoadInt(cases[clusters[mid].first].value));
+    cg->GenBranch(test, below, above);
+    cg->StartBlock(below);
+    EmitTree(lo, mid);
+    cg->StartBlock(above);
+    EmitTree(mid, hi);
+}
+
+void SwitchLowering::EmitHashed(int buckets) {
+    std::vector<std::vector<SwitchCase> > bucket(2 * buckets - 1);
+    int low = buckets, high = -buckets;
+    for (const SwitchCase &c : cases) {
+        int h = BucketOf(c.value, buckets);
+        bucket[h + buckets - 1].push_back(c);
+        low = std::min(low, h);
+        high = std::max(high, h);
+    }
+    List<BasicBlock*> targets;
+    for (int h = low; h <= high; h++)
+        targets.Append(bucket[h + buckets - 1].empty() ? otherwise : cg->NewBlock());
+    int remainder = cg->GenBinary(OP_Mod, value, cg->GenLoadInt(buckets));
+    cg->GenSwitch(remainder, low, &targets, otherwise);
+
+    for (int h = low; h <= high; h++) {
+        std::vector<SwitchCase> &in = bucket[h + buckets - 1];
+        if (in.empty()) continue;
+        cg->StartBlock(targets.Nth(h - low));
+        for (int i = 0; i + 1 < (int)in.size(); i++) {
+            BasicBlock *next = cg->NewBlock();
+            cg->GenBranch(cg->GenBinary(OP_Eq, value, cg->GenLoadInt(in[i].value)),
+                          in[i].target, next);
+            cg->StartBlock(next);
+        }
+        EmitCompare(in.back());
+    }
+}
+
+void SwitchLowering::Lower() {
+    const char *fnName = cg->CurrentFunction()->name;
+    int n = cases.size();
+    if (n == 0) {
+        cg->GenJump(otherwise);
+        PrintDebug("switch", "%s: no cases", fnName);
+        return;
+    }
+    std::sort(cases.begin(), cases.end(),
+              [](const SwitchCase &x, const SwitchCase &y) { return x.value < y.value; });
+    for (int i = 1; i < n; i++)
+        Assert(cases[i-1].value != cases[i].value);   // reported by the checker
+    FindClusters();
+
+    int low = cases[0].value, high = cases[n-1].value, numTables = 0;
+    for (const Cluster &c : clusters) numTables += c.isTable;
+    if (clusters.size() == 1 && numTables == 1) {
+        EmitTable(clusters[0]);
+        PrintDebug("switch", "%s: %d cases from %d to %d, jump table of %lld",
+                   fnName, n, low, high, (long long)high - low + 1);
+        return;
+    }
+    int worst, buckets = 0;
+    if (n >= MinHashCases && numTables == 0)
+        buckets = PickHashSize(&worst);
+    if (buckets) {
+        EmitHashed(buckets);
+        PrintDebug("switch", "%s: %d cases from %d to %d, hashed into %d buckets, "
+                   "at most %d in one", fnName, n, low, high, buckets, worst);
+        return;
+    }
+    EmitTree(0, clusters.size());
+    PrintDebug("switch", "%s: %d cases from %d to %d, tree of %d clusters, %d of them tables",
+               fnName, n, low, high, (int)clusters.size(), numTables);
+}
+
+
+void LowerSwitch(CodeGenerator *cg, int value, List<SwitchCase> *cases, BasicBlock *otherwise) {
+    SwitchLowering(cg, value, cases, otherwise).Lower();
+}
@@ -0,0 +1,46 @@
+/* File: switch.h
+ * --------------
+ * Lowering of switch statements into three-address code (see tac.h).
+ * Testing the cases one after another takes a compare per case, so the
+ * dispatch is instead built in one of three ways, picked by how many
+ * cases there are and how densely their values are spread:
+ *
+ *   table   When the values fill at least 40% of the range from the
+ *           smallest to the largest, a single OP_Switch looks the value
+ *           up in a jump table over that range.
+ *   hash    When there are 32 cases or more with no dense runs among
+ *           them, the value is reduced modulo a table size chosen so the
+ *           cases land in different buckets (two at most), and an
+ *           OP_Switch on the remainder goes to the bucket, which compares
+ *           the value with the cases in it.
+ *   tree    Otherwise the sorted values are split into clusters, dense
+ *           runs of four cases or more becoming jump tables and the rest
+ *           single values, and a balanced tree of < tests finds the
+ *           cluster, which compares the value or looks it up.
+ *
+ * -d switch reports the choice made for each switch.
+ */
+
+#ifndef _H_switch
+#define _H_switch
+
+#include "list.h"
+
+class CodeGenerator;
+struct BasicBlock;
+
+struct SwitchCase {
+    int value;
+    BasicBlock *target;
+};
+
+
+/* Function: LowerSwitch()
+ * -----------------------
+ * Ends the current block with code that goes to the target of the case
+ * whose value the temporary value holds, or to otherwise if there is
+ * none. The case values must be different.
+ */
+void LowerSwitch(CodeGenerator *cg, int value, List<SwitchCase> *cases, BasicBlock *otherwise);
+
+#endif
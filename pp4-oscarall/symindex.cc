@@ -0,0 +1,237 @@
+/* File: symindex.cc
+ * -----------------
+ * Implementation of the symbol index.
+ */
+
+#include "symindex.h"
+#include "ast_decl.h"
+#include "ast_stmt.h"
+#include "utility.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+
+SymbolIndex *SymbolIndex::current = NULL;
+
+/* Format
+ * ------
+ * A header, then the arrays it gives the lengths of, in this order.
+ * Names are offsets into the string table at the end.
+ */
+static const char Magic[8] = "dccsym1";
+
+struct IndexHeader {
+    char magic[8];
+    uint32_t numDecls, numOccurrences, stringBytes;
+};
+
+typedef enum { S_Class, S_Interface, S_Function, S_Method, S_Global, S_Field, S_Local } SymbolKind;
+static const char *kindNames[] = { "class", "interface", "function", "method", "variable", "field", "local" };
+
+struct SymbolDecl {
+    uint32_t name, qualifiedName;
+    int32_t line, firstColumn, lastColumn;
+    uint32_t kind;
+};
+
+struct Occurrence {
+    int32_t line, firstColumn, lastColumn;
+    uint32_t decl;
+};
+
+static bool Before(const Occurrence &x, const Occurrence &y) {
+    return x.line < y.line || (x.line == y.line && x.firstColumn < y.firstColumn);
+}
+
+static SymbolKind KindOf(Decl *d) {
+    Node *parent = d->GetParent();
+    if (d->IsClassDecl()) return S_Class;
+    if (d->IsInterfaceDecl()) return S_Interface;
+    if (d->IsFnDecl()) return d->IsMethodDecl() ? S_Method : S_Function;
+    if (dynamic_cast<Program*>(parent)) return S_Global;
+    if (dynamic_cast<ClassDecl*>(parent)) return S_Field;
+    return S_Local;
+}
+
+// The name of d preceded by those of the declarations it is in
+static std::string QualifiedName(Decl *d) {
+    std::string name = d->GetName();
+    for (Node *n = d->GetParent(); n; n = n->GetParent())
+        if (Decl *outer = dynamic_cast<Decl*>(n))
+            name = std::string(outer->GetName()) + "." + name;
+    return name;
+}
+
+static Occurrence OccurrenceOf(Identifier *name, uint32_t decl) {
+    yyltype *loc = name->GetLocation();
+    Occurrence o = { loc->first_line, loc->first_column, loc->last_column, decl };
+    return o;
+}
+
+bool SymbolIndex::Write(const char *path) {
+    std::unordered_map<Decl*,uint32_t> index;
+    std::vector<SymbolDecl> table(decls.size());
+    std::vector<Occurrence> occurrences;
+    std::string strings;
+    for (size_t i = 0; i < decls.size(); i++) {
+        Decl *d = decls[i];
+        index[d] = i;
+        yyltype *loc = d->GetId()->GetLocation();
+        table[i].name = strings.size();
+        strings.append(d->GetName(), strlen(d->GetName()) + 1);
+        table[i].qualifiedName = strings.size();
+        std::string qualified = QualifiedName(d);
+        strings.append(qualified.c_str(), qualified.size() + 1);
+        table[i].line = loc->first_line;
+        table[i].firstColumn = loc->first_column;
+        table[i].lastColumn = loc->last_column;
+        table[i].kind = KindOf(d);
+        occurrences.push_back(OccurrenceOf(d->GetId(), i));
+    }
+    for (std::pair<Identifier*,Decl*> &use : uses) {
+        std::unordered_map<Decl*,uint32_t>::iterator it = index.find(use.second);
+        if (it != index.end()) occurrences.push_back(OccurrenceOf(use.first, it->second));
+    }
+
+    // A name is resolved each time it is looked at, so only its first
+    // occurrence is kept
+    std::sort(occurrences.begin(), occurrences.end(), Before);
+    occurrences.erase(std::unique(occurrences.begin(), occurrences.end(), [](const Occurrence &x, const Occurrence &y) {
+        return !Before(x, y) && !Before(y, x);
+    }), occurrences.end());
+    std::vector<uint32_t> byDecl(occurrences.size()), byName(decls.size());
+    for (size_t i = 0; i < byDecl.size(); i++) byDecl[i] = i;
+    std::stable_sort(byDecl.begin(), byDecl.end(), [&](uint32_t x, uint32_t y) {
+        return occurrences[x].decl < occurrences[y].decl;
+    });
+    for (size_t i = 0; i < byName.size(); i++) byName[i] = i;
+    const char *s = strings.c_str();
+    std::sort(byName.begin(), byName.end(), [&](uint32_t x, uint32_t y) {
+        int c = strcmp(s + table[x].name, s + table[y].name);
+        return c != 0 ? c < 0 : strcmp(s + table[x].qualifiedName, s + table[y].qualifiedName) < 0;
+    });
+
+    IndexHeader header;
+    memcpy(header.magic, Magic, sizeof(Magic));
+    header.numDecls = table.size();
+    header.numOccurrences = occurrences.size();
+    header.stringBytes = strings.size();
+    FILE *fp = fopen(path, "wb");
+    if (!fp) return false;
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1
+        && fwrite(table.data(), sizeof(SymbolDecl), table.size(), fp) == table.size()
+        && fwrite(byName.data(), sizeof(uint32_t), byName.size(), fp) == byName.size()
+        && fwrite(occurrences.data(), sizeof(Occurrence), occurrences.size(), fp) == occurrences.size()
+        && fwrite(byDecl.data(), sizeof(uint32_t), byDecl.size(), fp) == byDecl.size()
+        && fwrite(strings.data(), 1, strings.size(), fp) == strings.size();
+    PrintDebug("symbols", "%zu declarations, %zu occurrences of names", table.size(), occurrences.size());
+    return (fclose(fp) == 0) && ok;
+}
+
+
+/* Queries
+ * -------
+ */
+
+class IndexFile
+{
+  private:
+    void *data;
+    size_t size;
+
+  public:
+    const SymbolDecl *decls;
+    const uint32_t *byName;
+    const Occurrence *occurrences;
+    const uint32_t *byDecl;
+    const char *strings;
+    uint32_t numDecls, numOccurrences;
+
+    IndexFile(const char *path);
+    ~IndexFile() { munmap(data, size); }
+
+    const char *Name(uint32_t d) { return strings + decls[d].name; }
+    const char *QualifiedName(uint32_t d) { return strings + decls[d].qualifiedName; }
+    void PrintDecl(uint32_t d, FILE *out);
+};
+
+IndexFile::IndexFile(const char *path) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) Failure("Cannot open symbol index %s", path);
+    size = st.st_size;
+    data = (size >= sizeof(IndexHeader)) ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    const IndexHeader *header = (const IndexHeader *)data;
+    if (data == MAP_FAILED || memcmp(header->magic, Magic, sizeof(Magic)) != 0)
+        Failure("%s is not a symbol index", path);
+    numDecls = header->numDecls;
+    numOccurrences = header->numOccurrences;
+    size_t expected = sizeof(IndexHeader) + numDecls * (sizeof(SymbolDecl) + sizeof(uint32_t))
+        + numOccurrences * (sizeof(Occurrence) + sizeof(uint32_t)) + header->stringBytes;
+    if (size != expected || (header->stringBytes > 0 && ((const char *)data)[size - 1] != '\0'))
+        Failure("Symbol index %s is damaged", path);
+    decls = (const SymbolDecl *)(header + 1);
+    byName = (const uint32_t *)(decls + numDecls);
+    occurrences = (const Occurrence *)(byName + numDecls);
+    byDecl = (const uint32_t *)(occurrences + numOccurrences);
+    strings = (const char *)(byDecl + numOccurrences);
+}
+
+void IndexFile::PrintDecl(uint32_t d, FILE *out) {
+    fprintf(out, "%d:%d-%d %s %s\n", decls[d].line, decls[d].firstColumn, decls[d].lastColumn,
+            kindNames[decls[d].kind], QualifiedName(d));
+}
+
+static int FindDefinition(IndexFile *index, const char *position, FILE *out) {
+    Occurrence at;
+    if (sscanf(position, "%d:%d", &at.line, &at.firstColumn) != 2)
+        Failure("--definition takes a position as <line>:<column>");
+    // The last occurrence that starts at or before the position is the
+    // only one that can take it in
+    const Occurrence *end = index->occurrences + index->numOccurrences;
+    const Occurrence *o = std::upper_bound(index->occurrences, end, at, Before);
+    if (o == index->occurrences || (--o)->line != at.line || o->lastColumn < at.firstColumn) {
+        fprintf(stderr, "No name at %d:%d\n", at.line, at.firstColumn);
+        return 1;
+    }
+    index->PrintDecl(o->decl, out);
+    return 0;
+}
+
+static int FindReferences(IndexFile *index, const char *name, FILE *out) {
+    const char *dot = strrchr(name, '.');
+    const char *plain = dot ? dot + 1 : name;
+    const uint32_t *end = index->byName + index->numDecls;
+    const uint32_t *first = std::lower_bound(index->byName, end, plain, [&](uint32_t d, const char *s) {
+        return strcmp(index->Name(d), s) < 0;
+    });
+    int found = 0;
+    for (const uint32_t *d = first; d < end && strcmp(index->Name(*d), plain) == 0; d++) {
+        if (dot && strcmp(index->QualifiedName(*d), name) != 0) continue;
+        found++;
+        index->PrintDecl(*d, out);
+        const uint32_t *refsEnd = index->byDecl + index->numOccurrences;
+        const uint32_t *ref = std::lower_bound(index->byDecl, refsEnd, *d, [&](uint32_t o, uint32_t decl) {
+            return index->occurrences[o].decl < decl;
+        });
+        for (; ref < refsEnd && index->occurrences[*ref].decl == *d; ref++) {
+            const Occurrence &o = index->occurrences[*ref];
+            fprintf(out, "  %d:%d-%d\n", o.line, o.firstColumn, o.lastColumn);
+        }
+    }
+    if (!found) fprintf(stderr, "Nothing called %s is declared\n", name);
+    return found ? 0 : 1;
+}
+
+int QuerySymbolIndex(const char *path, const char *definition, const char *references, FILE *out) {
+    if (!path || !*path) Failure("--definition and --references need --index=<file>");
+    IndexFile index(path);
+    return definition ? FindDefinition(&index, definition, out) : FindReferences(&index, references, out);
+}
@@ -0,0 +1,62 @@
+/* File: symindex.h
+ * ----------------
+ * The symbol index of a program, for going to the definition of a name
+ * and finding the references of a declaration without compiling the
+ * program again. Every declaration is recorded as it is built (globals,
+ * functions, classes, interfaces, their members, formals and locals),
+ * and every name the checker and code generation resolve, with the
+ * span of the identifier (see NoteUse in depgraph.h).
+ *
+ *   dcc --index=<file> < prog.decaf
+ *       compiles the program as usual and, once it has been checked and
+ *       generated, writes its index to file
+ *   dcc --index=<file> --definition=<line>:<column>
+ *       prints the declaration of the name at that position, as
+ *       "line:column-endColumn kind name"
+ *   dcc --index=<file> --references=<name>
+ *       prints where each declaration called name is declared and used,
+ *       one span per line; name is a plain name, which takes in every
+ *       declaration of that name, or one qualified by what it is
+ *       declared in, like Deck.Shuffle or main.x
+ *
+ * The queries return 1 if they found nothing. The file holds fixed-size
+ * records in sorted arrays: the occurrences of names by position, the
+ * same occurrences by declaration, and the declarations by name, then
+ * the names. A query maps it in and binary searches the array it needs,
+ * so it takes the same few milliseconds however large the program.
+ */
+
+#ifndef _H_symindex
+#define _H_symindex
+
+#include <stdio.h>
+#include <utility>
+#include <vector>
+
+class Decl;
+class Identifier;
+
+class SymbolIndex
+{
+  private:
+    std::vector<Decl*> decls;
+    std::vector<std::pair<Identifier*,Decl*> > uses;
+
+  public:
+        // Records the declarations built and uses resolved while set
+    static SymbolIndex *current;
+
+    void AddDecl(Decl *d) { decls.push_back(d); }
+    void AddUse(Identifier *name, Decl *d) { uses.push_back(std::make_pair(name, d)); }
+    bool Write(const char *path);
+};
+
+/* Function: QuerySymbolIndex()
+ * ----------------------------
+ * Answers --definition (a "line:column") or --references (a name),
+ * whichever is not NULL, from the index in path. Returns the exit
+ * status for dcc.
+ */
+int QuerySymbolIndex(const char *path, const char *definition, const char *references, FILE *out);
+
+#endif
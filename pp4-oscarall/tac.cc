@@ -0,0 +1,258 @@
+/* File: tac.cc
+ * ------------
+ * Implementation of the TAC data structures and of the -d tac dump.
+ */
+
+#include "tac.h"
+#include "arena.h"
+#include <new>
+#include <string.h>
+
+const char *const OpcodeNames[NumOpcodes] = {
+    "loadint", "loaddouble", "loadstring", "loadnull", "move",
+    "add", "sub", "mul", "div", "mod", "neg",
+    "fadd", "fsub", "fmul", "fdiv", "fneg",
+    "eq", "ne", "lt", "le", "gt", "ge",
+    "feq", "fne", "flt", "fle", "fgt", "fge",
+    "streq", "strne", "not",
+    "loadglobal", "storeglobal",
+    "loadfield", "storefield",
+    "loadelem", "storeelem", "length", "checkbounds", "checknull",
+    "new", "newarray",
+    "call", "vcall", "icall", "builtin",
+    "goto", "if", "switch", "return",
+    "phi"
+};
+
+const char *const BuiltinNames[NumBuiltins] = {
+    "PrintInt", "PrintBool", "PrintString",
+    "ReadInteger", "ReadLine"
+};
+
+static const char *const KindNames[] = { "int", "double", "ref" };
+
+
+Instr *NewInstr(Opcode op) {
+    Instr *instr = (Instr *)ArenaAlloc(sizeof(Instr));
+    memset(instr, 0, sizeof(Instr));
+    instr->op = op;
+    instr->dst = instr->a = instr->b = instr->c = NoTemp;
+    return instr;
+}
+
+int Instr::NumTargets() const {
+    switch (op) {
+      case OP_Jump:   return 1;
+      case OP_Branch: return 2;
+      case OP_Switch: return 1 + table->size;
+      default:        return 0;
+    }
+}
+
+BasicBlock *Instr::Target(int i) const {
+    return (op == OP_Switch && i > 0) ? table->targets[i - 1] : target[i];
+}
+
+static void PrintString(FILE *fp, const char *s) {
+    fputc('"', fp);
+    for (; *s; s++) {
+        switch (*s) {
+          case '\n': fputs("\\n", fp); break;
+          case '\t': fputs("\\t", fp); break;
+          case '"':  fputs("\\\"", fp); break;
+          case '\\': fputs("\\\\", fp); break;
+          default:   fputc(*s, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+static void PrintArgs(FILE *fp, Instr *instr) {
+    fputc('(', fp);
+    for (int i = 0; i < instr->numArgs; i++)
+        fprintf(fp, "%st%d", i ? ", " : "", instr->args[i]);
+    fputc(')', fp);
+}
+
+void Instr::Print(FILE *fp) {
+    fputs("    ", fp);
+    if (dst != NoTemp) fprintf(fp, "t%d = ", dst);
+    switch (op) {
+      case OP_LoadInt:      fprintf(fp, "%d", intValue); break;
+      case OP_LoadDouble:   fprintf(fp, "%g", doubleValue); break;
+      case OP_LoadString:   PrintString(fp, text); break;
+      case OP_LoadNull:     fputs("null", fp); break;
+      case OP_Move:         fprintf(fp, "t%d", a); break;
+      case OP_LoadGlobal:   fprintf(fp, "global[%d]", intValue); break;
+      case OP_StoreGlobal:  fprintf(fp, "global[%d] = t%d", intValue, a); break;
+      case OP_LoadField:    fprintf(fp, "t%d.field[%d]", a, intValue); break;
+      case OP_StoreField:   fprintf(fp, "t%d.field[%d] = t%d", a, intValue, b); break;
+      case OP_LoadElem:     fprintf(fp, "t%d[t%d]", a, b); break;
+      case OP_StoreElem:    fprintf(fp, "t%d[t%d] = t%d", a, b, c); break;
+      case OP_NewObject:    fprintf(fp, "new %s", cls->name); break;
+      case OP_NewArray:     fprintf(fp, "newarray t%d of %s", a, KindNames[intValue]); break;
+      case OP_Call:         fprintf(fp, "call %s", callee->name); PrintArgs(fp, this); break;
+      case OP_CallVirtual:  fprintf(fp, "vcall vtable[%d]", intValue); PrintArgs(fp, this); break;
+      case OP_CallInterface: fprintf(fp, "icall selector[%d]", intValue); PrintArgs(fp, this); break;
+      case OP_CallBuiltin:  fprintf(fp, "builtin %s", BuiltinNames[intValue]); PrintArgs(fp, this); break;
+      case OP_Phi:          fputs("phi", fp); PrintArgs(fp, this); break;
+      case OP_Jump:         fprintf(fp, "goto B%d", target[0]->id); break;
+      case OP_Branch:       fprintf(fp, "if t%d goto B%d else B%d", a, target[0]->id, target[1]->id); break;
+      case OP_Switch:
+        fprintf(fp, "switch t%d from %d [", a, table->low);
+        for (int i = 0; i < table->size; i++)
+            fprintf(fp, "%sB%d", i ? ", " : "", table->targets[i]->id);
+        fprintf(fp, "] else B%d", target[0]->id);
+        break;
+      case OP_Return:
+        fputs("return", fp);
+        if (a != NoTemp) fprintf(fp, " t%d", a);
+        break;
+      default:
+        fputs(OpcodeNames[op], fp);
+        if (a != NoTemp) fprintf(fp, " t%d", a);
+        if (b != NoTemp) fprintf(fp, ", t%d", b);
+    }
+    fputc('\n', fp);
+}
+
+
+void BasicBlock::Append(Instr *instr) {
+    instr->prev = last;
+    instr->next = NULL;
+    if (last) last->next = instr;
+    else first = instr;
+    last = instr;
+}
+
+void BasicBlock::InsertBefore(Instr *instr, Instr *before) {
+    if (!before) {
+        Append(instr);
+        return;
+    }
+    instr->next = before;
+    instr->prev = before->prev;
+    if (before->prev) before->prev->next = instr;
+    else first = instr;
+    before->prev = instr;
+}
+
+void BasicBlock::Remove(Instr *instr) {
+    if (instr->prev) instr->prev->next = instr->next;
+    else first = instr->next;
+    if (instr->next) instr->next->prev = instr->prev;
+    else last = instr->prev;
+    instr->prev = instr->next = NULL;
+}
+
+void BasicBlock::Print(FILE *fp) {
+    fprintf(fp, "  B%d:", id);
+    if (preds.NumElements()) {
+        fputs("    ; preds", fp);
+        for (BasicBlock *p : preds) fprintf(fp, " B%d", p->id);
+    }
+    fputc('\n', fp);
+    for (Instr *instr = first; instr; instr = instr->next)
+        instr->Print(fp);
+}
+
+
+int TacFunction::NewTemp(ValueKind kind) {
+    tempKinds.Append(kind);
+    return tempKinds.NumElements() - 1;
+}
+
+BasicBlock *TacFunction::NewBlock() {
+    BasicBlock *b = new (ArenaAlloc(sizeof(BasicBlock))) BasicBlock(blocks.NumElements());
+    blocks.Append(b);
+    return b;
+}
+
+void TacFunction::ComputeEdges() {
+    for (BasicBlock *b : blocks) {
+        b->preds = List<BasicBlock*>();
+        b->succs = List<BasicBlock*>();
+        b->id = -1;   // unreached
+    }
+    // Depth-first from the entry with an explicit stack, numbering the
+    // blocks as they are reached
+    List<BasicBlock*> reached, stack;
+    blocks.Nth(0)->id = 0;
+    reached.Append(blocks.Nth(0));
+    stack.Append(blocks.Nth(0));
+    while (stack.NumElements()) {
+        BasicBlock *b = stack.Nth(stack.NumElements() - 1);
+        stack.RemoveAt(stack.NumElements() - 1);
+        Instr *t = b->Terminator();
+        Assert(t != NULL);
+        int n = t->NumTargets();
+        for (int i = 0; i < n; i++) {
+            // An edge is added once however many targets it stands for;
+            // those of b are the last ones added to succ so far
+            BasicBlock *succ = t->Target(i);
+            int numPreds = succ->preds.NumElements();
+            if (numPreds && succ->preds.Nth(numPreds - 1) == b) continue;
+            b->succs.Append(succ);
+            succ->preds.Append(b);
+            if (succ->id == -1) {
+                succ->id = 0;
+                reached.Append(succ);
+                stack.Append(succ);
+            }
+        }
+    }
+    // Keep the reachable blocks in the order they were created, which
+    // follows the source and makes the dump easier to read
+    List<BasicBlock*> kept;
+    for (BasicBlock *b : blocks)
+        if (b->id != -1) {
+            b->id = kept.NumElements();
+            kept.Append(b);
+        }
+    blocks = kept;
+}
+
+void TacFunction::Print(FILE *fp) {
+    fprintf(fp, "function %s (%d params, %d temps)\n", name, numParams, NumTemps());
+    for (BasicBlock *b : blocks)
+        b->Print(fp);
+    fputc('\n', fp);
+}
+
+
+int ClassLayout::SlotForSelector(int selector) {
+    for (int i = 0; i < selectors.NumElements(); i++)
+        if (selectors.Nth(i) == selector) return i;
+    return -1;
+}
+
+void ClassLayout::Print(FILE *fp) {
+    fprintf(fp, "class %s", name);
+    if (base) fprintf(fp, " extends %s", base->name);
+    fputs("\n  fields:", fp);
+    for (int i = 0; i < NumFields(); i++)
+        fprintf(fp, " %s@%d", KindNames[fieldKinds.Nth(i)], fieldOffsets.Nth(i));
+    fprintf(fp, " (%d bytes)", size);
+    fputs("\n  vtable:", fp);
+    for (TacFunction *fn : vtable)
+        fprintf(fp, " %s", fn->name);
+    fputs("\n\n", fp);
+}
+
+
+int TacProgram::SelectorFor(const char *methodName) {
+    for (int i = 0; i < selectorNames.NumElements(); i++)
+        if (strcmp(selectorNames.Nth(i), methodName) == 0) return i;
+    selectorNames.Append(methodName);
+    return selectorNames.NumElements() - 1;
+}
+
+void TacProgram::Print(FILE *fp) {
+    for (int i = 0; i < globalKinds.NumElements(); i++)
+        fprintf(fp, "global[%d] %s: %s\n", i, globalNames.Nth(i), KindNames[globalKinds.Nth(i)]);
+    if (globalKinds.NumElements()) fputc('\n', fp);
+    for (ClassLayout *cls : classes)
+        cls->Print(fp);
+    for (TacFunction *fn : functions)
+        fn->Print(fp);
+}
@@ -0,0 +1,278 @@
+/* File: tac.h
+ * -----------
+ * The three-address code (TAC) intermediate representation a checked
+ * program is lowered into (see codegen.h). Later stages that optimize
+ * or emit code work from this form rather than from the parse tree.
+ *
+ * A TacFunction is a list of BasicBlocks, the first being the entry.
+ * Each block is a straight run of instructions that ends in exactly one
+ * terminator (OP_Jump, OP_Branch, OP_Switch or OP_Return), so the
+ * control flow graph is explicit. Instructions operate on temporaries, numbered
+ * from 0 within a function, which hold the parameters (the receiver of
+ * a method is t0), the local variables and every intermediate value.
+ * A temporary can be assigned more than once. Each temporary has a
+ * ValueKind, so later stages know which ones hold doubles and which
+ * hold references without going back to the declared types.
+ *
+ * Globals, object fields and vtable entries are numbered slots. An
+ * object is laid out as its class followed by its fields, those of its
+ * base class first, so a field keeps its slot in every subclass, and a
+ * method that overrides another takes over its vtable slot. Native code
+ * (see x86.h) packs the fields by size instead, at the byte offsets the
+ * ClassLayout gives each slot.
+ *
+ * Instructions, blocks and functions are allocated in the arena (see
+ * arena.h) and live as long as the compiler does. The instructions of a
+ * block form a doubly-linked list so passes can insert and remove them
+ * in place.
+ */
+
+#ifndef _H_tac
+#define _H_tac
+
+#include <stdio.h>
+#include <stdint.h>
+#include "list.h"
+
+class FnDecl;
+class ClassDecl;
+struct BasicBlock;
+struct TacFunction;
+struct ClassLayout;
+struct JumpTable;
+
+typedef enum { V_Int, V_Double, V_Ref } ValueKind;   // bools are V_Int
+
+typedef enum {
+    OP_LoadInt, OP_LoadDouble, OP_LoadString, OP_LoadNull, OP_Move,
+    OP_Add, OP_Sub, OP_Mul, OP_Div, OP_Mod, OP_Neg,
+    OP_FAdd, OP_FSub, OP_FMul, OP_FDiv, OP_FNeg,
+    OP_Eq, OP_Ne, OP_Lt, OP_Le, OP_Gt, OP_Ge,        // ints, bools, references
+    OP_FEq, OP_FNe, OP_FLt, OP_FLe, OP_FGt, OP_FGe,
+    OP_StrEq, OP_StrNe, OP_Not,
+    OP_LoadGlobal, OP_StoreGlobal,
+    OP_LoadField, OP_StoreField,
+    OP_LoadElem, OP_StoreElem, OP_ArrayLength, OP_CheckBounds, OP_CheckNull,
+    OP_NewObject, OP_NewArray,
+    OP_Call, OP_CallVirtual, OP_CallInterface, OP_CallBuiltin,
+    OP_Jump, OP_Branch, OP_Switch, OP_Return,
+    OP_Phi,                                          // only in SSA form (see ssa.h)
+    NumOpcodes
+} Opcode;
+
+// Names used by the -d tac dump
+extern const char *const OpcodeNames[NumOpcodes];
+
+typedef enum {
+    BI_PrintInt, BI_PrintBool, BI_PrintString,
+    BI_ReadInteger, BI_ReadLine,
+    NumBuiltins
+} Builtin;
+
+extern const char *const BuiltinNames[NumBuiltins];
+
+static const int NoTemp = -1;
+
+
+/* Struct: Instr
+ * -------------
+ * One instruction: dst = a op b, where any of the three may be NoTemp.
+ * Only OP_StoreElem has a third operand, c. What the other fields mean
+ * depends on the opcode:
+ *   OP_LoadInt                  intValue
+ *   OP_LoadDouble               doubleValue
+ *   OP_LoadString               text (decoded, without the quotes), an
+ *                               entry of the string pool
+ *   OP_Load/StoreGlobal         intValue is the global slot
+ *   OP_Load/StoreField          a is the object, intValue the field slot,
+ *                               cls the class that declares the field
+ *   OP_Load/StoreElem           a is the array, b the index
+ *   OP_StoreXxx                 the value stored is the last operand
+ *   OP_CheckBounds              a is the array, b the index
+ *   OP_CheckNull                a is the object; stops the program if it
+ *                               is null, as a call through it would
+ *   OP_NewObject                cls
+ *   OP_NewArray                 a is the length, intValue the ValueKind
+ *                               of the elements
+ *   OP_Call                     callee, args
+ *   OP_CallVirtual              intValue is the vtable slot, cls the
+ *                               static class of the receiver, args[0] the
+ *                               receiver
+ *   OP_CallInterface            intValue is the selector of the method
+ *                               name (see TacProgram), args[0] the receiver
+ *   OP_CallBuiltin              intValue is the Builtin, args
+ *   OP_Jump                     target[0]
+ *   OP_Branch                   a is the test, target[0] is taken when it
+ *                               is non-zero and target[1] otherwise
+ *   OP_Switch                   a is the value, table; goes to the target
+ *                               the table has for it, and to target[0] if
+ *                               it is outside the table
+ *   OP_Return                   a is the value returned, if any
+ *   OP_Phi                      args, one per predecessor of the block in
+ *                               the order of its preds list; intValue is
+ *                               the temporary it was placed for
+ */
+struct Instr {
+    Opcode op;
+    int dst, a, b, c;
+    union {
+        int intValue;
+        double doubleValue;
+        const char *text;
+        TacFunction *callee;
+        JumpTable *table;
+    };
+    ClassLayout *cls;
+    int numArgs;
+    int *args;
+    BasicBlock *target[2];
+    Instr *prev, *next;
+
+    bool IsTerminator() const { return op >= OP_Jump && op <= OP_Return; }
+    bool IsCall() const       { return op >= OP_Call && op <= OP_CallBuiltin; }
+        // Computes its result out of its operands (or constant) alone
+    bool IsComputation() const { return op <= OP_Not; }
+        // Has no effect but its result, so it can go if that is not needed;
+        // division can stop the program and a load can dereference null
+    bool IsRemovable() const {
+        return (IsComputation() && op != OP_Div && op != OP_Mod)
+            || op == OP_LoadGlobal || op == OP_Phi;
+    }
+        // The blocks a terminator may go to, target[0] first
+    int NumTargets() const;
+    BasicBlock *Target(int i) const;
+    void Print(FILE *fp);
+
+        // Calls f on each temporary the instruction reads: a, b, c, then
+        // the arguments of a call. f gets a reference, so it may rename them.
+    template <class F> void ForEachUse(F f) {
+        if (a != NoTemp) f(a);
+        if (b != NoTemp) f(b);
+        if (c != NoTemp) f(c);
+        for (int i = 0; i < numArgs; i++) f(args[i]);
+    }
+};
+
+// A new instruction with no operands, allocated in the arena
+Instr *NewInstr(Opcode op);
+
+
+/* Struct: JumpTable
+ * -----------------
+ * The targets of an OP_Switch for the values low to low + size - 1.
+ * Values in that range without a case of their own go to the default
+ * like those outside it, so their entries hold the default too.
+ */
+struct JumpTable {
+    int low, size;
+    BasicBlock **targets;
+
+        // Where value goes, otherwise if the table has no entry for it
+    BasicBlock *Lookup(int value, BasicBlock *otherwise) const {
+        int64_t i = (int64_t)value - low;
+        return (i >= 0 && i < size) ? targets[i] : otherwise;
+    }
+};
+
+
+/* Struct: BasicBlock
+ * ------------------
+ * The predecessor and successor lists are only valid after
+ * TacFunction::ComputeEdges.
+ */
+struct BasicBlock {
+    int id;
+    Instr *first, *last;
+    List<BasicBlock*> preds, succs;
+
+    BasicBlock(int n) : id(n), first(NULL), last(NULL) {}
+
+    Instr *Terminator() { return (last && last->IsTerminator()) ? last : NULL; }
+    void Append(Instr *instr);
+    void InsertBefore(Instr *instr, Instr *before);
+    void Remove(Instr *instr);
+    void Print(FILE *fp);
+};
+
+
+struct TacFunction {
+    const char *name;          // "main", or "Class.method" for methods
+    FnDecl *decl;
+    ClassLayout *cls;          // class of a method, NULL for functions
+    int numParams;             // including the receiver of a method
+    bool returnsValue;
+    List<ValueKind> tempKinds; // kind of each temporary
+    List<BasicBlock*> blocks;  // blocks[0] is the entry
+    bool inSSA;                // see ssa.h
+
+    TacFunction(const char *n, FnDecl *d, ClassLayout *c)
+      : name(n), decl(d), cls(c), numParams(0), returnsValue(false), inSSA(false) {}
+
+    int NumTemps() { return tempKinds.NumElements(); }
+    int NewTemp(ValueKind kind);
+    BasicBlock *NewBlock();
+
+        // Drops blocks that cannot be reached from the entry, numbers the
+        // rest in order and fills in their preds/succs, where each edge
+        // appears once even if a terminator names the same block twice
+    void ComputeEdges();
+    void Print(FILE *fp);
+};
+
+
+/* Struct: ClassLayout
+ * --------------------
+ * The fields and vtable of a class. In native objects a bool field
+ * takes 1 byte, an int 4 and anything else 8, each aligned to its size
+ * after the 8 bytes of the vtable address. The fields of the base class
+ * keep their offsets, and those the class adds go in largest first,
+ * each at the lowest offset free for it, which may be a gap the base
+ * class left.
+ */
+struct ClassLayout {
+    const char *name;
+    ClassDecl *decl;
+    ClassLayout *base;
+    int id;
+    List<ValueKind> fieldKinds;   // kind of each field slot
+    List<int> fieldSizes;         // bytes each field slot takes natively
+    List<int> fieldOffsets;       // and where it goes in the object
+    int size;                     // bytes of a native object, a multiple of 8
+    List<TacFunction*> vtable;
+    List<int> selectors;          // of the method in each vtable slot
+
+    ClassLayout(const char *n, ClassDecl *d, ClassLayout *b, int i)
+      : name(n), decl(d), base(b), id(i), size(8) {}
+
+    int NumFields() { return fieldKinds.NumElements(); }
+        // Vtable slot of the method with the given selector, or -1
+    int SlotForSelector(int selector);
+    void Print(FILE *fp);
+};
+
+
+/* Struct: TacProgram
+ * ------------------
+ * The whole lowered program. Every method name gets a selector, which
+ * is how calls through an interface find the method in the vtable of
+ * whatever class the receiver turns out to be. The string pool holds
+ * each distinct string literal once, and the text of every
+ * OP_LoadString is one of its entries, so equal literals are the same
+ * pointer.
+ */
+struct TacProgram {
+    List<ValueKind> globalKinds;
+    List<const char*> globalNames;
+    List<ClassLayout*> classes;
+    List<TacFunction*> functions;
+    List<const char*> selectorNames;
+    List<const char*> strings;    // the string pool
+    TacFunction *main;            // NULL if the program has no main
+
+    TacProgram() : main(NULL) {}
+
+    int SelectorFor(const char *methodName);
+    void Print(FILE *fp);
+};
+
+#endif
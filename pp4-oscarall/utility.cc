@@ -10,6 +10,7 @@
 #include <string.h>
 
 static List<const char*> debugKeys;
+static List<const char*> options;   // --name[=value], without the dashes
 static const int BufferSize = 2048;
 
 void Failure(const char *format, ...)
@@ -68,15 +69,30 @@ void PrintDebug(const char *key, const char *format, ...)
 
 void ParseCommandLine(int argc, char *argv[])
 {
-  if (argc == 1)
+  int i = 1;
+  for (; i < argc && (strncmp(argv[i], "--", 2) == 0 || strncmp(argv[i], "-f", 2) == 0); i++)
+    options.Append(argv[i] + 2);
+
+  if (i == argc)
     return;
   
-  if (strcmp(argv[1], "-d") != 0) { // first arg is not -d
-    printf("Usage:   -d <debug-key-1> <debug-key-2> ... \n");
+  if (strcmp(argv[i], "-d") != 0) { // next arg is not -d
+    printf("Usage:   [--option[=value] ...] -d <debug-key-1> <debug-key-2> ... \n");
     exit(2);
   }
 
-  for (int i = 2; i < argc; i++)
+  for (i++; i < argc; i++)
     SetDebugForKey(argv[i], true);
 }
 
+
+const char *GetOption(const char *name)
+{
+  int len = strlen(name);
+  for (const char *opt : options)
+    if (strncmp(opt, name, len) == 0) {
+      if (opt[len] == '\0') return "";
+      if (opt[len] == '=') return opt + len + 1;
+    }
+  return NULL;
+}
@@ -34,9 +34,15 @@ void Failure(const char *format, ...);
  * will print something similar to the following if ptr is NULL:
  *   *** Failure: Assertion failed: hashtable.cc, line 55:
  *       ptr != NULL
+ * Release builds compiled with -DNDEBUG drop the test entirely, so
+ * asserts are free in hot loops such as the List accessors.
  */ 
+#ifdef NDEBUG
+#define Assert(expr)  ((void)0)
+#else
 #define Assert(expr)  \
   ((expr) ? (void)0 : Failure("Assertion failed: %s, line %d:\n    %s", __FILE__, __LINE__, #expr))
+#endif
 
 
 
@@ -74,10 +80,22 @@ bool IsDebugOn(const char *key);
 
 /* Function: ParseCommandLine
  * --------------------------
- * Turn on the debugging flags from the command line.  Verifies that
- * first argument is -d, and then interpret all the arguments that follow
- * as being flags to turn on.
+ * Turn on the debugging flags from the command line.  Any leading
+ * --name[=value] options are recorded for GetOption, as are -fname[=value]
+ * ones, the way compilers spell code generation options. After those, verifies
+ * that the next argument is -d, and then interpret all the arguments that
+ * follow as being flags to turn on.
  */
 void ParseCommandLine(int argc, char *argv[]);
+
+
+/* Function: GetOption()
+ * Usage: const char *dir = GetOption("cache");
+ * --------------------------------------------
+ * Returns the value given for a --name=value (or -fname=value) option on
+ * the command line, "" for a bare --name, or NULL if the option was not
+ * given at all.
+ */
+const char *GetOption(const char *name);
      
 #endif
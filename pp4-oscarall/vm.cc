@@ -0,0 +1,330 @@
+/* File: vm.cc
+ * -----------
+ * Implementation of the bytecode interpreter.
+ */
+
+#include "vm.h"
+#include "bytecode.h"
+#include "heap.h"
+#include "dstring.h"
+#include "utility.h"
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#if defined(__GNUC__) && !defined(NO_COMPUTED_GOTO)
+#define COMPUTED_GOTO
+#endif
+
+static const int StackSize = 1 << 20;   // registers, for all frames
+static const int MaxFrames = 1 << 16;
+static const long DefaultNurseryKB = 1024, DefaultHeapMB = 1024;
+
+struct Frame {
+    const int *returnPc;
+    Value *regs;
+    BcFunction *fn;
+    Value *result;       // register of the caller that gets the result
+};
+
+
+// The slots outside the heap that may hold references: the globals
+// that do and the registers the stack map of each frame lists. The
+// innermost frame, which has regs, stands at pc, right after the
+// instruction that is collecting; the others at where they return to.
+static void FindRoots(BcProgram *program, Value *globals, Frame *frames, Frame *frame,
+                      Value *regs, int pc, std::vector<Value*> *roots) {
+    roots->clear();
+    for (int slot : program->refGlobals) roots->push_back(&globals[slot]);
+    for (Frame *f = frames; f <= frame; f++) {
+        Value *r = (f == frame) ? regs : f->regs;
+        BcStackMap *map = program->StackMapAt(f == frame ? pc : f->returnPc - program->code.begin());
+        Assert(map != NULL);
+        for (int i = 0; i < map->numRefs; i++) roots->push_back(&r[map->refs[i]]);
+    }
+}
+
+// A line of input without its newline, or NULL at the end of input
+static char *ReadInputLine(FILE *input) {
+    if (!input) return NULL;
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len = getline(&line, &size, input);
+    if (len < 0) {
+        free(line);
+        return NULL;
+    }
+    if (len > 0 && line[len-1] == '\n') line[--len] = '\0';
+    if (len > 0 && line[len-1] == '\r') line[--len] = '\0';
+    return line;
+}
+
+
+/* Macros for the dispatch loop. Each handler ends by advancing pc past
+ * its instruction (NEXT) or setting it to a jump target, then DISPATCH
+ * continues with the instruction at pc.
+ */
+#ifdef COMPUTED_GOTO
+#define CASE(name)     L_##name:
+#define DISPATCH()     goto *labels[*pc]
+#else
+#define CASE(name)     case BC_##name:
+#define DISPATCH()     goto dispatch
+#endif
+#define NEXT(size)     { pc += size; DISPATCH(); }
+#define R(n)           regs[pc[n]]
+#define FAIL(message)  { error = message; goto failed; }
+
+#define INT_BINARY(name, expr) \
+    CASE(name) { int64_t a = R(2).i, b = R(3).i; R(1).i = (int32_t)(expr); NEXT(4); }
+#define DOUBLE_BINARY(name, op) \
+    CASE(name) { R(1).d = R(2).d op R(3).d; NEXT(4); }
+#define COMPARE(name, field, op) \
+    CASE(name) { R(1).i = (R(2).field op R(3).field); NEXT(4); }
+#define COMPARE_AND_JUMP(name, op) \
+    CASE(name) { if (R(1).i op R(2).i) pc = code + pc[3]; else pc += 4; DISPATCH(); }
+
+// Pushes a frame for the callee of the call instruction at pc
+#define INVOKE(callee) { \
+        BcFunction *target = (callee); \
+        int numArgs = pc[3]; \
+        const int *args = pc + 4; \
+        Value *calleeRegs = regs + fn->numRegs; \
+        if (frame == framesEnd || calleeRegs + target->numRegs > stackEnd) \
+            FAIL("Stack overflow"); \
+        for (int i = 0; i < numArgs; i++) \
+            calleeRegs[i] = regs[args[i]]; \
+        frame->returnPc = args + numArgs; \
+        frame->regs = regs; \
+        frame->fn = fn; \
+        frame->result = &R(1); \
+        frame++; \
+        regs = calleeRegs; \
+        fn = target; \
+        pc = code + target->entry; \
+        DISPATCH(); \
+    }
+
+// Sets var to numValues Values of the heap, collecting it first if it
+// is full. size is that of the instruction at pc.
+#define ALLOCATE(var, numValues, kind, size) { \
+        var = heap.Allocate(numValues, kind); \
+        if (!var) { \
+            FindRoots(program, globals, frames, frame, regs, pc + size - code, &roots); \
+            heap.Collect(roots, numValues); \
+            var = heap.Allocate(numValues, kind); \
+            if (!var) FAIL("Out of memory"); \
+        } \
+    }
+
+// The receiver of the call instruction at pc, which is its first argument
+#define RECEIVER()     ((Value *)regs[pc[4]].p)
+
+
+int RunProgram(BcProgram *program, FILE *input)
+{
+#ifdef COMPUTED_GOTO
+#define LABEL_ADDRESS(name, dumpName, format) &&L_##name,
+    static void *const labels[NumBytecodes] = { BYTECODES(LABEL_ADDRESS) };
+#undef LABEL_ADDRESS
+#endif
+    const int *code = program->code.begin();
+    const Value *constants = program->constants.begin();
+    BcFunction **functions = program->functions.begin();
+    BcClass **classes = program->classes.begin();
+
+    Value *globals = (Value *)calloc(program->numGlobals + 1, sizeof(Value));
+    Value *stack = (Value *)malloc(StackSize * sizeof(Value));
+    Value *stackEnd = stack + StackSize;
+    Frame *frames = (Frame *)malloc(MaxFrames * sizeof(Frame));
+    Frame *frame = frames, *framesEnd = frames + MaxFrames;
+    const char *error = NULL;
+    const char *nurseryKB = GetOption("nursery"), *heapMB = GetOption("heap");
+    Heap heap((nurseryKB ? atol(nurseryKB) : DefaultNurseryKB) << 10,
+              (heapMB ? atol(heapMB) : DefaultHeapMB) << 20);
+    std::vector<Value*> roots;
+
+    BcFunction *fn = program->main;
+    Value *regs = stack;
+    const int *pc = code + fn->entry;
+    DISPATCH();
+
+#ifndef COMPUTED_GOTO
+  dispatch:
+    switch (*pc) {
+#endif
+    CASE(LoadInt)     R(1).i = pc[2]; NEXT(3);
+    CASE(LoadConst)   R(1) = constants[pc[2]]; NEXT(3);
+    CASE(Move)        R(1) = R(2); NEXT(3);
+
+    INT_BINARY(Add, a + b)
+    INT_BINARY(Sub, a - b)
+    INT_BINARY(Mul, a * b)
+    CASE(Div) {
+        if (R(3).i == 0) FAIL("Division by zero");
+        R(1).i = (int32_t)(R(2).i / R(3).i);
+        NEXT(4);
+    }
+    CASE(Mod) {
+        if (R(3).i == 0) FAIL("Division by zero");
+        R(1).i = (int32_t)(R(2).i % R(3).i);
+        NEXT(4);
+    }
+    CASE(Neg)         R(1).i = (int32_t)-R(2).i; NEXT(3);
+
+    DOUBLE_BINARY(FAdd, +)
+    DOUBLE_BINARY(FSub, -)
+    DOUBLE_BINARY(FMul, *)
+    DOUBLE_BINARY(FDiv, /)
+    CASE(FNeg)        R(1).d = -R(2).d; NEXT(3);
+
+    COMPARE(Eq, i, ==)
+    COMPARE(Ne, i, !=)
+    COMPARE(Lt, i, <)
+    COMPARE(Le, i, <=)
+    COMPARE(Gt, i, >)
+    COMPARE(Ge, i, >=)
+    COMPARE(FEq, d, ==)
+    COMPARE(FNe, d, !=)
+    COMPARE(FLt, d, <)
+    COMPARE(FLe, d, <=)
+    COMPARE(FGt, d, >)
+    COMPARE(FGe, d, >=)
+    CASE(StrEq)       R(1).i = StringsEqual((char *)R(2).p, (char *)R(3).p); NEXT(4);
+    CASE(StrNe)       R(1).i = !StringsEqual((char *)R(2).p, (char *)R(3).p); NEXT(4);
+    CASE(Not)         R(1).i = !R(2).i; NEXT(3);
+
+    CASE(LoadGlobal)  R(1) = globals[pc[2]]; NEXT(3);
+    CASE(StoreGlobal) globals[pc[1]] = R(2); NEXT(3);
+    CASE(LoadField) {
+        Value *object = (Value *)R(2).p;
+        if (!object) FAIL("Null object dereferenced");
+        R(1) = object[1 + pc[3]];
+        NEXT(4);
+    }
+    CASE(StoreField) {
+        Value *object = (Value *)R(1).p;
+        if (!object) FAIL("Null object dereferenced");
+        object[1 + pc[2]] = R(3);
+        heap.WriteBarrier(object, R(3));
+        NEXT(4);
+    }
+    CASE(LoadElem)    R(1) = ((Value *)R(2).p)[1 + R(3).i]; NEXT(4);
+    CASE(StoreElem) {
+        Value *array = (Value *)R(1).p;
+        array[1 + R(2).i] = R(3);
+        heap.WriteBarrier(array, R(3));
+        NEXT(4);
+    }
+    CASE(Length) {
+        Value *array = (Value *)R(2).p;
+        if (!array) FAIL("Null object dereferenced");
+        R(1).i = array[0].i;
+        NEXT(3);
+    }
+    CASE(CheckBounds) {
+        Value *array = (Value *)R(1).p;
+        if (!array) FAIL("Null object dereferenced");
+        if (R(2).i < 0 || R(2).i >= array[0].i) FAIL("Array subscript out of bounds");
+        NEXT(3);
+    }
+    CASE(CheckNull)   if (!R(1).p) FAIL("Null object dereferenced"); NEXT(2);
+    CASE(NewObject) {
+        BcClass *cls = classes[pc[2]];
+        Value *object;
+        ALLOCATE(object, 1 + cls->numFields, Heap::K_Object, 3)
+        object[0].p = cls;
+        R(1).p = object;
+        NEXT(3);
+    }
+    CASE(NewArray) {
+        int64_t length = R(2).i;
+        if (length < 1) FAIL("Array size is <= 0");
+        Value *array;
+        ALLOCATE(array, 1 + length, pc[3] ? Heap::K_RefArray : Heap::K_DataArray, 4)
+        array[0].i = length;
+        R(1).p = array;
+        NEXT(4);
+    }
+
+    CASE(Call)        INVOKE(functions[pc[2]])
+    CASE(CallVirtual) {
+        Value *receiver = RECEIVER();
+        if (!receiver) FAIL("Null object dereferenced");
+        INVOKE(((BcClass *)receiver[0].p)->vtable[pc[2]])
+    }
+    CASE(CallInterface) {
+        Value *receiver = RECEIVER();
+        if (!receiver) FAIL("Null object dereferenced");
+        INVOKE(((BcClass *)receiver[0].p)->bySelector[pc[2]])
+    }
+    CASE(Return) {
+        Value result = R(1);
+        if (frame == frames) goto finished;
+        frame--;
+        *frame->result = result;
+        regs = frame->regs;
+        fn = frame->fn;
+        pc = frame->returnPc;
+        DISPATCH();
+    }
+    CASE(ReturnVoid) {
+        if (frame == frames) goto finished;
+        frame--;
+        regs = frame->regs;
+        fn = frame->fn;
+        pc = frame->returnPc;
+        DISPATCH();
+    }
+
+    CASE(PrintInt)    printf("%d", (int)R(1).i); NEXT(2);
+    CASE(PrintBool)   fputs(R(1).i ? "true" : "false", stdout); NEXT(2);
+    CASE(PrintString) {
+        if (!R(1).p) FAIL("Null object dereferenced");
+        fputs((char *)R(1).p, stdout);
+        NEXT(2);
+    }
+    CASE(ReadInteger) {
+        char *line = ReadInputLine(input);
+        R(1).i = line ? (int32_t)strtol(line, NULL, 10) : 0;
+        free(line);
+        NEXT(2);
+    }
+    CASE(ReadLine) {
+        char *line = ReadInputLine(input);
+        R(1).p = NewString(line ? line : "", line ? strlen(line) : 0);
+        free(line);
+        NEXT(2);
+    }
+
+    CASE(Jump)        pc = code + pc[1]; DISPATCH();
+    CASE(JumpIfTrue)  if (R(1).i) pc = code + pc[2]; else pc += 3; DISPATCH();
+    CASE(JumpIfFalse) if (!R(1).i) pc = code + pc[2]; else pc += 3; DISPATCH();
+    COMPARE_AND_JUMP(JumpEq, ==)
+    COMPARE_AND_JUMP(JumpNe, !=)
+    COMPARE_AND_JUMP(JumpLt, <)
+    COMPARE_AND_JUMP(JumpLe, <=)
+    COMPARE_AND_JUMP(JumpGt, >)
+    COMPARE_AND_JUMP(JumpGe, >=)
+    CASE(JumpTable) {
+        uint64_t i = (uint64_t)(R(1).i - pc[2]);   // below low wraps around
+        pc = code + (i < (uint64_t)pc[4] ? pc[5 + i] : pc[3]);
+        DISPATCH();
+    }
+#ifndef COMPUTED_GOTO
+      default:
+        Failure("Bad bytecode %d at %d", *pc, (int)(pc - code));
+    }
+#endif
+
+  failed:
+    fflush(stdout);
+    printf("Decaf runtime error: %s\n", error);
+  finished:
+    fflush(stdout);
+    if (GetOption("gc-stats")) heap.PrintStats(stderr);
+    free(frames);
+    free(stack);
+    free(globals);
+    return error ? 1 : 0;
+}
@@ -0,0 +1,45 @@
+/* File: vm.h
+ * ----------
+ * The virtual machine behind dcc --run, which interprets the bytecode
+ * of a program (see bytecode.h).
+ *
+ * Registers, globals, fields and array elements all hold Values. An
+ * object is a run of Values whose first holds its BcClass and the rest
+ * its fields; an array is its length followed by its elements; a string
+ * is a NUL-terminated char array with its length and hash in front
+ * (see dstring.h). Objects and arrays live in a heap
+ * with a generational garbage collector (see heap.h), which finds the
+ * references on the register stack by the stack maps of the bytecode.
+ *
+ * Calls don't recurse in C. A call pushes a frame and gives the callee
+ * the registers right after those of the caller on a single register
+ * stack, with the arguments copied into its first registers; a return
+ * pops the frame. Where the C++ compiler supports it, dispatch goes
+ * through a table of label addresses (computed goto), so each handler
+ * jumps straight to the next one; elsewhere, or when built with
+ * -DNO_COMPUTED_GOTO, it is a plain switch.
+ *
+ * Runtime errors (subscripts out of bounds, array sizes below 1, null
+ * dereferences, division by zero, running out of stack) print a
+ * message and stop the program, as the MIPS runtime of the projects
+ * does.
+ */
+
+#ifndef _H_vm
+#define _H_vm
+
+#include <stdio.h>
+
+struct BcProgram;
+
+
+/* Function: RunProgram()
+ * ----------------------
+ * Runs the main function of the program, which must have one.
+ * ReadInteger and ReadLine read from input, or see the end of input if
+ * it is NULL. Output goes to stdout. Returns 0 if the program ran to
+ * the end and 1 if it stopped on a runtime error.
+ */
+int RunProgram(BcProgram *program, FILE *input);
+
+#endif
@@ -0,0 +1,791 @@
+/* File: x86.cc
+ * ------------
+ * Implementation of the x86-64 code generator.
+ */
+
+#include "x86.h"
+#include "tac.h"
+#include "regalloc.h"
+#include "dstring.h"
+#include "utility.h"
+#include <stdarg.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+
+typedef enum {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15,
+    XMM0, XMM14 = XMM0 + 14, XMM15 = XMM0 + 15,
+    RIP     // only as the base of a Loc
+} Register;
+
+static const char *const Names64[] = {
+    "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+    "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"
+};
+static const char *const Names32[] = {
+    "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
+    "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"
+};
+static const Register IntArgRegs[] = { RDI, RSI, RDX, RCX, R8, R9 };
+static const int NumIntArgRegs = 6, NumDoubleArgRegs = 8;
+static const Register CalleeSaved[] = { RBX, R12, R13, R14, R15 };
+static const int NumCalleeSaved = 5;
+
+// Codes passed to _DecafError by the stubs, see runtime.c
+static const int BoundsError = 0, DivisionError = 1;
+
+
+/* Struct: Loc
+ * -----------
+ * Where a value is, as an operand: a register, memory at base + offset
+ * (plus 8 * index when there is an index register, or relative to a
+ * label when base is RIP), an immediate, or the address of a label.
+ */
+struct Loc {
+    enum { Reg, Mem, Imm, Addr } type;
+    int reg, base, index, offset;
+    long imm;
+    const char *label;
+
+    static Loc InReg(int r)  { Loc l = Loc(); l.type = Reg; l.reg = r; return l; }
+    static Loc AtMem(int base, int offset, int index = -1)
+        { Loc l = Loc(); l.type = Mem; l.base = base; l.offset = offset; l.index = index; return l; }
+    static Loc AtLabel(const char *label, int offset = 0)
+        { Loc l = AtMem(RIP, offset); l.label = label; return l; }
+    static Loc Immediate(long value) { Loc l = Loc(); l.type = Imm; l.imm = value; return l; }
+    static Loc AddressOf(const char *label) { Loc l = Loc(); l.type = Addr; l.label = label; return l; }
+
+    bool IsReg(int r) const { return type == Reg && reg == r; }
+    bool operator==(const Loc &o) const {
+        return type == o.type && reg == o.reg && base == o.base && index == o.index
+            && offset == o.offset && imm == o.imm
+            && (label == o.label || (label && o.label && strcmp(label, o.label) == 0));
+    }
+};
+
+// One of the moves that have to happen together before a call or on entry
+struct Move {
+    Loc dst, src;
+    ValueKind kind;
+};
+
+
+class X86Emitter
+{
+  private:
+    FILE *out;
+    TacProgram *code;
+    RegisterPool pools[NumRegisterClasses];
+    std::unordered_map<const char*, int> strings;   // number of each pooled literal
+    List<double> doubles;
+    int numLabels;               // for the local labels of sequences
+
+    TacFunction *fn;             // being emitted
+    int fnIndex;
+    Allocation alloc;
+    List<int> saved;             // callee-saved registers fn uses
+    List<int> uses;              // how many times each temporary is read
+
+    void Emit(const char *format, ...);
+    std::string Operand(const Loc &l, ValueKind kind);
+    ValueKind KindOf(int temp) { return fn->tempKinds.Nth(temp); }
+    Loc TempLoc(int temp);
+    Loc InReg(int temp, int scratch);
+    const char *Suffix(ValueKind kind) { return kind == V_Int ? "l" : "q"; }
+    const char *BlockLabel(BasicBlock *b);
+
+    void MoveTo(const Loc &dst, const Loc &src, ValueKind kind);
+    void ParallelMove(List<Move> *moves);
+    void ArgLocations(ValueKind *kinds, int n, bool incoming, List<Loc> *locs, int *stackBytes);
+    void SetUpCall(Instr *instr);
+    void CallRuntime(const char *name, List<Move> *args);
+    void SaveResult(Instr *instr, ValueKind kind);
+
+    void EmitBinary(const char *op, Instr *instr);
+    void EmitDoubleBinary(const char *op, Instr *instr);
+    void EmitDivision(Instr *instr);
+    void EmitCompare(Instr *instr);
+    void EmitDoubleCompare(Instr *instr);
+    void EmitBranch(const char *cc, const char *negated, BasicBlock *ifTrue,
+                    BasicBlock *ifFalse, BasicBlock *next);
+    void EmitInstr(Instr *instr, BasicBlock *next);
+    void EmitEpilogue();
+    void EmitFunction(TacFunction *f, int index);
+    void EmitData();
+
+  public:
+    X86Emitter(TacProgram *c, FILE *fp);
+    void EmitProgram();
+};
+
+
+X86Emitter::X86Emitter(TacProgram *c, FILE *fp) {
+    code = c;
+    out = fp;
+    numLabels = 0;
+    fn = NULL;
+    fnIndex = 0;
+    for (int i = 0; i < code->strings.NumElements(); i++)
+        strings[code->strings.Nth(i)] = i;
+    // Registers that don't take arguments come first, so values are
+    // less often in the way of the moves before a call
+    int general[] = { R10, RSI, RDI, R8, R9, RCX };
+    for (int r : general) pools[RC_General].Add(r, false);
+    for (int r : CalleeSaved) pools[RC_General].Add(r, true);
+    for (int i = 13; i >= 0; i--) pools[RC_Double].Add(XMM0 + i, false);
+}
+
+void X86Emitter::Emit(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    if (format[strlen(format) - 1] != ':') fputc('\t', out);
+    vfprintf(out, format, args);
+    va_end(args);
+    fputc('\n', out);
+}
+
+static std::string RegName(int r, ValueKind kind) {
+    if (r >= XMM0) return "%xmm" + std::to_string(r - XMM0);
+    return std::string("%") + (kind == V_Int ? Names32[r] : Names64[r]);
+}
+
+std::string X86Emitter::Operand(const Loc &l, ValueKind kind) {
+    switch (l.type) {
+      case Loc::Reg: return RegName(l.reg, kind);
+      case Loc::Imm: return "$" + std::to_string(l.imm);
+      case Loc::Addr: return std::string(l.label) + "(%rip)";
+      default: break;
+    }
+    if (l.base == RIP)
+        return std::string(l.label) + (l.offset ? "+" + std::to_string(l.offset) : "") + "(%rip)";
+    std::string s = (l.offset ? std::to_string(l.offset) : "") + "(%" + Names64[l.base];
+    if (l.index >= 0) s += std::string(",%") + Names64[l.index] + ",8";
+    return s + ")";
+}
+
+Loc X86Emitter::TempLoc(int temp) {
+    if (alloc.InRegister(temp)) return Loc::InReg(alloc.reg.Nth(temp));
+    Assert(alloc.IsSpilled(temp));
+    return Loc::AtMem(RBP, -8 * (saved.NumElements() + alloc.slot.Nth(temp) + 1));
+}
+
+// The temporary in a register: its own, or scratch loaded from its slot
+Loc X86Emitter::InReg(int temp, int scratch) {
+    Loc l = TempLoc(temp);
+    if (l.type == Loc::Reg) return l;
+    MoveTo(Loc::InReg(scratch), l, KindOf(temp));
+    return Loc::InReg(scratch);
+}
+
+const char *X86Emitter::BlockLabel(BasicBlock *b) {
+    static char buf[32];
+    sprintf(buf, ".L%d_%d", fnIndex, b->id);
+    return buf;
+}
+
+
+/* Moves
+ * -----
+ * ints move as 32 bits, which clears the top half of a register, so an
+ * int in a register is always zero-extended.
+ */
+
+void X86Emitter::MoveTo(const Loc &dst, const Loc &src, ValueKind kind) {
+    if (dst == src) return;
+    bool toMem = (dst.type == Loc::Mem);
+    // A program the checker let through with mixed kinds still assembles
+    bool xmm = (src.type == Loc::Reg && src.reg >= XMM0) || (dst.type == Loc::Reg && dst.reg >= XMM0);
+    bool gpr = (src.type == Loc::Reg && src.reg < XMM0) || (dst.type == Loc::Reg && dst.reg < XMM0);
+    if (xmm && gpr) {
+        Emit("movq %s, %s", Operand(src, V_Ref).c_str(), Operand(dst, V_Ref).c_str());
+        return;
+    }
+    if (kind == V_Double) {
+        if (toMem && src.type == Loc::Mem) {
+            Emit("movsd %s, %%xmm14", Operand(src, kind).c_str());
+            Emit("movsd %%xmm14, %s", Operand(dst, kind).c_str());
+        } else {
+            Emit("movsd %s, %s", Operand(src, kind).c_str(), Operand(dst, kind).c_str());
+        }
+        return;
+    }
+    if (src.type == Loc::Addr) {
+        Loc r = toMem ? Loc::InReg(RDX) : dst;
+        Emit("leaq %s, %s", Operand(src, V_Ref).c_str(), Operand(r, V_Ref).c_str());
+        if (toMem) Emit("movq %%rdx, %s", Operand(dst, V_Ref).c_str());
+    } else if (src.type == Loc::Imm) {
+        // movl zero-extends into a register; a 64-bit move of a negative
+        // immediate would sign-extend
+        if (toMem && kind != V_Int)
+            Emit("movq %s, %s", Operand(src, kind).c_str(), Operand(dst, kind).c_str());
+        else
+            Emit("movl %s, %s", Operand(src, V_Int).c_str(), Operand(dst, V_Int).c_str());
+    } else if (toMem && src.type == Loc::Mem) {
+        Emit("mov%s %s, %s", Suffix(kind), Operand(src, kind).c_str(), RegName(RDX, kind).c_str());
+        Emit("mov%s %s, %s", Suffix(kind), RegName(RDX, kind).c_str(), Operand(dst, kind).c_str());
+    } else {
+        Emit("mov%s %s, %s", Suffix(kind), Operand(src, kind).c_str(), Operand(dst, kind).c_str());
+    }
+}
+
+// Performs moves that happen at once, so a register can be the source
+// of one and the destination of another. Stores to memory come first,
+// while every source is intact; the register moves are then ordered so
+// none overwrites a source still needed, going through a scratch
+// register to break cycles.
+void X86Emitter::ParallelMove(List<Move> *moves) {
+    List<Move> pending;
+    for (Move &m : *moves) {
+        if (m.dst.type != Loc::Mem) {
+            if (!(m.dst == m.src)) pending.Append(m);
+        } else if (m.kind != V_Double && m.src.type == Loc::Mem) {
+            // Not through rdx, which may hold an argument
+            MoveTo(Loc::InReg(R11), m.src, m.kind);
+            MoveTo(m.dst, Loc::InReg(R11), m.kind);
+        } else {
+            MoveTo(m.dst, m.src, m.kind);
+        }
+    }
+    while (pending.NumElements()) {
+        int ready = -1;
+        for (int i = 0; i < pending.NumElements() && ready < 0; i++) {
+            bool needed = false;
+            for (Move &m : pending)
+                needed |= m.src.IsReg(pending.Nth(i).dst.reg);
+            if (!needed) ready = i;
+        }
+        if (ready >= 0) {
+            Move m = pending.Nth(ready);
+            MoveTo(m.dst, m.src, m.kind);
+            pending.RemoveAt(ready);
+            continue;
+        }
+        Move first = pending.Nth(0);
+        int reg = first.src.reg;
+        Loc scratch = Loc::InReg(reg >= XMM0 ? XMM15 : R11);
+        MoveTo(scratch, first.src, first.kind == V_Int ? V_Ref : first.kind);
+        for (Move &m : pending)
+            if (m.src.IsReg(reg)) m.src = scratch;
+    }
+}
+
+// Where arguments of the given kinds are passed; incoming ones on the
+// stack are found above the saved rbp and the return address
+void X86Emitter::ArgLocations(ValueKind *kinds, int n, bool incoming, List<Loc> *locs, int *stackBytes) {
+    int numInt = 0, numDouble = 0, stack = 0;
+    for (int i = 0; i < n; i++) {
+        if (kinds[i] == V_Double && numDouble < NumDoubleArgRegs)
+            locs->Append(Loc::InReg(XMM0 + numDouble++));
+        else if (kinds[i] != V_Double && numInt < NumIntArgRegs)
+            locs->Append(Loc::InReg(IntArgRegs[numInt++]));
+        else {
+            locs->Append(incoming ? Loc::AtMem(RBP, 16 + stack) : Loc::AtMem(RSP, stack));
+            stack += 8;
+        }
+    }
+    if (stackBytes) *stackBytes = stack;
+}
+
+void X86Emitter::SetUpCall(Instr *instr) {
+    List<ValueKind> kinds;
+    for (int i = 0; i < instr->numArgs; i++)
+        kinds.Append(KindOf(instr->args[i]));
+    List<Loc> locs;
+    ArgLocations(kinds.begin(), instr->numArgs, false, &locs, NULL);
+    List<Move> moves;
+    for (int i = 0; i < instr->numArgs; i++) {
+        Move m = { locs.Nth(i), TempLoc(instr->args[i]), kinds.Nth(i) };
+        moves.Append(m);
+    }
+    ParallelMove(&moves);
+}
+
+void X86Emitter::CallRuntime(const char *name, List<Move> *args) {
+    ParallelMove(args);
+    Emit("call %s", name);
+}
+
+// Moves the result of the call just made into the destination of instr
+void X86Emitter::SaveResult(Instr *instr, ValueKind kind) {
+    if (instr->dst == NoTemp) return;
+    MoveTo(TempLoc(instr->dst), Loc::InReg(kind == V_Double ? XMM0 : RAX), kind);
+}
+
+
+/* Instructions
+ * ------------
+ */
+
+// Any instruction that may call a function in the runtime or elsewhere
+static bool CallsOut(Instr *instr) {
+    return instr->IsCall() || instr->op == OP_NewObject || instr->op == OP_NewArray
+        || instr->op == OP_StrEq || instr->op == OP_StrNe;
+}
+
+// dst = a op b on ints, in dst itself when that doesn't overwrite b first
+void X86Emitter::EmitBinary(const char *op, Instr *instr) {
+    Loc d = TempLoc(instr->dst), a = TempLoc(instr->a), b = TempLoc(instr->b);
+    Loc work = (d.type == Loc::Reg && !(d == b)) ? d : Loc::InReg(RAX);
+    MoveTo(work, a, V_Int);
+    Emit("%sl %s, %s", op, Operand(b, V_Int).c_str(), Operand(work, V_Int).c_str());
+    MoveTo(d, work, V_Int);
+}
+
+void X86Emitter::EmitDoubleBinary(const char *op, Instr *instr) {
+    Loc d = TempLoc(instr->dst), a = TempLoc(instr->a), b = TempLoc(instr->b);
+    Loc work = (d.type == Loc::Reg && !(d == b)) ? d : Loc::InReg(XMM14);
+    MoveTo(work, a, V_Double);
+    Emit("%ssd %s, %s", op, Operand(b, V_Double).c_str(), Operand(work, V_Double).c_str());
+    MoveTo(d, work, V_Double);
+}
+
+// Division by zero stops the program; dividing by -1 is done by hand,
+// since idiv faults on the one quotient that overflows
+void X86Emitter::EmitDivision(Instr *instr) {
+    bool mod = (instr->op == OP_Mod);
+    int label = numLabels;
+    numLabels += 2;
+    MoveTo(Loc::InReg(RAX), TempLoc(instr->a), V_Int);
+    MoveTo(Loc::InReg(R11), TempLoc(instr->b), V_Int);
+    Emit("testl %%r11d, %%r11d");
+    Emit("je _decaf_division_error");
+    Emit("cmpl $-1, %%r11d");
+    Emit("jne .LS%d", label);
+    Emit(mod ? "xorl %%eax, %%eax" : "negl %%eax");
+    Emit("jmp .LS%d", label + 1);
+    Emit(".LS%d:", label);
+    Emit("cltd");
+    Emit("idivl %%r11d");
+    if (mod) Emit("movl %%edx, %%eax");
+    Emit(".LS%d:", label + 1);
+    MoveTo(TempLoc(instr->dst), Loc::InReg(RAX), V_Int);
+}
+
+static const char *const ConditionCodes[] = { "e", "ne", "l", "le", "g", "ge" };
+static const char *const NegatedCodes[] = { "ne", "e", "ge", "g", "le", "l" };
+
+// Sets the flags for a (int or reference) comparison of a with b
+static ValueKind CompareKind(Instr *instr, TacFunction *fn) {
+    bool refs = fn->tempKinds.Nth(instr->a) == V_Ref || fn->tempKinds.Nth(instr->b) == V_Ref;
+    return refs ? V_Ref : V_Int;
+}
+
+void X86Emitter::EmitCompare(Instr *instr) {
+    ValueKind kind = CompareKind(instr, fn);
+    Loc a = InReg(instr->a, RAX);
+    Emit("cmp%s %s, %s", Suffix(kind), Operand(TempLoc(instr->b), kind).c_str(), Operand(a, kind).c_str());
+    Emit("set%s %%al", ConditionCodes[instr->op - OP_Eq]);
+    Emit("movzbl %%al, %%eax");
+    MoveTo(TempLoc(instr->dst), Loc::InReg(RAX), V_Int);
+}
+
+// ucomisd leaves the carry flag set for "below" and for unordered
+// operands (NaN), so every test is phrased as above/above-or-equal,
+// which is false for NaN as it should be
+void X86Emitter::EmitDoubleCompare(Instr *instr) {
+    int k = instr->op - OP_FEq;
+    bool swap = (instr->op == OP_FLt || instr->op == OP_FLe);
+    int first = swap ? instr->b : instr->a, second = swap ? instr->a : instr->b;
+    Loc x = InReg(first, XMM14);
+    Emit("ucomisd %s, %s", Operand(TempLoc(second), V_Double).c_str(), Operand(x, V_Double).c_str());
+    switch (k) {
+      case 0: Emit("sete %%al"); Emit("setnp %%dl"); Emit("andb %%dl, %%al"); break;
+      case 1: Emit("setne %%al"); Emit("setp %%dl"); Emit("orb %%dl, %%al"); break;
+      case 2: case 4: Emit("seta %%al"); break;
+      default: Emit("setae %%al"); break;
+    }
+    Emit("movzbl %%al, %%eax");
+    MoveTo(TempLoc(instr->dst), Loc::InReg(RAX), V_Int);
+}
+
+// Jumps on condition code cc to ifTrue and otherwise to ifFalse, the
+// flags having been set, falling through to next where possible
+void X86Emitter::EmitBranch(const char *cc, const char *negated, BasicBlock *ifTrue,
+                            BasicBlock *ifFalse, BasicBlock *next) {
+    if (ifTrue == next) {
+        cc = negated;
+        ifTrue = ifFalse;
+        ifFalse = next;
+    }
+    Emit("j%s %s", cc, BlockLabel(ifTrue));
+    if (ifFalse != next) Emit("jmp %s", BlockLabel(ifFalse));
+}
+
+// An int comparison whose result only feeds the branch right after it
+// is done by the branch
+static bool FusesWithBranch(Instr *instr, List<int> *uses) {
+    Instr *next = instr->next;
+    return instr->op >= OP_Eq && instr->op <= OP_Ge && next && next->op == OP_Branch
+        && next->a == instr->dst && uses->Nth(instr->dst) == 1;
+}
+
+static const char *const BuiltinFunctions[NumBuiltins] = {
+    "_PrintInt", "_PrintBool", "_PrintString",
+    "_ReadInteger", "_ReadLine"
+};
+
+void X86Emitter::EmitInstr(Instr *instr, BasicBlock *next) {
+    char label[64];
+    List<Move> args;
+    switch (instr->op) {
+      case OP_LoadInt:
+        MoveTo(TempLoc(instr->dst), Loc::Immediate(instr->intValue), V_Int);
+        break;
+      case OP_LoadNull:
+        MoveTo(TempLoc(instr->dst), Loc::Immediate(0), V_Ref);
+        break;
+      case OP_LoadDouble:
+        sprintf(label, ".LD%d", doubles.NumElements());
+        doubles.Append(instr->doubleValue);
+        MoveTo(TempLoc(instr->dst), Loc::AtLabel(strdup(label)), V_Double);
+        break;
+      case OP_LoadString:
+        Assert(strings.count(instr->text));
+        sprintf(label, ".LT%d", strings[instr->text]);
+        MoveTo(TempLoc(instr->dst), Loc::AddressOf(strdup(label)), V_Ref);
+        break;
+      case OP_Move:
+        MoveTo(TempLoc(instr->dst), TempLoc(instr->a), KindOf(instr->dst));
+        break;
+
+      case OP_Add: EmitBinary("add", instr); break;
+      case OP_Sub: EmitBinary("sub", instr); break;
+      case OP_Mul: EmitBinary("imul", instr); break;
+      case OP_Div: case OP_Mod: EmitDivision(instr); break;
+      case OP_Neg:
+        MoveTo(Loc::InReg(RAX), TempLoc(instr->a), V_Int);
+        Emit("negl %%eax");
+        MoveTo(TempLoc(instr->dst), Loc::InReg(RAX), V_Int);
+        break;
+      case OP_FAdd: EmitDoubleBinary("add", instr); break;
+      case OP_FSub: EmitDoubleBinary("sub", instr); break;
+      case OP_FMul: EmitDoubleBinary("mul", instr); break;
+      case OP_FDiv: EmitDoubleBinary("div", instr); break;
+      case OP_FNeg:
+        MoveTo(Loc::InReg(XMM14), TempLoc(instr->a), V_Double);
+        Emit("xorpd .LSignBit(%%rip), %%xmm14");
+        MoveTo(TempLoc(instr->dst), Loc::InReg(XMM14), V_Double);
+        break;
+      case OP_Eq: case OP_Ne: case OP_Lt: case OP_Le: case OP_Gt: case OP_Ge:
+        EmitCompare(instr);
+        break;
+      case OP_FEq: case OP_FNe: case OP_FLt: case OP_FLe: case OP_FGt: case OP_FGe:
+        EmitDoubleCompare(instr);
+        break;
+      case OP_StrEq: case OP_StrNe: {
+        Move a = { Loc::InReg(RDI), TempLoc(instr->a), V_Ref };
+        Move b = { Loc::InReg(RSI), TempLoc(instr->b), V_Ref };
+        args.Append(a);
+        args.Append(b);
+        CallRuntime("_StringEqual", &args);
+        if (instr->op == OP_StrNe) Emit("xorl $1, %%eax");
+        SaveResult(instr, V_Int);
+        break;
+      }
+      case OP_Not:
+        MoveTo(Loc::InReg(RAX), TempLoc(instr->a), V_Int);
+        Emit("xorl $1, %%eax");
+        MoveTo(TempLoc(instr->dst), Loc::InReg(RAX), V_Int);
+        break;
+
+      case OP_LoadGlobal:
+        MoveTo(TempLoc(instr->dst), Loc::AtLabel("_decaf_globals", 8 * instr->intValue), KindOf(instr->dst));
+        break;
+      case OP_StoreGlobal:
+        MoveTo(Loc::AtLabel("_decaf_globals", 8 * instr->intValue), TempLoc(instr->a), KindOf(instr->a));
+        break;
+      case OP_LoadField: {
+        // A bool field is a single byte
+        Loc object = InReg(instr->a, R11);
+        Loc field = Loc::AtMem(object.reg, instr->cls->fieldOffsets.Nth(instr->intValue));
+        if (instr->cls->fieldSizes.Nth(instr->intValue) == 1) {
+            Emit("movzbl %s, %%eax", Operand(field, V_Int).c_str());
+            MoveTo(TempLoc(instr->dst), Loc::InReg(RAX), V_Int);
+        } else {
+            MoveTo(TempLoc(instr->dst), field, KindOf(instr->dst));
+        }
+        break;
+      }
+      case OP_StoreField: {
+        Loc object = InReg(instr->a, R11);
+        Loc field = Loc::AtMem(object.reg, instr->cls->fieldOffsets.Nth(instr->intValue));
+        if (instr->cls->fieldSizes.Nth(instr->intValue) == 1) {
+            MoveTo(Loc::InReg(RAX), TempLoc(instr->b), V_Int);
+            Emit("movb %%al, %s", Operand(field, V_Int).c_str());
+        } else {
+            MoveTo(field, TempLoc(instr->b), KindOf(instr->b));
+        }
+        break;
+      }
+      case OP_LoadElem: {
+        Loc array = InReg(instr->a, R11);
+        MoveTo(Loc::InReg(RAX), TempLoc(instr->b), V_Int);
+        MoveTo(TempLoc(instr->dst), Loc::AtMem(array.reg, 8, RAX), KindOf(instr->dst));
+        break;
+      }
+      case OP_StoreElem: {
+        Loc array = InReg(instr->a, R11);
+        MoveTo(Loc::InReg(RAX), TempLoc(instr->b), V_Int);
+        MoveTo(Loc::AtMem(array.reg, 8, RAX), TempLoc(instr->c), KindOf(instr->c));
+        break;
+      }
+      case OP_ArrayLength: {
+        Loc array = InReg(instr->a, R11);
+        MoveTo(TempLoc(instr->dst), Loc::AtMem(array.reg, 0), V_Int);
+        break;
+      }
+      case OP_CheckBounds: {
+        // A negative index is a huge one once zero-extended, so a single
+        // unsigned comparison catches both ends
+        Loc array = InReg(instr->a, R11);
+        MoveTo(Loc::InReg(RAX), TempLoc(instr->b), V_Int);
+        Emit("cmpq (%%%s), %%rax", Names64[array.reg]);
+        Emit("jae _decaf_bounds_error");
+        break;
+      }
+      case OP_CheckNull: {
+        // Reading through null faults, like any other dereference
+        Loc object = InReg(instr->a, R11);
+        Emit("cmpb $0, (%%%s)", Names64[object.reg]);
+        break;
+      }
+      case OP_NewObject: {
+        sprintf(label, "_vt_%s", instr->cls->name);
+        Move size = { Loc::InReg(RDI), Loc::Immediate(instr->cls->size), V_Int };
+        Move vtable = { Loc::InReg(RSI), Loc::AddressOf(label), V_Ref };
+        args.Append(size);
+        args.Append(vtable);
+        CallRuntime("_AllocObject", &args);
+        SaveResult(instr, V_Ref);
+        break;
+      }
+      case OP_NewArray: {
+        Move length = { Loc::InReg(RDI), TempLoc(instr->a), V_Int };
+        args.Append(length);
+        CallRuntime("_AllocArray", &args);
+        SaveResult(instr, V_Ref);
+        break;
+      }
+
+      case OP_Call:
+        SetUpCall(instr);
+        Emit("call _D_%s", instr->callee->name);
+        SaveResult(instr, instr->dst == NoTemp ? V_Int : KindOf(instr->dst));
+        break;
+      case OP_CallVirtual:
+        SetUpCall(instr);   // the receiver is now in rdi
+        Emit("movq (%%rdi), %%rax");
+        Emit("call *%d(%%rax)", 8 * (1 + instr->intValue));
+        SaveResult(instr, instr->dst == NoTemp ? V_Int : KindOf(instr->dst));
+        break;
+      case OP_CallInterface:
+        SetUpCall(instr);
+        Emit("movq (%%rdi), %%rax");
+        Emit("movq (%%rax), %%rax");
+        Emit("call *%d(%%rax)", 8 * instr->intValue);
+        SaveResult(instr, instr->dst == NoTemp ? V_Int : KindOf(instr->dst));
+        break;
+      case OP_CallBuiltin:
+        SetUpCall(instr);
+        Emit("call %s", BuiltinFunctions[instr->intValue]);
+        SaveResult(instr, instr->dst == NoTemp ? V_Int : KindOf(instr->dst));
+        break;
+
+      case OP_Jump:
+        if (instr->target[0] != next) Emit("jmp %s", BlockLabel(instr->target[0]));
+        break;
+      case OP_Branch:
+        if (instr->prev && FusesWithBranch(instr->prev, &uses)) {
+            Instr *test = instr->prev;
+            ValueKind kind = CompareKind(test, fn);
+            Loc a = InReg(test->a, RAX);
+            Emit("cmp%s %s, %s", Suffix(kind), Operand(TempLoc(test->b), kind).c_str(),
+                 Operand(a, kind).c_str());
+            int k = test->op - OP_Eq;
+            EmitBranch(ConditionCodes[k], NegatedCodes[k], instr->target[0], instr->target[1], next);
+        } else {
+            Emit("cmpl $0, %s", Operand(TempLoc(instr->a), V_Int).c_str());
+            EmitBranch("ne", "e", instr->target[0], instr->target[1], next);
+        }
+        break;
+      case OP_Switch: {
+        // The table follows the code and holds the distance of each
+        // target from the table, so it needs no relocations
+        JumpTable *table = instr->table;
+        int label = numLabels++;
+        MoveTo(Loc::InReg(RAX), TempLoc(instr->a), V_Int);
+        if (table->low) Emit("subl $%d, %%eax", table->low);
+        Emit("cmpl $%d, %%eax", table->size);
+        Emit("jae %s", BlockLabel(instr->target[0]));
+        Emit("leaq .LS%d(%%rip), %%rdx", label);
+        Emit("movslq (%%rdx,%%rax,4), %%rax");
+        Emit("addq %%rdx, %%rax");
+        Emit("jmp *%%rax");
+        Emit(".p2align 2");
+        Emit(".LS%d:", label);
+        for (int i = 0; i < table->size; i++)
+            Emit(".long %s-.LS%d", BlockLabel(table->targets[i]), label);
+        break;
+      }
+      case OP_Return:
+        if (instr->a != NoTemp) {
+            ValueKind kind = KindOf(instr->a);
+            MoveTo(Loc::InReg(kind == V_Double ? XMM0 : RAX), TempLoc(instr->a), kind);
+        }
+        EmitEpilogue();
+        break;
+      default:
+        Failure("No x86 code for %s", OpcodeNames[instr->op]);
+    }
+}
+
+
+/* Functions
+ * ---------
+ * The frame holds the callee-saved registers fn uses, pushed below the
+ * saved rbp, then the spill slots and, at the bottom, room for the
+ * arguments of the calls that don't fit in registers. Its size keeps rsp
+ * 16-byte aligned at every call, as the convention requires.
+ */
+
+void X86Emitter::EmitEpilogue() {
+    int n = saved.NumElements();
+    if (n) Emit("leaq %d(%%rbp), %%rsp", -8 * n);
+    else Emit("movq %%rbp, %%rsp");
+    for (int i = n - 1; i >= 0; i--)
+        Emit("popq %%%s", Names64[saved.Nth(i)]);
+    Emit("popq %%rbp");
+    Emit("ret");
+}
+
+void X86Emitter::EmitFunction(TacFunction *f, int index) {
+    fn = f;
+    fnIndex = index;
+    AllocateRegisters(f, pools, CallsOut, &alloc);
+
+    saved = List<int>();
+    for (int r : CalleeSaved)
+        for (int t = 0; t < f->NumTemps(); t++)
+            if (alloc.reg.Nth(t) == r) {
+                saved.Append(r);
+                break;
+            }
+    uses = List<int>();
+    for (int t = 0; t < f->NumTemps(); t++) uses.Append(0);
+    int outgoing = 0;
+    for (BasicBlock *b : f->blocks)
+        for (Instr *instr = b->first; instr; instr = instr->next) {
+            instr->ForEachUse([&](int &t) { uses.begin()[t]++; });
+            if (instr->IsCall()) {
+                List<ValueKind> kinds;
+                for (int i = 0; i < instr->numArgs; i++) kinds.Append(KindOf(instr->args[i]));
+                List<Loc> locs;
+                int stack;
+                ArgLocations(kinds.begin(), instr->numArgs, false, &locs, &stack);
+                if (stack > outgoing) outgoing = stack;
+            }
+        }
+    int frame = 8 * alloc.numSlots + outgoing;
+    if ((8 * saved.NumElements() + frame) % 16) frame += 8;
+
+    fprintf(out, "\n_D_%s:\n", f->name);
+    Emit("pushq %%rbp");
+    Emit("movq %%rsp, %%rbp");
+    for (int r : saved) Emit("pushq %%%s", Names64[r]);
+    if (frame) Emit("subq $%d, %%rsp", frame);
+
+    // The parameters that are used move from where they arrive
+    List<Loc> locs;
+    ArgLocations(f->tempKinds.begin(), f->numParams, true, &locs, NULL);
+    List<Move> moves;
+    for (int t = 0; t < f->numParams; t++)
+        if (alloc.InRegister(t) || alloc.IsSpilled(t)) {
+            Move m = { TempLoc(t), locs.Nth(t), KindOf(t) };
+            moves.Append(m);
+        }
+    ParallelMove(&moves);
+
+    int numBlocks = f->blocks.NumElements();
+    for (int i = 0; i < numBlocks; i++) {
+        BasicBlock *b = f->blocks.Nth(i);
+        BasicBlock *next = (i + 1 < numBlocks) ? f->blocks.Nth(i+1) : NULL;
+        fprintf(out, "%s:\n", BlockLabel(b));
+        for (Instr *instr = b->first; instr; instr = instr->next)
+            if (!FusesWithBranch(instr, &uses))
+                EmitInstr(instr, next);
+    }
+}
+
+
+/* Data
+ * ----
+ */
+
+static void EmitString(FILE *out, const char *s) {
+    fputs("\t.string \"", out);
+    for (; *s; s++) {
+        unsigned char c = *s;
+        if (c == '"' || c == '\\') fprintf(out, "\\%c", c);
+        else if (c == '\n') fputs("\\n", out);
+        else if (c == '\t') fputs("\\t", out);
+        else if (c < ' ' || c >= 127) fprintf(out, "\\%03o", c);
+        else fputc(c, out);
+    }
+    fputs("\"\n", out);
+}
+
+void X86Emitter::EmitData() {
+    fputs("\n\t.section .rodata\n", out);
+    // Each string is preceded by its length and hash (see dstring.h)
+    for (int i = 0; i < code->strings.NumElements(); i++) {
+        const char *text = code->strings.Nth(i);
+        size_t length = strlen(text);
+        fprintf(out, "\t.align 8\n\t.long %zu, %u\n.LT%d:\n", length, HashString(text, length), i);
+        EmitString(out, text);
+    }
+    Emit(".align 16");
+    Emit(".LSignBit:");
+    Emit(".quad 0x8000000000000000, 0");
+    for (int i = 0; i < doubles.NumElements(); i++) {
+        double d = doubles.Nth(i);
+        unsigned long long bits;
+        memcpy(&bits, &d, sizeof(bits));
+        fprintf(out, ".LD%d:\n\t.quad 0x%llx\n", i, bits);
+    }
+
+    fputs("\n\t.data\n\t.align 8\n", out);
+    int numSelectors = code->selectorNames.NumElements();
+    for (ClassLayout *cls : code->classes) {
+        fprintf(out, "_vt_%s:\n\t.quad _sel_%s\n", cls->name, cls->name);
+        for (TacFunction *m : cls->vtable)
+            fprintf(out, "\t.quad _D_%s\n", m->name);
+        fprintf(out, "_sel_%s:\n", cls->name);
+        for (int s = 0; s < numSelectors; s++) {
+            int slot = cls->SlotForSelector(s);
+            if (slot >= 0) fprintf(out, "\t.quad _D_%s\n", cls->vtable.Nth(slot)->name);
+            else fputs("\t.quad 0\n", out);
+        }
+    }
+    int numGlobals = code->globalKinds.NumElements();
+    fputs("\n\t.bss\n\t.align 8\n_decaf_globals:\n", out);
+    fprintf(out, "\t.zero %d\n", 8 * (numGlobals ? numGlobals : 1));
+    fputs("\n\t.section .note.GNU-stack,\"\",@progbits\n", out);
+}
+
+void X86Emitter::EmitProgram() {
+    fputs("# Generated by dcc --asm; link with runtime.c\n", out);
+    fputs("\t.text\n\t.globl _D_main\n", out);
+    // The runtime reports errors with rsp aligned, as C expects
+    fprintf(out, "\n_decaf_bounds_error:\n\tandq $-16, %%rsp\n\tmovl $%d, %%edi\n\tcall _DecafError\n", BoundsError);
+    fprintf(out, "_decaf_division_error:\n\tandq $-16, %%rsp\n\tmovl $%d, %%edi\n\tcall _DecafError\n", DivisionError);
+    for (int i = 0; i < code->functions.NumElements(); i++)
+        EmitFunction(code->functions.Nth(i), i);
+    EmitData();
+}
+
+
+void EmitX86(TacProgram *code, FILE *out) {
+    X86Emitter emitter(code, out);
+    emitter.EmitProgram();
+}
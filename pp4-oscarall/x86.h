@@ -0,0 +1,47 @@
+/* File: x86.h
+ * -----------
+ * Native code generation: translates the lowered program (see tac.h)
+ * into x86-64 assembly for Linux, in the AT&T syntax the GNU assembler
+ * reads (dcc --asm). The output is linked with the small C runtime in
+ * runtime.c, which provides main, the built-in functions and
+ * allocation:
+ *
+ *   dcc --asm < prog.decaf > prog.s && cc -o prog prog.s runtime.c
+ *
+ * Functions follow the System V calling convention, so Decaf code and
+ * the runtime call each other directly: ints, bools and references go
+ * in rdi, rsi, rdx, rcx, r8 and r9, doubles in xmm0-xmm7, the rest on
+ * the stack, and the receiver of a method is its first argument. ints
+ * are 32 bits wide and everything else 64, but every global, array
+ * element and spill slot takes 8 bytes.
+ *
+ * Temporaries are assigned registers by linear scan (see regalloc.h).
+ * rax, rdx, r11, xmm14 and xmm15 are never assigned; they are the
+ * scratch registers that instruction sequences and the moves around
+ * calls work with.
+ *
+ * Objects and arrays are laid out much as in the VM: an object starts
+ * with the address of the vtable of its class, and an array with its
+ * length. The fields of an object are packed, though, a bool taking a
+ * byte and an int four, at the offsets of its ClassLayout (see tac.h). A vtable starts with the address of a table indexed by
+ * method selector, through which interface calls find their method,
+ * followed by the methods in slot order. Subscripts are checked inline;
+ * null dereferences fault and are reported by the runtime.
+ */
+
+#ifndef _H_x86
+#define _H_x86
+
+#include <stdio.h>
+
+struct TacProgram;
+
+
+/* Function: EmitX86()
+ * -------------------
+ * Writes the assembly of the whole program, which must have a main, to
+ * out.
+ */
+void EmitX86(TacProgram *code, FILE *out);
+
+#endif
@@ -0,0 +1,217 @@
+#!/bin/bash
+#
+# File: runtests.sh
+# -----------------
+# Golden-output regression harness shared by all the stages. It is run
+# from a stage's Makefile with the stage directory as first argument,
+# and works on that stage's ./dcc and samples directory. Every sample
+# (*.frag, *.decaf) is fed to the compiler on stdin once for each golden
+# file it has, and the combined stdout/stderr is compared against that
+# file with diff -w, the same way the projects are graded:
+#
+#   sample.out       plain dcc (the diagnostics, or the parse tree in pp2)
+#   sample.run.out   dcc --run, the output of the program itself
+#   sample.tac.out   dcc -d tac, the three-address code
+#
+# The error messages end in a NUL character (see errors.cc), which is
+# dropped before comparing so diff treats the output as text.
+#
+#   runtests.sh <stage> check      diff every sample against its golden files
+#   runtests.sh <stage> bench      check, and also time every sample and compare
+#                                  the timings against samples/bench_baseline.csv,
+#                                  which baseline must have written first
+#   runtests.sh <stage> baseline   bench, then store the timings as the new baseline
+#   runtests.sh <stage> run        execute the programs named in RUN_SAMPLES (default
+#                                  those with a .run.out file) with dcc --run, check
+#                                  their output and time them, to benchmark the VM
+#   runtests.sh <stage> native     compile the RUN_SAMPLES programs with dcc --asm,
+#                                  link them with runtime.c using $CC (default cc),
+#                                  check their output and time them against the VM
+#
+# A golden file named in samples/known_failures (one per line, followed
+# by the reason) records a known gap of the stage: its mismatch is shown
+# as XFAIL and does not fail the run. One that starts to match is shown
+# as XPASS and does fail, so the entry gets removed.
+#
+# Timings are written to samples/bench.csv as "sample,usec" lines. Each
+# sample is run BENCH_RUNS times (default 5) and the fastest run is kept.
+# A sample regresses when it is slower than its baseline by more than
+# BENCH_TOLERANCE percent (default 25) plus BENCH_SLACK usecs (default
+# 2000, so start-up noise on the tiny samples does not fail the build).
+# Any output mismatch or timing regression makes the script exit non-zero.
+# Timings depend on the machine, so no baseline is committed: run
+# `make bench-baseline` once on a known-good tree before `make bench`,
+# which refuses to run without one.
+
+if [ $# -lt 1 ] || [ ! -d "$1" ]; then
+  echo "Usage: $0 <stage-dir> [check|bench|baseline|run|native]"
+  exit 2
+fi
+cd "$1" || exit 2
+
+COMPILER=./dcc
+SAMPLES=samples
+RESULTS=$SAMPLES/bench.csv
+BASELINE=$SAMPLES/bench_baseline.csv
+KNOWN=$SAMPLES/known_failures
+RUNS=${BENCH_RUNS:-5}
+TOLERANCE=${BENCH_TOLERANCE:-25}
+SLACK=${BENCH_SLACK:-2000}
+FLAGS=
+
+mode=${2:-check}
+case $mode in
+  check|bench|baseline|run|native) ;;
+  *) echo "Usage: $0 <stage-dir> [check|bench|baseline|run|native]"; exit 2 ;;
+esac
+
+if [ ! -x $COMPILER ]; then
+  echo "$COMPILER not found in $1, run make first"
+  exit 2
+fi
+
+if [ $mode = bench ] && [ ! -f $BASELINE ]; then
+  echo "$BASELINE not found in $1, run make bench-baseline first"
+  exit 2
+fi
+
+if [ -z "$RUN_SAMPLES" ]; then
+  for golden in $SAMPLES/*.run.out; do
+    [ -f "$golden" ] && RUN_SAMPLES="$RUN_SAMPLES $(basename "$golden" .run.out)"
+  done
+fi
+
+output=$(mktemp)
+native=$(mktemp -d)
+trap 'rm -rf $output $native' EXIT
+
+# Prints the wall-clock time of one compiler run on the given sample in
+# usecs. The bash time builtin is used so this works the same on Linux
+# and Mac OS (whose date has no nanosecond format).
+time_one() {
+  local TIMEFORMAT=%R secs
+  secs=$( { time $COMPILER $FLAGS < "$1" > /dev/null 2>&1; } 2>&1 )
+  awk -v s="$secs" 'BEGIN { printf "%d", s * 1000000 }'
+}
+
+# Fastest of RUNS timings for the given sample.
+time_sample() {
+  local best= t i
+  for ((i = 0; i < RUNS; i++)); do
+    t=$(time_one "$1")
+    if [ -z "$best" ] || [ "$t" -lt "$best" ]; then best=$t; fi
+  done
+  echo $best
+}
+
+failed=0
+checked=0
+
+# Compares the output collected in $output against the golden file and
+# reports the outcome, taking the known failures into account. Returns
+# non-zero if it counts as a failure.
+compare() {
+  local golden=$1 name=$(basename "$1") known=
+  # The reason, plus a "." so that an entry without one still counts
+  [ -f $KNOWN ] && known=$(awk -v n="$name" '$1 == n { sub(/^[^ \t]+[ \t]*/, ""); print $0 "." }' $KNOWN)
+  checked=$((checked + 1))
+  if diff -w $output "$golden" > /dev/null; then
+    if [ -z "$known" ]; then
+      echo "PASS  $name"
+      return 0
+    fi
+    echo "XPASS $name (matches now, remove it from $KNOWN)"
+  elif [ -n "$known" ]; then
+    echo "XFAIL $name (known: ${known%.})"
+    return 0
+  else
+    echo "FAIL  $name (output differs)"
+    diff -w $output "$golden" | head -20 | sed 's/^/      /'
+  fi
+  failed=$((failed + 1))
+  return 1
+}
+
+# Runs the compiler with the given flags on the sample, without NULs.
+collect() {
+  local sample=$1; shift
+  $COMPILER "$@" < "$sample" 2>&1 | tr -d '\000' > $output
+}
+
+# Each program has to print its .run.out; then it is timed.
+if [ $mode = run ]; then
+  FLAGS=--run
+  for name in $RUN_SAMPLES; do
+    sample=$SAMPLES/$name.decaf
+    collect "$sample" --run
+    compare $SAMPLES/$name.run.out || continue
+    echo "RUN   $name.decaf $(time_sample "$sample")us"
+  done
+  echo "$failed programs failed"
+  [ $failed -eq 0 ]
+  exit
+fi
+
+# Each program is compiled to an executable, which has to print the
+# .run.out too; it and the VM then read their input from /dev/null
+# while timed.
+if [ $mode = native ]; then
+  for name in $RUN_SAMPLES; do
+    sample=$SAMPLES/$name.decaf
+    exe=$native/$name
+    if ! $COMPILER --asm < "$sample" > $exe.s 2> $output ||
+       ! ${CC:-cc} -O2 -o $exe $exe.s runtime.c > $output 2>&1; then
+      echo "FAIL  $name.decaf (does not compile)"
+      tail -5 $output | sed 's/^/      /'
+      failed=$((failed + 1))
+      continue
+    fi
+    $exe < /dev/null 2>&1 | tr -d '\000' > $output
+    compare $SAMPLES/$name.run.out || continue
+    FLAGS=--run
+    vm=$(time_sample "$sample")
+    COMPILER=$exe FLAGS=
+    echo "RUN   $name.decaf vm ${vm}us, native $(time_sample /dev/null)us"
+    COMPILER=./dcc
+  done
+  echo "$failed programs failed"
+  [ $failed -eq 0 ]
+  exit
+fi
+
+[ $mode != check ] && : > $RESULTS
+
+for sample in $SAMPLES/*.frag $SAMPLES/*.decaf; do
+  [ -f "$sample" ] || continue
+  name=$(basename "$sample")
+  stem=${sample%.*}
+
+  [ -f $stem.run.out ] && { collect "$sample" --run; compare $stem.run.out; }
+  [ -f $stem.tac.out ] && { collect "$sample" -d tac; compare $stem.tac.out; }
+  [ -f $stem.out ] || continue
+  collect "$sample"
+  compare $stem.out
+
+  [ $mode = check ] && continue
+  usec=$(time_sample "$sample")
+  echo "$name,$usec" >> $RESULTS
+
+  [ $mode = baseline ] && continue
+  base=$(awk -F, -v n="$name" '$1 == n { print $2 }' $BASELINE 2>/dev/null)
+  if [ -z "$base" ]; then
+    echo "TIME  $name ${usec}us (no baseline)"
+  elif [ $usec -gt $((base + base * TOLERANCE / 100 + SLACK)) ]; then
+    echo "SLOW  $name ${usec}us, baseline ${base}us"
+    failed=$((failed + 1))
+  else
+    echo "TIME  $name ${usec}us, baseline ${base}us"
+  fi
+done
+
+if [ $mode = baseline ]; then
+  cp $RESULTS $BASELINE
+  echo "Stored timings of $(wc -l < $BASELINE | tr -d ' ') samples in $BASELINE"
+fi
+
+echo "$checked outputs checked, $failed failures"
+[ $failed -eq 0 ]